@@ -12,7 +12,20 @@
         "src/input_wrapper.cpp",
         "src/shared_buffer.cpp",
         "src/audio_manager.cpp",
-        "src/audio_wrapper.cpp"
+        "src/audio_wrapper.cpp",
+        "src/atlas_file.cpp",
+        "src/atlas_metadata.cpp",
+        "src/worker_pool.cpp",
+        "src/pixel_ops.cpp",
+        "src/raster.cpp",
+        "src/bitmap_font.cpp",
+        "src/text_layout.cpp",
+        "src/truetype_font.cpp",
+        "src/resample.cpp",
+        "src/noise.cpp",
+        "src/image_filter.cpp",
+        "src/color_grade.cpp",
+        "src/vector_path.cpp"
       ],
       "include_dirs": [
         "<!@(node -p \"require('node-addon-api').include\")",
@@ -21,7 +34,7 @@
       ],
       "conditions": [
         ["OS=='win'", {
-          "sources": [ "src/console_win.cpp" ],
+          "sources": [ "src/console_win.cpp", "src/mapped_file_win.cpp" ],
           "include_dirs": [
             "C:/vcpkg/installed/x64-windows/include"
           ],
@@ -39,7 +52,7 @@
           }
         }],
         ["OS=='linux'", {
-          "sources": [ "src/console_posix.cpp" ],
+          "sources": [ "src/console_posix.cpp", "src/mapped_file_posix.cpp" ],
           "libraries": [
             "-lraylib",
             "-lGL",
@@ -53,7 +66,7 @@
           "cflags_cc!": ["-fno-exceptions"]
         }],
         ["OS=='mac'", {
-          "sources": [ "src/console_posix.cpp" ],
+          "sources": [ "src/console_posix.cpp", "src/mapped_file_posix.cpp" ],
           "libraries": [ 
               "-lraylib",
               "-framework Foundation",
@@ -73,6 +86,37 @@
         }]
       ],
       "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ]
+    },
+    {
+      "target_name": "native_tests",
+      "type": "executable",
+      "sources": [
+        "tests/image_filter_test.cpp",
+        "src/image_filter.cpp",
+        "src/worker_pool.cpp"
+      ],
+      "include_dirs": [
+        "<(module_root_dir)/include"
+      ],
+      "conditions": [
+        ["OS=='win'", {
+          "msvs_settings": {
+            "VCCLCompilerTool": {
+              "ExceptionHandling": 1,
+              "AdditionalOptions": ["/std:c++20"]
+            }
+          }
+        }],
+        ["OS=='linux'", {
+          "libraries": [ "-lpthread" ],
+          "cflags_cc!": ["-fno-exceptions"]
+        }],
+        ["OS=='mac'", {
+          "xcode_settings": {
+            "OTHER_CPLUSPLUSFLAGS": ["-std=c++17"]
+          }
+        }]
+      ]
     }
   ]
 }
\ No newline at end of file
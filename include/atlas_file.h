@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Precompiled atlas (.tatlas) layout:
+//
+//   [TAtlasHeader][AtlasFrame x frameCount][palette][pad][pixel rows]
+//
+// The palette (256 RGBA entries) is only present for ATLAS_FORMAT_INDEXED8.
+// Pixel rows start on a TATLAS_ROW_ALIGN boundary and every row is padded to
+// `stride` bytes, so a mapped file can be blitted from directly (mmap keeps
+// the file offset alignment since mappings are page aligned).
+
+#define TATLAS_MAGIC 0x534C5441u // "ATLS" little endian
+#define TATLAS_VERSION 1
+#define TATLAS_ROW_ALIGN 64
+#define TATLAS_EXTENSION ".tatlas"
+
+enum AtlasPixelFormat : uint32_t
+{
+    ATLAS_FORMAT_RGBA8 = 0,
+    ATLAS_FORMAT_INDEXED8 = 1, // 1 byte palette index per pixel
+};
+
+#define ATLAS_PALETTE_SIZE 256
+
+// header flags
+#define TATLAS_FLAG_OPAQUE (1u << 0)       // every pixel has alpha 255
+#define TATLAS_FLAG_OPACITY_KNOWN (1u << 1) // TATLAS_FLAG_OPAQUE is meaningful
+
+// frame flags
+#define ATLAS_FRAME_OPAQUE (1u << 0)  // no transparent pixels inside the trimmed rect
+#define ATLAS_FRAME_ROTATED (1u << 1) // stored rotated 90deg clockwise in the sheet
+#define ATLAS_FRAME_EMPTY (1u << 2)   // fully transparent, nothing to draw
+
+struct AtlasFrame
+{
+    uint32_t x, y, w, h;       // trimmed rect inside the atlas
+    int32_t trimX, trimY;      // offset of the trimmed rect inside the source frame
+    uint32_t sourceW, sourceH; // untrimmed frame size
+    uint32_t flags;
+    uint32_t _pad;
+};
+
+struct TAtlasHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride; // bytes per pixel row, multiple of TATLAS_ROW_ALIGN
+    uint32_t format; // AtlasPixelFormat
+    uint32_t flags;
+    uint32_t frameCount;
+    uint64_t frameOffset;
+    uint64_t pixelOffset;
+    uint64_t pixelBytes;
+    uint64_t sourceSize;  // cache key: size of the source image
+    int64_t sourceMtime;  // cache key: last write time of the source image
+    uint64_t paletteOffset; // 256 x RGBA8, indexed atlases only
+    uint64_t reserved[6];   // keep header at 128 bytes
+};
+
+static_assert(sizeof(AtlasFrame) == 40, "AtlasFrame is part of the on-disk format");
+static_assert(sizeof(TAtlasHeader) == 128, "TAtlasHeader is part of the on-disk format");
+
+// Returns the header if data holds a complete, supported atlas file whose
+// non-empty frames all lie inside the pixel rect
+const TAtlasHeader *ValidateAtlasFile(const uint8_t *data, size_t size);
+
+// true when the area the frame covers in the sheet (w and h swapped for
+// rotated frames) lies inside width x height
+bool AtlasFrameInside(const AtlasFrame &frame, uint32_t width, uint32_t height);
+
+// palette is required (ATLAS_PALETTE_SIZE entries) when format is ATLAS_FORMAT_INDEXED8
+bool WriteAtlasFile(const std::string &path, const uint8_t *pixels, uint32_t width, uint32_t height,
+                    uint32_t srcStride, const std::vector<AtlasFrame> &frames, uint32_t flags,
+                    uint64_t sourceSize, int64_t sourceMtime,
+                    AtlasPixelFormat format = ATLAS_FORMAT_RGBA8, const uint32_t *palette = nullptr);
+
+inline uint32_t AtlasBytesPerPixel(uint32_t format)
+{
+    return format == ATLAS_FORMAT_INDEXED8 ? 1u : 4u;
+}
+
+// size + mtime of a source file, used as the cache key
+bool GetAtlasSourceKey(const std::string &path, uint64_t &size, int64_t &mtime);
+
+// where the cached copy of `sourcePath` lives (next to it when cacheDir is empty)
+std::string GetAtlasCachePath(const std::string &sourcePath, const std::string &cacheDir);
+
+// fills trim rect, trim offset and opacity flags for a frame covering
+// (frame.x, frame.y, frame.w, frame.h) of an RGBA8 image
+void ComputeFrameTrim(const uint8_t *pixels, uint32_t stride, AtlasFrame &frame);
+
+bool ScanOpaque(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t stride);
+bool ScanOpaqueIndexed(const uint8_t *indices, uint32_t width, uint32_t height, uint32_t stride,
+                       const uint32_t *palette);
+
+// Exact palette extraction: succeeds only if the RGBA8 image has at most 256
+// distinct colours. Palette entries hold the RGBA bytes in memory order, the
+// unused tail is zeroed. Fully transparent pixels all map to one entry.
+bool BuildIndexedPixels(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t stride,
+                        std::vector<uint8_t> &indices, uint32_t *palette, uint32_t &colorCount);
+
+// 2x2 box filter, alpha weighted so transparent texels don't darken edges.
+// dst is tightly packed RGBA8, dstW = (srcW + 1) / 2, dstH = (srcH + 1) / 2:
+// an odd last row/column keeps its own texel instead of being dropped
+void DownsampleBox2x(const uint8_t *src, uint32_t srcW, uint32_t srcH, uint32_t srcStride,
+                     uint8_t *dst, uint32_t dstW, uint32_t dstH);
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "atlas_file.h"
+
+// Sprite-sheet metadata (TexturePacker / Aseprite JSON)
+
+struct AtlasAnimation
+{
+    std::string name;
+    std::vector<uint32_t> frames; // indices into the atlas frame table
+    std::vector<float> durations; // seconds per frame, empty: use fps
+    float fps;
+    bool loop;
+
+    AtlasAnimation() : fps(12), loop(true) {}
+};
+
+struct AtlasMetadata
+{
+    std::vector<AtlasFrame> frames;
+    std::vector<std::string> frameNames;
+    std::vector<float> frameDurations; // seconds, 0 when the sheet has none
+    std::vector<AtlasAnimation> animations;
+    std::string image; // meta.image, informational
+};
+
+// Parses TexturePacker (hash or array) and Aseprite exports. `json` is parsed
+// in place and is clobbered. Frame rects come back in sheet space; rotated
+// frames keep their unrotated w/h and carry ATLAS_FRAME_ROTATED.
+bool ParseAtlasMetadata(std::string &json, AtlasMetadata &out, std::string &error);
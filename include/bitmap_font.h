@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "text_layout.h"
+
+// Bitmap fonts: a grid of glyph cells in an atlas, laid out natively
+
+struct FontGlyph
+{
+    uint32_t x, y, w, h; // cell rect in the atlas
+    float advance;       // pen advance, charSpacing included
+};
+
+struct BitmapFontConfig
+{
+    uint32_t cellsPerRow = 16;
+    uint32_t cellsPerColumn = 16;
+    uint32_t cellWidth = 32;
+    uint32_t cellHeight = 32;
+    uint32_t offsetX = 0; // first cell in the atlas
+    uint32_t offsetY = 0;
+    std::string charOrder; // UTF-8, one codepoint per cell; empty: CP437 order
+    float lineHeight = 0;  // 0: cellHeight
+    float lineGap = 0;     // extra space between lines
+    float charSpacing = 0; // extra space between characters
+    std::vector<float> advances; // per cell, overrides cellWidth (proportional fonts)
+    std::vector<std::pair<std::string, float>> kerning; // two-character pair -> adjustment
+};
+
+// Text layout is cached per (string, maxWidth, align), so static text only
+// pays for a hash lookup once it has been laid out.
+class BitmapFont
+{
+public:
+    bool Build(const BitmapFontConfig &config, uint32_t atlasWidth, uint32_t atlasHeight, std::string &error);
+
+    // Units are unscaled font pixels; maxWidth <= 0 disables wrapping.
+    // The reference stays valid until the next Layout call.
+    const TextLayout &Layout(const std::string &text, float maxWidth, TextAlign align);
+
+    const FontGlyph &Glyph(uint32_t index) const { return glyphs_[index]; }
+    float LineHeight() const { return metrics_.lineHeight; }
+
+private:
+    int32_t Find(uint32_t codepoint) const;
+    float Kerning(uint32_t left, uint32_t right) const;
+
+    std::vector<FontGlyph> glyphs_;
+    int32_t ascii_[128]; // codepoint -> glyph, -1: missing
+    std::unordered_map<uint32_t, uint32_t> codepoints_; // everything above ASCII
+    std::unordered_map<uint64_t, float> kerning_;       // (left << 32 | right) glyph pair
+    int32_t fallback_ = -1; // '?' if the font has it
+    TextMetrics metrics_ = {};
+    TextLayoutCache layouts_;
+};
+
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Colour grading of straight-alpha RGBA8 rows: a 4x5 colour matrix or a 3D
+// lookup table. Both are baked into per-byte tables up front, so a row
+// costs a few table loads and vector adds per pixel.
+
+#define COLOR_LUT_MAX_SIZE 128
+
+enum LutInterpolation : uint32_t
+{
+    LUT_TETRAHEDRAL = 0, // 4 lattice points, the usual for grading LUTs
+    LUT_TRILINEAR = 1,   // 8 lattice points
+};
+
+// SVG feColorMatrix layout: rows r', g', b', a'; columns r, g, b, a and an
+// offset, colours in 0..1
+struct ColorMatrix
+{
+    float m[20];
+};
+
+ColorMatrix IdentityColorMatrix();
+ColorMatrix SaturationColorMatrix(float amount);  // 0 grey, 1 unchanged
+ColorMatrix HueRotateColorMatrix(float degrees);
+ColorMatrix SepiaColorMatrix(float amount);       // 0 unchanged, 1 full sepia
+ColorMatrix MultiplyColorMatrix(const ColorMatrix &after, const ColorMatrix &before);
+
+// what Renderer::CreateColorGrade builds: a LUT from cubePath or lutSize^3
+// RGB triples when either is set, the matrix otherwise
+struct ColorGradeConfig
+{
+    ColorMatrix matrix = IdentityColorMatrix();
+    std::string cubePath;
+    uint32_t lutSize = 0;
+    std::vector<float> lut;
+    LutInterpolation interpolation = LUT_TETRAHEDRAL;
+};
+
+class ColorGrade
+{
+public:
+    void SetMatrix(const ColorMatrix &matrix);
+    // size^3 RGB triples, red varying fastest (.cube order), outputs in 0..1;
+    // domain maps input 0..1 onto the lattice (null: 0..1)
+    bool SetLut(uint32_t size, const float *rgb, LutInterpolation interpolation, std::string &error,
+                const float *domainMin = nullptr, const float *domainMax = nullptr);
+    // Adobe / Resolve .cube, 3D tables only
+    bool LoadCube(const std::string &path, LutInterpolation interpolation, std::string &error);
+
+    // count pixels from src to dst (may be the same row); LUTs keep alpha
+    void ApplyRow(const uint8_t *src, uint8_t *dst, size_t count) const;
+
+    bool IsLut() const { return lut_size_ != 0; }
+    uint32_t LutSize() const { return lut_size_; }
+
+private:
+    void ApplyMatrixRow(const uint8_t *src, uint8_t *dst, size_t count) const;
+    void ApplyLutRow(const uint8_t *src, uint8_t *dst, size_t count) const;
+
+    // matrix: per channel and byte value, that input's share of the output
+    // pixel (offset folded into red), 0..255 scale
+    std::vector<float> matrix_table_;
+
+    // lut: entries padded to 4 floats, 0..255 scale
+    uint32_t lut_size_ = 0;
+    LutInterpolation interpolation_ = LUT_TETRAHEDRAL;
+    std::vector<float> lut_;
+    uint32_t offset_[3][256]; // per channel and byte value: lattice offset of the cell
+    float frac_[3][256];      // and the position inside it
+};
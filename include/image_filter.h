@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+#include "worker_pool.h"
+
+// Blurs and small convolutions over RGBA8 regions, on premultiplied colour
+// so transparent pixels don't darken what they're blurred into. Blurs run
+// in two passes over rows, each writing its result transposed, so both the
+// horizontal and the vertical pass read contiguous memory; row bands go
+// across the worker pool.
+
+enum ImageFilterType : uint32_t
+{
+    FILTER_BOX_BLUR = 0,      // running sums, cost independent of radius
+    FILTER_GAUSSIAN_BLUR = 1, // three box passes approximating the Gaussian
+    FILTER_CONVOLVE = 2,      // size x size kernel
+};
+
+#define FILTER_MAX_KERNEL 5
+
+struct ImageFilter
+{
+    ImageFilterType type = FILTER_GAUSSIAN_BLUR;
+    float radius = 4.0f; // box: half width in pixels; gaussian: standard deviation, as in CSS blur()
+
+    // convolution: kernel rows top to bottom, divisor 0 means the kernel
+    // sum (1 when that is 0); bias is added to r, g, b in 0..255 units
+    uint32_t size = 3; // 3 or 5
+    float kernel[FILTER_MAX_KERNEL * FILTER_MAX_KERNEL] = {};
+    float divisor = 0.0f;
+    float bias = 0.0f;
+};
+
+struct FilterImage
+{
+    uint8_t *data;
+    uint32_t stride; // bytes per row
+    uint32_t width, height;
+};
+
+// Filters src into dst, both width x height; dst may be src itself. Edges
+// extend the border pixels. False when the filter can't run (bad kernel
+// size, mismatched images).
+bool ApplyImageFilter(const ImageFilter &filter, const FilterImage &src, const FilterImage &dst, WorkerPool &pool);
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Procedural 2D noise for canvas fills and generated atlases.
+// Time never adds a dimension: it animates the lattice in place (gradients
+// rotate, values oscillate, cell points orbit), so an animated field costs
+// the same as a still one and never just scrolls.
+
+#define NOISE_MAX_OCTAVES 12
+
+enum NoiseType : uint32_t
+{
+    NOISE_PERLIN = 0,
+    NOISE_SIMPLEX = 1,
+    NOISE_VALUE = 2,
+    NOISE_CELLULAR = 3, // distance to the nearest cell point (F1)
+};
+
+enum NoiseFractal : uint32_t
+{
+    NOISE_FBM = 0,        // octaves summed
+    NOISE_RIDGED = 1,     // sharp crests where the noise crosses zero
+    NOISE_TURBULENCE = 2, // octaves of |noise| summed
+};
+
+struct NoiseParams
+{
+    NoiseType type = NOISE_PERLIN;
+    NoiseFractal fractal = NOISE_FBM;
+    uint32_t seed = 0;
+    float scale = 0.01f; // first octave frequency, lattice cells per pixel
+    uint32_t octaves = 4; // 1..NOISE_MAX_OCTAVES
+    float lacunarity = 2.0f; // frequency step per octave
+    float gain = 0.5f;       // amplitude step per octave
+    float offsetX = 0, offsetY = 0; // in pixels, added before scaling
+    float time = 0;
+};
+
+class NoiseGenerator
+{
+public:
+    explicit NoiseGenerator(const NoiseParams &params);
+
+    // values in [0, 1] at (x + i * step, y) for i < count, x and y in pixels.
+    // Const and allocation-free after warm-up, so rows can run on any thread.
+    void Row(float x, float y, float step, uint32_t count, float *out) const;
+
+private:
+    void BaseRow(float x, float y, float step, uint32_t count, float *out) const;
+
+    NoiseParams params_;
+    uint8_t perm_[512];
+    // per lattice hash, at params_.time: gradient / value / cell point
+    float gradX_[256], gradY_[256];
+    float value_[256];
+    float pointX_[256], pointY_[256];
+};
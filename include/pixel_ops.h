@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Span kernels on straight-alpha RGBA8 rows, shared by the compositor and
+// the software drawing paths. SSE2 when the target has it, scalar otherwise;
+// both produce identical results.
+
+enum BlendMode : uint32_t
+{
+    BLEND_NORMAL = 0, // source over
+    BLEND_ADD = 1,
+    BLEND_MULTIPLY = 2,
+    BLEND_SCREEN = 3,
+};
+
+// dst = blend(dst, src) over count pixels, src alpha scaled by opacity (0..255)
+void BlendSpan(uint8_t *dst, const uint8_t *src, size_t count, uint32_t opacity, BlendMode mode);
+
+// dst = rgba (bytes r, g, b, a in memory order) over count pixels
+void FillSpan(uint8_t *dst, uint32_t rgba, size_t count);
+
+// rgba blended source-over, its alpha scaled per pixel by mask (0..255 coverage)
+void BlendMaskSpan(uint8_t *dst, uint32_t rgba, const uint8_t *mask, size_t count);
+
+struct GradientStop
+{
+    float offset; // 0..1
+    uint8_t r, g, b, a;
+};
+
+// 256-entry RGBA ramp through stops sorted by offset; before the first and
+// after the last stop the end colours hold. No stops: transparent.
+void BuildGradientRamp(const GradientStop *stops, size_t count, uint8_t ramp[256 * 4]);
+
+// rounded x / 255 for x in [0, 65535]
+inline uint32_t Div255(uint32_t x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Anti-aliased polygon coverage. Edges deposit the exact signed area they
+// cover into a per-pixel accumulation buffer (the font-rs / stb_truetype
+// scheme); a prefix sum along each row then gives the winding-weighted
+// coverage, folded by the fill rule. Concave, self-intersecting and
+// multi-contour shapes need no special handling.
+
+enum FillRule : uint32_t
+{
+    FILL_NONZERO = 0,
+    FILL_EVENODD = 1,
+};
+
+class CoverageRasterizer
+{
+public:
+    // clears and sizes the area; edge coordinates are relative to its top-left.
+    // Only the cells touched since the last Reset are cleared, so a large,
+    // mostly empty area (a long thin stroke) stays cheap.
+    void Reset(uint32_t width, uint32_t height);
+
+    // one edge of a closed contour, any direction, may leave the area
+    void AddLine(float x0, float y0, float x1, float y1);
+
+    // 0..255 coverage of row y (width() bytes)
+    void ResolveRow(uint32_t y, FillRule rule, uint8_t *coverage) const;
+
+    // Sparse form of ResolveRow: writes only [x0, x1), the columns that can
+    // be non-zero. Nothing winds left of the first touched cell and the
+    // winding is constant right of the last one. False when the row is empty.
+    bool ResolveSpan(uint32_t y, FillRule rule, uint8_t *coverage, uint32_t &x0, uint32_t &x1) const;
+
+    uint32_t Width() const { return width_; }
+    uint32_t Height() const { return height_; }
+
+private:
+    void AddClampedLine(float x0, float y0, float x1, float y1);
+
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    uint32_t stride_ = 0; // width + 2: clamped edges land up to column width + 1
+    std::vector<float> cells_;
+    std::vector<uint32_t> span_lo_; // touched cells per row, lo > hi when none
+    std::vector<uint32_t> span_hi_;
+};
+
+// Rows [rowBegin, rowEnd) of an RGBA canvas. Stroke functions clip to them,
+// so disjoint row ranges can be drawn on different threads while keeping
+// the primitive order within each pixel.
+struct RasterTarget
+{
+    uint8_t *pixels;
+    uint32_t width;
+    int32_t rowBegin;
+    int32_t rowEnd;
+};
+
+// Strokes blend rgba source-over with their coverage; coordinates are canvas
+// pixels (pixel centres at +0.5).
+
+// Wu line up to one pixel wide, coverage scaled by weight (0..1)
+void DrawLineWu(const RasterTarget &t, float x0, float y0, float x1, float y1, uint32_t rgba, float weight);
+
+// wider line with round caps, coverage from the distance to the segment
+void DrawLineThick(const RasterTarget &t, float x0, float y0, float x1, float y1, float thickness, uint32_t rgba);
+
+// ring of the given thickness centred on the radius, or a disc when thickness is 0
+void DrawCircleAA(const RasterTarget &t, float cx, float cy, float radius, float thickness, uint32_t rgba);
@@ -6,7 +6,21 @@
 #include "vector"
 #include <functional>
 #include "shared_buffer.h"
+#include "atlas_file.h"
+#include "atlas_metadata.h"
+#include "worker_pool.h"
+#include "pixel_ops.h"
+#include "raster.h"
+#include "bitmap_font.h"
+#include "truetype_font.h"
+#include "resample.h"
+#include "noise.h"
+#include "image_filter.h"
+#include "color_grade.h"
+#include "vector_path.h"
 #include <thread>
+#include <deque>
+#include <condition_variable>
 #include "napi.h"
 #include <atomic>
 #include <cstdint>
@@ -35,22 +49,75 @@ extern "C" void stbi_image_free(void *retval_from_stbi_load);
 
 #define MAX_DIRTY_REGIONS 256
 
+// Optional extended layout, appended after the legacy region list.
+// Present when CTRL_EXT_MAGIC holds CTRL_EXT_MAGIC_VALUE; the header has
+// CTRL_EXT_HEADER_SLOTS slots (unused ones reserved), then the dirty-tile
+// bitmap: tileRows x wordsPerRow u32, bit (col & 31) of word
+// [row * wordsPerRow + col / 32] marks tile (col, row). Both sides set bits
+// with an atomic OR (Atomics.or in JS), the uploader clears them.
+#define CTRL_LEGACY_SLOTS (CTRL_DIRTY_REGIONS + MAX_DIRTY_REGIONS * 4) // 1039, 4156 bytes
+#define CTRL_EXT_MAGIC (CTRL_LEGACY_SLOTS + 0)
+#define CTRL_EXT_VERSION (CTRL_LEGACY_SLOTS + 1)
+#define CTRL_TILE_SIZE (CTRL_LEGACY_SLOTS + 2) // pixels, 0: tile tracking off
+#define CTRL_TILE_COLS (CTRL_LEGACY_SLOTS + 3)
+#define CTRL_TILE_ROWS (CTRL_LEGACY_SLOTS + 4)
+#define CTRL_TILE_WORDS_PER_ROW (CTRL_LEGACY_SLOTS + 5)
+#define CTRL_WORKER_COUNT (CTRL_LEGACY_SLOTS + 6)   // frame barrier: workers per frame, 0 off
+#define CTRL_WORKER_COMMITS (CTRL_LEGACY_SLOTS + 7) // Atomics.add(…, 1) by each worker when its band is done
+#define CTRL_FRAME_EPOCH (CTRL_LEGACY_SLOTS + 8)    // bumped after every swap
+#define CTRL_EXT_HEADER_SLOTS 16
+#define CTRL_TILE_BITMAP (CTRL_LEGACY_SLOTS + CTRL_EXT_HEADER_SLOTS)
+
+#define CTRL_EXT_MAGIC_VALUE 0x54584543u // "CEXT"
+#define CTRL_EXT_VERSION_VALUE 1
+#define DEFAULT_DIRTY_TILE_SIZE 32
+
+class MappedFile;
+
+#define ATLAS_MAX_MIP_LEVELS 6
+
+// box-filtered copy of an RGBA atlas at 1/2^level size
+struct AtlasMipLevel
+{
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> pixels; // tightly packed RGBA8
+};
+
 struct SpriteAtlas
 {
     uint32_t width;
     uint32_t height;
-    uint8_t *data; // RGBA8 pixel data, owned by this struct
+    uint32_t stride; // bytes per row (width * bpp when decoded, padded when mapped)
+    uint32_t format; // AtlasPixelFormat: RGBA8 or 8-bit palette indices
+    uint8_t *data;   // pixel data, owned by this struct (stb_image, storage or a file mapping)
+    MappedFile *mapping; // set when data points into a mapped .tatlas file
+    std::vector<uint8_t> storage; // backing for data when it was converted after decode
 
-    SpriteAtlas() : width(0), height(0), data(nullptr) {}
+    uint32_t flags;                 // TATLAS_FLAG_* (opacity is cached once known)
+    std::vector<AtlasFrame> frames; // optional frame table (precompiled atlases)
+    std::vector<uint32_t> palette;  // ATLAS_PALETTE_SIZE RGBA entries for indexed atlases
+    std::vector<std::string> frameNames;      // from sprite-sheet metadata, parallel to frames
+    std::vector<AtlasAnimation> animations;   // from sprite-sheet metadata
+    std::string path;               // source the atlas was loaded from
 
-    ~SpriteAtlas()
-    {
-        if (data)
-        {
-            stbi_image_free(data); // Correct way to free stb_image data
-            data = nullptr;
-        }
-    }
+    // mip pyramid, built on first zoomed-out draw when enabled (RGBA atlases only)
+    bool mipmaps;
+    std::vector<AtlasMipLevel> mips;
+
+    // memory budget bookkeeping; data is nullptr while evicted
+    bool indexedRequested;  // reload with the same options
+    bool reloadQueued;      // async reload in flight
+    uint64_t lastUsed;      // LRU clock value of the last draw
+    uint64_t residentBytes; // pixel bytes currently held
+
+    SpriteAtlas() : width(0), height(0), stride(0), format(ATLAS_FORMAT_RGBA8), data(nullptr),
+                    mapping(nullptr), flags(0), mipmaps(false), indexedRequested(false), reloadQueued(false),
+                    lastUsed(0), residentBytes(0) {}
+
+    ~SpriteAtlas();
+
+    void ReleasePixels(); // frees pixel memory, keeps size / frames / path
 
     // prevent accidental copies
     SpriteAtlas(const SpriteAtlas &) = delete;
@@ -65,6 +132,7 @@ struct SpriteAnimation
     uint32_t frameCount;
     float fps;
     bool loop;
+    std::vector<float> durations; // per-frame seconds, empty: 1 / fps
 
     SpriteAnimation() : frames(nullptr), frameCount(0), fps(0), id(0), loop(false) {}
 
@@ -103,7 +171,11 @@ struct AnimatedSprite
     std::unordered_map<uint32_t, SpriteAnimation *> animations; // ID -> anim
     std::unordered_map<std::string, uint32_t> animationNames;   // "idle" -> ID
 
+    // palette override for indexed atlases (empty: use the atlas palette)
+    std::vector<uint32_t> palette;
+
     uint32_t currentAnimationId;
+    uint32_t animFrameIndex; // position inside the current animation
 
     // Animation state (optional, can be driven by JS or C++)
     uint32_t *frameSequence; // Array of frame indices
@@ -118,6 +190,7 @@ struct AnimatedSprite
                        framesPerRow(0), x(0), y(0), rotation(0), scaleX(1), scaleY(1),
                        flipH(0), flipV(0), opaque(0), _pad(0),
                        modR(255), modG(255), modB(255), modA(255),
+                       currentAnimationId(0), animFrameIndex(0),
                        frameSequence(nullptr), frameCount(0), frameTimer(0), fps(12),
                        playing(0), loop(0) {}
 
@@ -143,6 +216,7 @@ struct AnimationDef
     std::vector<uint32_t> frames;
     float fps;
     bool loop;
+    std::vector<float> durations; // optional per-frame seconds
 };
 
 // animator for loose sprites
@@ -226,15 +300,104 @@ struct SharedBufferRefs
 {
     uint8_t *pixel_buffers[3];                  // pointers to JS ArrayBuffers
     uint32_t *control;                          // pointer to control buffer
-    Napi::Reference<Napi::ArrayBuffer> refs[4]; // Keep buffers alive
+    Napi::Reference<Napi::Object> refs[4];      // Keep buffers (or their views) alive
     size_t buffer_size;                         // size of each pixel buffer
+    size_t capacity[4] = {0, 0, 0, 0};          // bytes available behind each pointer
+    bool shared_memory = false;                 // passed as views over SharedArrayBuffers
+    uint32_t slot_count = 3;                    // pixel buffers in use: 3, 2 (swap on commit) or 1 (staged)
     uint32_t width;
     uint32_t height;
     unsigned int texture_id;
+
+    // extended control layout (0 when the buffer uses the legacy layout only)
+    uint32_t ext_version = 0;
+    uint32_t tile_size = 0;
+    uint32_t tile_cols = 0;
+    uint32_t tile_rows = 0;
+    uint32_t tile_words_per_row = 0;
+
+    // automatic dirty detection: copy of what the texture holds, diffed
+    // tile by tile when JS flags a frame without marking any region
+    uint32_t diff_tile_size = 0; // 0: off
+    std::vector<uint8_t> shadow;
+    bool shadow_valid = false;
+
+    // copy-forward: damage of the last two frames, replayed into the slot
+    // JS gets next so incremental drawing sees current pixels
+    bool copy_forward = false;
+    std::vector<DirtyRect> frame_damage; // frame being uploaded
+    std::vector<DirtyRect> prev_damage;  // the one before
+    bool frame_damage_full = false;
+    bool prev_damage_full = false;
+
+    // layer of a compositor target: JS keeps drawing into one slot, the set
+    // is never swapped or uploaded on its own
+    bool composite_source = false;
+
+    // single-slot sets: pixels that changed, copied out at commit and packed
+    // row by row in `staged` order until the upload
+    std::vector<uint8_t> staging;
+    std::vector<DirtyRect> staged;
+
+    // graded on the way to the texture, the canvas keeps its own pixels
+    std::shared_ptr<const ColorGrade> color_grade;
+};
+
+// control buffer bytes needed for a canvas (tileSize 0: legacy layout)
+size_t GetControlBufferSize(uint32_t width, uint32_t height, uint32_t tileSize);
+
+// what happens to existing pixels when a shared buffer set is resized
+enum BufferResizePolicy : uint32_t
+{
+    RESIZE_CLEAR = 0, // transparent black
+    RESIZE_KEEP = 1,  // keep the top-left corner, clear what's new
+    RESIZE_SCALE = 2, // nearest-neighbour scale to the new size
+};
+
+enum GradientType : uint32_t
+{
+    GRADIENT_LINEAR = 0, // from (x0, y0) to (x1, y1)
+    GRADIENT_RADIAL = 1, // centred on (x0, y0), radius r0 to r1
+};
+
+// FillGradient input, points and radii in world space like the filled rect
+struct Gradient
+{
+    GradientType type = GRADIENT_LINEAR;
+    float x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    float r0 = 0, r1 = 0;
+    std::vector<GradientStop> stops; // any order
+};
+
+// floats per DrawLines / DrawCircles record
+#define STROKE_LINE_FLOATS 9
+#define STROKE_CIRCLE_FLOATS 8
+
+// one input of CompositeLayers, listed bottom to top
+struct CompositeLayer
+{
+    size_t bufRefId = 0;
+    int32_t x = 0; // offset in the target
+    int32_t y = 0;
+    uint32_t opacity = 255;
+    BlendMode blend = BLEND_NORMAL;
+    DirtyRect scissor; // target space, empty: no scissor
+    bool visible = true;
 };
 
 using onReziseCallback = std::function<void(int width, int height)>;
 
+struct AtlasMemoryStats
+{
+    uint64_t residentBytes;
+    uint64_t budgetBytes; // 0: unlimited
+    uint64_t evictions;
+    uint64_t reloads;
+    uint32_t atlasCount;
+    uint32_t residentCount;
+    uint32_t pendingReloads;
+};
+
 class Color4
 {
 public:
@@ -250,6 +413,37 @@ public:
     }
 };
 
+// DrawBitmapText / MeasureBitmapText options
+struct TextStyle
+{
+    float scale = 1.0f;
+    float rotation = 0.0f; // radians, about the text origin
+    Color4 tint = Color4(1, 1, 1, 1);
+    float maxWidth = 0.0f; // wrap width at this scale, 0: no wrapping
+    TextAlign align = TEXT_ALIGN_LEFT;
+    bool useCamera = false; // origin in world space, zoom and rotation follow the camera
+};
+
+// DrawPath options: the fill goes down first, the stroke on top, as in canvas
+struct PathPaint
+{
+    PathTransform transform; // path units to canvas pixels, to world space with useCamera
+    bool fill = true;
+    Color4 fillColor = Color4(0, 0, 0, 1);
+    FillRule rule = FILL_NONZERO;
+    bool stroke = false;
+    Color4 strokeColor = Color4(0, 0, 0, 1);
+    StrokeStyle style; // width in path units, scaled with the transform
+    bool useCamera = false;
+};
+
+// a BitmapFont and the atlas its cells live in
+struct FontFace
+{
+    uint32_t atlasId = 0;
+    BitmapFont font;
+};
+
 class Vec2
 {
 public:
@@ -266,12 +460,42 @@ public:
     Renderer();
     ~Renderer();
 
-    uint32_t LoadAtlas(const std::string &path);
+    uint32_t LoadAtlas(const std::string &path, bool indexed = false);
     SpriteAtlas *GetAtlas(uint32_t atlasId);
     uint32_t GetAtlasPixel(SpriteAtlas *atlas, uint32_t x, uint32_t y);
     bool IsAtlasOpaque(SpriteAtlas *atlas);
+    void CopyAtlasPixels(const SpriteAtlas *atlas, uint8_t *dst); // tightly packed RGBA
     void FreeAtlas(uint32_t atlasId);
 
+    // precompiled atlases / decode cache
+    void SetAtlasCache(bool enabled, const std::string &cacheDir);
+    bool CompileAtlas(const std::string &srcPath, const std::string &dstPath,
+                      uint32_t frameWidth, uint32_t frameHeight, bool indexed = false);
+
+    // atlas memory budget: LRU eviction, reload on next use
+    void SetAtlasBudget(uint64_t budgetBytes, bool asyncReload, const Color4 &placeholder);
+    SpriteAtlas *AcquireAtlas(uint32_t atlasId, bool forDraw);
+
+    // mip levels for zoomed-out draws
+    bool SetAtlasMipmaps(uint32_t atlasId, bool enabled);
+    AtlasMemoryStats GetAtlasMemoryStats();
+
+    // filtered resampling: an atlas region into a canvas rect (blended or
+    // copied), or a derived RGBA atlas at a new size where every frame is
+    // resampled on its own so neighbours never bleed in (0 on failure)
+    bool DrawAtlasRegion(size_t bufRefId, uint32_t atlasId, uint32_t sx, uint32_t sy, uint32_t sw, uint32_t sh,
+                         float dx, float dy, float dw, float dh, ResampleFilter filter, bool blend, bool useCamera);
+    uint32_t ResizeAtlas(uint32_t atlasId, uint32_t width, uint32_t height, ResampleFilter filter);
+
+    // sprite-sheet metadata (TexturePacker / Aseprite JSON)
+    uint32_t LoadAtlasWithMetadata(const std::string &imagePath, const std::string &jsonPath, bool indexed = false);
+    uint32_t CreateSpriteFromAtlas(uint32_t atlasId, bool opaque);
+
+    // palette swaps / colour cycling (indexed atlases)
+    bool SetSpritePalette(uint32_t spriteId, const uint32_t *colors, uint32_t count);
+    void ResetSpritePalette(uint32_t spriteId);
+    bool CycleSpritePalette(uint32_t spriteId, uint32_t start, uint32_t count, int32_t shift);
+
     // sprite
     uint32_t CreateSprite(uint32_t atlasId, uint32_t frameWidth, uint32_t frameHeight,
                           uint32_t frameCount, bool opaque);
@@ -370,14 +594,132 @@ public:
     // buffers
     void SwapAllBuffers();
     void ProcessBufferUpdates();
-    void SwapBuffers(size_t bufRefId);
+    bool SwapBuffers(size_t bufRefId); // true if the set was dirty and rotated
+
+    // JS-side commit: sets CTRL_DIRTY_FLAG and wakes the swap thread at once
+    bool CommitFrame(size_t bufRefId);
+    // buffer sets rotated since the last call, so their new write slot can be announced to JS
+    std::vector<size_t> TakeSwappedBuffers();
+    // called on the async swap thread after a pass that rotated a set, so the
+    // host can announce it from its own thread (nullptr: none)
+    void SetSwapListener(std::function<void()> listener);
     void ProcessDirtyRegions(size_t bufRefId, uint32_t buffer_idx);
     void UploadEntireBuffer(size_t bufRefId, uint32_t buffer_idx);
     void UploadRegionToGPU(TextureId texId, uint8_t *pixel_data,
                            uint32_t x, uint32_t y, uint32_t w, uint32_t h,
-                           uint32_t fullWidth, uint32_t fullHeight);
+                           uint32_t fullWidth, uint32_t fullHeight, const ColorGrade *grade = nullptr);
 
     void ProcessPendingRegions(size_t bufRefId);
+
+    // dirty tracking: clamps to the canvas, never drops a region
+    void RecordDirtyRegion(SharedBufferRefs *s, int32_t x, int32_t y, int32_t w, int32_t h);
+    bool TakeDirtyRegions(SharedBufferRefs *s, std::vector<DirtyRect> &regions);
+    bool InitControlLayout(SharedBufferRefs *s, size_t controlBytes, uint32_t tileSize);
+    bool SetAutoDirtyDetection(size_t bufRefId, bool enabled, uint32_t tileSize = DEFAULT_DIRTY_TILE_SIZE);
+    bool SetCopyForward(size_t bufRefId, bool enabled);
+
+    // Splits the canvas into `count` tile-row-aligned bands for worker_threads
+    // and arms the frame barrier (count 0 disarms it). Needs the tile layout.
+    bool AssignWorkerBands(size_t bufRefId, uint32_t count, std::vector<DirtyRect> &bands);
+
+    // Resizes a buffer set in place. pixels[i] / control point at the memory
+    // to use from now on: the current buffers when their capacity suffices,
+    // otherwise fresh ones from the caller. The texture is recreated under
+    // the same id, so bufRefId keeps working for draws.
+    bool ResizeSharedBuffers(size_t bufRefId, uint32_t width, uint32_t height, BufferResizePolicy policy,
+                             uint8_t *const pixels[3], uint32_t *control, size_t controlBytes);
+
+    // shared pool for per-frame pixel work, created on first use
+    WorkerPool &Workers();
+
+    // Software fills into a buffer set's write slot. Rects are in world space
+    // and go through the camera in its control buffer, like sprites; colours
+    // with alpha blend source-over, clears replace. The filled area is
+    // recorded dirty, big fills are split across the worker pool.
+    bool FillRect(size_t bufRefId, float x, float y, float w, float h, const Color4 &color);
+    bool ClearRect(size_t bufRefId, float x, float y, float w, float h);
+    bool FillGradient(size_t bufRefId, float x, float y, float w, float h, const Gradient &gradient);
+    // Anti-aliased polygon fill, concave or self-intersecting. points holds
+    // x, y pairs; contours the point count of each closed contour (empty: all
+    // points form one). World space through the camera when useCamera is set,
+    // canvas pixels otherwise.
+    bool FillPolygon(size_t bufRefId, const float *points, size_t pointCount, const std::vector<uint32_t> &contours,
+                     const Color4 &color, FillRule rule, bool useCamera);
+
+    // Batched anti-aliased strokes, one call for thousands of primitives.
+    // Line records are x0, y0, x1, y1, thickness, r, g, b, a; circle records
+    // cx, cy, radius, thickness (0: filled), r, g, b, a (colour 0..1). Lines
+    // up to one pixel wide are Wu lines, wider ones get round caps.
+    bool DrawLines(size_t bufRefId, const float *records, size_t count, bool useCamera);
+    bool DrawCircles(size_t bufRefId, const float *records, size_t count, bool useCamera);
+
+    // Bitmap fonts over a grid atlas. UTF-8 text is drawn straight into the
+    // write slot; upright untinted text uses the sprite blitters. Layouts are
+    // cached per string and wrap width, so static text skips layout.
+    uint32_t CreateBitmapFont(uint32_t atlasId, const BitmapFontConfig &config); // 0 on failure
+    void FreeBitmapFont(uint32_t fontId);
+    bool MeasureBitmapText(uint32_t fontId, const std::string &text, const TextStyle &style,
+                           float &width, float &height, uint32_t &lines);
+    bool DrawBitmapText(uint32_t fontId, size_t bufRefId, const std::string &text, float x, float y,
+                        const TextStyle &style);
+
+    // TrueType fonts. Glyphs are rasterized per pixel size on first use into
+    // a packed coverage atlas and blended with the tint as a mask, so text
+    // stays crisp at any size. Rotation is not applied; pixelSize is scaled
+    // by style.scale and, in camera mode, the zoom.
+    uint32_t LoadTrueTypeFont(const std::string &path); // 0 on failure
+    void FreeTrueTypeFont(uint32_t fontId);
+    bool MeasureTrueTypeText(uint32_t fontId, const std::string &text, float pixelSize, const TextStyle &style,
+                             float &width, float &height, uint32_t &lines);
+    bool DrawTrueTypeText(uint32_t fontId, size_t bufRefId, const std::string &text, float x, float y,
+                          float pixelSize, const TextStyle &style);
+    bool GetTrueTypeFontStats(uint32_t fontId, TrueTypeStats &stats);
+
+    // Procedural noise coloured through stops (any order, none: black to
+    // white), rows split across the worker pool. FillNoise samples in the
+    // rect's own pixels, so the pattern moves and zooms with it; advancing
+    // params.time animates in place.
+    bool FillNoise(size_t bufRefId, float x, float y, float w, float h, const NoiseParams &params,
+                   const std::vector<GradientStop> &stops);
+    uint32_t CreateNoiseAtlas(uint32_t width, uint32_t height, const NoiseParams &params,
+                              const std::vector<GradientStop> &stops); // 0 on failure
+
+    // Blur / convolution of a canvas region in canvas pixels (clipped to the
+    // canvas). The result goes back in place, or to (dstX, dstY) in
+    // dstBufRefId's write slot when that is another canvas or position.
+    bool FilterCanvas(size_t bufRefId, int32_t x, int32_t y, uint32_t w, uint32_t h, const ImageFilter &filter,
+                      size_t dstBufRefId, int32_t dstX, int32_t dstY);
+    // Filters every frame on its own, so neighbours never bleed into each
+    // other. In place only for generated RGBA atlases (nothing to reload
+    // them from), otherwise into a new atlas. Returns the filtered atlas id,
+    // 0 on failure.
+    uint32_t FilterAtlas(uint32_t atlasId, const ImageFilter &filter, bool inPlace);
+
+    // Colour grades (4x5 matrix or 3D LUT). ApplyColorGrade rewrites a canvas
+    // region in place; SetCanvasColorGrade grades every upload of the canvas
+    // instead, dirty rects only, fused with the copy to the texture. Freeing
+    // a grade doesn't detach it from canvases still using it.
+    uint32_t CreateColorGrade(const ColorGradeConfig &config); // 0 on failure
+    bool FreeColorGrade(uint32_t gradeId);
+    bool ApplyColorGrade(size_t bufRefId, uint32_t gradeId, int32_t x, int32_t y, uint32_t w, uint32_t h);
+    bool SetCanvasColorGrade(size_t bufRefId, uint32_t gradeId); // 0 clears
+
+    // Vector paths from PathVerb command streams: curves, fills (nonzero or
+    // even-odd) and strokes with joins and caps. A path handle caches its
+    // coverage per transform and style (translations to a quarter pixel), so
+    // a static icon rasterizes once per scale and redraws are a masked blend.
+    // DrawPathCommands rasterizes a one-off stream straight into the canvas.
+    uint32_t CreatePath(const float *commands, size_t count); // 0 on failure
+    bool DestroyPath(uint32_t pathId);
+    bool DrawPath(size_t bufRefId, uint32_t pathId, const PathPaint &paint);
+    bool DrawPathCommands(size_t bufRefId, const float *commands, size_t count, const PathPaint &paint);
+
+    // CPU layer compositor: blends the layers' changed areas into the target's
+    // write slot and marks them dirty, so the target uploads once per frame.
+    // Layers that neither drew nor changed config cost nothing.
+    bool SetCompositeLayers(size_t targetId, const std::vector<CompositeLayer> &layers);
+    int CompositeLayers(size_t targetId); // rects composited, -1 on a bad target
+
     void PartialTextureUpdate(size_t bufRefId, uint32_t x, uint32_t y, uint32_t w, uint32_t h);
 
     void StartAsyncBufferProcessing();
@@ -397,6 +739,120 @@ private:
     std::unordered_map<uint32_t, SpriteAtlas *> atlases_;
     uint32_t next_atlas_id_ = 1;
     std::mutex atlas_mutex_;
+    // cache settings, guarded by atlas_reload_mutex_ (the loader thread reads them)
+    bool atlas_cache_enabled_ = false;
+    std::string atlas_cache_dir_; // empty: cache next to the source image
+
+    SpriteAtlas *MapAtlasFile(const std::string &path, uint64_t sourceSize, int64_t sourceMtime, bool checkKey);
+    SpriteAtlas *DecodeAtlas(const std::string &path);
+    SpriteAtlas *LoadAtlasPixels(const std::string &path, bool indexed);
+    bool IndexAtlas(SpriteAtlas *atlas);
+    uint32_t RegisterAtlas(SpriteAtlas *atlas);
+
+    // budget / LRU state, guarded by atlas_mutex_
+    uint64_t atlas_budget_ = 0;
+    uint64_t atlas_resident_bytes_ = 0;
+    uint64_t atlas_use_clock_ = 0;
+    uint64_t atlas_evictions_ = 0;
+    uint64_t atlas_reloads_ = 0;
+    bool atlas_async_reload_ = false;
+    Color atlas_placeholder_ = {0, 0, 0, 0};
+
+    struct AtlasReloadJob
+    {
+        uint32_t atlasId;
+        std::string path;
+        bool indexed;
+        SpriteAtlas *result;
+    };
+
+    // frame diff (SetAutoDirtyDetection)
+    void DiffAgainstShadow(SharedBufferRefs *s, const uint8_t *pixels, std::vector<DirtyRect> &regions);
+    void SyncShadow(SharedBufferRefs *s, const uint8_t *pixels, const std::vector<DirtyRect> &regions);
+    std::unique_ptr<WorkerPool> worker_pool_;
+    std::mutex worker_pool_mutex_;
+
+    // copy-forward (SetCopyForward)
+    void NoteDamage(SharedBufferRefs *s, const std::vector<DirtyRect> &regions, bool full);
+    void CopyForward(SharedBufferRefs *s, uint32_t from, uint32_t to);
+
+    // one call per clipped row: (dst at the row's first pixel, screen x, screen y, pixels)
+    using FillKernel = std::function<void(uint8_t *, int32_t, int32_t, uint32_t)>;
+    bool FillArea(size_t bufRefId, float x, float y, float w, float h, const FillKernel &kernel);
+    CoverageRasterizer polygon_raster_; // buffers_mutex_
+    bool DrawStrokes(size_t bufRefId, const float *records, size_t count, bool circles, bool useCamera);
+
+    // single-slot sets (slot_count 1)
+    void StageFrame(SharedBufferRefs *s);
+    void UploadStaged(SharedBufferRefs *s);
+
+    // compositor state per target (buffers_mutex_)
+    struct CompositeTarget
+    {
+        std::vector<CompositeLayer> layers;
+        std::vector<DirtyRect> bounds; // per layer, target space, as of the last config
+        uint32_t width = 0;
+        uint32_t height = 0;
+        DirtyRegionSet pending; // damage from config changes, not yet composited
+    };
+    std::unordered_map<size_t, CompositeTarget> composite_targets_;
+    DirtyRect LayerBounds(const SharedBufferRefs *target, const CompositeLayer &layer);
+
+    // path handles (path_mutex_); masks past PATH_MAX_MASKS per path drop
+    // the least recently drawn
+    struct PathMask
+    {
+        int32_t left = 0, top = 0; // from the whole-pixel part of the translation
+        uint32_t width = 0, height = 0;
+        std::vector<uint8_t> coverage;
+        std::vector<uint32_t> spans; // x0, x1 per row that can be non-zero
+    };
+    struct PathMaskKey
+    {
+        float a, b, c, d; // linear part of the transform
+        float fracX, fracY;
+        bool stroke;
+        FillRule rule;
+        StrokeStyle style;
+        bool operator==(const PathMaskKey &o) const;
+    };
+    struct CachedPathMask
+    {
+        PathMaskKey key;
+        std::shared_ptr<const PathMask> mask;
+        uint64_t lastUse;
+    };
+    struct PathEntry
+    {
+        VectorPath path;
+        std::vector<CachedPathMask> masks;
+    };
+    std::unordered_map<uint32_t, PathEntry> paths_;
+    uint32_t next_path_id_ = 1;
+    uint64_t path_clock_ = 0;
+    std::mutex path_mutex_;
+    CoverageRasterizer path_raster_; // path_mutex_
+
+    bool PathDeviceTransform(size_t bufRefId, const PathPaint &paint, PathTransform &t);
+    std::shared_ptr<const PathMask> BuildPathMask(const FlatPath &flat, bool stroke, FillRule rule, const StrokeStyle &style);
+    // buffers_mutex_ held: blend a cached mask at (x, y) / rasterize in place
+    void BlendPathMask(SharedBufferRefs *s, const PathMask &mask, int64_t x, int64_t y, uint32_t rgba);
+    void RasterizeFlatPath(SharedBufferRefs *s, const FlatPath &flat, bool stroke, FillRule rule,
+                           const StrokeStyle &style, uint32_t rgba);
+
+    // background reloads; results are adopted on the JS thread in AcquireAtlas
+    std::thread atlas_loader_thread_;
+    std::mutex atlas_reload_mutex_;
+    std::condition_variable atlas_reload_cv_;
+    std::deque<AtlasReloadJob> atlas_reload_queue_;
+    std::vector<AtlasReloadJob> atlas_reload_done_;
+    bool atlas_loader_stop_ = false;
+
+    void EnforceAtlasBudget(uint32_t keepId);
+    uint32_t SelectAtlasLevel(SpriteAtlas *atlas, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH);
+    void AdoptReloadedPixels(SpriteAtlas *atlas, SpriteAtlas *loaded);
+    void ApplyFinishedReloads();
+    void AtlasLoaderThread();
     std::unordered_map<uint32_t, AnimatedSprite *> sprites_;
     uint32_t next_sprite_id_ = 1;
     std::mutex sprite_mutex_;
@@ -404,6 +860,15 @@ private:
     std::unordered_map<uint32_t, Animator *> animators_;
     uint32_t next_animator_id_ = 1;
     std::mutex animator_mutex_;
+
+    std::unordered_map<uint32_t, FontFace *> fonts_;
+    std::unordered_map<uint32_t, TrueTypeFont *> truetype_fonts_;
+    uint32_t next_font_id_ = 1; // shared, bitmap and TrueType ids never collide
+    std::mutex font_mutex_;
+
+    std::unordered_map<uint32_t, std::shared_ptr<const ColorGrade>> color_grades_;
+    uint32_t next_grade_id_ = 1;
+    std::mutex grade_mutex_;
     // Internal texture management
     TextureId nextTextureId_;
     TextureId nextRenderTextureId_;
@@ -418,5 +883,12 @@ private:
     std::atomic<bool> async_processing_{false};
     std::thread buffer_update_thread_;
 
+    // commit signal for BufferUpdateThread, plus swaps not yet announced (buffers_mutex_)
+    std::mutex commit_mutex_;
+    std::condition_variable commit_cv_;
+    bool frame_committed_ = false;
+    std::vector<size_t> swapped_buffers_;
+    std::function<void()> swap_listener_; // commit_mutex_
+
     void BufferUpdateThread();
 };
\ No newline at end of file
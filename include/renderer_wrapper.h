@@ -11,6 +11,7 @@ class RendererWrapper : public Napi::ObjectWrap<RendererWrapper>
 public:
     static Napi::Object Init(Napi::Env env, Napi::Object exports);
     RendererWrapper(const Napi::CallbackInfo &info);
+    ~RendererWrapper();
 
     // Core lifecycle
     Napi::Value Initialize(const Napi::CallbackInfo &info);
@@ -128,6 +129,8 @@ public:
     Napi::Value MarkBufferDirty(const Napi::CallbackInfo &info);
     Napi::Value GetBufferData(const Napi::CallbackInfo &info);
     Napi::Value UpdateBufferData(const Napi::CallbackInfo &info);
+    Napi::Value GetBufferViews(const Napi::CallbackInfo &info);
+    Napi::Value GetBufferGeneration(const Napi::CallbackInfo &info);
     Napi::Value MarkBufferRegionDirty(const Napi::CallbackInfo &info);
     Napi::Value SetBufferDimensions(const Napi::CallbackInfo &info);
     Napi::Value GetBufferStats(const Napi::CallbackInfo &info);
@@ -139,6 +142,14 @@ public:
     Napi::Value LoadImage(const Napi::CallbackInfo &info);
     Napi::Value UnloadImage(const Napi::CallbackInfo &info);
     Napi::Value InitSharedBuffers(const Napi::CallbackInfo &info);
+    Napi::Value GetControlBufferSize(const Napi::CallbackInfo &info);
+    Napi::Value SetAutoDirtyDetection(const Napi::CallbackInfo &info);
+    Napi::Value SetCopyForward(const Napi::CallbackInfo &info);
+    Napi::Value ResizeSharedBuffers(const Napi::CallbackInfo &info);
+    Napi::Value AssignWorkerBands(const Napi::CallbackInfo &info);
+    Napi::Value CommitFrame(const Napi::CallbackInfo &info);
+    Napi::Value SetCompositeLayers(const Napi::CallbackInfo &info);
+    Napi::Value CompositeLayers(const Napi::CallbackInfo &info);
 
     Napi::Value SetClearColor(const Napi::CallbackInfo &info)
     {
@@ -239,12 +250,24 @@ public:
     Napi::Value GetAtlasData(const Napi::CallbackInfo &info);
     Napi::Value GetAtlasDataAndFree(const Napi::CallbackInfo &info);
     Napi::Value FreeAtlas(const Napi::CallbackInfo &info);
+    Napi::Value SetAtlasCache(const Napi::CallbackInfo &info);
+    Napi::Value CompileAtlas(const Napi::CallbackInfo &info);
+    Napi::Value GetAtlasPalette(const Napi::CallbackInfo &info);
+    Napi::Value SetAtlasBudget(const Napi::CallbackInfo &info);
+    Napi::Value GetAtlasMemoryStats(const Napi::CallbackInfo &info);
+    Napi::Value SetAtlasMipmaps(const Napi::CallbackInfo &info);
+    Napi::Value DrawAtlasRegion(const Napi::CallbackInfo &info);
+    Napi::Value ResizeAtlas(const Napi::CallbackInfo &info);
+    Napi::Value LoadAtlasWithMetadata(const Napi::CallbackInfo &info);
+    Napi::Value CreateSpriteFromAtlas(const Napi::CallbackInfo &info);
     
     // animated sprite
     Napi::Value CreateSprite(const Napi::CallbackInfo &info);
     Napi::Value UpdateSprite(const Napi::CallbackInfo &info);
     Napi::Value DrawSprite(const Napi::CallbackInfo &info);
     Napi::Value DestroySprite(const Napi::CallbackInfo &info);
+    Napi::Value SetSpritePalette(const Napi::CallbackInfo &info);
+    Napi::Value CycleSpritePalette(const Napi::CallbackInfo &info);
     Napi::Value CreateSpriteWithAnimations(const Napi::CallbackInfo &info);
     Napi::Value PlayAnimation(const Napi::CallbackInfo &info);
     Napi::Value UpdateSpriteAnimations(const Napi::CallbackInfo &info);
@@ -256,6 +279,34 @@ public:
     Napi::Value DrawAnimator(const Napi::CallbackInfo &info);
     Napi::Value UpdateAnimators(const Napi::CallbackInfo &info);
     Napi::Value DestroyAnimator(const Napi::CallbackInfo &info);
+
+    // software drawing
+    Napi::Value FillRect(const Napi::CallbackInfo &info);
+    Napi::Value ClearRect(const Napi::CallbackInfo &info);
+    Napi::Value FillGradient(const Napi::CallbackInfo &info);
+    Napi::Value FillNoise(const Napi::CallbackInfo &info);
+    Napi::Value CreateNoiseAtlas(const Napi::CallbackInfo &info);
+    Napi::Value FilterCanvas(const Napi::CallbackInfo &info);
+    Napi::Value FilterAtlas(const Napi::CallbackInfo &info);
+    Napi::Value CreateColorGrade(const Napi::CallbackInfo &info);
+    Napi::Value FreeColorGrade(const Napi::CallbackInfo &info);
+    Napi::Value ApplyColorGrade(const Napi::CallbackInfo &info);
+    Napi::Value SetCanvasColorGrade(const Napi::CallbackInfo &info);
+    Napi::Value CreatePath(const Napi::CallbackInfo &info);
+    Napi::Value DestroyPath(const Napi::CallbackInfo &info);
+    Napi::Value DrawPath(const Napi::CallbackInfo &info);
+    Napi::Value FillPolygon(const Napi::CallbackInfo &info);
+    Napi::Value DrawLines(const Napi::CallbackInfo &info);
+    Napi::Value DrawCircles(const Napi::CallbackInfo &info);
+    Napi::Value CreateBitmapFont(const Napi::CallbackInfo &info);
+    Napi::Value FreeBitmapFont(const Napi::CallbackInfo &info);
+    Napi::Value MeasureBitmapText(const Napi::CallbackInfo &info);
+    Napi::Value DrawBitmapText(const Napi::CallbackInfo &info);
+    Napi::Value LoadTrueTypeFont(const Napi::CallbackInfo &info);
+    Napi::Value FreeTrueTypeFont(const Napi::CallbackInfo &info);
+    Napi::Value MeasureTrueTypeText(const Napi::CallbackInfo &info);
+    Napi::Value DrawTrueTypeText(const Napi::CallbackInfo &info);
+    Napi::Value GetTrueTypeFontStats(const Napi::CallbackInfo &info);
     // Napi::Value PartialTextureUpdate(const Napi::CallbackInfo &info)
     // {
     //     Napi::Env env = info.Env();
@@ -283,9 +334,21 @@ private:
     Napi::ObjectReference inputWrapper_;
     Napi::ObjectReference audioWrapper_;
 
+    // Int32Array views over shared control buffers, for Atomics.notify
+    std::unordered_map<size_t, Napi::ObjectReference> notifyViews_;
+    void NotifySwappedBuffers(Napi::Env env);
+    // brings swaps made on the async swap thread back to the JS thread
+    Napi::ThreadSafeFunction swapNotifier_;
+    void CloseSwapNotifier();
+
     // Helper methods
     static Color4 ParseColor(const Napi::Value &colorValue, const Color4 &defaultColor = Color4(0.1f, 0.1f, 0.1f, 1.0f));
     static Vec2 ParseVec2(const Napi::Value &vecValue, const Vec2 &defaultVec = Vec2(0, 0));
+    static bool ParseTextStyle(const Napi::Value &value, TextStyle &style, std::string &error);
+    static void ParseGradientStops(const Napi::Array &array, std::vector<GradientStop> &stops);
+    static bool ParseNoiseOptions(const Napi::Value &value, NoiseParams &params, std::vector<GradientStop> &stops,
+                                  std::string &error);
+    static bool ParsePathPaint(const Napi::Value &value, PathPaint &paint, std::string &error);
 
     static Napi::FunctionReference constructor;
 };
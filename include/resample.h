@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Separable image resampling for atlas-to-canvas draws and derived atlases.
+// Filtering happens on premultiplied colour, so transparent texels never
+// bleed dark fringes into the result.
+
+enum ResampleFilter : uint32_t
+{
+    RESAMPLE_NEAREST = 0,
+    RESAMPLE_BILINEAR = 1,
+    RESAMPLE_BICUBIC = 2,  // Catmull-Rom
+    RESAMPLE_LANCZOS3 = 3,
+};
+
+// a region of RGBA8 pixels, or 8-bit indices expanded through palette;
+// samples are clamped to the region so neighbouring frames never bleed in
+struct ResampleSource
+{
+    const uint8_t *data;
+    uint32_t stride;
+    const uint32_t *palette; // set for indexed sources
+    uint32_t x, y, width, height;
+};
+
+// Weights for one axis: output i reads taps source pixels from first[i].
+// Downscaling widens the kernel by the scale factor, so every source pixel
+// contributes (no aliasing).
+struct ResampleAxis
+{
+    std::vector<int32_t> first;
+    std::vector<float> weights; // taps per output, normalised
+    uint32_t taps = 0;
+};
+
+void BuildResampleAxis(uint32_t srcLength, uint32_t dstLength, ResampleFilter filter, ResampleAxis &axis);
+
+// Output rows [rowBegin, rowEnd) of the scaled image, columns [colBegin,
+// colEnd); emit gets each row as straight-alpha RGBA8. Independent row
+// ranges can run on different threads.
+typedef std::function<void(uint32_t row, const uint8_t *rgba)> ResampleEmit;
+void ResampleRows(const ResampleSource &src, const ResampleAxis &ax, const ResampleAxis &ay,
+                  uint32_t colBegin, uint32_t colEnd, uint32_t rowBegin, uint32_t rowEnd, const ResampleEmit &emit);
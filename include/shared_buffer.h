@@ -9,6 +9,8 @@
 #include <cstdint>
 #include <chrono>
 #include <algorithm>
+#include <memory>
+#include <map>
 
 struct DirtyRect
 {
@@ -58,13 +60,50 @@ struct DirtyRect
     }
 };
 
+// Union of dirty rects kept as y-bands of sorted, disjoint x-spans (the
+// classic X11/pixman region layout). Inserting touches only the bands the
+// rect covers, found by a map lookup, and the exact union area is updated
+// incrementally, so coverage checks never double-count overlaps.
+class DirtyRegionSet
+{
+public:
+    void Clear();
+    void Add(int x, int y, int width, int height);
+
+    bool Empty() const { return bands_.empty(); }
+    int64_t Area() const { return area_; }
+    size_t BandCount() const { return bands_.size(); }
+
+    // non-overlapping rects covering exactly the union
+    std::vector<DirtyRect> Rects() const;
+
+    // Rects for upload. Neighbours are merged into their bounding box when
+    // the extra bytes cost less than the per-upload overhead saved.
+    std::vector<DirtyRect> UploadRects(size_t uploadOverheadBytes, size_t bytesPerPixel = 4) const;
+
+private:
+    typedef std::pair<int, int> Span; // [x0, x1)
+
+    struct Band
+    {
+        int y1; // band covers [key, y1)
+        std::vector<Span> spans;
+    };
+
+    std::map<int, Band> bands_;
+    int64_t area_ = 0;
+
+    void SplitAt(int y);
+    void Coalesce(int y0, int y1);
+    static int AddSpan(std::vector<Span> &spans, int x0, int x1);
+};
+
 class SharedBuffer
 {
 public:
     SharedBuffer(size_t size, int width, int height);
     ~SharedBuffer();
 
-    void *GetData();
     size_t GetSize() const;
     bool IsDirty() const;
     void MarkDirty();
@@ -77,6 +116,13 @@ public:
     void *GetReadData();  // For render thread - always safe to read
     void *GetWriteData(); // For JavaScript thread - gets current write buffer
 
+    // Storage handed to JS as external ArrayBuffers. A view keeps its block
+    // alive after a Resize; the generation changes on every swap and resize,
+    // which is when JS must fetch fresh views.
+    std::shared_ptr<std::vector<uint8_t>> GetReadStorage();
+    std::shared_ptr<std::vector<uint8_t>> GetWriteStorage();
+    size_t GetGeneration() const { return generation_.load(); }
+
     // double buffering control
     bool SwapBuffers();
     bool TryLockForWrite(int timeout_ms = 0);
@@ -86,6 +132,9 @@ public:
     bool IsWriteLocked() const { return write_locked_.load(); }
 
     std::vector<DirtyRect> GetDirtyRegions() const;
+    int64_t GetDirtyArea() const; // exact, overlaps counted once
+    // per-upload cost in bytes-equivalent that drives region merging
+    void SetUploadOverhead(size_t bytes) { upload_overhead_ = bytes; }
     void ClearDirtyRegions();
     void MarkRegionDirty(int x, int y, int width, int height);
     void MarkFullyDirty();
@@ -98,12 +147,11 @@ public:
     int GetHeight() {return buffer_height_;};
 
 private:
-    std::vector<unsigned char> data_;
     std::mutex mutex_;
     std::atomic<bool> locked_;
     bool use_external_;
     // std::chrono::time_point<double> last_access_;
-    std::vector<uint8_t> buffers_[2];
+    std::shared_ptr<std::vector<uint8_t>> buffers_[2];
     std::atomic<int> read_index_{0};        // current read buffer index
     std::atomic<int> write_index_{1};       // current write buffer index
     std::atomic<bool> dirty_{false};        // write buffer has new data
@@ -113,18 +161,18 @@ private:
     std::condition_variable swap_cv_;
 
     std::atomic<size_t> swap_count_{0};
+    std::atomic<size_t> generation_{0};
 
     // buffer dimensions (for dirty rect validation)
     int buffer_width_;
     int buffer_height_;
 
     mutable std::mutex dirty_mutex_;
-    std::vector<DirtyRect> dirty_regions_;
-    bool fully_dirty_;
+    DirtyRegionSet dirty_regions_;
+    bool fully_dirty_ = false;
+    size_t upload_overhead_;
 
     SharedBuffer(const SharedBuffer &) = delete;
     SharedBuffer &operator=(const SharedBuffer &) = delete;
 
-    void OptimizeDirtyRegions();
-    float CalculateDirtyCoverage() const;
 };
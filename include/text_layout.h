@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Text layout shared by bitmap and TrueType fonts
+
+enum TextAlign
+{
+    TEXT_ALIGN_LEFT,
+    TEXT_ALIGN_CENTER,
+    TEXT_ALIGN_RIGHT
+};
+
+struct PlacedGlyph
+{
+    uint32_t glyph; // font-defined glyph id
+    float x, y;     // pen position on the line top, relative to the text origin
+};
+
+struct TextLayout
+{
+    std::vector<PlacedGlyph> glyphs; // whitespace is not placed
+    float width;  // widest line
+    float height;
+    uint32_t lines;
+
+    TextLayout() : width(0), height(0), lines(0) {}
+};
+
+// font-wide values the layout needs
+struct TextMetrics
+{
+    float lineHeight;
+    float lineGap;      // extra space between lines
+    float spaceAdvance; // tabs are four spaces
+};
+
+struct GlyphMetrics
+{
+    uint32_t glyph;
+    float advance;
+};
+
+// false: the font has nothing for the codepoint, it advances like a space
+typedef std::function<bool(uint32_t codepoint, GlyphMetrics &out)> GlyphLookup;
+// adjustment between two glyph ids, may be empty
+typedef std::function<float(uint32_t left, uint32_t right)> KerningLookup;
+
+// Word wraps at spaces when maxWidth > 0 (words wider than the box break
+// between characters), honours '\n' and aligns each line in the box.
+void LayoutText(const std::string &text, float maxWidth, TextAlign align, const TextMetrics &metrics,
+                const GlyphLookup &lookup, const KerningLookup &kerning, TextLayout &out);
+
+// Laid-out strings per (text, maxWidth, align). Two generations: a full one
+// becomes the old one, hits there are promoted, so text drawn every frame
+// stays resident without any bookkeeping per hit.
+class TextLayoutCache
+{
+public:
+    typedef std::function<void(TextLayout &out)> Compute;
+
+    // the reference stays valid until the next Get or Clear
+    const TextLayout &Get(const std::string &text, float maxWidth, TextAlign align, const Compute &compute);
+    void Clear();
+    size_t Size() const { return layouts_.size() + old_layouts_.size(); }
+
+private:
+    std::unordered_map<std::string, TextLayout> layouts_;
+    std::unordered_map<std::string, TextLayout> old_layouts_;
+};
+
+// next codepoint at text[i], advancing i; malformed bytes decode to U+FFFD
+uint32_t DecodeUtf8(const std::string &text, size_t &i);
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "text_layout.h"
+
+// TrueType fonts rasterized on demand into one coverage atlas per pixel size
+
+#define TRUETYPE_MAX_SIZE 512        // pixel sizes above this are refused
+#define TRUETYPE_ATLAS_MAX_SIDE 2048 // a full atlas at this height starts over
+
+struct TrueTypeGlyph
+{
+    uint16_t x, y, w, h;      // coverage rect in the size's atlas, w == 0: nothing to draw
+    int16_t offsetX, offsetY; // from the pen position on the line top
+    float advance;
+};
+
+struct TrueTypeStats
+{
+    uint64_t hits;       // glyph lookups served from an atlas
+    uint64_t misses;     // glyphs rasterized
+    uint32_t resets;     // atlases that filled up and started over
+    uint32_t sizes;      // pixel sizes with an atlas
+    uint32_t glyphs;     // glyphs currently packed
+    uint64_t atlasBytes; // coverage memory across all sizes
+    uint64_t usedPixels; // area taken by packed glyphs
+};
+
+class TrueTypeFont
+{
+public:
+    // takes the font file; fails when it can't be parsed
+    bool Load(std::vector<unsigned char> data, std::string &error);
+
+    // Glyph for a codepoint at pixelSize (1..TRUETYPE_MAX_SIZE), rasterized
+    // and packed on a miss. nullptr when the font can't produce it. The
+    // pointer and Coverage() stay valid until the next Glyph call.
+    const TrueTypeGlyph *Glyph(uint32_t pixelSize, uint32_t codepoint);
+    const uint8_t *Coverage(uint32_t pixelSize, uint32_t &stride) const;
+
+    // layout in pixels at pixelSize, cached like bitmap font layouts and
+    // valid until the next Layout call; PlacedGlyph::glyph is the codepoint
+    const TextLayout &Layout(uint32_t pixelSize, const std::string &text, float maxWidth, TextAlign align);
+
+    TrueTypeStats Stats() const;
+
+private:
+    struct SizeCache
+    {
+        uint32_t pixelSize = 0;
+        uint32_t width = 0, height = 0;
+        std::vector<uint8_t> coverage; // 8-bit, width x height
+        uint32_t shelfX = 0, shelfY = 0, shelfHeight = 0;
+        uint64_t usedPixels = 0;
+        std::unordered_map<uint32_t, TrueTypeGlyph> glyphs; // by codepoint
+        std::unordered_set<uint32_t> missing;               // codepoints the font failed on
+        TextLayoutCache layouts;
+        float spaceAdvance = 0;
+    };
+
+    SizeCache *Size(uint32_t pixelSize);
+    bool Pack(SizeCache &cache, uint32_t w, uint32_t h, uint32_t &x, uint32_t &y);
+    void Reset(SizeCache &cache);
+
+    std::vector<unsigned char> data_;
+    std::unordered_map<uint32_t, std::unique_ptr<SizeCache>> sizes_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint32_t resets_ = 0;
+};
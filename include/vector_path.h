@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "raster.h"
+
+// Vector paths from a compact command stream: an opcode followed by its
+// coordinates. Curves are flattened after the transform with Wang's
+// formula, so each one gets just enough segments to stay within the
+// tolerance in canvas pixels. Strokes are built from pieces (segment quads,
+// joins, caps) all wound the same way; the nonzero rule unions them in the
+// CoverageRasterizer.
+
+enum PathVerb : uint32_t
+{
+    PATH_MOVE = 0,  // x, y
+    PATH_LINE = 1,  // x, y
+    PATH_QUAD = 2,  // cx, cy, x, y
+    PATH_CUBIC = 3, // c1x, c1y, c2x, c2y, x, y
+    PATH_CLOSE = 4,
+};
+
+enum LineJoin : uint32_t
+{
+    JOIN_MITER = 0,
+    JOIN_ROUND = 1,
+    JOIN_BEVEL = 2,
+};
+
+enum LineCap : uint32_t
+{
+    CAP_BUTT = 0,
+    CAP_ROUND = 1,
+    CAP_SQUARE = 2,
+};
+
+struct StrokeStyle
+{
+    float width = 1.0f;
+    LineJoin join = JOIN_MITER;
+    LineCap cap = CAP_BUTT;
+    float miterLimit = 4.0f; // as canvas / SVG: longer miters become bevels
+};
+
+// path units to canvas pixels: x' = a x + c y + e, y' = b x + d y + f
+struct PathTransform
+{
+    float a = 1.0f, b = 0.0f, c = 0.0f, d = 1.0f, e = 0.0f, f = 0.0f;
+};
+
+// flattened contours, canvas pixels
+struct FlatPath
+{
+    std::vector<float> xy;
+    std::vector<uint32_t> counts; // points per contour
+    std::vector<uint8_t> closed;
+
+    // false when there are no points
+    bool Bounds(float &minX, float &minY, float &maxX, float &maxY) const;
+};
+
+class VectorPath
+{
+public:
+    // false on an unknown opcode or a truncated command; drawing commands
+    // before the first move start where they are (like canvas lineTo)
+    bool Parse(const float *commands, size_t count, std::string &error);
+    bool Empty() const { return verbs_.empty(); }
+
+    // tolerance: how far a flattened curve may stray, in canvas pixels
+    void Flatten(const PathTransform &transform, float tolerance, FlatPath &out) const;
+
+private:
+    std::vector<uint8_t> verbs_;
+    std::vector<float> points_; // path units
+};
+
+// every contour closed, edges relative to (originX, originY)
+void AddFillEdges(const FlatPath &path, float originX, float originY, CoverageRasterizer &raster);
+
+// outline pieces of the stroke (style.width in canvas pixels), for FILL_NONZERO
+void AddStrokeEdges(const FlatPath &path, const StrokeStyle &style, float tolerance,
+                    float originX, float originY, CoverageRasterizer &raster);
+
+// how far a stroke can reach past its centre line
+float StrokeReach(const StrokeStyle &style);
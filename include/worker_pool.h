@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small fork/join pool for splitting per-frame pixel work (diffs, fills)
+// across cores. ParallelFor blocks until every index has run; the calling
+// thread takes part, so a pool with 0 workers just runs inline.
+class WorkerPool
+{
+public:
+    // threads 0: hardware_concurrency - 1
+    explicit WorkerPool(unsigned threads = 0);
+    ~WorkerPool();
+
+    // runs fn(i) for i in [0, count), one ParallelFor at a time
+    void ParallelFor(size_t count, const std::function<void(size_t)> &fn);
+    unsigned ThreadCount() const { return static_cast<unsigned>(workers_.size()); }
+
+private:
+    void WorkerLoop();
+    void RunJobs();
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::mutex submit_mutex_;
+    std::condition_variable wake_cv_;
+    std::condition_variable done_cv_;
+
+    const std::function<void(size_t)> *job_ = nullptr;
+    size_t job_count_ = 0;
+    std::atomic<size_t> next_{0};
+    unsigned active_ = 0; // workers inside RunJobs
+    uint64_t generation_ = 0;
+    bool stop_ = false;
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+};
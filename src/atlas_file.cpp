@@ -0,0 +1,369 @@
+#include "atlas_file.h"
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <filesystem>
+#include <functional>
+#include <system_error>
+
+static uint64_t AlignUp(uint64_t value, uint64_t align)
+{
+    return (value + align - 1) / align * align;
+}
+
+// off/len describe a range inside a size byte buffer, without wrapping
+static bool RangeInside(uint64_t offset, uint64_t length, uint64_t size)
+{
+    return offset <= size && length <= size - offset;
+}
+
+bool AtlasFrameInside(const AtlasFrame &frame, uint32_t width, uint32_t height)
+{
+    // area the frame covers in the sheet
+    bool rotated = (frame.flags & ATLAS_FRAME_ROTATED) != 0;
+    uint32_t sheetW = rotated ? frame.h : frame.w;
+    uint32_t sheetH = rotated ? frame.w : frame.h;
+    return RangeInside(frame.x, sheetW, width) && RangeInside(frame.y, sheetH, height);
+}
+
+const TAtlasHeader *ValidateAtlasFile(const uint8_t *data, size_t size)
+{
+    if (!data || size < sizeof(TAtlasHeader))
+        return nullptr;
+
+    const TAtlasHeader *header = reinterpret_cast<const TAtlasHeader *>(data);
+    if (header->magic != TATLAS_MAGIC || header->version != TATLAS_VERSION)
+        return nullptr;
+    if (header->format != ATLAS_FORMAT_RGBA8 && header->format != ATLAS_FORMAT_INDEXED8)
+        return nullptr;
+    if (header->width == 0 || header->height == 0 ||
+        header->stride < static_cast<uint64_t>(header->width) * AtlasBytesPerPixel(header->format))
+        return nullptr;
+
+    uint64_t frameBytes = static_cast<uint64_t>(header->frameCount) * sizeof(AtlasFrame);
+    if (header->frameOffset % alignof(AtlasFrame) != 0 || !RangeInside(header->frameOffset, frameBytes, size))
+        return nullptr;
+
+    if (header->format == ATLAS_FORMAT_INDEXED8 &&
+        (header->paletteOffset % sizeof(uint32_t) != 0 ||
+         !RangeInside(header->paletteOffset, ATLAS_PALETTE_SIZE * sizeof(uint32_t), size)))
+        return nullptr;
+
+    if (header->pixelOffset % TATLAS_ROW_ALIGN != 0)
+        return nullptr;
+    if (header->pixelBytes < static_cast<uint64_t>(header->stride) * header->height)
+        return nullptr;
+    if (!RangeInside(header->pixelOffset, header->pixelBytes, size))
+        return nullptr;
+
+    // frames are blitted from without further checks
+    const AtlasFrame *frames = reinterpret_cast<const AtlasFrame *>(data + header->frameOffset);
+    for (uint32_t i = 0; i < header->frameCount; i++)
+    {
+        if (!(frames[i].flags & ATLAS_FRAME_EMPTY) && !AtlasFrameInside(frames[i], header->width, header->height))
+            return nullptr;
+    }
+
+    return header;
+}
+
+bool WriteAtlasFile(const std::string &path, const uint8_t *pixels, uint32_t width, uint32_t height,
+                    uint32_t srcStride, const std::vector<AtlasFrame> &frames, uint32_t flags,
+                    uint64_t sourceSize, int64_t sourceMtime,
+                    AtlasPixelFormat format, const uint32_t *palette)
+{
+    if (format == ATLAS_FORMAT_INDEXED8 && !palette)
+        return false;
+
+    const uint32_t bpp = AtlasBytesPerPixel(format);
+    const uint64_t paletteBytes = format == ATLAS_FORMAT_INDEXED8 ? ATLAS_PALETTE_SIZE * sizeof(uint32_t) : 0;
+
+    TAtlasHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TATLAS_MAGIC;
+    header.version = TATLAS_VERSION;
+    header.width = width;
+    header.height = height;
+    header.stride = static_cast<uint32_t>(AlignUp(static_cast<uint64_t>(width) * bpp, TATLAS_ROW_ALIGN));
+    header.format = format;
+    header.flags = flags;
+    header.frameCount = static_cast<uint32_t>(frames.size());
+    header.frameOffset = sizeof(TAtlasHeader);
+    header.paletteOffset = paletteBytes ? header.frameOffset + frames.size() * sizeof(AtlasFrame) : 0;
+    header.pixelOffset = AlignUp(header.frameOffset + frames.size() * sizeof(AtlasFrame) + paletteBytes, TATLAS_ROW_ALIGN);
+    header.pixelBytes = static_cast<uint64_t>(header.stride) * height;
+    header.sourceSize = sourceSize;
+    header.sourceMtime = sourceMtime;
+
+    // write next to the target and rename, so a crashed write never leaves a
+    // truncated file that a later run would try to map
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!frames.empty())
+            out.write(reinterpret_cast<const char *>(frames.data()), frames.size() * sizeof(AtlasFrame));
+
+        if (paletteBytes)
+            out.write(reinterpret_cast<const char *>(palette), static_cast<std::streamsize>(paletteBytes));
+
+        std::vector<char> padding(TATLAS_ROW_ALIGN, 0);
+        uint64_t written = header.frameOffset + frames.size() * sizeof(AtlasFrame) + paletteBytes;
+        out.write(padding.data(), static_cast<std::streamsize>(header.pixelOffset - written));
+
+        std::vector<uint8_t> row(header.stride, 0);
+        for (uint32_t y = 0; y < height; ++y)
+        {
+            memcpy(row.data(), pixels + static_cast<size_t>(y) * srcStride, static_cast<size_t>(width) * bpp);
+            out.write(reinterpret_cast<const char *>(row.data()), header.stride);
+        }
+
+        if (!out)
+        {
+            out.close();
+            std::error_code ec;
+            std::filesystem::remove(tmpPath, ec);
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool GetAtlasSourceKey(const std::string &path, uint64_t &size, int64_t &mtime)
+{
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec)
+        return false;
+
+    auto time = std::filesystem::last_write_time(path, ec);
+    if (ec)
+        return false;
+
+    mtime = static_cast<int64_t>(time.time_since_epoch().count());
+    return true;
+}
+
+std::string GetAtlasCachePath(const std::string &sourcePath, const std::string &cacheDir)
+{
+    if (cacheDir.empty())
+        return sourcePath + TATLAS_EXTENSION;
+
+    // flatten into the cache dir; the path hash keeps same-named images apart
+    std::filesystem::path source(sourcePath);
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(source, ec);
+    size_t hash = std::hash<std::string>{}(ec ? sourcePath : absolute.string());
+
+    char prefix[17];
+    snprintf(prefix, sizeof(prefix), "%016llx", static_cast<unsigned long long>(hash));
+
+    return (std::filesystem::path(cacheDir) /
+            (std::string(prefix) + "_" + source.filename().string() + TATLAS_EXTENSION))
+        .string();
+}
+
+void ComputeFrameTrim(const uint8_t *pixels, uint32_t stride, AtlasFrame &frame)
+{
+    uint32_t minX = frame.w, minY = frame.h, maxX = 0, maxY = 0;
+    bool opaque = true;
+    bool any = false;
+
+    for (uint32_t y = 0; y < frame.h; ++y)
+    {
+        const uint8_t *row = pixels + static_cast<size_t>(frame.y + y) * stride + static_cast<size_t>(frame.x) * 4u;
+        for (uint32_t x = 0; x < frame.w; ++x)
+        {
+            uint8_t a = row[x * 4 + 3];
+            if (a == 0)
+                continue;
+
+            any = true;
+            if (x < minX)
+                minX = x;
+            if (x > maxX)
+                maxX = x;
+            if (y < minY)
+                minY = y;
+            if (y > maxY)
+                maxY = y;
+        }
+    }
+
+    frame.sourceW = frame.w;
+    frame.sourceH = frame.h;
+    frame.trimX = 0;
+    frame.trimY = 0;
+    frame.flags &= ~(ATLAS_FRAME_OPAQUE | ATLAS_FRAME_EMPTY);
+
+    if (!any)
+    {
+        frame.flags |= ATLAS_FRAME_EMPTY;
+        return;
+    }
+
+    frame.trimX = static_cast<int32_t>(minX);
+    frame.trimY = static_cast<int32_t>(minY);
+    frame.x += minX;
+    frame.y += minY;
+    frame.w = maxX - minX + 1;
+    frame.h = maxY - minY + 1;
+
+    // opacity of the trimmed rect
+    for (uint32_t y = 0; y < frame.h && opaque; ++y)
+    {
+        const uint8_t *row = pixels + static_cast<size_t>(frame.y + y) * stride + static_cast<size_t>(frame.x) * 4u;
+        for (uint32_t x = 0; x < frame.w; ++x)
+        {
+            if (row[x * 4 + 3] < 255)
+            {
+                opaque = false;
+                break;
+            }
+        }
+    }
+
+    if (opaque)
+        frame.flags |= ATLAS_FRAME_OPAQUE;
+}
+
+bool ScanOpaque(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t stride)
+{
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t *row = pixels + static_cast<size_t>(y) * stride;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            if (row[x * 4 + 3] < 255)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool ScanOpaqueIndexed(const uint8_t *indices, uint32_t width, uint32_t height, uint32_t stride,
+                       const uint32_t *palette)
+{
+    // check each palette entry once, only the ones actually used matter
+    bool checked[ATLAS_PALETTE_SIZE] = {};
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t *row = indices + static_cast<size_t>(y) * stride;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint8_t idx = row[x];
+            if (checked[idx])
+                continue;
+            checked[idx] = true;
+
+            const uint8_t *c = reinterpret_cast<const uint8_t *>(&palette[idx]);
+            if (c[3] < 255)
+                return false;
+        }
+    }
+    return true;
+}
+
+bool BuildIndexedPixels(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t stride,
+                        std::vector<uint8_t> &indices, uint32_t *palette, uint32_t &colorCount)
+{
+    memset(palette, 0, ATLAS_PALETTE_SIZE * sizeof(uint32_t));
+    colorCount = 0;
+    indices.resize(static_cast<size_t>(width) * height);
+
+    // small open-addressing table, 512 slots for at most 256 colours
+    const uint32_t TABLE_SIZE = ATLAS_PALETTE_SIZE * 2;
+    uint32_t keys[TABLE_SIZE];
+    int16_t values[TABLE_SIZE];
+    for (uint32_t i = 0; i < TABLE_SIZE; ++i)
+        values[i] = -1;
+
+    uint32_t lastColor = 0;
+    uint8_t lastIndex = 0;
+    bool haveLast = false;
+
+    for (uint32_t y = 0; y < height; ++y)
+    {
+        const uint8_t *row = pixels + static_cast<size_t>(y) * stride;
+        uint8_t *dst = indices.data() + static_cast<size_t>(y) * width;
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            uint32_t color;
+            memcpy(&color, row + x * 4, 4);
+            if (row[x * 4 + 3] == 0)
+                color = 0; // all invisible pixels are the same colour
+
+            // runs of one colour are the common case in pixel art
+            if (haveLast && color == lastColor)
+            {
+                dst[x] = lastIndex;
+                continue;
+            }
+
+            uint32_t slot = (color * 2654435761u) >> 23; // 9 bits -> 0..511
+            while (values[slot] >= 0 && keys[slot] != color)
+                slot = (slot + 1) & (TABLE_SIZE - 1);
+
+            if (values[slot] < 0)
+            {
+                if (colorCount == ATLAS_PALETTE_SIZE)
+                    return false;
+                keys[slot] = color;
+                values[slot] = static_cast<int16_t>(colorCount);
+                palette[colorCount++] = color;
+            }
+
+            lastColor = color;
+            lastIndex = static_cast<uint8_t>(values[slot]);
+            haveLast = true;
+            dst[x] = lastIndex;
+        }
+    }
+    return true;
+}
+
+void DownsampleBox2x(const uint8_t *src, uint32_t srcW, uint32_t srcH, uint32_t srcStride,
+                     uint8_t *dst, uint32_t dstW, uint32_t dstH)
+{
+    for (uint32_t y = 0; y < dstH; ++y)
+    {
+        // odd sizes: the last row/column has no partner and is averaged with itself
+        uint32_t y0 = y * 2 < srcH ? y * 2 : srcH - 1;
+        uint32_t y1 = y0 + 1 < srcH ? y0 + 1 : y0;
+        const uint8_t *row0 = src + static_cast<size_t>(y0) * srcStride;
+        const uint8_t *row1 = src + static_cast<size_t>(y1) * srcStride;
+        uint8_t *out = dst + static_cast<size_t>(y) * dstW * 4;
+
+        for (uint32_t x = 0; x < dstW; ++x)
+        {
+            uint32_t x0 = x * 2 < srcW ? x * 2 : srcW - 1;
+            uint32_t x1 = x0 + 1 < srcW ? x0 + 1 : x0;
+            const uint8_t *p[4] = {row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4};
+
+            uint32_t a = p[0][3] + p[1][3] + p[2][3] + p[3][3];
+            if (a == 0)
+            {
+                memset(out + x * 4, 0, 4);
+                continue;
+            }
+
+            for (int c = 0; c < 3; ++c)
+            {
+                uint32_t sum = p[0][c] * p[0][3] + p[1][c] * p[1][3] + p[2][c] * p[2][3] + p[3][c] * p[3][3];
+                out[x * 4 + c] = static_cast<uint8_t>((sum + a / 2) / a);
+            }
+            out[x * 4 + 3] = static_cast<uint8_t>((a + 2) / 4);
+        }
+    }
+}
@@ -0,0 +1,251 @@
+#include "atlas_metadata.h"
+#include "rapidjson/document.h"
+#include <unordered_map>
+#include <algorithm>
+
+using rapidjson::Value;
+
+static uint32_t GetUint(const Value &obj, const char *key, uint32_t fallback = 0)
+{
+    auto it = obj.FindMember(key);
+    if (it == obj.MemberEnd() || !it->value.IsNumber())
+        return fallback;
+    double v = it->value.GetDouble();
+    return v > 0 ? static_cast<uint32_t>(v) : 0;
+}
+
+static int32_t GetInt(const Value &obj, const char *key, int32_t fallback = 0)
+{
+    auto it = obj.FindMember(key);
+    if (it == obj.MemberEnd() || !it->value.IsNumber())
+        return fallback;
+    return static_cast<int32_t>(it->value.GetDouble());
+}
+
+static bool GetBool(const Value &obj, const char *key)
+{
+    auto it = obj.FindMember(key);
+    return it != obj.MemberEnd() && it->value.IsBool() && it->value.GetBool();
+}
+
+static const Value *GetObject(const Value &obj, const char *key)
+{
+    auto it = obj.FindMember(key);
+    if (it == obj.MemberEnd() || !it->value.IsObject())
+        return nullptr;
+    return &it->value;
+}
+
+// one entry of "frames", same shape in both exporters
+static bool ParseFrame(const Value &entry, AtlasFrame &frame, float &duration)
+{
+    const Value *rect = GetObject(entry, "frame");
+    if (!rect)
+        return false;
+
+    frame = {};
+    frame.x = GetUint(*rect, "x");
+    frame.y = GetUint(*rect, "y");
+    frame.w = GetUint(*rect, "w");
+    frame.h = GetUint(*rect, "h");
+
+    if (GetBool(entry, "rotated"))
+    {
+        // w/h are the upright size, the sheet area is h x w (turned 90deg clockwise)
+        frame.flags |= ATLAS_FRAME_ROTATED;
+    }
+
+    frame.sourceW = frame.w;
+    frame.sourceH = frame.h;
+
+    if (const Value *source = GetObject(entry, "sourceSize"))
+    {
+        frame.sourceW = GetUint(*source, "w", frame.w);
+        frame.sourceH = GetUint(*source, "h", frame.h);
+    }
+
+    if (GetBool(entry, "trimmed"))
+    {
+        if (const Value *sprite = GetObject(entry, "spriteSourceSize"))
+        {
+            frame.trimX = GetInt(*sprite, "x");
+            frame.trimY = GetInt(*sprite, "y");
+        }
+    }
+
+    if (frame.w == 0 || frame.h == 0)
+        frame.flags |= ATLAS_FRAME_EMPTY;
+
+    duration = GetUint(entry, "duration") / 1000.0f; // aseprite: ms
+    return true;
+}
+
+// aseprite tag directions are expanded into a plain frame sequence
+static void AppendTagFrames(AtlasAnimation &anim, uint32_t from, uint32_t to, const std::string &direction)
+{
+    std::vector<uint32_t> forward;
+    for (uint32_t i = from; i <= to; i++)
+        forward.push_back(i);
+
+    if (direction == "reverse" || direction == "pingpong_reverse")
+        std::reverse(forward.begin(), forward.end());
+
+    anim.frames = forward;
+    if (direction == "pingpong" || direction == "pingpong_reverse")
+    {
+        // back again without repeating either end
+        for (size_t i = forward.size() >= 2 ? forward.size() - 2 : 0; i > 0; i--)
+            anim.frames.push_back(forward[i]);
+    }
+}
+
+static void FillDurations(AtlasAnimation &anim, const AtlasMetadata &meta)
+{
+    float total = 0.0f;
+    for (uint32_t idx : anim.frames)
+    {
+        float d = meta.frameDurations[idx];
+        if (d <= 0.0f)
+        {
+            // mixed sheet, fall back to a fixed fps
+            anim.durations.clear();
+            return;
+        }
+        anim.durations.push_back(d);
+        total += d;
+    }
+
+    if (total > 0.0f)
+        anim.fps = anim.frames.size() / total;
+}
+
+bool ParseAtlasMetadata(std::string &json, AtlasMetadata &out, std::string &error)
+{
+    rapidjson::Document doc;
+    doc.ParseInsitu(&json[0]);
+    if (doc.HasParseError() || !doc.IsObject())
+    {
+        error = "invalid JSON (offset " + std::to_string(doc.GetErrorOffset()) + ")";
+        return false;
+    }
+
+    auto framesIt = doc.FindMember("frames");
+    if (framesIt == doc.MemberEnd())
+    {
+        error = "missing \"frames\"";
+        return false;
+    }
+
+    const Value &frames = framesIt->value;
+    if (frames.IsObject())
+    {
+        // hash export: { "name": { frame, rotated, ... } }, document order is frame order
+        for (auto it = frames.MemberBegin(); it != frames.MemberEnd(); ++it)
+        {
+            AtlasFrame frame;
+            float duration = 0.0f;
+            if (!it->value.IsObject() || !ParseFrame(it->value, frame, duration))
+            {
+                error = std::string("bad frame entry: ") + it->name.GetString();
+                return false;
+            }
+            out.frames.push_back(frame);
+            out.frameNames.emplace_back(it->name.GetString(), it->name.GetStringLength());
+            out.frameDurations.push_back(duration);
+        }
+    }
+    else if (frames.IsArray())
+    {
+        // array export: [ { filename, frame, rotated, ... } ]
+        for (rapidjson::SizeType i = 0; i < frames.Size(); i++)
+        {
+            const Value &entry = frames[i];
+            AtlasFrame frame;
+            float duration = 0.0f;
+            if (!entry.IsObject() || !ParseFrame(entry, frame, duration))
+            {
+                error = "bad frame entry at index " + std::to_string(i);
+                return false;
+            }
+
+            auto nameIt = entry.FindMember("filename");
+            std::string name = (nameIt != entry.MemberEnd() && nameIt->value.IsString())
+                                   ? std::string(nameIt->value.GetString(), nameIt->value.GetStringLength())
+                                   : std::to_string(i);
+
+            out.frames.push_back(frame);
+            out.frameNames.push_back(name);
+            out.frameDurations.push_back(duration);
+        }
+    }
+    else
+    {
+        error = "\"frames\" must be an object or an array";
+        return false;
+    }
+
+    std::unordered_map<std::string, uint32_t> frameIndex;
+    for (uint32_t i = 0; i < out.frameNames.size(); i++)
+        frameIndex.emplace(out.frameNames[i], i);
+
+    // aseprite: meta.frameTags [{ name, from, to, direction }]
+    if (const Value *meta = GetObject(doc, "meta"))
+    {
+        auto imageIt = meta->FindMember("image");
+        if (imageIt != meta->MemberEnd() && imageIt->value.IsString())
+            out.image = imageIt->value.GetString();
+
+        auto tagsIt = meta->FindMember("frameTags");
+        if (tagsIt != meta->MemberEnd() && tagsIt->value.IsArray())
+        {
+            for (const Value &tag : tagsIt->value.GetArray())
+            {
+                if (!tag.IsObject() || !tag.HasMember("name") || !tag["name"].IsString())
+                    continue;
+
+                uint32_t from = GetUint(tag, "from");
+                uint32_t to = GetUint(tag, "to");
+                if (from > to || to >= out.frames.size())
+                    continue;
+
+                auto dirIt = tag.FindMember("direction");
+                std::string direction = (dirIt != tag.MemberEnd() && dirIt->value.IsString()) ? dirIt->value.GetString() : "forward";
+
+                AtlasAnimation anim;
+                anim.name = tag["name"].GetString();
+                AppendTagFrames(anim, from, to, direction);
+                FillDurations(anim, out);
+                out.animations.push_back(anim);
+            }
+        }
+    }
+
+    // texturepacker / pixi: "animations": { "name": ["frame", ...] }
+    auto animsIt = doc.FindMember("animations");
+    if (animsIt != doc.MemberEnd() && animsIt->value.IsObject())
+    {
+        for (auto it = animsIt->value.MemberBegin(); it != animsIt->value.MemberEnd(); ++it)
+        {
+            if (!it->value.IsArray())
+                continue;
+
+            AtlasAnimation anim;
+            anim.name = it->name.GetString();
+            for (const Value &name : it->value.GetArray())
+            {
+                if (!name.IsString())
+                    continue;
+                auto found = frameIndex.find(std::string(name.GetString(), name.GetStringLength()));
+                if (found != frameIndex.end())
+                    anim.frames.push_back(found->second);
+            }
+
+            if (anim.frames.empty())
+                continue;
+            FillDurations(anim, out);
+            out.animations.push_back(anim);
+        }
+    }
+
+    return true;
+}
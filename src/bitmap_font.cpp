@@ -0,0 +1,124 @@
+#include "bitmap_font.h"
+#include <algorithm>
+
+// code page 437 order, as generated by the font atlas tool in docs.md
+static const char *DEFAULT_CHAR_ORDER =
+    " ☺☻♥♦♣♠•◘○◙♂♀♪♫☼►◄↕‼¶§▬↨↑↓→←∟↔▲▼"
+    " !\"#$%&'()*+,-./0123456789:;<=>?"
+    "@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_"
+    "`abcdefghijklmnopqrstuvwxyz{¦}~⌂"
+    "ÇüéâäàåçêëèïîìÄÅÉæÆôöòûùÿÖÜ¢£¥₧ƒ"
+    "áíóúñÑªº¿⌐¬½¼¡«»░▒▓│┤╡╢╖╕╣║╗╝╜╛┐"
+    "└┴┬├─┼╞╟╚╔╩╦╠═╬╧╨╤╥╙╘╒╓╫╪┘┌█▄▌▐▀"
+    "αßΓπΣσµτΦΘΩδ∞φε∩≡±≥≤⌠⌡÷≈°∙·√ⁿ²■□";
+
+bool BitmapFont::Build(const BitmapFontConfig &config, uint32_t atlasWidth, uint32_t atlasHeight, std::string &error)
+{
+    if (config.cellWidth == 0 || config.cellHeight == 0 || config.cellsPerRow == 0 || config.cellsPerColumn == 0)
+    {
+        error = "cell size and grid must be non-zero";
+        return false;
+    }
+
+    glyphs_.clear();
+    codepoints_.clear();
+    kerning_.clear();
+    layouts_.Clear();
+    std::fill(ascii_, ascii_ + 128, -1);
+
+    const std::string order = config.charOrder.empty() ? std::string(DEFAULT_CHAR_ORDER) : config.charOrder;
+    const uint32_t cells = config.cellsPerRow * config.cellsPerColumn;
+    size_t i = 0;
+    for (uint32_t cell = 0; cell < cells && i < order.size(); cell++)
+    {
+        uint32_t cp = DecodeUtf8(order, i);
+        FontGlyph glyph;
+        glyph.x = config.offsetX + (cell % config.cellsPerRow) * config.cellWidth;
+        glyph.y = config.offsetY + (cell / config.cellsPerRow) * config.cellHeight;
+        glyph.w = config.cellWidth;
+        glyph.h = config.cellHeight;
+        if (glyph.x + glyph.w > atlasWidth || glyph.y + glyph.h > atlasHeight)
+            break; // grid runs off the atlas
+
+        float advance = cell < config.advances.size() && config.advances[cell] > 0.0f ? config.advances[cell]
+                                                                                        : static_cast<float>(config.cellWidth);
+        glyph.advance = advance + config.charSpacing;
+
+        // the first cell wins when a codepoint repeats
+        uint32_t index = static_cast<uint32_t>(glyphs_.size());
+        if (cp < 128)
+        {
+            if (ascii_[cp] < 0)
+                ascii_[cp] = static_cast<int32_t>(index);
+        }
+        else
+        {
+            codepoints_.emplace(cp, index);
+        }
+        glyphs_.push_back(glyph);
+    }
+
+    if (glyphs_.empty())
+    {
+        error = "no glyph cell fits inside the atlas";
+        return false;
+    }
+
+    fallback_ = Find('?');
+    int32_t space = Find(' ');
+    metrics_.spaceAdvance = space >= 0 ? glyphs_[space].advance : config.cellWidth + config.charSpacing;
+    metrics_.lineHeight = config.lineHeight > 0.0f ? config.lineHeight : static_cast<float>(config.cellHeight);
+    metrics_.lineGap = config.lineGap;
+
+    for (const auto &pair : config.kerning)
+    {
+        size_t k = 0;
+        if (pair.first.empty())
+            continue;
+        int32_t left = Find(DecodeUtf8(pair.first, k));
+        if (k >= pair.first.size())
+            continue;
+        int32_t right = Find(DecodeUtf8(pair.first, k));
+        if (left >= 0 && right >= 0)
+            kerning_[(static_cast<uint64_t>(left) << 32) | static_cast<uint32_t>(right)] = pair.second;
+    }
+    return true;
+}
+
+int32_t BitmapFont::Find(uint32_t codepoint) const
+{
+    if (codepoint < 128)
+        return ascii_[codepoint];
+    auto it = codepoints_.find(codepoint);
+    return it == codepoints_.end() ? -1 : static_cast<int32_t>(it->second);
+}
+
+float BitmapFont::Kerning(uint32_t left, uint32_t right) const
+{
+    if (kerning_.empty())
+        return 0.0f;
+    auto it = kerning_.find((static_cast<uint64_t>(left) << 32) | right);
+    return it == kerning_.end() ? 0.0f : it->second;
+}
+
+const TextLayout &BitmapFont::Layout(const std::string &text, float maxWidth, TextAlign align)
+{
+    if (maxWidth < 0.0f)
+        maxWidth = 0.0f;
+
+    return layouts_.Get(text, maxWidth, align, [&](TextLayout &out)
+                        {
+                            auto lookup = [this](uint32_t cp, GlyphMetrics &glyph)
+                            {
+                                int32_t g = Find(cp);
+                                if (g < 0)
+                                    g = fallback_;
+                                if (g < 0)
+                                    return false;
+                                glyph = {static_cast<uint32_t>(g), glyphs_[g].advance};
+                                return true;
+                            };
+                            auto kerning = [this](uint32_t left, uint32_t right)
+                            { return Kerning(left, right); };
+                            LayoutText(text, maxWidth, align, metrics_, lookup, kerning, out); });
+}
@@ -0,0 +1,324 @@
+#include "color_grade.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GRADE_SSE2 1
+#endif
+
+#ifdef GRADE_SSE2
+typedef __m128 Pixel4;
+static inline Pixel4 Load4(const float *p) { return _mm_loadu_ps(p); }
+static inline Pixel4 Add4(Pixel4 a, Pixel4 b) { return _mm_add_ps(a, b); }
+static inline Pixel4 Sub4(Pixel4 a, Pixel4 b) { return _mm_sub_ps(a, b); }
+static inline Pixel4 Lerp4(Pixel4 a, Pixel4 b, float t) { return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t))); }
+static inline Pixel4 MulAdd4(Pixel4 acc, Pixel4 v, float w) { return _mm_add_ps(acc, _mm_mul_ps(v, _mm_set1_ps(w))); }
+
+// rounds and saturates four channels into one RGBA8 pixel
+static inline void StoreBytes(Pixel4 v, uint8_t *out)
+{
+    __m128i i = _mm_cvtps_epi32(v);
+    i = _mm_packs_epi32(i, i);
+    i = _mm_packus_epi16(i, i);
+    uint32_t px = static_cast<uint32_t>(_mm_cvtsi128_si32(i));
+    std::memcpy(out, &px, 4);
+}
+#else
+struct Pixel4
+{
+    float v[4];
+};
+static inline Pixel4 Load4(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+static inline Pixel4 Add4(Pixel4 a, Pixel4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+static inline Pixel4 Sub4(Pixel4 a, Pixel4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+static inline Pixel4 Lerp4(Pixel4 a, Pixel4 b, float t)
+{
+    return {{a.v[0] + (b.v[0] - a.v[0]) * t, a.v[1] + (b.v[1] - a.v[1]) * t,
+             a.v[2] + (b.v[2] - a.v[2]) * t, a.v[3] + (b.v[3] - a.v[3]) * t}};
+}
+static inline Pixel4 MulAdd4(Pixel4 acc, Pixel4 v, float w)
+{
+    for (int c = 0; c < 4; c++)
+        acc.v[c] += v.v[c] * w;
+    return acc;
+}
+static inline void StoreBytes(Pixel4 v, uint8_t *out)
+{
+    for (int c = 0; c < 4; c++)
+        out[c] = static_cast<uint8_t>(std::min(std::max(std::nearbyint(v.v[c]), 0.0f), 255.0f));
+}
+#endif
+
+ColorMatrix IdentityColorMatrix()
+{
+    ColorMatrix m = {};
+    m.m[0] = m.m[6] = m.m[12] = m.m[18] = 1.0f;
+    return m;
+}
+
+// coefficients from the SVG / CSS filter effects spec
+ColorMatrix SaturationColorMatrix(float s)
+{
+    ColorMatrix m = IdentityColorMatrix();
+    const float rows[9] = {0.213f + 0.787f * s, 0.715f - 0.715f * s, 0.072f - 0.072f * s,
+                           0.213f - 0.213f * s, 0.715f + 0.285f * s, 0.072f - 0.072f * s,
+                           0.213f - 0.213f * s, 0.715f - 0.715f * s, 0.072f + 0.928f * s};
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            m.m[r * 5 + c] = rows[r * 3 + c];
+    return m;
+}
+
+ColorMatrix HueRotateColorMatrix(float degrees)
+{
+    const float a = degrees * 3.14159265358979f / 180.0f;
+    const float cs = std::cos(a);
+    const float sn = std::sin(a);
+    ColorMatrix m = IdentityColorMatrix();
+    const float rows[9] = {0.213f + cs * 0.787f - sn * 0.213f, 0.715f - cs * 0.715f - sn * 0.715f, 0.072f - cs * 0.072f + sn * 0.928f,
+                           0.213f - cs * 0.213f + sn * 0.143f, 0.715f + cs * 0.285f + sn * 0.140f, 0.072f - cs * 0.072f - sn * 0.283f,
+                           0.213f - cs * 0.213f - sn * 0.787f, 0.715f - cs * 0.715f + sn * 0.715f, 0.072f + cs * 0.928f + sn * 0.072f};
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            m.m[r * 5 + c] = rows[r * 3 + c];
+    return m;
+}
+
+ColorMatrix SepiaColorMatrix(float amount)
+{
+    const float k = 1.0f - std::min(std::max(amount, 0.0f), 1.0f);
+    ColorMatrix m = IdentityColorMatrix();
+    const float rows[9] = {0.393f + 0.607f * k, 0.769f - 0.769f * k, 0.189f - 0.189f * k,
+                           0.349f - 0.349f * k, 0.686f + 0.314f * k, 0.168f - 0.168f * k,
+                           0.272f - 0.272f * k, 0.534f - 0.534f * k, 0.131f + 0.869f * k};
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 3; c++)
+            m.m[r * 5 + c] = rows[r * 3 + c];
+    return m;
+}
+
+ColorMatrix MultiplyColorMatrix(const ColorMatrix &after, const ColorMatrix &before)
+{
+    ColorMatrix m = {};
+    for (int r = 0; r < 4; r++)
+    {
+        for (int c = 0; c < 5; c++)
+        {
+            float sum = c == 4 ? after.m[r * 5 + 4] : 0.0f;
+            for (int k = 0; k < 4; k++)
+                sum += after.m[r * 5 + k] * before.m[k * 5 + c];
+            m.m[r * 5 + c] = sum;
+        }
+    }
+    return m;
+}
+
+void ColorGrade::SetMatrix(const ColorMatrix &matrix)
+{
+    lut_size_ = 0;
+    lut_.clear();
+
+    // output = sum over input channels c of column c * value, plus the offset
+    matrix_table_.assign(4 * 256 * 4, 0.0f);
+    for (int c = 0; c < 4; c++)
+    {
+        for (int v = 0; v < 256; v++)
+        {
+            float *entry = &matrix_table_[(c * 256 + v) * 4];
+            for (int r = 0; r < 4; r++)
+                entry[r] = matrix.m[r * 5 + c] * v + (c == 0 ? matrix.m[r * 5 + 4] * 255.0f : 0.0f);
+        }
+    }
+}
+
+bool ColorGrade::SetLut(uint32_t size, const float *rgb, LutInterpolation interpolation, std::string &error,
+                        const float *domainMin, const float *domainMax)
+{
+    if (size < 2 || size > COLOR_LUT_MAX_SIZE)
+    {
+        error = "LUT size must be 2.." + std::to_string(COLOR_LUT_MAX_SIZE);
+        return false;
+    }
+
+    const size_t entries = static_cast<size_t>(size) * size * size;
+    lut_.assign(entries * 4, 0.0f);
+    for (size_t i = 0; i < entries; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            float v = rgb[i * 3 + c];
+            lut_[i * 4 + c] = std::isfinite(v) ? std::min(std::max(v, 0.0f), 1.0f) * 255.0f : 0.0f;
+        }
+    }
+
+    // the last cell starts at size - 2, so value 255 lands on its far side
+    const uint32_t strides[3] = {1, size, size * size};
+    for (int c = 0; c < 3; c++)
+    {
+        float lo = domainMin ? domainMin[c] : 0.0f;
+        float hi = domainMax ? domainMax[c] : 1.0f;
+        float span = hi > lo ? hi - lo : 1.0f;
+        for (int v = 0; v < 256; v++)
+        {
+            float pos = std::min(std::max((v / 255.0f - lo) / span, 0.0f), 1.0f) * (size - 1);
+            uint32_t cell = std::min(static_cast<uint32_t>(pos), size - 2);
+            offset_[c][v] = cell * strides[c] * 4;
+            frac_[c][v] = pos - cell;
+        }
+    }
+
+    matrix_table_.clear();
+    lut_size_ = size;
+    interpolation_ = interpolation;
+    return true;
+}
+
+bool ColorGrade::LoadCube(const std::string &path, LutInterpolation interpolation, std::string &error)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        error = "can't open " + path;
+        return false;
+    }
+
+    uint32_t size = 0;
+    float domainMin[3] = {0.0f, 0.0f, 0.0f};
+    float domainMax[3] = {1.0f, 1.0f, 1.0f};
+    std::vector<float> rgb;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#')
+            continue;
+
+        std::istringstream in(line.substr(start));
+        if (std::isalpha(static_cast<unsigned char>(line[start])))
+        {
+            std::string key;
+            in >> key;
+            if (key == "LUT_3D_SIZE")
+                in >> size;
+            else if (key == "LUT_1D_SIZE")
+            {
+                error = "1D .cube LUTs are not supported";
+                return false;
+            }
+            else if (key == "DOMAIN_MIN")
+                in >> domainMin[0] >> domainMin[1] >> domainMin[2];
+            else if (key == "DOMAIN_MAX")
+                in >> domainMax[0] >> domainMax[1] >> domainMax[2];
+            else if (key == "LUT_3D_INPUT_RANGE")
+            {
+                float lo = 0.0f, hi = 1.0f;
+                in >> lo >> hi;
+                std::fill(domainMin, domainMin + 3, lo);
+                std::fill(domainMax, domainMax + 3, hi);
+            }
+            // TITLE and unknown keywords are skipped
+            continue;
+        }
+
+        float r, g, b;
+        if (!(in >> r >> g >> b))
+        {
+            error = "bad .cube data line: " + line;
+            return false;
+        }
+        rgb.push_back(r);
+        rgb.push_back(g);
+        rgb.push_back(b);
+    }
+
+    if (size == 0)
+    {
+        error = "missing LUT_3D_SIZE";
+        return false;
+    }
+    if (rgb.size() != static_cast<size_t>(size) * size * size * 3)
+    {
+        error = "expected " + std::to_string(size * size * size) + " entries, got " + std::to_string(rgb.size() / 3);
+        return false;
+    }
+    return SetLut(size, rgb.data(), interpolation, error, domainMin, domainMax);
+}
+
+void ColorGrade::ApplyMatrixRow(const uint8_t *src, uint8_t *dst, size_t count) const
+{
+    const float *table = matrix_table_.data();
+    for (size_t i = 0; i < count; i++, src += 4, dst += 4)
+    {
+        Pixel4 v = Add4(Add4(Load4(table + src[0] * 4), Load4(table + (256 + src[1]) * 4)),
+                        Add4(Load4(table + (512 + src[2]) * 4), Load4(table + (768 + src[3]) * 4)));
+        StoreBytes(v, dst);
+    }
+}
+
+// axis order (0 r, 1 g, 2 b) by descending fraction, indexed by
+// (r >= g) * 4 + (g >= b) * 2 + (r >= b); rows 1 and 6 can't happen
+static const uint8_t kTetrahedronOrder[8][3] = {
+    {2, 1, 0}, {2, 1, 0}, {1, 2, 0}, {1, 0, 2},
+    {2, 0, 1}, {0, 2, 1}, {0, 1, 2}, {0, 1, 2},
+};
+
+void ColorGrade::ApplyLutRow(const uint8_t *src, uint8_t *dst, size_t count) const
+{
+    const float *lut = lut_.data();
+    const uint32_t dr = 4;
+    const uint32_t dg = lut_size_ * 4;
+    const uint32_t db = lut_size_ * lut_size_ * 4;
+
+    for (size_t i = 0; i < count; i++, src += 4, dst += 4)
+    {
+        const float *c000 = lut + offset_[0][src[0]] + offset_[1][src[1]] + offset_[2][src[2]];
+        const float fr = frac_[0][src[0]];
+        const float fg = frac_[1][src[1]];
+        const float fb = frac_[2][src[2]];
+        const uint8_t alpha = src[3];
+
+        Pixel4 out;
+        if (interpolation_ == LUT_TRILINEAR)
+        {
+            Pixel4 c00 = Lerp4(Load4(c000), Load4(c000 + dr), fr);
+            Pixel4 c10 = Lerp4(Load4(c000 + dg), Load4(c000 + dg + dr), fr);
+            Pixel4 c01 = Lerp4(Load4(c000 + db), Load4(c000 + db + dr), fr);
+            Pixel4 c11 = Lerp4(Load4(c000 + db + dg), Load4(c000 + db + dg + dr), fr);
+            out = Lerp4(Lerp4(c00, c10, fg), Lerp4(c01, c11, fg), fb);
+        }
+        else
+        {
+            // walk from c000 to c111 along the edges of the tetrahedron the
+            // point falls in, largest fraction first; the order comes from a
+            // table so mixed content doesn't stall on branch misses
+            const uint32_t steps[3] = {dr, dg, db};
+            const float fracs[3] = {fr, fg, fb};
+            const uint8_t *order = kTetrahedronOrder[(fr >= fg) * 4 + (fg >= fb) * 2 + (fr >= fb)];
+            const int first = order[0], second = order[1], third = order[2];
+            const float *c1 = c000 + steps[first];
+            const float *c2 = c1 + steps[second];
+            const float *c3 = c2 + steps[third];
+            Pixel4 p0 = Load4(c000);
+            Pixel4 p1 = Load4(c1);
+            Pixel4 p2 = Load4(c2);
+            Pixel4 p3 = Load4(c3);
+            out = MulAdd4(MulAdd4(MulAdd4(p0, Sub4(p1, p0), fracs[first]), Sub4(p2, p1), fracs[second]),
+                          Sub4(p3, p2), fracs[third]);
+        }
+        StoreBytes(out, dst);
+        dst[3] = alpha;
+    }
+}
+
+void ColorGrade::ApplyRow(const uint8_t *src, uint8_t *dst, size_t count) const
+{
+    if (lut_size_)
+        ApplyLutRow(src, dst, count);
+    else if (!matrix_table_.empty())
+        ApplyMatrixRow(src, dst, count);
+    else if (src != dst)
+        std::memmove(dst, src, count * 4);
+}
@@ -0,0 +1,283 @@
+#include "image_filter.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define FILTER_SSE2 1
+#endif
+
+// rows per ParallelFor job, and per transposed block write
+static const uint32_t FILTER_BAND_ROWS = 32;
+
+#ifdef FILTER_SSE2
+typedef __m128 Pixel4;
+static inline Pixel4 Zero4() { return _mm_setzero_ps(); }
+static inline Pixel4 Load4(const float *p) { return _mm_loadu_ps(p); }
+static inline void Store4(float *p, Pixel4 v) { _mm_storeu_ps(p, v); }
+static inline Pixel4 Add4(Pixel4 a, Pixel4 b) { return _mm_add_ps(a, b); }
+static inline Pixel4 Sub4(Pixel4 a, Pixel4 b) { return _mm_sub_ps(a, b); }
+static inline Pixel4 Scale4(Pixel4 a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+static inline Pixel4 MulAdd4(Pixel4 acc, const float *p, float w) { return _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(p), _mm_set1_ps(w))); }
+#else
+struct Pixel4
+{
+    float v[4];
+};
+static inline Pixel4 Zero4() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+static inline Pixel4 Load4(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void Store4(float *p, Pixel4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+static inline Pixel4 Add4(Pixel4 a, Pixel4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+static inline Pixel4 Sub4(Pixel4 a, Pixel4 b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+static inline Pixel4 Scale4(Pixel4 a, float s) { return {{a.v[0] * s, a.v[1] * s, a.v[2] * s, a.v[3] * s}}; }
+static inline Pixel4 MulAdd4(Pixel4 acc, const float *p, float w)
+{
+    for (int c = 0; c < 4; c++)
+        acc.v[c] += p[c] * w;
+    return acc;
+}
+#endif
+
+// straight-alpha RGBA8 -> premultiplied floats
+static void PremultiplyLine(const uint8_t *src, uint32_t count, float *out)
+{
+    for (uint32_t i = 0; i < count; i++, src += 4, out += 4)
+    {
+        float a = src[3] * (1.0f / 255.0f);
+        out[0] = src[0] * a;
+        out[1] = src[1] * a;
+        out[2] = src[2] * a;
+        out[3] = src[3];
+    }
+}
+
+static inline uint8_t ToByte(float v)
+{
+    return static_cast<uint8_t>(std::min(std::max(v, 0.0f), 255.0f) + 0.5f);
+}
+
+static inline void Unpremultiply(const float *px, float bias, uint8_t *out)
+{
+    if (px[3] < 0.5f)
+    {
+        std::memset(out, 0, 4);
+        return;
+    }
+    float unpremultiply = 255.0f / std::min(px[3], 255.0f);
+    out[0] = ToByte(px[0] * unpremultiply + bias);
+    out[1] = ToByte(px[1] * unpremultiply + bias);
+    out[2] = ToByte(px[2] * unpremultiply + bias);
+    out[3] = ToByte(px[3]);
+}
+
+// one running-sum box over count pixels; the window slides one add and one
+// subtract per pixel whatever the radius
+static void BoxLine(const float *in, float *out, uint32_t count, uint32_t radius)
+{
+    const uint32_t last = count - 1;
+    Pixel4 sum = Scale4(Load4(in), radius + 1.0f);
+    for (uint32_t k = 1; k <= radius; k++)
+        sum = Add4(sum, Load4(in + std::min(k, last) * 4));
+
+    const float norm = 1.0f / (2 * radius + 1);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        Store4(out + i * 4, Scale4(sum, norm));
+        uint32_t add = std::min(i + radius + 1, last);
+        uint32_t sub = i > radius ? i - radius : 0;
+        sum = Add4(sum, Sub4(Load4(in + add * 4), Load4(in + sub * 4)));
+    }
+}
+
+// box radii for a blur; a Gaussian is three boxes whose widths add up to
+// its variance (Kovesi, "Fast almost-Gaussian filtering")
+static uint32_t BlurRadii(const ImageFilter &filter, uint32_t radii[3])
+{
+    if (!(filter.radius > 0.0f))
+        return 0;
+    if (filter.type == FILTER_BOX_BLUR)
+    {
+        radii[0] = static_cast<uint32_t>(std::min(filter.radius + 0.5f, 65535.0f));
+        return radii[0] > 0 ? 1 : 0;
+    }
+
+    const float sigma = std::min(filter.radius, 10000.0f);
+    const int passes = 3;
+    int lower = static_cast<int>(std::sqrt(12.0f * sigma * sigma / passes + 1.0f));
+    if (lower % 2 == 0)
+        lower--;
+    int wide = static_cast<int>(std::lround((12.0f * sigma * sigma - passes * lower * lower - 4.0f * passes * lower - 3.0f * passes) /
+                                            (-4.0f * lower - 4.0f)));
+    uint32_t count = 0;
+    for (int i = 0; i < passes; i++)
+    {
+        int width = i < wide ? lower : lower + 2;
+        if (width > 1)
+            radii[count++] = static_cast<uint32_t>((width - 1) / 2);
+    }
+    return count;
+}
+
+// runs the boxes over line (count pixels) using scratch, result in line
+static void BoxPasses(float *line, float *scratch, uint32_t count, const uint32_t *radii, uint32_t passes)
+{
+    for (uint32_t p = 0; p < passes; p++)
+    {
+        BoxLine(line, scratch, count, radii[p]);
+        std::swap(line, scratch);
+    }
+    if (passes & 1)
+        std::memcpy(scratch, line, static_cast<size_t>(count) * 16);
+}
+
+static void Blur(const ImageFilter &filter, const FilterImage &src, const FilterImage &dst, WorkerPool &pool)
+{
+    uint32_t radii[3];
+    const uint32_t passes = BlurRadii(filter, radii);
+    const uint32_t w = src.width;
+    const uint32_t h = src.height;
+    if (passes == 0)
+    {
+        if (dst.data != src.data)
+        {
+            for (uint32_t y = 0; y < h; y++)
+                std::memmove(dst.data + static_cast<size_t>(y) * dst.stride, src.data + static_cast<size_t>(y) * src.stride, static_cast<size_t>(w) * 4);
+        }
+        return;
+    }
+
+    // w rows of h pixels: the image after the horizontal pass, transposed.
+    // Shared by every band, so the lambdas take its pointer
+    std::vector<float> transposedBuffer(static_cast<size_t>(w) * h * 4);
+    float *transposed = transposedBuffer.data();
+
+    size_t bands = (h + FILTER_BAND_ROWS - 1) / FILTER_BAND_ROWS;
+    pool.ParallelFor(bands, [&](size_t b)
+                     {
+                         thread_local std::vector<float> lines, scratch;
+                         lines.resize(static_cast<size_t>(FILTER_BAND_ROWS) * w * 4);
+                         scratch.resize(static_cast<size_t>(w) * 4);
+                         const uint32_t y0 = static_cast<uint32_t>(b) * FILTER_BAND_ROWS;
+                         const uint32_t rows = std::min(h - y0, FILTER_BAND_ROWS);
+                         for (uint32_t r = 0; r < rows; r++)
+                         {
+                             float *line = &lines[static_cast<size_t>(r) * w * 4];
+                             PremultiplyLine(src.data + static_cast<size_t>(y0 + r) * src.stride, w, line);
+                             BoxPasses(line, scratch.data(), w, radii, passes);
+                         }
+                         // the band lands as a run of rows pixels in each transposed row
+                         for (uint32_t x = 0; x < w; x++)
+                         {
+                             float *t = &transposed[(static_cast<size_t>(x) * h + y0) * 4];
+                             for (uint32_t r = 0; r < rows; r++)
+                                 std::memcpy(t + r * 4, &lines[(static_cast<size_t>(r) * w + x) * 4], 16);
+                         } });
+
+    bands = (w + FILTER_BAND_ROWS - 1) / FILTER_BAND_ROWS;
+    pool.ParallelFor(bands, [&](size_t b)
+                     {
+                         thread_local std::vector<float> scratch;
+                         scratch.resize(static_cast<size_t>(h) * 4);
+                         const uint32_t x0 = static_cast<uint32_t>(b) * FILTER_BAND_ROWS;
+                         const uint32_t cols = std::min(w - x0, FILTER_BAND_ROWS);
+                         for (uint32_t c = 0; c < cols; c++)
+                             BoxPasses(&transposed[static_cast<size_t>(x0 + c) * h * 4], scratch.data(), h, radii, passes);
+                         // and back: each output row gets a run of cols pixels
+                         for (uint32_t y = 0; y < h; y++)
+                         {
+                             uint8_t *out = dst.data + static_cast<size_t>(y) * dst.stride + static_cast<size_t>(x0) * 4;
+                             for (uint32_t c = 0; c < cols; c++)
+                                 Unpremultiply(&transposed[(static_cast<size_t>(x0 + c) * h + y) * 4], 0.0f, out + c * 4);
+                         } });
+}
+
+static void Convolve(const ImageFilter &filter, const FilterImage &src, const FilterImage &dst, WorkerPool &pool)
+{
+    const uint32_t k = filter.size;
+    const uint32_t half = k / 2;
+    const uint32_t w = src.width;
+    const uint32_t h = src.height;
+
+    float divisor = filter.divisor;
+    if (divisor == 0.0f)
+    {
+        for (uint32_t i = 0; i < k * k; i++)
+            divisor += filter.kernel[i];
+        if (divisor == 0.0f)
+            divisor = 1.0f;
+    }
+    float weights[FILTER_MAX_KERNEL * FILTER_MAX_KERNEL];
+    for (uint32_t i = 0; i < k * k; i++)
+        weights[i] = filter.kernel[i] / divisor;
+
+    // premultiplied copy with the border extended by half the kernel, so
+    // the kernel loop never clamps (and dst may overwrite src)
+    const uint32_t pw = w + 2 * half;
+    const uint32_t ph = h + 2 * half;
+    std::vector<float> paddedBuffer(static_cast<size_t>(pw) * ph * 4);
+    float *padded = paddedBuffer.data();
+
+    size_t bands = (ph + FILTER_BAND_ROWS - 1) / FILTER_BAND_ROWS;
+    pool.ParallelFor(bands, [&](size_t b)
+                     {
+                         const uint32_t first = static_cast<uint32_t>(b) * FILTER_BAND_ROWS;
+                         const uint32_t last = std::min(ph, first + FILTER_BAND_ROWS);
+                         for (uint32_t py = first; py < last; py++)
+                         {
+                             uint32_t sy = std::min(std::max(py, half) - half, h - 1);
+                             float *row = &padded[static_cast<size_t>(py) * pw * 4];
+                             PremultiplyLine(src.data + static_cast<size_t>(sy) * src.stride, w, row + half * 4);
+                             for (uint32_t i = 0; i < half; i++)
+                             {
+                                 std::memcpy(row + i * 4, row + half * 4, 16);
+                                 std::memcpy(row + (half + w + i) * 4, row + (half + w - 1) * 4, 16);
+                             }
+                         } });
+
+    bands = (h + FILTER_BAND_ROWS - 1) / FILTER_BAND_ROWS;
+    pool.ParallelFor(bands, [&](size_t b)
+                     {
+                         const uint32_t first = static_cast<uint32_t>(b) * FILTER_BAND_ROWS;
+                         const uint32_t last = std::min(h, first + FILTER_BAND_ROWS);
+                         for (uint32_t y = first; y < last; y++)
+                         {
+                             uint8_t *out = dst.data + static_cast<size_t>(y) * dst.stride;
+                             for (uint32_t x = 0; x < w; x++)
+                             {
+                                 Pixel4 acc = Zero4();
+                                 for (uint32_t i = 0; i < k; i++)
+                                 {
+                                     const float *p = &padded[(static_cast<size_t>(y + i) * pw + x) * 4];
+                                     for (uint32_t j = 0; j < k; j++)
+                                         acc = MulAdd4(acc, p + j * 4, weights[i * k + j]);
+                                 }
+                                 float px[4];
+                                 Store4(px, acc);
+                                 Unpremultiply(px, filter.bias, out + x * 4);
+                             }
+                         } });
+}
+
+bool ApplyImageFilter(const ImageFilter &filter, const FilterImage &src, const FilterImage &dst, WorkerPool &pool)
+{
+    if (src.width != dst.width || src.height != dst.height || !src.data || !dst.data)
+        return false;
+    if (src.width == 0 || src.height == 0)
+        return true;
+
+    switch (filter.type)
+    {
+    case FILTER_BOX_BLUR:
+    case FILTER_GAUSSIAN_BLUR:
+        Blur(filter, src, dst, pool);
+        return true;
+    case FILTER_CONVOLVE:
+        if (filter.size != 3 && filter.size != 5)
+            return false;
+        Convolve(filter, src, dst, pool);
+        return true;
+    default:
+        return false;
+    }
+}
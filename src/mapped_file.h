@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+// Implemented per platform in mapped_file_posix.cpp / mapped_file_win.cpp
+class MappedFile
+{
+public:
+    // returns nullptr if the file can't be opened or mapped
+    static MappedFile *Open(const std::string &path);
+    ~MappedFile();
+
+    const uint8_t *Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+private:
+    MappedFile() : data_(nullptr), size_(0), file_(nullptr), mapping_(nullptr) {}
+
+    const uint8_t *data_;
+    size_t size_;
+    void *file_;    // platform file handle (windows only)
+    void *mapping_; // platform mapping handle (windows only)
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+};
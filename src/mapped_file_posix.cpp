@@ -0,0 +1,44 @@
+#ifndef _WIN32
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "mapped_file.h"
+
+MappedFile *MappedFile::Open(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    void *ptr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    close(fd);
+
+    if (ptr == MAP_FAILED)
+        return nullptr;
+
+    MappedFile *file = new MappedFile();
+    file->data_ = static_cast<const uint8_t *>(ptr);
+    file->size_ = static_cast<size_t>(st.st_size);
+    return file;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+    {
+        munmap(const_cast<uint8_t *>(data_), size_);
+        data_ = nullptr;
+    }
+}
+
+#endif // !_WIN32
@@ -0,0 +1,57 @@
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "mapped_file.h"
+
+MappedFile *MappedFile::Open(const std::string &path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return nullptr;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    void *ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!ptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    MappedFile *mapped = new MappedFile();
+    mapped->data_ = static_cast<const uint8_t *>(ptr);
+    mapped->size_ = static_cast<size_t>(size.QuadPart);
+    mapped->file_ = file;
+    mapped->mapping_ = mapping;
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+        data_ = nullptr;
+    }
+    if (mapping_)
+        CloseHandle(static_cast<HANDLE>(mapping_));
+    if (file_)
+        CloseHandle(static_cast<HANDLE>(file_));
+}
+
+#endif // _WIN32
@@ -0,0 +1,356 @@
+#include "noise.h"
+#include <algorithm>
+#include <cmath>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define NOISE_SSE2 1
+#endif
+
+static const float TWO_PI = 6.28318530718f;
+
+// simplex skew / unskew factors for 2D
+static const float SKEW_2D = 0.36602540378f;   // (sqrt(3) - 1) / 2
+static const float UNSKEW_2D = 0.21132486540f; // (3 - sqrt(3)) / 6
+
+static uint64_t SplitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+static float UnitFloat(uint64_t &state)
+{
+    return static_cast<float>(SplitMix64(state) >> 40) * (1.0f / 16777216.0f);
+}
+
+// Saturates at +-2^29 (NaN goes low) instead of overflowing the int cast, with
+// room left for the ci + cj and xi + 1 lattice sums. Floats that far out
+// have no fraction left, so the noise there is junk either way; it just
+// has to stay defined.
+static inline int32_t FastFloor(float v)
+{
+    const float limit = 536870912.0f;
+    v = v > -limit ? (v < limit ? v : limit) : -limit;
+    int32_t i = static_cast<int32_t>(v);
+    return v < static_cast<float>(i) ? i - 1 : i;
+}
+
+// quintic: zero first and second derivative at the lattice
+static inline float Fade(float t)
+{
+    return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+NoiseGenerator::NoiseGenerator(const NoiseParams &params) : params_(params)
+{
+    params_.octaves = std::min<uint32_t>(std::max<uint32_t>(params_.octaves, 1), NOISE_MAX_OCTAVES);
+    params_.lacunarity = params_.lacunarity > 0.0f && std::isfinite(params_.lacunarity) ? params_.lacunarity : 2.0f;
+    params_.gain = params_.gain > 0.0f && std::isfinite(params_.gain) ? params_.gain : 0.0f;
+    if (!std::isfinite(params_.scale))
+        params_.scale = 0.01f;
+    if (!std::isfinite(params_.offsetX) || !std::isfinite(params_.offsetY))
+        params_.offsetX = params_.offsetY = 0.0f;
+    if (!std::isfinite(params_.time))
+        params_.time = 0.0f;
+
+    uint64_t state = params_.seed;
+    for (uint32_t i = 0; i < 256; i++)
+        perm_[i] = static_cast<uint8_t>(i);
+    for (uint32_t i = 255; i > 0; i--)
+        std::swap(perm_[i], perm_[SplitMix64(state) % (i + 1)]);
+    for (uint32_t i = 0; i < 256; i++)
+        perm_[i + 256] = perm_[i];
+
+    // every lattice feature turns at its own rate, half of them backwards
+    const float time = params_.time;
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        float speed = 0.5f + UnitFloat(state);
+        if (SplitMix64(state) & 1)
+            speed = -speed;
+
+        float angle = UnitFloat(state) * TWO_PI + time * speed;
+        gradX_[i] = std::cos(angle);
+        gradY_[i] = std::sin(angle);
+
+        value_[i] = std::sin(UnitFloat(state) * TWO_PI + time * speed);
+
+        // orbit stays inside the cell, so a 3x3 search always finds the nearest
+        angle = UnitFloat(state) * TWO_PI + time * speed;
+        float radius = 0.15f + 0.25f * UnitFloat(state);
+        pointX_[i] = 0.5f + radius * std::cos(angle);
+        pointY_[i] = 0.5f + radius * std::sin(angle);
+    }
+}
+
+// first pixel past i whose sample leaves lattice column xi
+static inline uint32_t CellRunEnd(float x, float step, uint32_t i, uint32_t count, int32_t xi)
+{
+    if (!(step > 0.0f))
+        return step == 0.0f ? count : i + 1;
+    float left = (xi + 1 - (x + i * step)) / step;
+    if (!(left < static_cast<float>(count - i)))
+        return count; // also when far out coordinates make it NaN
+    return left < 1.0f ? i + 1 : i + static_cast<uint32_t>(std::ceil(left));
+}
+
+// One octave in [-1, 1]. Along a row y is fixed, so everything that depends
+// only on y and the lattice column is set up once per cell and each pixel
+// pays a few multiply-adds.
+void NoiseGenerator::BaseRow(float x, float y, float step, uint32_t count, float *out) const
+{
+    switch (params_.type)
+    {
+    case NOISE_SIMPLEX:
+    {
+        uint32_t i = 0;
+#ifdef NOISE_SSE2
+        // geometry four pixels at a time, only the hash lookups stay scalar
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 vy = _mm_set1_ps(y);
+        const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+        auto floor4 = [&](__m128 v)
+        {
+            __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+            return _mm_sub_ps(t, _mm_and_ps(_mm_cmplt_ps(v, t), one));
+        };
+        auto falloff4 = [&](__m128 dx, __m128 dy)
+        {
+            __m128 t = _mm_max_ps(_mm_sub_ps(half, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy))), zero);
+            t = _mm_mul_ps(t, t);
+            return _mm_mul_ps(t, t);
+        };
+        for (; i + 4 <= count; i += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps(x), _mm_mul_ps(_mm_add_ps(_mm_set1_ps(static_cast<float>(i)), lanes), _mm_set1_ps(step)));
+            __m128 skew = _mm_mul_ps(_mm_add_ps(px, vy), _mm_set1_ps(SKEW_2D));
+            __m128 ci = floor4(_mm_add_ps(px, skew));
+            __m128 cj = floor4(_mm_add_ps(vy, skew));
+            __m128 unskew = _mm_mul_ps(_mm_add_ps(ci, cj), _mm_set1_ps(UNSKEW_2D));
+            __m128 x0 = _mm_sub_ps(px, _mm_sub_ps(ci, unskew));
+            __m128 y0 = _mm_sub_ps(vy, _mm_sub_ps(cj, unskew));
+            __m128 upper = _mm_and_ps(_mm_cmpgt_ps(x0, y0), one); // i1, and j1 = 1 - i1
+            __m128 x1 = _mm_add_ps(_mm_sub_ps(x0, upper), _mm_set1_ps(UNSKEW_2D));
+            __m128 y1 = _mm_add_ps(_mm_sub_ps(_mm_add_ps(y0, upper), one), _mm_set1_ps(UNSKEW_2D));
+            __m128 x2 = _mm_add_ps(x0, _mm_set1_ps(2.0f * UNSKEW_2D - 1.0f));
+            __m128 y2 = _mm_add_ps(y0, _mm_set1_ps(2.0f * UNSKEW_2D - 1.0f));
+
+            alignas(16) int32_t ii[4], jj[4], up[4];
+            alignas(16) float g[6][4];
+            _mm_store_si128(reinterpret_cast<__m128i *>(ii), _mm_cvttps_epi32(ci));
+            _mm_store_si128(reinterpret_cast<__m128i *>(jj), _mm_cvttps_epi32(cj));
+            _mm_store_si128(reinterpret_cast<__m128i *>(up), _mm_cvttps_epi32(upper));
+            for (int l = 0; l < 4; l++)
+            {
+                uint32_t h0 = perm_[perm_[ii[l] & 255] + (jj[l] & 255)];
+                uint32_t h1 = perm_[perm_[(ii[l] + up[l]) & 255] + ((jj[l] + 1 - up[l]) & 255)];
+                uint32_t h2 = perm_[perm_[(ii[l] + 1) & 255] + ((jj[l] + 1) & 255)];
+                g[0][l] = gradX_[h0];
+                g[1][l] = gradY_[h0];
+                g[2][l] = gradX_[h1];
+                g[3][l] = gradY_[h1];
+                g[4][l] = gradX_[h2];
+                g[5][l] = gradY_[h2];
+            }
+
+            __m128 n = _mm_mul_ps(falloff4(x0, y0), _mm_add_ps(_mm_mul_ps(_mm_load_ps(g[0]), x0), _mm_mul_ps(_mm_load_ps(g[1]), y0)));
+            n = _mm_add_ps(n, _mm_mul_ps(falloff4(x1, y1), _mm_add_ps(_mm_mul_ps(_mm_load_ps(g[2]), x1), _mm_mul_ps(_mm_load_ps(g[3]), y1))));
+            n = _mm_add_ps(n, _mm_mul_ps(falloff4(x2, y2), _mm_add_ps(_mm_mul_ps(_mm_load_ps(g[4]), x2), _mm_mul_ps(_mm_load_ps(g[5]), y2))));
+            _mm_storeu_ps(out + i, _mm_mul_ps(n, _mm_set1_ps(99.0f)));
+        }
+#endif
+        for (; i < count; i++)
+        {
+            float px = x + i * step;
+            float skew = (px + y) * SKEW_2D;
+            int32_t ci = FastFloor(px + skew);
+            int32_t cj = FastFloor(y + skew);
+            float unskew = (ci + cj) * UNSKEW_2D;
+            float x0 = px - (ci - unskew);
+            float y0 = y - (cj - unskew);
+            int32_t i1 = x0 > y0 ? 1 : 0;
+            int32_t j1 = 1 - i1;
+            float x1 = x0 - i1 + UNSKEW_2D;
+            float y1 = y0 - j1 + UNSKEW_2D;
+            float x2 = x0 - 1.0f + 2.0f * UNSKEW_2D;
+            float y2 = y0 - 1.0f + 2.0f * UNSKEW_2D;
+
+            const uint8_t *row0 = perm_ + perm_[ci & 255];
+            const uint8_t *row1 = perm_ + perm_[(ci + i1) & 255];
+            const uint8_t *row2 = perm_ + perm_[(ci + 1) & 255];
+            uint32_t h0 = row0[cj & 255];
+            uint32_t h1 = row1[(cj + j1) & 255];
+            uint32_t h2 = row2[(cj + 1) & 255];
+
+            // corners out of reach clamp to zero instead of branching
+            float t0 = std::max(0.5f - x0 * x0 - y0 * y0, 0.0f);
+            float t1 = std::max(0.5f - x1 * x1 - y1 * y1, 0.0f);
+            float t2 = std::max(0.5f - x2 * x2 - y2 * y2, 0.0f);
+            t0 *= t0;
+            t1 *= t1;
+            t2 *= t2;
+            float n = t0 * t0 * (gradX_[h0] * x0 + gradY_[h0] * y0) +
+                      t1 * t1 * (gradX_[h1] * x1 + gradY_[h1] * y1) +
+                      t2 * t2 * (gradX_[h2] * x2 + gradY_[h2] * y2);
+            // unit gradients peak just under 1 / 99
+            out[i] = n * 99.0f;
+        }
+        return;
+    }
+
+    case NOISE_CELLULAR:
+    {
+        const int32_t yi = FastFloor(y);
+        const float fy = y - yi;
+        float px[9], py[9];
+        for (uint32_t i = 0; i < count;)
+        {
+            const int32_t xi = FastFloor(x + i * step);
+            const uint32_t end = CellRunEnd(x, step, i, count, xi);
+            // the 3x3 neighbourhood's points, relative to this cell
+            for (int32_t dx = -1, k = 0; dx <= 1; dx++)
+            {
+                const uint8_t *column = perm_ + perm_[(xi + dx) & 255];
+                for (int32_t dy = -1; dy <= 1; dy++, k++)
+                {
+                    uint32_t h = column[(yi + dy) & 255];
+                    px[k] = dx + pointX_[h];
+                    py[k] = (dy + pointY_[h] - fy) * (dy + pointY_[h] - fy);
+                }
+            }
+
+            // point by point over the run, so the pixel loops vectorize
+            const float origin = x - xi;
+            std::fill(out + i, out + end, 8.0f);
+            for (int k = 0; k < 9; k++)
+            {
+                const float cx = px[k] - origin;
+                const float cy = py[k];
+                for (uint32_t j = i; j < end; j++)
+                {
+                    float d = cx - j * step;
+                    d = d * d + cy;
+                    out[j] = d < out[j] ? d : out[j];
+                }
+            }
+            i = end;
+        }
+        for (uint32_t i = 0; i < count; i++)
+            out[i] = std::min(std::sqrt(out[i]), 1.0f) * 2.0f - 1.0f;
+        return;
+    }
+
+    case NOISE_VALUE:
+    {
+        const int32_t yi = FastFloor(y);
+        const float v = Fade(y - yi);
+        const int32_t Y = yi & 255;
+        for (uint32_t i = 0; i < count;)
+        {
+            const int32_t xi = FastFloor(x + i * step);
+            const uint32_t end = CellRunEnd(x, step, i, count, xi);
+            // both lattice columns already blended along y
+            const uint8_t *c0 = perm_ + perm_[xi & 255];
+            const uint8_t *c1 = perm_ + perm_[(xi + 1) & 255];
+            const float left = value_[c0[Y]] + v * (value_[c0[Y + 1]] - value_[c0[Y]]);
+            const float right = value_[c1[Y]] + v * (value_[c1[Y + 1]] - value_[c1[Y]]);
+
+            const float origin = x - xi;
+            for (; i < end; i++)
+                out[i] = left + Fade(origin + i * step) * (right - left);
+        }
+        return;
+    }
+
+    default:
+    {
+        const int32_t yi = FastFloor(y);
+        const float fy = y - yi;
+        const float v = Fade(fy);
+        const int32_t Y = yi & 255;
+        for (uint32_t i = 0; i < count;)
+        {
+            const int32_t xi = FastFloor(x + i * step);
+            const uint32_t end = CellRunEnd(x, step, i, count, xi);
+            // corner dot products blended along y, linear in fx: a * fx + b
+            const uint8_t *c0 = perm_ + perm_[xi & 255];
+            const uint8_t *c1 = perm_ + perm_[(xi + 1) & 255];
+            uint32_t h00 = c0[Y], h01 = c0[Y + 1], h10 = c1[Y], h11 = c1[Y + 1];
+            const float a0 = gradX_[h00] + v * (gradX_[h01] - gradX_[h00]);
+            const float b0 = gradY_[h00] * fy + v * (gradY_[h01] * (fy - 1.0f) - gradY_[h00] * fy);
+            const float a1 = gradX_[h10] + v * (gradX_[h11] - gradX_[h10]);
+            const float b1 = gradY_[h10] * fy + v * (gradY_[h11] * (fy - 1.0f) - gradY_[h10] * fy) - a1;
+
+            const float origin = x - xi;
+            for (; i < end; i++)
+            {
+                float fx = origin + i * step;
+                float n0 = a0 * fx + b0;
+                float n1 = a1 * fx + b1;
+                // unit gradients reach sqrt(1/2) at most
+                out[i] = (n0 + Fade(fx) * (n1 - n0)) * 1.41421356f;
+            }
+        }
+        return;
+    }
+    }
+}
+
+void NoiseGenerator::Row(float x, float y, float step, uint32_t count, float *out) const
+{
+    thread_local std::vector<float> octave;
+    if (octave.size() < count)
+        octave.resize(count);
+    std::fill(out, out + count, 0.0f);
+
+    float frequency = params_.scale;
+    float amplitude = 1.0f;
+    float total = 0.0f;
+    for (uint32_t o = 0; o < params_.octaves; o++)
+    {
+        // shifted off the previous octave's lattice so crests don't line up
+        float shift = o * 19.19f;
+        BaseRow((x + params_.offsetX) * frequency + shift, (y + params_.offsetY) * frequency + shift * 0.382f,
+                step * frequency, count, octave.data());
+
+        const float *n = octave.data();
+        switch (params_.fractal)
+        {
+        case NOISE_RIDGED:
+            for (uint32_t i = 0; i < count; i++)
+            {
+                float ridge = 1.0f - std::fabs(n[i]);
+                out[i] += amplitude * ridge * ridge;
+            }
+            break;
+        case NOISE_TURBULENCE:
+            for (uint32_t i = 0; i < count; i++)
+                out[i] += amplitude * std::fabs(n[i]);
+            break;
+        default:
+            for (uint32_t i = 0; i < count; i++)
+                out[i] += amplitude * n[i];
+            break;
+        }
+
+        total += amplitude;
+        frequency *= params_.lacunarity;
+        amplitude *= params_.gain;
+    }
+
+    // fbm is signed, the others already run from 0
+    const float norm = 1.0f / total;
+    const float bias = params_.fractal == NOISE_FBM ? 0.5f : 0.0f;
+    const float gain = params_.fractal == NOISE_FBM ? 0.5f * norm : norm;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // written so NaN lands on 0: the result indexes colour ramps
+        float v = out[i] * gain + bias;
+        out[i] = v > 0.0f ? (v < 1.0f ? v : 1.0f) : 0.0f;
+    }
+}
@@ -0,0 +1,194 @@
+#include "pixel_ops.h"
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PIXEL_OPS_SSE2 1
+#endif
+
+// blended colour channel before coverage is applied
+static inline uint32_t BlendChannel(uint32_t d, uint32_t s, BlendMode mode)
+{
+    switch (mode)
+    {
+    case BLEND_ADD:
+        return d + s > 255 ? 255 : d + s;
+    case BLEND_MULTIPLY:
+        return Div255(d * s);
+    case BLEND_SCREEN:
+        return d + s - Div255(d * s);
+    default:
+        return s;
+    }
+}
+
+static inline void BlendPixel(uint8_t *d, const uint8_t *s, uint32_t opacity, BlendMode mode)
+{
+    uint32_t a = Div255(s[3] * opacity);
+    if (a == 0)
+        return;
+
+    uint32_t inv = 255 - a;
+    for (int c = 0; c < 3; c++)
+        d[c] = static_cast<uint8_t>(Div255(BlendChannel(d[c], s[c], mode) * a + d[c] * inv));
+    d[3] = static_cast<uint8_t>(Div255(255 * a + d[3] * inv));
+}
+
+#ifdef PIXEL_OPS_SSE2
+// Div255 on eight u16 lanes
+static inline __m128i Div255x8(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// two pixels widened to u16 lanes
+static inline __m128i BlendTwo(__m128i d, __m128i s, __m128i opacity, BlendMode mode)
+{
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    const __m128i c255 = _mm_set1_epi16(255);
+
+    // per-pixel coverage broadcast to all four lanes
+    __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    a = Div255x8(_mm_mullo_epi16(a, opacity));
+
+    __m128i b;
+    switch (mode)
+    {
+    case BLEND_ADD:
+        b = _mm_min_epi16(_mm_add_epi16(d, s), c255);
+        break;
+    case BLEND_MULTIPLY:
+        b = Div255x8(_mm_mullo_epi16(d, s));
+        break;
+    case BLEND_SCREEN:
+        b = _mm_sub_epi16(_mm_add_epi16(d, s), Div255x8(_mm_mullo_epi16(d, s)));
+        break;
+    default:
+        b = s;
+        break;
+    }
+    // alpha always composes as source-over
+    b = _mm_or_si128(_mm_andnot_si128(alphaLanes, b), _mm_and_si128(alphaLanes, c255));
+
+    __m128i inv = _mm_sub_epi16(c255, a);
+    return Div255x8(_mm_add_epi16(_mm_mullo_epi16(b, a), _mm_mullo_epi16(d, inv)));
+}
+#endif
+
+void BlendSpan(uint8_t *dst, const uint8_t *src, size_t count, uint32_t opacity, BlendMode mode)
+{
+    if (opacity == 0)
+        return;
+    if (opacity > 255)
+        opacity = 255;
+
+    size_t i = 0;
+#ifdef PIXEL_OPS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i op = _mm_set1_epi16(static_cast<short>(opacity));
+    const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i * 4));
+        int alpha = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(s, alphaMask), zero)) & 0x8888;
+
+        // fully transparent quad: nothing to do
+        if (alpha == 0x8888)
+            continue;
+
+        // fully opaque quad, plain source-over at full opacity: straight copy
+        if (mode == BLEND_NORMAL && opacity == 255 &&
+            (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(s, alphaMask), alphaMask)) & 0x8888) == 0x8888)
+        {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), s);
+            continue;
+        }
+
+        __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst + i * 4));
+        __m128i lo = BlendTwo(_mm_unpacklo_epi8(d, zero), _mm_unpacklo_epi8(s, zero), op, mode);
+        __m128i hi = BlendTwo(_mm_unpackhi_epi8(d, zero), _mm_unpackhi_epi8(s, zero), op, mode);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < count; i++)
+        BlendPixel(dst + i * 4, src + i * 4, opacity, mode);
+}
+
+void FillSpan(uint8_t *dst, uint32_t rgba, size_t count)
+{
+    size_t i = 0;
+#ifdef PIXEL_OPS_SSE2
+    const __m128i v = _mm_set1_epi32(static_cast<int>(rgba));
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * 4), v);
+#endif
+    for (; i < count; i++)
+        std::memcpy(dst + i * 4, &rgba, 4);
+}
+
+void BlendMaskSpan(uint8_t *dst, uint32_t rgba, const uint8_t *mask, size_t count)
+{
+    uint8_t src[4];
+    std::memcpy(src, &rgba, 4);
+
+    size_t i = 0;
+    while (i < count)
+    {
+        if (mask[i] == 0)
+        {
+            i++;
+            continue;
+        }
+
+        // shape interiors: runs of full coverage are a plain fill
+        if (mask[i] == 255 && src[3] == 255)
+        {
+            size_t end = i;
+            while (end < count && mask[end] == 255)
+                end++;
+            FillSpan(dst + i * 4, rgba, end - i);
+            i = end;
+            continue;
+        }
+
+        BlendPixel(dst + i * 4, src, mask[i], BLEND_NORMAL);
+        i++;
+    }
+}
+
+void BuildGradientRamp(const GradientStop *stops, size_t count, uint8_t ramp[256 * 4])
+{
+    for (int i = 0; i < 256; i++)
+    {
+        uint8_t *out = ramp + i * 4;
+        if (count == 0)
+        {
+            std::memset(out, 0, 4);
+            continue;
+        }
+
+        float t = i / 255.0f;
+        size_t k = 0;
+        while (k < count && stops[k].offset < t)
+            k++;
+
+        const GradientStop &hi = stops[k == count ? count - 1 : k];
+        if (k == 0 || k == count)
+        {
+            out[0] = hi.r;
+            out[1] = hi.g;
+            out[2] = hi.b;
+            out[3] = hi.a;
+            continue;
+        }
+
+        // lo.offset < t <= hi.offset, so the span is never empty
+        const GradientStop &lo = stops[k - 1];
+        float f = (t - lo.offset) / (hi.offset - lo.offset);
+        out[0] = static_cast<uint8_t>(lo.r + (hi.r - lo.r) * f + 0.5f);
+        out[1] = static_cast<uint8_t>(lo.g + (hi.g - lo.g) * f + 0.5f);
+        out[2] = static_cast<uint8_t>(lo.b + (hi.b - lo.b) * f + 0.5f);
+        out[3] = static_cast<uint8_t>(lo.a + (hi.a - lo.a) * f + 0.5f);
+    }
+}
@@ -0,0 +1,478 @@
+#include "raster.h"
+#include "pixel_ops.h"
+#include <algorithm>
+#include <cmath>
+
+// float to int without UB for huge or NaN values, result in [lo, hi]
+static inline int ClampToInt(float v, int lo, int hi)
+{
+    if (!(v > static_cast<float>(lo)))
+        return lo;
+    if (v >= static_cast<float>(hi))
+        return hi;
+    return static_cast<int>(v);
+}
+
+// Liang-Barsky in double, so far-off endpoints don't overflow the deltas;
+// false when the segment misses the box or is not finite
+static bool ClipSegment(float &x0, float &y0, float &x1, float &y1,
+                        float minX, float minY, float maxX, float maxY)
+{
+    if (!std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+        return false;
+
+    double dx = static_cast<double>(x1) - x0;
+    double dy = static_cast<double>(y1) - y0;
+    const double p[4] = {-dx, dx, -dy, dy};
+    const double q[4] = {static_cast<double>(x0) - minX, maxX - static_cast<double>(x0),
+                         static_cast<double>(y0) - minY, maxY - static_cast<double>(y0)};
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (p[i] == 0.0)
+        {
+            if (q[i] < 0.0)
+                return false;
+            continue;
+        }
+        double r = q[i] / p[i];
+        if (p[i] < 0.0)
+            t0 = std::max(t0, r);
+        else
+            t1 = std::min(t1, r);
+        if (t0 > t1)
+            return false;
+    }
+
+    double ox = x0;
+    double oy = y0;
+    if (t0 > 0.0)
+    {
+        x0 = static_cast<float>(ox + dx * t0);
+        y0 = static_cast<float>(oy + dy * t0);
+    }
+    if (t1 < 1.0)
+    {
+        x1 = static_cast<float>(ox + dx * t1);
+        y1 = static_cast<float>(oy + dy * t1);
+    }
+    return true;
+}
+
+void CoverageRasterizer::Reset(uint32_t width, uint32_t height)
+{
+    // everything outside the touched spans is zero already
+    for (uint32_t y = 0; y < height_; y++)
+    {
+        if (span_lo_[y] <= span_hi_[y])
+        {
+            float *row = &cells_[static_cast<size_t>(y) * stride_];
+            std::fill(row + span_lo_[y], row + span_hi_[y] + 1, 0.0f);
+        }
+    }
+
+    width_ = width;
+    height_ = height;
+    stride_ = width + 2;
+    size_t size = static_cast<size_t>(stride_) * height;
+    if (cells_.size() < size)
+        cells_.resize(size, 0.0f);
+    span_lo_.assign(height, UINT32_MAX);
+    span_hi_.assign(height, 0);
+}
+
+void CoverageRasterizer::AddLine(float x0, float y0, float x1, float y1)
+{
+    if (y0 == y1 || !std::isfinite(x0) || !std::isfinite(y0) || !std::isfinite(x1) || !std::isfinite(y1))
+        return;
+
+    // Split where the edge crosses the left or right border and pin the
+    // outside pieces to it: winding from the left still reaches every pixel
+    // of the row, winding from the right reaches none.
+    // (in double: the deltas of far-off finite endpoints overflow float)
+    double dx = static_cast<double>(x1) - x0;
+    double dy = static_cast<double>(y1) - y0;
+    double ts[4] = {0.0, 0.0, 0.0, 1.0};
+    int n = 1;
+    for (float border : {0.0f, static_cast<float>(width_)})
+    {
+        if ((x0 < border) != (x1 < border) && x0 != border && x1 != border)
+            ts[n++] = (border - static_cast<double>(x0)) / dx;
+    }
+    ts[n++] = 1.0;
+    // at most two crossings in between
+    if (n == 4 && ts[2] < ts[1])
+        std::swap(ts[1], ts[2]);
+
+    float px = x0;
+    float py = y0;
+    for (int i = 1; i < n; i++)
+    {
+        float nx = i == n - 1 ? x1 : static_cast<float>(x0 + dx * ts[i]);
+        float ny = i == n - 1 ? y1 : static_cast<float>(y0 + dy * ts[i]);
+        AddClampedLine(px, py, nx, ny);
+        px = nx;
+        py = ny;
+    }
+}
+
+void CoverageRasterizer::AddClampedLine(float x0, float y0, float x1, float y1)
+{
+    const float right = static_cast<float>(width_);
+    x0 = std::min(std::max(x0, 0.0f), right);
+    x1 = std::min(std::max(x1, 0.0f), right);
+
+    float dir = 1.0f;
+    if (y0 > y1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+        dir = -1.0f;
+    }
+    if (y1 <= 0.0f || y0 >= static_cast<float>(height_) || y0 == y1)
+        return;
+
+    // rows outside the target take no coverage, so cutting the edge to them
+    // is exact and keeps the int row range below well defined
+    const float bottom = static_cast<float>(height_);
+    if (y0 < 0.0f || y1 > bottom)
+    {
+        double dxdy = (static_cast<double>(x1) - x0) / (static_cast<double>(y1) - y0);
+        double ox = x0;
+        double oy = y0;
+        auto xAt = [&](double y)
+        { return static_cast<float>(std::min(std::max(ox + (y - oy) * dxdy, 0.0), static_cast<double>(right))); };
+        if (y0 < 0.0f)
+        {
+            x0 = xAt(0.0);
+            y0 = 0.0f;
+        }
+        if (y1 > bottom)
+        {
+            x1 = xAt(bottom);
+            y1 = bottom;
+        }
+        if (y0 >= y1)
+            return;
+    }
+
+    float dxdy = (x1 - x0) / (y1 - y0);
+    int yStart = static_cast<int>(std::floor(y0));
+    int yEnd = std::min(static_cast<int>(height_), static_cast<int>(std::ceil(y1)));
+
+    for (int y = yStart; y < yEnd; y++)
+    {
+        float ya = std::max(static_cast<float>(y), y0);
+        float yb = std::min(static_cast<float>(y + 1), y1);
+        float dy = yb - ya;
+        if (dy <= 0.0f)
+            continue;
+
+        float xa = std::min(std::max(x0 + (ya - y0) * dxdy, 0.0f), right);
+        float xb = std::min(std::max(x0 + (yb - y0) * dxdy, 0.0f), right);
+        float d = dy * dir;
+        float *row = &cells_[static_cast<size_t>(y) * stride_];
+
+        float lo = std::min(xa, xb);
+        float hi = std::max(xa, xb);
+        float loFloor = std::floor(lo);
+        int loI = static_cast<int>(loFloor);
+        float hiCeil = std::ceil(hi);
+        int hiI = static_cast<int>(hiCeil);
+
+        span_lo_[y] = std::min(span_lo_[y], static_cast<uint32_t>(loI));
+        span_hi_[y] = std::max(span_hi_[y], static_cast<uint32_t>(std::max(hiI, loI + 1)));
+
+        if (hiI <= loI + 1)
+        {
+            // within one pixel column: split by the mean x
+            float xm = 0.5f * (xa + xb) - loFloor;
+            row[loI] += d - d * xm;
+            row[loI + 1] += d * xm;
+            continue;
+        }
+
+        // across columns: triangle at each end, constant steps in between
+        float s = 1.0f / (hi - lo);
+        float loF = lo - loFloor;
+        float a0 = 0.5f * s * (1.0f - loF) * (1.0f - loF);
+        float hiF = hi - hiCeil + 1.0f;
+        float am = 0.5f * s * hiF * hiF;
+
+        row[loI] += d * a0;
+        if (hiI == loI + 2)
+        {
+            row[loI + 1] += d * (1.0f - a0 - am);
+        }
+        else
+        {
+            float a1 = s * (1.5f - loF);
+            row[loI + 1] += d * (a1 - a0);
+            for (int x = loI + 2; x < hiI - 1; x++)
+                row[x] += d * s;
+            float a2 = a1 + (hiI - loI - 3) * s;
+            row[hiI - 1] += d * (1.0f - a2 - am);
+        }
+        row[hiI] += d * am;
+    }
+}
+
+// accumulated winding to 0..255 coverage
+static inline uint8_t FoldCoverage(float acc, FillRule rule)
+{
+    float v = std::fabs(acc);
+    if (rule == FILL_EVENODD)
+    {
+        // winding 2 is outside again: fold into 0..1
+        v = std::fmod(v, 2.0f);
+        if (v > 1.0f)
+            v = 2.0f - v;
+    }
+    else if (v > 1.0f)
+    {
+        v = 1.0f;
+    }
+    return static_cast<uint8_t>(v * 255.0f + 0.5f);
+}
+
+void CoverageRasterizer::ResolveRow(uint32_t y, FillRule rule, uint8_t *coverage) const
+{
+    const float *row = &cells_[static_cast<size_t>(y) * stride_];
+    float acc = 0.0f;
+    for (uint32_t x = 0; x < width_; x++)
+    {
+        acc += row[x];
+        coverage[x] = FoldCoverage(acc, rule);
+    }
+}
+
+bool CoverageRasterizer::ResolveSpan(uint32_t y, FillRule rule, uint8_t *coverage, uint32_t &x0, uint32_t &x1) const
+{
+    uint32_t lo = span_lo_[y];
+    uint32_t hi = span_hi_[y];
+    if (lo > hi || lo >= width_)
+        return false;
+
+    const float *row = &cells_[static_cast<size_t>(y) * stride_];
+    uint32_t end = std::min(hi + 1, width_);
+    float acc = 0.0f;
+    for (uint32_t x = lo; x < end; x++)
+    {
+        acc += row[x];
+        coverage[x] = FoldCoverage(acc, rule);
+    }
+
+    x0 = lo;
+    x1 = end;
+    uint8_t rest = end < width_ ? FoldCoverage(acc, rule) : 0;
+    if (rest)
+    {
+        std::fill(coverage + end, coverage + width_, rest);
+        x1 = width_;
+    }
+    return true;
+}
+
+static inline void PlotCoverage(const RasterTarget &t, int x, int y, uint32_t rgba, float coverage)
+{
+    if (x < 0 || x >= static_cast<int>(t.width) || y < t.rowBegin || y >= t.rowEnd || coverage <= 0.0f)
+        return;
+    uint8_t mask = static_cast<uint8_t>(std::min(coverage, 1.0f) * 255.0f + 0.5f);
+    BlendMaskSpan(t.pixels + (static_cast<size_t>(y) * t.width + x) * 4u, rgba, &mask, 1);
+}
+
+void DrawLineWu(const RasterTarget &t, float x0, float y0, float x1, float y1, uint32_t rgba, float weight)
+{
+    // keep a few pixels of margin so the clipped ends (partial coverage) stay off the target
+    const float margin = 3.0f;
+    if (!ClipSegment(x0, y0, x1, y1, -margin, t.rowBegin - margin,
+                     static_cast<float>(t.width) + margin, t.rowEnd + margin))
+        return;
+
+    // Wu's algorithm works on integer pixel centres
+    x0 -= 0.5f;
+    y0 -= 0.5f;
+    x1 -= 0.5f;
+    y1 -= 0.5f;
+
+    bool steep = std::fabs(y1 - y0) > std::fabs(x1 - x0);
+    if (steep)
+    {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+    }
+    if (x0 > x1)
+    {
+        std::swap(x0, x1);
+        std::swap(y0, y1);
+    }
+
+    float dx = x1 - x0;
+    float gradient = dx == 0.0f ? 1.0f : (y1 - y0) / dx;
+
+    // (major, minor) -> canvas (x, y)
+    auto plot = [&](int major, int minor, float c)
+    {
+        if (steep)
+            PlotCoverage(t, minor, major, rgba, c * weight);
+        else
+            PlotCoverage(t, major, minor, rgba, c * weight);
+    };
+
+    // endpoints: partial coverage along the major axis too
+    float xEnd = std::round(x0);
+    float yEnd = y0 + gradient * (xEnd - x0);
+    float xGap = 1.0f - (x0 + 0.5f - std::floor(x0 + 0.5f));
+    int xStart = static_cast<int>(xEnd);
+    float yFloor = std::floor(yEnd);
+    plot(xStart, static_cast<int>(yFloor), (1.0f - (yEnd - yFloor)) * xGap);
+    plot(xStart, static_cast<int>(yFloor) + 1, (yEnd - yFloor) * xGap);
+    float intery = yEnd + gradient;
+
+    xEnd = std::round(x1);
+    yEnd = y1 + gradient * (xEnd - x1);
+    xGap = x1 + 0.5f - std::floor(x1 + 0.5f);
+    int xStop = static_cast<int>(xEnd);
+    yFloor = std::floor(yEnd);
+    plot(xStop, static_cast<int>(yFloor), (1.0f - (yEnd - yFloor)) * xGap);
+    plot(xStop, static_cast<int>(yFloor) + 1, (yEnd - yFloor) * xGap);
+
+    // only visit the part of the run that can touch the target rows
+    int first = xStart + 1;
+    int last = xStop - 1;
+    if (steep)
+    {
+        first = std::max(first, t.rowBegin);
+        last = std::min(last, t.rowEnd - 1);
+    }
+    else
+    {
+        first = std::max(first, 0);
+        last = std::min(last, static_cast<int>(t.width) - 1);
+        if (gradient != 0.0f)
+        {
+            // intery(x) = intery + (x - (xStart + 1)) * gradient must reach [rowBegin - 1, rowEnd]
+            float a = (t.rowBegin - 1 - intery) / gradient;
+            float b = (t.rowEnd - intery) / gradient;
+            // a shallow gradient puts a and b far out, clamp before converting
+            int base = xStart + 1;
+            first = std::max(first, base + ClampToInt(std::floor(std::min(a, b)) - 1.0f, first - base, last - base + 1));
+            last = std::min(last, base + ClampToInt(std::ceil(std::max(a, b)) + 1.0f, first - base - 1, last - base));
+        }
+        else if (std::floor(intery) + 1 < t.rowBegin || std::floor(intery) >= t.rowEnd)
+        {
+            return;
+        }
+    }
+
+    for (int x = first; x <= last; x++)
+    {
+        float y = intery + (x - (xStart + 1)) * gradient;
+        float yF = std::floor(y);
+        plot(x, static_cast<int>(yF), 1.0f - (y - yF));
+        plot(x, static_cast<int>(yF) + 1, y - yF);
+    }
+}
+
+void DrawLineThick(const RasterTarget &t, float x0, float y0, float x1, float y1, float thickness, uint32_t rgba)
+{
+    float hw = thickness * 0.5f;
+
+    // only the part within stroke reach of the target matters; clipping
+    // there also keeps the coordinates small enough for the int ranges and
+    // the squared lengths below (strokes past 2^17 pixels wide are cut short)
+    float reach = std::min(hw, 65536.0f) + 2.0f;
+    if (!ClipSegment(x0, y0, x1, y1, -reach, t.rowBegin - reach,
+                     static_cast<float>(t.width) + reach, t.rowEnd + reach))
+        return;
+
+    float dx = x1 - x0;
+    float dy = y1 - y0;
+    float len2 = dx * dx + dy * dy;
+
+    int top = ClampToInt(std::floor(std::min(y0, y1) - hw - 1.0f), t.rowBegin, t.rowEnd);
+    int bottom = ClampToInt(std::ceil(std::max(y0, y1) + hw + 1.0f), t.rowBegin, t.rowEnd);
+
+    thread_local std::vector<uint8_t> coverage;
+    for (int y = top; y < bottom; y++)
+    {
+        float py = y + 0.5f;
+
+        // the part of the segment within reach of this row bounds its columns
+        float ta = 0.0f;
+        float tb = 1.0f;
+        if (dy != 0.0f)
+        {
+            ta = (py - hw - 1.0f - y0) / dy;
+            tb = (py + hw + 1.0f - y0) / dy;
+            if (ta > tb)
+                std::swap(ta, tb);
+            ta = std::max(ta, 0.0f);
+            tb = std::min(tb, 1.0f);
+            if (ta > tb)
+                continue;
+        }
+        float xa = x0 + dx * ta;
+        float xb = x0 + dx * tb;
+        int left = ClampToInt(std::floor(std::min(xa, xb) - hw - 1.0f), 0, static_cast<int>(t.width));
+        int right = ClampToInt(std::ceil(std::max(xa, xb) + hw + 1.0f), 0, static_cast<int>(t.width));
+        if (right <= left)
+            continue;
+
+        if (coverage.size() < static_cast<size_t>(right - left))
+            coverage.resize(right - left);
+        for (int x = left; x < right; x++)
+        {
+            float px = x + 0.5f;
+            float s = len2 > 0.0f ? ((px - x0) * dx + (py - y0) * dy) / len2 : 0.0f;
+            s = std::min(std::max(s, 0.0f), 1.0f);
+            float ex = x0 + dx * s - px;
+            float ey = y0 + dy * s - py;
+            float c = std::min(std::max(hw + 0.5f - std::sqrt(ex * ex + ey * ey), 0.0f), 1.0f);
+            coverage[x - left] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+        }
+        BlendMaskSpan(t.pixels + (static_cast<size_t>(y) * t.width + left) * 4u, rgba, coverage.data(), right - left);
+    }
+}
+
+void DrawCircleAA(const RasterTarget &t, float cx, float cy, float radius, float thickness, uint32_t rgba)
+{
+    bool filled = thickness <= 0.0f;
+    // hairline rings keep a one pixel profile and fade with their thickness instead
+    float hw = filled ? 0.0f : std::max(thickness, 1.0f) * 0.5f;
+    float weight = filled ? 1.0f : std::min(thickness, 1.0f);
+    float outer = radius + hw + 0.5f;
+
+    int top = ClampToInt(std::floor(cy - outer), t.rowBegin, t.rowEnd);
+    int bottom = ClampToInt(std::ceil(cy + outer), t.rowBegin, t.rowEnd);
+    // a span never needs to reach further than this from the centre
+    double reachX = std::fabs(static_cast<double>(cx)) + t.width + 1.0;
+
+    thread_local std::vector<uint8_t> coverage;
+    for (int y = top; y < bottom; y++)
+    {
+        float ey = y + 0.5f - cy;
+        if (std::fabs(ey) >= outer)
+            continue;
+        // in double so huge radii don't overflow the squares
+        double o = outer;
+        float half = static_cast<float>(std::min(std::sqrt(o * o - static_cast<double>(ey) * ey), reachX));
+        int left = ClampToInt(std::floor(cx - half), 0, static_cast<int>(t.width));
+        int right = ClampToInt(std::ceil(cx + half), 0, static_cast<int>(t.width));
+        if (right <= left)
+            continue;
+
+        if (coverage.size() < static_cast<size_t>(right - left))
+            coverage.resize(right - left);
+        for (int x = left; x < right; x++)
+        {
+            float ex = x + 0.5f - cx;
+            float d = std::sqrt(ex * ex + ey * ey);
+            float c = filled ? radius + 0.5f - d : (hw + 0.5f - std::fabs(d - radius)) * weight;
+            c = c > 0.0f ? std::min(c, 1.0f) : 0.0f; // NaN (inf - inf) counts as uncovered
+            coverage[x - left] = static_cast<uint8_t>(c * 255.0f + 0.5f);
+        }
+        BlendMaskSpan(t.pixels + (static_cast<size_t>(y) * t.width + left) * 4u, rgba, coverage.data(), right - left);
+    }
+}
@@ -4,6 +4,16 @@
 #include "renderer.h"
 #include <iostream>
 #include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <set>
+#include <tuple>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RENDERER_SSE2 1
+#endif
+#include "mapped_file.h"
 #include "input_manager.h"
 #include "audio_manager.h"
 #include <debugger.h>
@@ -14,6 +24,19 @@ Renderer::Renderer() : width_(0), height_(0), initialized_(false),
 
 Renderer::~Renderer()
 {
+    if (atlas_loader_thread_.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(atlas_reload_mutex_);
+            atlas_loader_stop_ = true;
+        }
+        atlas_reload_cv_.notify_all();
+        atlas_loader_thread_.join();
+
+        for (AtlasReloadJob &job : atlas_reload_done_)
+            delete job.result;
+        atlas_reload_done_.clear();
+    }
 
     {
         std::lock_guard<std::mutex> lock(atlas_mutex_);
@@ -67,6 +90,16 @@ Renderer::~Renderer()
         sprites_.clear();
     }
 
+    {
+        std::lock_guard<std::mutex> lock(font_mutex_);
+        for (auto &pair : fonts_)
+            delete pair.second;
+        fonts_.clear();
+        for (auto &pair : truetype_fonts_)
+            delete pair.second;
+        truetype_fonts_.clear();
+    }
+
     if (initialized_)
     {
         Shutdown();
@@ -159,1307 +192,4976 @@ void Renderer::DrawText(const std::string &text, const Vec2 &pos, int fontSize,
 
 // sprite
 
-uint32_t Renderer::LoadAtlas(const std::string &path)
+SpriteAtlas::~SpriteAtlas()
 {
-    int width, height, channels;
+    ReleasePixels();
+}
 
-    // Force RGBA (4 channels)
-    uint8_t *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+void SpriteAtlas::ReleasePixels()
+{
+    if (mapping)
+    {
+        // data points into the mapping
+        delete mapping;
+        mapping = nullptr;
+        data = nullptr;
+    }
+    else if (data && storage.empty())
+    {
+        stbi_image_free(data); // Correct way to free stb_image data
+        data = nullptr;
+    }
+    else
+    {
+        data = nullptr;
+    }
+    std::vector<uint8_t>().swap(storage);
+    std::vector<AtlasMipLevel>().swap(mips);
+    residentBytes = 0;
+}
 
-    if (!pixels)
+static bool EndsWith(const std::string &str, const std::string &suffix)
+{
+    return str.size() >= suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+uint32_t Renderer::LoadAtlas(const std::string &path, bool indexed)
+{
+    SpriteAtlas *atlas = LoadAtlasPixels(path, indexed);
+    if (!atlas)
     {
         Debugger::Instance().LogError("Failed to load atlas: " + path);
         return 0; // Invalid ID
     }
 
-    SpriteAtlas *atlas = new SpriteAtlas();
-    atlas->width = static_cast<uint32_t>(width);
-    atlas->height = static_cast<uint32_t>(height);
-    atlas->data = pixels; // Transfer ownership
+    atlas->indexedRequested = indexed;
+    return RegisterAtlas(atlas);
+}
 
-    std::lock_guard<std::mutex> lock(atlas_mutex_);
-    uint32_t id = next_atlas_id_++;
-    atlases_[id] = atlas;
+// decode / map / cache pipeline shared by LoadAtlas and budget reloads;
+// touches no renderer state except a snapshot of the cache settings, so it runs on the loader thread too
+SpriteAtlas *Renderer::LoadAtlasPixels(const std::string &path, bool indexed)
+{
+    SpriteAtlas *atlas = nullptr;
 
-    Debugger::Instance().LogInfo("Loaded atlas " + std::to_string(id) +
-                                 ": " + std::to_string(width) + "x" + std::to_string(height));
+    if (EndsWith(path, TATLAS_EXTENSION))
+    {
+        // precompiled atlas, map it as is
+        return MapAtlasFile(path, 0, 0, false);
+    }
 
-    return id;
-}
+    bool cacheEnabled;
+    std::string cacheDir;
+    {
+        // SetAtlasCache may run on the JS thread while the loader thread is here
+        std::lock_guard<std::mutex> lock(atlas_reload_mutex_);
+        cacheEnabled = atlas_cache_enabled_;
+        cacheDir = atlas_cache_dir_;
+    }
 
-SpriteAtlas *Renderer::GetAtlas(uint32_t atlasId)
-{
-    std::lock_guard<std::mutex> lock(atlas_mutex_);
-    auto it = atlases_.find(atlasId);
-    if (it == atlases_.end())
+    uint64_t sourceSize = 0;
+    int64_t sourceMtime = 0;
+    bool cacheable = cacheEnabled && GetAtlasSourceKey(path, sourceSize, sourceMtime);
+    // indexed and RGBA copies of one image are cached separately
+    std::string cachePath = cacheable ? GetAtlasCachePath(indexed ? path + ".i8" : path, cacheDir) : std::string();
+
+    // cache hit: skip the decode entirely
+    if (cacheable)
+    {
+        atlas = MapAtlasFile(cachePath, sourceSize, sourceMtime, true);
+        if (atlas)
+        {
+            atlas->path = path;
+            return atlas;
+        }
+    }
+
+    atlas = DecodeAtlas(path);
+    if (!atlas)
         return nullptr;
-    return it->second;
+
+    if (indexed && !IndexAtlas(atlas))
+        Debugger::Instance().LogWarn("Atlas has more than 256 colours, keeping RGBA8: " + path);
+
+    if (cacheable)
+    {
+        // opacity is computed once here and stored with the cache entry
+        IsAtlasOpaque(atlas);
+        if (!WriteAtlasFile(cachePath, atlas->data, atlas->width, atlas->height, atlas->stride,
+                            atlas->frames, atlas->flags, sourceSize, sourceMtime,
+                            static_cast<AtlasPixelFormat>(atlas->format), atlas->palette.data()))
+        {
+            Debugger::Instance().LogWarn("Failed to write atlas cache: " + cachePath);
+        }
+    }
+
+    return atlas;
 }
 
-uint32_t Renderer::GetAtlasPixel(SpriteAtlas *atlas, uint32_t x, uint32_t y)
+SpriteAtlas *Renderer::DecodeAtlas(const std::string &path)
 {
-    if (!atlas || x >= atlas->width || y >= atlas->height)
-        return 0;
+    int width, height, channels;
 
-    uint32_t idx = (y * atlas->width + x) * 4;
-    uint8_t r = atlas->data[idx];
-    uint8_t g = atlas->data[idx + 1];
-    uint8_t b = atlas->data[idx + 2];
-    uint8_t a = atlas->data[idx + 3];
+    // Force RGBA (4 channels)
+    uint8_t *pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+    if (!pixels)
+        return nullptr;
 
-    // Pack into RGBA32
-    return (a << 24) | (b << 16) | (g << 8) | r;
+    SpriteAtlas *atlas = new SpriteAtlas();
+    atlas->width = static_cast<uint32_t>(width);
+    atlas->height = static_cast<uint32_t>(height);
+    atlas->stride = atlas->width * 4;
+    atlas->data = pixels; // Transfer ownership
+    atlas->path = path;
+    return atlas;
 }
 
-bool Renderer::IsAtlasOpaque(SpriteAtlas *atlas)
+bool Renderer::IndexAtlas(SpriteAtlas *atlas)
 {
-    if (!atlas)
+    if (atlas->format == ATLAS_FORMAT_INDEXED8)
+        return true;
+
+    std::vector<uint8_t> indices;
+    uint32_t palette[ATLAS_PALETTE_SIZE];
+    uint32_t colorCount = 0;
+    if (!BuildIndexedPixels(atlas->data, atlas->width, atlas->height, atlas->stride, indices, palette, colorCount))
         return false;
 
-    size_t pixelCount = atlas->width * atlas->height;
-    for (size_t i = 0; i < pixelCount; i++)
+    if (atlas->mapping)
     {
-        if (atlas->data[i * 4 + 3] < 255)
-            return false;
+        delete atlas->mapping;
+        atlas->mapping = nullptr;
+    }
+    else if (atlas->storage.empty())
+    {
+        stbi_image_free(atlas->data);
     }
+
+    atlas->storage.swap(indices);
+    atlas->data = atlas->storage.data();
+    atlas->stride = atlas->width;
+    atlas->format = ATLAS_FORMAT_INDEXED8;
+    atlas->palette.assign(palette, palette + ATLAS_PALETTE_SIZE);
+
+    Debugger::Instance().LogInfo("Indexed atlas " + atlas->path + ": " + std::to_string(colorCount) + " colours");
     return true;
 }
 
-void Renderer::FreeAtlas(uint32_t atlasId)
+SpriteAtlas *Renderer::MapAtlasFile(const std::string &path, uint64_t sourceSize, int64_t sourceMtime, bool checkKey)
 {
-    std::lock_guard<std::mutex> lock(atlas_mutex_);
-    auto it = atlases_.find(atlasId);
-    if (it != atlases_.end())
+    MappedFile *file = MappedFile::Open(path);
+    if (!file)
+        return nullptr;
+
+    const TAtlasHeader *header = ValidateAtlasFile(file->Data(), file->Size());
+    if (!header || (checkKey && (header->sourceSize != sourceSize || header->sourceMtime != sourceMtime)))
     {
-        delete it->second;
-        atlases_.erase(it);
+        // stale or foreign file, caller falls back to decoding
+        delete file;
+        return nullptr;
+    }
+
+    SpriteAtlas *atlas = new SpriteAtlas();
+    atlas->width = header->width;
+    atlas->height = header->height;
+    atlas->stride = header->stride;
+    atlas->format = header->format;
+    atlas->flags = header->flags;
+    atlas->mapping = file;
+    // the mapping is read-only, nothing writes through this pointer
+    atlas->data = const_cast<uint8_t *>(file->Data() + header->pixelOffset);
+    atlas->path = path;
+
+    const AtlasFrame *frames = reinterpret_cast<const AtlasFrame *>(file->Data() + header->frameOffset);
+    atlas->frames.assign(frames, frames + header->frameCount);
+
+    if (header->format == ATLAS_FORMAT_INDEXED8)
+    {
+        const uint32_t *palette = reinterpret_cast<const uint32_t *>(file->Data() + header->paletteOffset);
+        atlas->palette.assign(palette, palette + ATLAS_PALETTE_SIZE);
     }
+
+    return atlas;
 }
 
-// renderer.cpp
+uint32_t Renderer::LoadAtlasWithMetadata(const std::string &imagePath, const std::string &jsonPath, bool indexed)
+{
+    std::ifstream file(jsonPath, std::ios::binary);
+    if (!file)
+    {
+        Debugger::Instance().LogError("Failed to open atlas metadata: " + jsonPath);
+        return 0;
+    }
+    std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
 
-uint32_t Renderer::CreateSprite(uint32_t atlasId, uint32_t frameWidth, uint32_t frameHeight,
-                                uint32_t frameCount, bool opaque)
+    AtlasMetadata meta;
+    std::string error;
+    if (!ParseAtlasMetadata(json, meta, error))
+    {
+        Debugger::Instance().LogError("Failed to parse atlas metadata " + jsonPath + ": " + error);
+        return 0;
+    }
+
+    uint32_t atlasId = LoadAtlas(imagePath, indexed);
+    SpriteAtlas *atlas = AcquireAtlas(atlasId, false);
+    if (!atlas)
+    {
+        // registered but its pixels couldn't be brought back
+        if (atlasId != 0)
+            FreeAtlas(atlasId);
+        return 0;
+    }
+
+    for (size_t i = 0; i < meta.frames.size(); i++)
+    {
+        AtlasFrame &frame = meta.frames[i];
+        if (frame.flags & ATLAS_FRAME_EMPTY)
+            continue;
+
+        if (!AtlasFrameInside(frame, atlas->width, atlas->height))
+        {
+            Debugger::Instance().LogError("Atlas metadata frame '" + meta.frameNames[i] + "' is outside the image: " + jsonPath);
+            FreeAtlas(atlasId);
+            return 0;
+        }
+
+        // area the frame covers in the sheet
+        bool rotated = (frame.flags & ATLAS_FRAME_ROTATED) != 0;
+        uint32_t sheetW = rotated ? frame.h : frame.w;
+        uint32_t sheetH = rotated ? frame.w : frame.h;
+        uint32_t bpp = AtlasBytesPerPixel(atlas->format);
+        const uint8_t *origin = atlas->data + static_cast<size_t>(frame.y) * atlas->stride + static_cast<size_t>(frame.x) * bpp;
+        bool opaque = atlas->format == ATLAS_FORMAT_INDEXED8
+                          ? ScanOpaqueIndexed(origin, sheetW, sheetH, atlas->stride, atlas->palette.data())
+                          : ScanOpaque(origin, sheetW, sheetH, atlas->stride);
+        if (opaque)
+            frame.flags |= ATLAS_FRAME_OPAQUE;
+    }
+
+    atlas->frames = std::move(meta.frames);
+    atlas->frameNames = std::move(meta.frameNames);
+    atlas->animations = std::move(meta.animations);
+
+    Debugger::Instance().LogInfo("Atlas " + std::to_string(atlasId) + ": " + std::to_string(atlas->frames.size()) +
+                                 " frames, " + std::to_string(atlas->animations.size()) + " animations");
+    return atlasId;
+}
+
+uint32_t Renderer::CreateSpriteFromAtlas(uint32_t atlasId, bool opaque)
 {
-    // Validate atlas exists
     SpriteAtlas *atlas = GetAtlas(atlasId);
-    if (!atlas)
+    if (!atlas || atlas->frames.empty())
     {
-        Debugger::Instance().LogError("CreateSprite: invalid atlasId " + std::to_string(atlasId));
+        Debugger::Instance().LogError("CreateSpriteFromAtlas: atlas " + std::to_string(atlasId) + " has no frame table");
         return 0;
     }
 
-    AnimatedSprite *sprite = new AnimatedSprite();
-    sprite->atlasId = atlasId;
-    sprite->frameWidth = frameWidth;
-    sprite->frameHeight = frameHeight;
-    sprite->framesPerRow = atlas->width / frameWidth;
-    sprite->opaque = opaque ? 1 : 0;
+    std::vector<AnimationDef> animations;
+    for (const AtlasAnimation &src : atlas->animations)
+    {
+        AnimationDef def;
+        def.name = src.name;
+        def.frames = src.frames;
+        def.fps = src.fps;
+        def.loop = src.loop;
+        def.durations = src.durations;
+        animations.push_back(def);
+    }
 
-    // Default position (will be updated from JS)
-    sprite->x = 0;
-    sprite->y = 0;
-    sprite->scaleX = 1.0f;
-    sprite->scaleY = 1.0f;
-    sprite->rotation = 0;
-    sprite->currentFrame = 0;
+    // frame size comes from the frame table
+    return CreateSpriteWithAnimations(atlasId, 0, 0, opaque, animations);
+}
 
-    std::lock_guard<std::mutex> lock(sprite_mutex_);
-    uint32_t id = next_sprite_id_++;
-    sprites_[id] = sprite;
+static uint64_t AtlasPixelBytes(const SpriteAtlas *atlas)
+{
+    return atlas->data ? static_cast<uint64_t>(atlas->stride) * atlas->height : 0;
+}
 
-    Debugger::Instance().LogInfo("Created sprite " + std::to_string(id) +
-                                 " from atlas " + std::to_string(atlasId));
+uint32_t Renderer::RegisterAtlas(SpriteAtlas *atlas)
+{
+    std::lock_guard<std::mutex> lock(atlas_mutex_);
+    uint32_t id = next_atlas_id_++;
+    atlases_[id] = atlas;
+
+    atlas->residentBytes = AtlasPixelBytes(atlas);
+    atlas->lastUsed = ++atlas_use_clock_;
+    atlas_resident_bytes_ += atlas->residentBytes;
+
+    Debugger::Instance().LogInfo("Loaded atlas " + std::to_string(id) +
+                                 ": " + std::to_string(atlas->width) + "x" + std::to_string(atlas->height) +
+                                 (atlas->mapping ? " (mapped)" : ""));
 
+    EnforceAtlasBudget(id);
     return id;
 }
 
-AnimatedSprite *Renderer::GetSprite(uint32_t spriteId)
+void Renderer::SetAtlasBudget(uint64_t budgetBytes, bool asyncReload, const Color4 &placeholder)
 {
-    std::lock_guard<std::mutex> lock(sprite_mutex_);
-    auto it = sprites_.find(spriteId);
-    if (it == sprites_.end())
-        return nullptr;
-    return it->second;
+    {
+        std::lock_guard<std::mutex> lock(atlas_mutex_);
+        atlas_budget_ = budgetBytes;
+        atlas_async_reload_ = asyncReload;
+        atlas_placeholder_ = placeholder.ToRaylib();
+        EnforceAtlasBudget(0);
+    }
+
+    if (asyncReload && !atlas_loader_thread_.joinable())
+    {
+        atlas_loader_stop_ = false;
+        atlas_loader_thread_ = std::thread(&Renderer::AtlasLoaderThread, this);
+    }
 }
 
-void Renderer::UpdateSprite(uint32_t spriteId, float x, float y, float rotation,
-                            float scaleX, float scaleY, uint32_t frame,
-                            uint8_t flipH, uint8_t flipV)
+// caller holds atlas_mutex_
+void Renderer::EnforceAtlasBudget(uint32_t keepId)
 {
-    AnimatedSprite *sprite = GetSprite(spriteId);
-    if (!sprite)
+    if (atlas_budget_ == 0)
         return;
 
-    sprite->x = x;
-    sprite->y = y;
-    sprite->rotation = rotation;
-    sprite->scaleX = scaleX;
-    sprite->scaleY = scaleY;
-    sprite->currentFrame = frame;
-    sprite->flipH = flipH;
-    sprite->flipV = flipV;
+    while (atlas_resident_bytes_ > atlas_budget_)
+    {
+        // least recently drawn resident atlas
+        SpriteAtlas *victim = nullptr;
+        uint32_t victimId = 0;
+        for (auto &pair : atlases_)
+        {
+            SpriteAtlas *atlas = pair.second;
+            if (pair.first == keepId || !atlas->data || atlas->path.empty())
+                continue;
+            if (!victim || atlas->lastUsed < victim->lastUsed)
+            {
+                victim = atlas;
+                victimId = pair.first;
+            }
+        }
+
+        if (!victim)
+            return; // only the protected atlas is left
+
+        atlas_resident_bytes_ -= victim->residentBytes;
+        victim->ReleasePixels();
+        atlas_evictions_++;
+
+        Debugger::Instance().LogInfo("Evicted atlas " + std::to_string(victimId) + " (" + victim->path + ")");
+    }
 }
 
-void Renderer::DestroySprite(uint32_t spriteId)
+// moves the pixels of a freshly loaded copy into the registered atlas;
+// frame table and metadata of the registered atlas stay as they are
+void Renderer::AdoptReloadedPixels(SpriteAtlas *atlas, SpriteAtlas *loaded)
 {
-    std::lock_guard<std::mutex> lock(sprite_mutex_);
-    auto it = sprites_.find(spriteId);
-    if (it != sprites_.end())
+    atlas->ReleasePixels();
+
+    atlas->data = loaded->data;
+    atlas->mapping = loaded->mapping;
+    atlas->storage.swap(loaded->storage);
+    atlas->stride = loaded->stride;
+    atlas->format = loaded->format;
+    atlas->palette = loaded->palette;
+    atlas->flags = (atlas->flags & TATLAS_FLAG_OPACITY_KNOWN) ? atlas->flags : loaded->flags;
+    atlas->residentBytes = AtlasPixelBytes(atlas);
+
+    loaded->data = nullptr;
+    loaded->mapping = nullptr;
+    delete loaded;
+
+    atlas_resident_bytes_ += atlas->residentBytes;
+    atlas_reloads_++;
+}
+
+// caller holds atlas_mutex_
+void Renderer::ApplyFinishedReloads()
+{
+    std::vector<AtlasReloadJob> done;
     {
-        delete it->second;
-        sprites_.erase(it);
+        std::lock_guard<std::mutex> lock(atlas_reload_mutex_);
+        done.swap(atlas_reload_done_);
+    }
+
+    for (AtlasReloadJob &job : done)
+    {
+        auto it = atlases_.find(job.atlasId);
+        if (it == atlases_.end() || it->second->data)
+        {
+            // freed, or reloaded synchronously in the meantime
+            delete job.result;
+            continue;
+        }
+
+        SpriteAtlas *atlas = it->second;
+        atlas->reloadQueued = false;
+        if (!job.result)
+        {
+            Debugger::Instance().LogError("Failed to reload atlas: " + job.path);
+            continue;
+        }
+
+        AdoptReloadedPixels(atlas, job.result);
+        atlas->lastUsed = ++atlas_use_clock_;
+        EnforceAtlasBudget(job.atlasId);
     }
 }
 
-struct FrameRect
+SpriteAtlas *Renderer::AcquireAtlas(uint32_t atlasId, bool forDraw)
 {
-    uint32_t x, y, w, h;
-};
+    std::unique_lock<std::mutex> lock(atlas_mutex_);
+    if (atlas_async_reload_)
+        ApplyFinishedReloads();
 
-FrameRect GetFrameRect(AnimatedSprite *sprite, uint32_t frameIndex)
-{
-    uint32_t col = frameIndex % sprite->framesPerRow;
-    uint32_t row = frameIndex / sprite->framesPerRow;
+    auto it = atlases_.find(atlasId);
+    if (it == atlases_.end())
+        return nullptr;
 
-    return {
-        col * sprite->frameWidth,
-        row * sprite->frameHeight,
-        sprite->frameWidth,
-        sprite->frameHeight};
+    SpriteAtlas *atlas = it->second;
+    atlas->lastUsed = ++atlas_use_clock_;
+    if (atlas->data)
+        return atlas;
+
+    if (forDraw && atlas_async_reload_)
+    {
+        // draw a placeholder until the loader thread is done
+        if (!atlas->reloadQueued)
+        {
+            atlas->reloadQueued = true;
+            std::lock_guard<std::mutex> reloadLock(atlas_reload_mutex_);
+            atlas_reload_queue_.push_back({atlasId, atlas->path, atlas->indexedRequested, nullptr});
+            atlas_reload_cv_.notify_one();
+        }
+        return atlas;
+    }
+
+    // synchronous reload, decode outside the lock
+    std::string path = atlas->path;
+    bool indexed = atlas->indexedRequested;
+    lock.unlock();
+    SpriteAtlas *loaded = LoadAtlasPixels(path, indexed);
+    lock.lock();
+
+    it = atlases_.find(atlasId);
+    if (it == atlases_.end() || !loaded)
+    {
+        if (!loaded)
+            Debugger::Instance().LogError("Failed to reload atlas: " + path);
+        delete loaded;
+        return nullptr;
+    }
+
+    atlas = it->second;
+    if (atlas->data)
+    {
+        delete loaded;
+        return atlas;
+    }
+
+    AdoptReloadedPixels(atlas, loaded);
+    EnforceAtlasBudget(atlasId);
+    return atlas;
 }
 
+void Renderer::AtlasLoaderThread()
+{
+    while (true)
+    {
+        AtlasReloadJob job;
+        {
+            std::unique_lock<std::mutex> lock(atlas_reload_mutex_);
+            atlas_reload_cv_.wait(lock, [this]
+                                  { return atlas_loader_stop_ || !atlas_reload_queue_.empty(); });
+            if (atlas_loader_stop_)
+                return;
+            job = atlas_reload_queue_.front();
+            atlas_reload_queue_.pop_front();
+        }
+
+        job.result = LoadAtlasPixels(job.path, job.indexed);
 
-// Fast path: opaque, no rotation, nearest neighbor
-void BlitSpriteNN_Opaque(uint8_t* dstBuffer, uint32_t dstWidth, uint32_t dstHeight,
-                         const ScreenRect& dstRect,
-                         const SpriteAtlas* atlas, const FrameRect& srcRect,
-                         bool flipH, bool flipV)
+        std::lock_guard<std::mutex> lock(atlas_reload_mutex_);
+        atlas_reload_done_.push_back(job);
+    }
+}
+
+bool Renderer::SetAtlasMipmaps(uint32_t atlasId, bool enabled)
 {
-    // Clamp dest rect to buffer bounds
-    int32_t dstX = dstRect.x;
-    int32_t dstY = dstRect.y;
-    int32_t dstW = dstRect.width;
-    int32_t dstH = dstRect.height;
-    
-    if (dstX >= static_cast<int32_t>(dstWidth) || dstY >= static_cast<int32_t>(dstHeight))
-        return;
-    if (dstX + dstW <= 0 || dstY + dstH <= 0)
-        return;
-    
-   
-    int32_t clipLeft = 0, clipTop = 0;
-    if (dstX < 0) {
-        clipLeft = -dstX;
-        dstW += dstX;
-        dstX = 0;
+    std::lock_guard<std::mutex> lock(atlas_mutex_);
+    auto it = atlases_.find(atlasId);
+    if (it == atlases_.end())
+        return false;
+
+    SpriteAtlas *atlas = it->second;
+    if (enabled && atlas->format != ATLAS_FORMAT_RGBA8)
+    {
+        Debugger::Instance().LogWarn("SetAtlasMipmaps: atlas " + std::to_string(atlasId) + " is indexed, mipmaps need RGBA8");
+        return false;
     }
-    if (dstY < 0) {
-        clipTop = -dstY;
-        dstH += dstY;
-        dstY = 0;
+
+    atlas->mipmaps = enabled;
+    if (!enabled && !atlas->mips.empty())
+    {
+        uint64_t mipBytes = 0;
+        for (const AtlasMipLevel &mip : atlas->mips)
+            mipBytes += mip.pixels.size();
+        std::vector<AtlasMipLevel>().swap(atlas->mips);
+        atlas->residentBytes -= mipBytes;
+        atlas_resident_bytes_ -= mipBytes;
     }
-    if (dstX + dstW > static_cast<int32_t>(dstWidth))
-        dstW = dstWidth - dstX;
-    if (dstY + dstH > static_cast<int32_t>(dstHeight))
-        dstH = dstHeight - dstY;
-    
-    if (dstW <= 0 || dstH <= 0)
-        return;
-    
-    const uint8_t* srcData = atlas->data;
-    const uint32_t srcWidth = atlas->width;
-    const float scaleX = static_cast<float>(srcRect.w) / dstRect.width;
-    const float scaleY = static_cast<float>(srcRect.h) / dstRect.height;
-    
-    // Row-by-row blit
-    for (int32_t row = 0; row < dstH; row++) {
-        int32_t screenY = dstY + row;
-        int32_t localY = clipTop + row;
-        
-        // Map to source Y
-        float srcYf = (localY + 0.5f) * scaleY;
-        uint32_t srcY = static_cast<uint32_t>(srcYf);
-        if (flipV)
-            srcY = (srcRect.h - 1) - srcY;
-        srcY += srcRect.y;
-        
-        uint32_t dstRowBase = screenY * dstWidth * 4;
-        uint32_t srcRowBase = srcY * srcWidth * 4;
-        
-        for (int32_t col = 0; col < dstW; col++) {
-            int32_t screenX = dstX + col;
-            int32_t localX = clipLeft + col;
-            
-            // Map to source X
-            float srcXf = (localX + 0.5f) * scaleX;
-            uint32_t srcX = static_cast<uint32_t>(srcXf);
-            if (flipH)
-                srcX = (srcRect.w - 1) - srcX;
-            srcX += srcRect.x;
-            
-            uint32_t dstIdx = dstRowBase + screenX * 4;
-            uint32_t srcIdx = srcRowBase + srcX * 4;
-            
-            // Direct copy (opaque, no blend)
-            dstBuffer[dstIdx + 0] = srcData[srcIdx + 0]; // R
-            dstBuffer[dstIdx + 1] = srcData[srcIdx + 1]; // G
-            dstBuffer[dstIdx + 2] = srcData[srcIdx + 2]; // B
-            dstBuffer[dstIdx + 3] = 255;                  // A
+    return true;
+}
+
+// mip level whose texel size matches the on-screen scale; builds the pyramid on first use
+uint32_t Renderer::SelectAtlasLevel(SpriteAtlas *atlas, uint32_t srcW, uint32_t srcH, uint32_t dstW, uint32_t dstH)
+{
+    if (!atlas->mipmaps || !atlas->data || atlas->format != ATLAS_FORMAT_RGBA8 || srcW == 0 || srcH == 0)
+        return 0;
+
+    // the axis shrinking least decides, so the other axis never gets blurrier than needed
+    float scaleX = static_cast<float>(dstW) / srcW;
+    float scaleY = static_cast<float>(dstH) / srcH;
+    float scale = scaleX > scaleY ? scaleX : scaleY;
+
+    uint32_t level = 0;
+    while (level < ATLAS_MAX_MIP_LEVELS && scale * (1u << (level + 1)) <= 1.0f)
+        level++;
+    if (level == 0)
+        return 0;
+
+    if (atlas->mips.empty())
+    {
+        std::lock_guard<std::mutex> lock(atlas_mutex_);
+
+        uint32_t w = atlas->width;
+        uint32_t h = atlas->height;
+        const uint8_t *src = atlas->data;
+        uint32_t srcStride = atlas->stride;
+        uint64_t mipBytes = 0;
+
+        while (atlas->mips.size() < ATLAS_MAX_MIP_LEVELS && (w > 1 || h > 1))
+        {
+            AtlasMipLevel mip;
+            // rounded up, so LevelRect's outward rounding stays inside every level
+            mip.width = (w + 1) / 2;
+            mip.height = (h + 1) / 2;
+            mip.pixels.resize(static_cast<size_t>(mip.width) * mip.height * 4);
+            DownsampleBox2x(src, w, h, srcStride, mip.pixels.data(), mip.width, mip.height);
+            mipBytes += mip.pixels.size();
+            atlas->mips.push_back(std::move(mip));
+
+            const AtlasMipLevel &last = atlas->mips.back();
+            w = last.width;
+            h = last.height;
+            src = last.pixels.data();
+            srcStride = w * 4;
         }
+
+        atlas->residentBytes += mipBytes;
+        atlas_resident_bytes_ += mipBytes;
     }
+
+    return level < atlas->mips.size() ? level : static_cast<uint32_t>(atlas->mips.size());
 }
 
-// With alpha blending
-void BlitSpriteNN_Alpha(uint8_t* dstBuffer, uint32_t dstWidth, uint32_t dstHeight,
-                        const ScreenRect& dstRect,
-                        const SpriteAtlas* atlas, const FrameRect& srcRect,
-                        bool flipH, bool flipV)
+AtlasMemoryStats Renderer::GetAtlasMemoryStats()
 {
+    std::lock_guard<std::mutex> lock(atlas_mutex_);
+    AtlasMemoryStats stats = {};
+    stats.residentBytes = atlas_resident_bytes_;
+    stats.budgetBytes = atlas_budget_;
+    stats.evictions = atlas_evictions_;
+    stats.reloads = atlas_reloads_;
+    stats.atlasCount = static_cast<uint32_t>(atlases_.size());
+    for (auto &pair : atlases_)
+    {
+        if (pair.second->data)
+            stats.residentCount++;
+        if (pair.second->reloadQueued)
+            stats.pendingReloads++;
+    }
+    return stats;
+}
 
-    int32_t dstX = dstRect.x;
-    int32_t dstY = dstRect.y;
-    int32_t dstW = dstRect.width;
-    int32_t dstH = dstRect.height;
-    
-    if (dstX >= static_cast<int32_t>(dstWidth) || dstY >= static_cast<int32_t>(dstHeight))
-        return;
-    if (dstX + dstW <= 0 || dstY + dstH <= 0)
-        return;
-    
-    int32_t clipLeft = 0, clipTop = 0;
-    if (dstX < 0) {
-        clipLeft = -dstX;
-        dstW += dstX;
-        dstX = 0;
+void Renderer::SetAtlasCache(bool enabled, const std::string &cacheDir)
+{
+    {
+        std::lock_guard<std::mutex> lock(atlas_reload_mutex_);
+        atlas_cache_enabled_ = enabled;
+        atlas_cache_dir_ = cacheDir;
     }
-    if (dstY < 0) {
-        clipTop = -dstY;
-        dstH += dstY;
-        dstY = 0;
+
+    if (enabled && !cacheDir.empty())
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(cacheDir, ec);
+        if (ec)
+            Debugger::Instance().LogWarn("Failed to create atlas cache dir: " + cacheDir);
     }
-    if (dstX + dstW > static_cast<int32_t>(dstWidth))
-        dstW = dstWidth - dstX;
-    if (dstY + dstH > static_cast<int32_t>(dstHeight))
-        dstH = dstHeight - dstY;
-    
-    if (dstW <= 0 || dstH <= 0)
-        return;
-    
-    const uint8_t* srcData = atlas->data;
-    const uint32_t srcWidth = atlas->width;
-    const float scaleX = static_cast<float>(srcRect.w) / dstRect.width;
-    const float scaleY = static_cast<float>(srcRect.h) / dstRect.height;
-    
-    for (int32_t row = 0; row < dstH; row++) {
-        int32_t screenY = dstY + row;
-        int32_t localY = clipTop + row;
-        
-        float srcYf = (localY + 0.5f) * scaleY;
-        uint32_t srcY = static_cast<uint32_t>(srcYf);
-        if (flipV)
-            srcY = (srcRect.h - 1) - srcY;
-        srcY += srcRect.y;
-        
-        uint32_t dstRowBase = screenY * dstWidth * 4;
-        uint32_t srcRowBase = srcY * srcWidth * 4;
-        
-        for (int32_t col = 0; col < dstW; col++) {
-            int32_t screenX = dstX + col;
-            int32_t localX = clipLeft + col;
-            
-            float srcXf = (localX + 0.5f) * scaleX;
-            uint32_t srcX = static_cast<uint32_t>(srcXf);
-            if (flipH)
-                srcX = (srcRect.w - 1) - srcX;
-            srcX += srcRect.x;
-            
-            uint32_t dstIdx = dstRowBase + screenX * 4;
-            uint32_t srcIdx = srcRowBase + srcX * 4;
-            
-            uint8_t sR = srcData[srcIdx + 0];
-            uint8_t sG = srcData[srcIdx + 1];
-            uint8_t sB = srcData[srcIdx + 2];
-            uint8_t sA = srcData[srcIdx + 3];
-            
-            if (sA == 255) {
-                // Fully opaque pixel - direct copy
-                dstBuffer[dstIdx + 0] = sR;
-                dstBuffer[dstIdx + 1] = sG;
-                dstBuffer[dstIdx + 2] = sB;
-                dstBuffer[dstIdx + 3] = 255;
-            } else if (sA > 0) {
-                // Alpha blend
-                uint8_t dR = dstBuffer[dstIdx + 0];
-                uint8_t dG = dstBuffer[dstIdx + 1];
-                uint8_t dB = dstBuffer[dstIdx + 2];
-                uint8_t dA = dstBuffer[dstIdx + 3];
-                
-                uint32_t inv = 255 - sA;
-                
-                uint8_t outR = ((sR * sA + dR * inv) + 127) / 255;
-                uint8_t outG = ((sG * sA + dG * inv) + 127) / 255;
-                uint8_t outB = ((sB * sA + dB * inv) + 127) / 255;
-                uint8_t outA = ((sA * 255 + dA * inv) + 127) / 255;
-                
-                dstBuffer[dstIdx + 0] = outR;
-                dstBuffer[dstIdx + 1] = outG;
-                dstBuffer[dstIdx + 2] = outB;
-                dstBuffer[dstIdx + 3] = outA;
+}
+
+bool Renderer::CompileAtlas(const std::string &srcPath, const std::string &dstPath,
+                            uint32_t frameWidth, uint32_t frameHeight, bool indexed)
+{
+    SpriteAtlas *atlas = DecodeAtlas(srcPath);
+    if (!atlas)
+    {
+        Debugger::Instance().LogError("CompileAtlas: failed to load " + srcPath);
+        return false;
+    }
+
+    // optional uniform grid -> frame table with trim/opacity per frame
+    if (frameWidth > 0 && frameHeight > 0)
+    {
+        uint32_t cols = atlas->width / frameWidth;
+        uint32_t rows = atlas->height / frameHeight;
+        for (uint32_t row = 0; row < rows; row++)
+        {
+            for (uint32_t col = 0; col < cols; col++)
+            {
+                AtlasFrame frame = {};
+                frame.x = col * frameWidth;
+                frame.y = row * frameHeight;
+                frame.w = frameWidth;
+                frame.h = frameHeight;
+                ComputeFrameTrim(atlas->data, atlas->stride, frame);
+                atlas->frames.push_back(frame);
             }
-            // If sA == 0, skip (fully transparent)
         }
     }
-}
 
-// cam work
+    IsAtlasOpaque(atlas);
 
+    // trim and opacity above are computed on RGBA, index afterwards
+    if (indexed && !IndexAtlas(atlas))
+        Debugger::Instance().LogWarn("CompileAtlas: more than 256 colours, keeping RGBA8: " + srcPath);
 
-ScreenRect WorldToScreen(const CameraState &cam, float worldX, float worldY,
-                         float worldW, float worldH)
+    uint64_t sourceSize = 0;
+    int64_t sourceMtime = 0;
+    GetAtlasSourceKey(srcPath, sourceSize, sourceMtime);
+
+    bool ok = WriteAtlasFile(dstPath, atlas->data, atlas->width, atlas->height, atlas->stride,
+                             atlas->frames, atlas->flags, sourceSize, sourceMtime,
+                             static_cast<AtlasPixelFormat>(atlas->format), atlas->palette.data());
+    if (!ok)
+        Debugger::Instance().LogError("CompileAtlas: failed to write " + dstPath);
+
+    delete atlas;
+    return ok;
+}
+
+SpriteAtlas *Renderer::GetAtlas(uint32_t atlasId)
 {
-    // Translate to camera space
-    float dx = worldX - cam.worldX;
-    float dy = worldY - cam.worldY;
+    std::lock_guard<std::mutex> lock(atlas_mutex_);
+    auto it = atlases_.find(atlasId);
+    if (it == atlases_.end())
+        return nullptr;
+    return it->second;
+}
 
-    // Rotate by negative camera rotation (inverse transform)
-    float cosA = cosf(-cam.rotation);
-    float sinA = sinf(-cam.rotation);
+uint32_t Renderer::GetAtlasPixel(SpriteAtlas *atlas, uint32_t x, uint32_t y)
+{
+    if (!atlas || x >= atlas->width || y >= atlas->height)
+        return 0;
 
-    float camX = dx * cosA - dy * sinA;
-    float camY = dx * sinA + dy * cosA;
+    const uint8_t *px;
+    if (atlas->format == ATLAS_FORMAT_INDEXED8)
+        px = reinterpret_cast<const uint8_t *>(&atlas->palette[atlas->data[static_cast<size_t>(y) * atlas->stride + x]]);
+    else
+        px = atlas->data + static_cast<size_t>(y) * atlas->stride + x * 4;
 
-    // Apply zoom
-    camX *= cam.zoom;
-    camY *= cam.zoom;
+    uint8_t r = px[0];
+    uint8_t g = px[1];
+    uint8_t b = px[2];
+    uint8_t a = px[3];
 
-    // Convert to screen coordinates (camera center = screen center)
-    float screenX = camX + cam.viewWidth / 2.0f;
-    float screenY = camY + cam.viewHeight / 2.0f;
+    // Pack into RGBA32
+    return (a << 24) | (b << 16) | (g << 8) | r;
+}
 
-    return {
-        static_cast<int32_t>(screenX),
-        static_cast<int32_t>(screenY),
-        static_cast<uint32_t>(worldW * cam.zoom),
-        static_cast<uint32_t>(worldH * cam.zoom)};
+void Renderer::CopyAtlasPixels(const SpriteAtlas *atlas, uint8_t *dst)
+{
+    // rows may be padded (mapped atlases), so copy row by row
+    size_t rowBytes = static_cast<size_t>(atlas->width) * 4;
+    for (uint32_t y = 0; y < atlas->height; y++)
+    {
+        const uint8_t *src = atlas->data + static_cast<size_t>(y) * atlas->stride;
+        if (atlas->format == ATLAS_FORMAT_INDEXED8)
+        {
+            // expand through the palette
+            uint32_t *row = reinterpret_cast<uint32_t *>(dst + y * rowBytes);
+            for (uint32_t x = 0; x < atlas->width; x++)
+                memcpy(&row[x], &atlas->palette[src[x]], 4);
+        }
+        else
+        {
+            memcpy(dst + y * rowBytes, src, rowBytes);
+        }
+    }
 }
 
-void Renderer::DrawSprite(uint32_t spriteId, size_t bufRefId)
+bool Renderer::IsAtlasOpaque(SpriteAtlas *atlas)
 {
-    //  Debugger::Instance().LogInfo("DrawSprite called - spriteId: " + std::to_string(spriteId) + ", bufRefId: " + std::to_string(bufRefId));
-     
-     // process pending JS writes
-     ProcessPendingRegions(bufRefId);
-     
+    if (!atlas)
+        return false;
 
-     AnimatedSprite* sprite = GetSprite(spriteId);
-     if (!sprite) {
-         Debugger::Instance().LogWarn("DrawSprite - Early return: sprite not found (spriteId: " + std::to_string(spriteId) + ")");
-         return;
-     }
-     
-
-     SpriteAtlas* atlas = GetAtlas(sprite->atlasId);
-     if (!atlas) {
-         Debugger::Instance().LogWarn("DrawSprite - Early return: atlas not found (atlasId: " + std::to_string(sprite->atlasId) + ")");
-         return;
-     }
-     
-     //  get js camera state
-     CameraState cam = GetCameraState(bufRefId);
-     
-     // calculate world-space sprite bounds
-     float worldW = sprite->frameWidth * sprite->scaleX;
-     float worldH = sprite->frameHeight * sprite->scaleY;
-     
-     // frustum cull
-     if (!IsInFrustum(cam, sprite->x, sprite->y, worldW, worldH)) {
-        //  Debugger::Instance().LogInfo("DrawSprite - Early return: sprite outside frustum (pos: " + std::to_string(sprite->x) + ", " + std::to_string(sprite->y) + ")");
-         return; // Off-screen, don't draw
-     }
-     
-     // convert to screen space
-     ScreenRect screenRect = WorldToScreen(cam, sprite->x, sprite->y, worldW, worldH);
-     
+    if (atlas->flags & TATLAS_FLAG_OPACITY_KNOWN)
+        return (atlas->flags & TATLAS_FLAG_OPAQUE) != 0;
 
-     std::lock_guard<std::mutex> lock(buffers_mutex_);
-     if (bufRefId >= shared_buffers_ref.size()) {
-         Debugger::Instance().LogWarn("DrawSprite - Early return: bufRefId out of range (bufRefId: " + std::to_string(bufRefId) + ", size: " + std::to_string(shared_buffers_ref.size()) + ")");
-         return;
-     }
-     
-     SharedBufferRefs* s = shared_buffers_ref[bufRefId];
-     if (!s || !s->control) {
-         Debugger::Instance().LogWarn("DrawSprite - Early return: SharedBufferRefs or control is null (bufRefId: " + std::to_string(bufRefId) + ")");
-         return;
-     }
-    
-    std::atomic<uint32_t>* ctrl = reinterpret_cast<std::atomic<uint32_t>*>(s->control);
-    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
-    uint8_t* dstBuffer = s->pixel_buffers[js_write];
-    
-    // get frame rect from atlas
-    FrameRect srcRect = GetFrameRect(sprite, sprite->currentFrame);
-    
-    // blit pixels (choose fast path if opaque)
-    if (sprite->opaque) {
-        BlitSpriteNN_Opaque(dstBuffer, s->width, s->height, screenRect, 
-                           atlas, srcRect, sprite->flipH, sprite->flipV);
-    } else {
-        BlitSpriteNN_Alpha(dstBuffer, s->width, s->height, screenRect,
-                          atlas, srcRect, sprite->flipH, sprite->flipV);
-    }
+    bool opaque = atlas->format == ATLAS_FORMAT_INDEXED8
+                      ? ScanOpaqueIndexed(atlas->data, atlas->width, atlas->height, atlas->stride, atlas->palette.data())
+                      : ScanOpaque(atlas->data, atlas->width, atlas->height, atlas->stride);
+    atlas->flags |= TATLAS_FLAG_OPACITY_KNOWN | (opaque ? TATLAS_FLAG_OPAQUE : 0);
+    return opaque;
+}
 
-    // mark dirty region
-    // Add region for the sprite's screen bounds
-    uint32_t dirty_count = ctrl[CTRL_DIRTY_COUNT].load(std::memory_order_acquire);
-    
-    if (dirty_count < MAX_DIRTY_REGIONS) {
-        uint32_t offset = CTRL_DIRTY_REGIONS + (dirty_count * 4);
-        
-        // Clamp to buffer bounds
-        int32_t rx = screenRect.x < 0 ? 0 : screenRect.x;
-        int32_t ry = screenRect.y < 0 ? 0 : screenRect.y;
-        uint32_t rw = screenRect.width;
-        uint32_t rh = screenRect.height;
-        
-        if (rx + rw > s->width)
-            rw = s->width - rx;
-        if (ry + rh > s->height)
-            rh = s->height - ry;
-        
-        ctrl[offset + 0] = rx;
-        ctrl[offset + 1] = ry;
-        ctrl[offset + 2] = rw;
-        ctrl[offset + 3] = rh;
-        
-        ctrl[CTRL_DIRTY_COUNT].store(dirty_count + 1, std::memory_order_release);
+void Renderer::FreeAtlas(uint32_t atlasId)
+{
+    std::lock_guard<std::mutex> lock(atlas_mutex_);
+    auto it = atlases_.find(atlasId);
+    if (it != atlases_.end())
+    {
+        atlas_resident_bytes_ -= it->second->residentBytes;
+        delete it->second;
+        atlases_.erase(it);
     }
-
-    // Debug output
-    // Debugger::Instance().LogInfo("DrawSprite - ID: " + std::to_string(spriteId) + 
-    //                               " | Atlas: " + std::to_string(sprite->atlasId) +
-    //                               " | Frame: " + std::to_string(sprite->currentFrame));
-    
-    // Debugger::Instance().LogInfo("DrawSprite - World Pos: (" + std::to_string(sprite->x) + 
-    //                               ", " + std::to_string(sprite->y) + 
-    //                               ") | World Size: " + std::to_string(worldW) + 
-    //                               "x" + std::to_string(worldH));
-    
-    // Debugger::Instance().LogInfo("DrawSprite - Screen Rect: (" + std::to_string(screenRect.x) + 
-    //                               ", " + std::to_string(screenRect.y) + 
-    //                               ") | Screen Size: " + std::to_string(screenRect.width) + 
-    //                               "x" + std::to_string(screenRect.height));
-    
-    // Debugger::Instance().LogInfo("DrawSprite - Dirty Region Count: " + std::to_string(dirty_count) + 
-    //                               "/" + std::to_string(MAX_DIRTY_REGIONS) +
-    //                               " | Buffer ID: " + std::to_string(bufRefId) +
-    //                               " | Buffer Size: " + std::to_string(s->width) + 
-    //                               "x" + std::to_string(s->height));
-    
-    // Debugger::Instance().LogInfo("DrawSprite - Scale: (" + std::to_string(sprite->scaleX) + 
-    //                               ", " + std::to_string(sprite->scaleY) + 
-    //                               ") | Flip: H=" + std::to_string(sprite->flipH) + 
-    //                               " V=" + std::to_string(sprite->flipV) +
-    //                               " | Opaque: " + std::to_string(sprite->opaque));
-    
-    // We do NOT swap buffers or set dirty flag here
-    // That only happens on canvas.upload() in javascript, on js has the final say
 }
 
+// renderer.cpp
 
-// anim 
+uint32_t Renderer::CreateSprite(uint32_t atlasId, uint32_t frameWidth, uint32_t frameHeight,
+                                uint32_t frameCount, bool opaque)
+{
+    // Validate atlas exists
+    SpriteAtlas *atlas = GetAtlas(atlasId);
+    if (!atlas)
+    {
+        Debugger::Instance().LogError("CreateSprite: invalid atlasId " + std::to_string(atlasId));
+        return 0;
+    }
 
+    // frameWidth 0 means "use the atlas frame table"
+    if (frameWidth == 0 && !atlas->frames.empty())
+    {
+        frameWidth = atlas->frames[0].sourceW;
+        frameHeight = atlas->frames[0].sourceH;
+    }
+    if (frameWidth == 0 || frameHeight == 0)
+    {
+        Debugger::Instance().LogError("CreateSprite: frame size is 0 and atlas " + std::to_string(atlasId) + " has no frame table");
+        return 0;
+    }
 
-uint32_t Renderer::CreateSpriteWithAnimations(uint32_t atlasId, uint32_t frameWidth,
-                                              uint32_t frameHeight, bool opaque,
-                                              const std::vector<AnimationDef>& animations)
-{
-    // Create base sprite
-    AnimatedSprite* sprite = new AnimatedSprite();
+    AnimatedSprite *sprite = new AnimatedSprite();
     sprite->atlasId = atlasId;
     sprite->frameWidth = frameWidth;
     sprite->frameHeight = frameHeight;
-    sprite->framesPerRow = 0; // Will be set from atlas
+    sprite->framesPerRow = atlas->width / frameWidth;
     sprite->opaque = opaque ? 1 : 0;
-    
-    // Calculate frames per row from atlas
-    SpriteAtlas* atlas = GetAtlas(atlasId);
-    if (atlas) {
-        sprite->framesPerRow = atlas->width / frameWidth;
-    }
-    
-    // Load animations
-    uint32_t nextAnimId = 1;
-    for (const auto& animDef : animations) {
-        SpriteAnimation* anim = new SpriteAnimation();
-        anim->name = animDef.name;
-        anim->id = nextAnimId++;
-        anim->fps = animDef.fps;
-        anim->loop = animDef.loop;
-        anim->frameCount = animDef.frames.size();
-        
-        // Copy frame array
-        anim->frames = new uint32_t[anim->frameCount];
-        for (size_t i = 0; i < anim->frameCount; i++) {
-            anim->frames[i] = animDef.frames[i];
-        }
-        
-        // Store in dictionaries
-        sprite->animations[anim->id] = anim;
-        sprite->animationNames[anim->name] = anim->id;
-    }
-    
-    // Set initial frame to first frame of first animation (if any)
-    if (!animations.empty() && animations[0].frames.size() > 0) {
-        sprite->currentFrame = animations[0].frames[0];
-    }
-    
-    // Register sprite
+
+    // Default position (will be updated from JS)
+    sprite->x = 0;
+    sprite->y = 0;
+    sprite->scaleX = 1.0f;
+    sprite->scaleY = 1.0f;
+    sprite->rotation = 0;
+    sprite->currentFrame = 0;
+
     std::lock_guard<std::mutex> lock(sprite_mutex_);
     uint32_t id = next_sprite_id_++;
     sprites_[id] = sprite;
-    
-    Debugger::Instance().LogInfo("Created sprite " + std::to_string(id) + 
-                                 " with " + std::to_string(animations.size()) + " animations");
-    
+
+    Debugger::Instance().LogInfo("Created sprite " + std::to_string(id) +
+                                 " from atlas " + std::to_string(atlasId));
+
     return id;
 }
 
-void Renderer::PlayAnimation(uint32_t spriteId, const std::string& animName)
+AnimatedSprite *Renderer::GetSprite(uint32_t spriteId)
 {
-    AnimatedSprite* sprite = GetSprite(spriteId);
+    std::lock_guard<std::mutex> lock(sprite_mutex_);
+    auto it = sprites_.find(spriteId);
+    if (it == sprites_.end())
+        return nullptr;
+    return it->second;
+}
+
+void Renderer::UpdateSprite(uint32_t spriteId, float x, float y, float rotation,
+                            float scaleX, float scaleY, uint32_t frame,
+                            uint8_t flipH, uint8_t flipV)
+{
+    AnimatedSprite *sprite = GetSprite(spriteId);
     if (!sprite)
         return;
-    
-    // Lookup animation ID by name
-    auto it = sprite->animationNames.find(animName);
-    if (it == sprite->animationNames.end()) {
-        Debugger::Instance().LogWarn("Animation '" + animName + "' not found on sprite " + 
-                                        std::to_string(spriteId));
-        return;
+
+    sprite->x = x;
+    sprite->y = y;
+    sprite->rotation = rotation;
+    sprite->scaleX = scaleX;
+    sprite->scaleY = scaleY;
+    sprite->currentFrame = frame;
+    sprite->flipH = flipH;
+    sprite->flipV = flipV;
+}
+
+void Renderer::DestroySprite(uint32_t spriteId)
+{
+    std::lock_guard<std::mutex> lock(sprite_mutex_);
+    auto it = sprites_.find(spriteId);
+    if (it != sprites_.end())
+    {
+        delete it->second;
+        sprites_.erase(it);
     }
-    
-    PlayAnimationById(spriteId, it->second);
 }
 
-void Renderer::PlayAnimationById(uint32_t spriteId, uint32_t animId)
+void Renderer::ResetSpritePalette(uint32_t spriteId)
+{
+    AnimatedSprite *sprite = GetSprite(spriteId);
+    if (sprite)
+        sprite->palette.clear();
+}
+
+bool Renderer::SetSpritePalette(uint32_t spriteId, const uint32_t *colors, uint32_t count)
+{
+    AnimatedSprite *sprite = GetSprite(spriteId);
+    if (!sprite)
+        return false;
+
+    SpriteAtlas *atlas = GetAtlas(sprite->atlasId);
+    if (!atlas || atlas->format != ATLAS_FORMAT_INDEXED8)
+    {
+        Debugger::Instance().LogWarn("SetSpritePalette: sprite " + std::to_string(spriteId) + " does not use an indexed atlas");
+        return false;
+    }
+
+    // entries past `count` keep the atlas colours
+    if (count > ATLAS_PALETTE_SIZE)
+        count = ATLAS_PALETTE_SIZE;
+    sprite->palette = atlas->palette;
+    memcpy(sprite->palette.data(), colors, count * sizeof(uint32_t));
+    return true;
+}
+
+bool Renderer::CycleSpritePalette(uint32_t spriteId, uint32_t start, uint32_t count, int32_t shift)
+{
+    AnimatedSprite *sprite = GetSprite(spriteId);
+    if (!sprite)
+        return false;
+
+    if (sprite->palette.empty())
+    {
+        SpriteAtlas *atlas = GetAtlas(sprite->atlasId);
+        if (!atlas || atlas->format != ATLAS_FORMAT_INDEXED8)
+            return false;
+        sprite->palette = atlas->palette;
+    }
+
+    if (start >= ATLAS_PALETTE_SIZE || count < 2)
+        return true;
+    if (start + count > ATLAS_PALETTE_SIZE)
+        count = ATLAS_PALETTE_SIZE - start;
+
+    // positive shift moves entry i to i + shift, wrapping inside the range
+    int32_t n = static_cast<int32_t>(count);
+    int32_t k = ((shift % n) + n) % n;
+    if (k == 0)
+        return true;
+
+    auto first = sprite->palette.begin() + start;
+    std::rotate(first, first + (n - k), first + n);
+    return true;
+}
+
+struct FrameRect
+{
+    uint32_t x, y, w, h;
+};
+
+// pixels a blitter samples from: the atlas itself or one of its mip levels
+struct AtlasSurface
+{
+    const uint8_t *data;
+    uint32_t stride;
+    uint32_t format;
+};
+
+static AtlasSurface AtlasLevel(const SpriteAtlas *atlas, uint32_t level)
+{
+    if (level == 0 || level > atlas->mips.size())
+        return {atlas->data, atlas->stride, atlas->format};
+
+    const AtlasMipLevel &mip = atlas->mips[level - 1];
+    return {mip.pixels.data(), mip.width * 4, ATLAS_FORMAT_RGBA8};
+}
+
+// frame rect scaled down to a mip level, rounded outwards; mip sizes round
+// up too, so a frame inside the atlas stays inside the level
+static FrameRect LevelRect(const FrameRect &rect, uint32_t level)
+{
+    if (level == 0)
+        return rect;
+
+    uint32_t x0 = rect.x >> level;
+    uint32_t y0 = rect.y >> level;
+    uint32_t x1 = (rect.x + rect.w + (1u << level) - 1) >> level;
+    uint32_t y1 = (rect.y + rect.h + (1u << level) - 1) >> level;
+    return {x0, y0, x1 - x0, y1 - y0};
+}
+
+FrameRect GetFrameRect(AnimatedSprite *sprite, uint32_t frameIndex)
+{
+    if (sprite->framesPerRow == 0)
+        return {0, 0, sprite->frameWidth, sprite->frameHeight};
+
+    uint32_t col = frameIndex % sprite->framesPerRow;
+    uint32_t row = frameIndex / sprite->framesPerRow;
+
+    return {
+        col * sprite->frameWidth,
+        row * sprite->frameHeight,
+        sprite->frameWidth,
+        sprite->frameHeight};
+}
+
+
+// Fast path: opaque, no rotation, nearest neighbor
+void BlitSpriteNN_Opaque(uint8_t* dstBuffer, uint32_t dstWidth, uint32_t dstHeight,
+                         const ScreenRect& dstRect,
+                         const AtlasSurface& src, const FrameRect& srcRect,
+                         bool flipH, bool flipV)
+{
+    // Clamp dest rect to buffer bounds
+    int32_t dstX = dstRect.x;
+    int32_t dstY = dstRect.y;
+    int32_t dstW = dstRect.width;
+    int32_t dstH = dstRect.height;
+    
+    if (dstX >= static_cast<int32_t>(dstWidth) || dstY >= static_cast<int32_t>(dstHeight))
+        return;
+    if (dstX + dstW <= 0 || dstY + dstH <= 0)
+        return;
+    
+   
+    int32_t clipLeft = 0, clipTop = 0;
+    if (dstX < 0) {
+        clipLeft = -dstX;
+        dstW += dstX;
+        dstX = 0;
+    }
+    if (dstY < 0) {
+        clipTop = -dstY;
+        dstH += dstY;
+        dstY = 0;
+    }
+    if (dstX + dstW > static_cast<int32_t>(dstWidth))
+        dstW = dstWidth - dstX;
+    if (dstY + dstH > static_cast<int32_t>(dstHeight))
+        dstH = dstHeight - dstY;
+    
+    if (dstW <= 0 || dstH <= 0)
+        return;
+    
+    const uint8_t* srcData = src.data;
+    const uint32_t srcStride = src.stride;
+    const float scaleX = static_cast<float>(srcRect.w) / dstRect.width;
+    const float scaleY = static_cast<float>(srcRect.h) / dstRect.height;
+    
+    // Row-by-row blit
+    for (int32_t row = 0; row < dstH; row++) {
+        int32_t screenY = dstY + row;
+        int32_t localY = clipTop + row;
+        
+        // Map to source Y
+        float srcYf = (localY + 0.5f) * scaleY;
+        uint32_t srcY = static_cast<uint32_t>(srcYf);
+        if (flipV)
+            srcY = (srcRect.h - 1) - srcY;
+        srcY += srcRect.y;
+        
+        uint32_t dstRowBase = screenY * dstWidth * 4;
+        size_t srcRowBase = static_cast<size_t>(srcY) * srcStride;
+        
+        for (int32_t col = 0; col < dstW; col++) {
+            int32_t screenX = dstX + col;
+            int32_t localX = clipLeft + col;
+            
+            // Map to source X
+            float srcXf = (localX + 0.5f) * scaleX;
+            uint32_t srcX = static_cast<uint32_t>(srcXf);
+            if (flipH)
+                srcX = (srcRect.w - 1) - srcX;
+            srcX += srcRect.x;
+            
+            uint32_t dstIdx = dstRowBase + screenX * 4;
+            size_t srcIdx = srcRowBase + srcX * 4;
+            
+            // Direct copy (opaque, no blend)
+            dstBuffer[dstIdx + 0] = srcData[srcIdx + 0]; // R
+            dstBuffer[dstIdx + 1] = srcData[srcIdx + 1]; // G
+            dstBuffer[dstIdx + 2] = srcData[srcIdx + 2]; // B
+            dstBuffer[dstIdx + 3] = 255;                  // A
+        }
+    }
+}
+
+// With alpha blending
+void BlitSpriteNN_Alpha(uint8_t* dstBuffer, uint32_t dstWidth, uint32_t dstHeight,
+                        const ScreenRect& dstRect,
+                        const AtlasSurface& src, const FrameRect& srcRect,
+                        bool flipH, bool flipV)
+{
+
+    int32_t dstX = dstRect.x;
+    int32_t dstY = dstRect.y;
+    int32_t dstW = dstRect.width;
+    int32_t dstH = dstRect.height;
+    
+    if (dstX >= static_cast<int32_t>(dstWidth) || dstY >= static_cast<int32_t>(dstHeight))
+        return;
+    if (dstX + dstW <= 0 || dstY + dstH <= 0)
+        return;
+    
+    int32_t clipLeft = 0, clipTop = 0;
+    if (dstX < 0) {
+        clipLeft = -dstX;
+        dstW += dstX;
+        dstX = 0;
+    }
+    if (dstY < 0) {
+        clipTop = -dstY;
+        dstH += dstY;
+        dstY = 0;
+    }
+    if (dstX + dstW > static_cast<int32_t>(dstWidth))
+        dstW = dstWidth - dstX;
+    if (dstY + dstH > static_cast<int32_t>(dstHeight))
+        dstH = dstHeight - dstY;
+    
+    if (dstW <= 0 || dstH <= 0)
+        return;
+    
+    const uint8_t* srcData = src.data;
+    const uint32_t srcStride = src.stride;
+    const float scaleX = static_cast<float>(srcRect.w) / dstRect.width;
+    const float scaleY = static_cast<float>(srcRect.h) / dstRect.height;
+    
+    for (int32_t row = 0; row < dstH; row++) {
+        int32_t screenY = dstY + row;
+        int32_t localY = clipTop + row;
+        
+        float srcYf = (localY + 0.5f) * scaleY;
+        uint32_t srcY = static_cast<uint32_t>(srcYf);
+        if (flipV)
+            srcY = (srcRect.h - 1) - srcY;
+        srcY += srcRect.y;
+        
+        uint32_t dstRowBase = screenY * dstWidth * 4;
+        size_t srcRowBase = static_cast<size_t>(srcY) * srcStride;
+        
+        for (int32_t col = 0; col < dstW; col++) {
+            int32_t screenX = dstX + col;
+            int32_t localX = clipLeft + col;
+            
+            float srcXf = (localX + 0.5f) * scaleX;
+            uint32_t srcX = static_cast<uint32_t>(srcXf);
+            if (flipH)
+                srcX = (srcRect.w - 1) - srcX;
+            srcX += srcRect.x;
+            
+            uint32_t dstIdx = dstRowBase + screenX * 4;
+            size_t srcIdx = srcRowBase + srcX * 4;
+            
+            uint8_t sR = srcData[srcIdx + 0];
+            uint8_t sG = srcData[srcIdx + 1];
+            uint8_t sB = srcData[srcIdx + 2];
+            uint8_t sA = srcData[srcIdx + 3];
+            
+            if (sA == 255) {
+                // Fully opaque pixel - direct copy
+                dstBuffer[dstIdx + 0] = sR;
+                dstBuffer[dstIdx + 1] = sG;
+                dstBuffer[dstIdx + 2] = sB;
+                dstBuffer[dstIdx + 3] = 255;
+            } else if (sA > 0) {
+                // Alpha blend
+                uint8_t dR = dstBuffer[dstIdx + 0];
+                uint8_t dG = dstBuffer[dstIdx + 1];
+                uint8_t dB = dstBuffer[dstIdx + 2];
+                uint8_t dA = dstBuffer[dstIdx + 3];
+                
+                uint32_t inv = 255 - sA;
+                
+                uint8_t outR = ((sR * sA + dR * inv) + 127) / 255;
+                uint8_t outG = ((sG * sA + dG * inv) + 127) / 255;
+                uint8_t outB = ((sB * sA + dB * inv) + 127) / 255;
+                uint8_t outA = ((sA * 255 + dA * inv) + 127) / 255;
+                
+                dstBuffer[dstIdx + 0] = outR;
+                dstBuffer[dstIdx + 1] = outG;
+                dstBuffer[dstIdx + 2] = outB;
+                dstBuffer[dstIdx + 3] = outA;
+            }
+            // If sA == 0, skip (fully transparent)
+        }
+    }
+}
+
+// Indexed atlas: expand through the palette while blitting
+void BlitSpriteNN_Palette(uint8_t* dstBuffer, uint32_t dstWidth, uint32_t dstHeight,
+                          const ScreenRect& dstRect,
+                          const AtlasSurface& src, const uint32_t* palette,
+                          const FrameRect& srcRect,
+                          bool flipH, bool flipV, bool opaque)
+{
+    int32_t dstX = dstRect.x;
+    int32_t dstY = dstRect.y;
+    int32_t dstW = dstRect.width;
+    int32_t dstH = dstRect.height;
+    
+    if (dstX >= static_cast<int32_t>(dstWidth) || dstY >= static_cast<int32_t>(dstHeight))
+        return;
+    if (dstX + dstW <= 0 || dstY + dstH <= 0)
+        return;
+    
+    int32_t clipLeft = 0, clipTop = 0;
+    if (dstX < 0) {
+        clipLeft = -dstX;
+        dstW += dstX;
+        dstX = 0;
+    }
+    if (dstY < 0) {
+        clipTop = -dstY;
+        dstH += dstY;
+        dstY = 0;
+    }
+    if (dstX + dstW > static_cast<int32_t>(dstWidth))
+        dstW = dstWidth - dstX;
+    if (dstY + dstH > static_cast<int32_t>(dstHeight))
+        dstH = dstHeight - dstY;
+    
+    if (dstW <= 0 || dstH <= 0)
+        return;
+    
+    const uint8_t* srcData = src.data;
+    const uint32_t srcStride = src.stride;
+    const uint8_t* pal = reinterpret_cast<const uint8_t*>(palette);
+    const float scaleX = static_cast<float>(srcRect.w) / dstRect.width;
+    const float scaleY = static_cast<float>(srcRect.h) / dstRect.height;
+    
+    for (int32_t row = 0; row < dstH; row++) {
+        int32_t screenY = dstY + row;
+        int32_t localY = clipTop + row;
+        
+        float srcYf = (localY + 0.5f) * scaleY;
+        uint32_t srcY = static_cast<uint32_t>(srcYf);
+        if (flipV)
+            srcY = (srcRect.h - 1) - srcY;
+        srcY += srcRect.y;
+        
+        uint32_t dstRowBase = screenY * dstWidth * 4;
+        const uint8_t* srcRow = srcData + static_cast<size_t>(srcY) * srcStride;
+        
+        for (int32_t col = 0; col < dstW; col++) {
+            int32_t screenX = dstX + col;
+            int32_t localX = clipLeft + col;
+            
+            float srcXf = (localX + 0.5f) * scaleX;
+            uint32_t srcX = static_cast<uint32_t>(srcXf);
+            if (flipH)
+                srcX = (srcRect.w - 1) - srcX;
+            srcX += srcRect.x;
+            
+            uint32_t dstIdx = dstRowBase + screenX * 4;
+            const uint8_t* c = pal + srcRow[srcX] * 4;
+            uint8_t sA = c[3];
+            
+            if (opaque || sA == 255) {
+                dstBuffer[dstIdx + 0] = c[0];
+                dstBuffer[dstIdx + 1] = c[1];
+                dstBuffer[dstIdx + 2] = c[2];
+                dstBuffer[dstIdx + 3] = 255;
+            } else if (sA > 0) {
+                uint32_t inv = 255 - sA;
+                dstBuffer[dstIdx + 0] = ((c[0] * sA + dstBuffer[dstIdx + 0] * inv) + 127) / 255;
+                dstBuffer[dstIdx + 1] = ((c[1] * sA + dstBuffer[dstIdx + 1] * inv) + 127) / 255;
+                dstBuffer[dstIdx + 2] = ((c[2] * sA + dstBuffer[dstIdx + 2] * inv) + 127) / 255;
+                dstBuffer[dstIdx + 3] = ((sA * 255 + dstBuffer[dstIdx + 3] * inv) + 127) / 255;
+            }
+        }
+    }
+}
+
+// Frame stored turned 90deg clockwise in the sheet (TexturePacker "rotated").
+// srcRect is the upright frame, upright (u, v) lives at sheet (x + h-1-v, y + u)
+void BlitSpriteNN_Rotated(uint8_t* dstBuffer, uint32_t dstWidth, uint32_t dstHeight,
+                          const ScreenRect& dstRect,
+                          const AtlasSurface& src, const uint32_t* palette,
+                          const FrameRect& srcRect,
+                          bool flipH, bool flipV)
+{
+    int32_t dstX = dstRect.x;
+    int32_t dstY = dstRect.y;
+    int32_t dstW = dstRect.width;
+    int32_t dstH = dstRect.height;
+    
+    if (dstX >= static_cast<int32_t>(dstWidth) || dstY >= static_cast<int32_t>(dstHeight))
+        return;
+    if (dstX + dstW <= 0 || dstY + dstH <= 0)
+        return;
+    
+    int32_t clipLeft = 0, clipTop = 0;
+    if (dstX < 0) {
+        clipLeft = -dstX;
+        dstW += dstX;
+        dstX = 0;
+    }
+    if (dstY < 0) {
+        clipTop = -dstY;
+        dstH += dstY;
+        dstY = 0;
+    }
+    if (dstX + dstW > static_cast<int32_t>(dstWidth))
+        dstW = dstWidth - dstX;
+    if (dstY + dstH > static_cast<int32_t>(dstHeight))
+        dstH = dstHeight - dstY;
+    
+    if (dstW <= 0 || dstH <= 0)
+        return;
+    
+    const bool indexed = src.format == ATLAS_FORMAT_INDEXED8;
+    const uint8_t* pal = reinterpret_cast<const uint8_t*>(palette);
+    const float scaleX = static_cast<float>(srcRect.w) / dstRect.width;
+    const float scaleY = static_cast<float>(srcRect.h) / dstRect.height;
+    
+    for (int32_t row = 0; row < dstH; row++) {
+        int32_t screenY = dstY + row;
+        uint32_t v = static_cast<uint32_t>((clipTop + row + 0.5f) * scaleY);
+        if (flipV)
+            v = (srcRect.h - 1) - v;
+        
+        // one upright row is one sheet column
+        uint32_t sheetX = srcRect.x + (srcRect.h - 1 - v);
+        uint32_t dstRowBase = screenY * dstWidth * 4;
+        
+        for (int32_t col = 0; col < dstW; col++) {
+            int32_t screenX = dstX + col;
+            uint32_t u = static_cast<uint32_t>((clipLeft + col + 0.5f) * scaleX);
+            if (flipH)
+                u = (srcRect.w - 1) - u;
+            
+            size_t sheetIdx = static_cast<size_t>(srcRect.y + u) * src.stride;
+            const uint8_t* c = indexed ? pal + src.data[sheetIdx + sheetX] * 4
+                                       : src.data + sheetIdx + sheetX * 4;
+            uint32_t dstIdx = dstRowBase + screenX * 4;
+            uint8_t sA = c[3];
+            
+            if (sA == 255) {
+                dstBuffer[dstIdx + 0] = c[0];
+                dstBuffer[dstIdx + 1] = c[1];
+                dstBuffer[dstIdx + 2] = c[2];
+                dstBuffer[dstIdx + 3] = 255;
+            } else if (sA > 0) {
+                uint32_t inv = 255 - sA;
+                dstBuffer[dstIdx + 0] = ((c[0] * sA + dstBuffer[dstIdx + 0] * inv) + 127) / 255;
+                dstBuffer[dstIdx + 1] = ((c[1] * sA + dstBuffer[dstIdx + 1] * inv) + 127) / 255;
+                dstBuffer[dstIdx + 2] = ((c[2] * sA + dstBuffer[dstIdx + 2] * inv) + 127) / 255;
+                dstBuffer[dstIdx + 3] = ((sA * 255 + dstBuffer[dstIdx + 3] * inv) + 127) / 255;
+            }
+        }
+    }
+}
+
+// Stand-in for an atlas that is still reloading (alpha 0: draw nothing)
+void FillAtlasPlaceholder(uint8_t* dstBuffer, uint32_t dstWidth, uint32_t dstHeight,
+                          const ScreenRect& dstRect, Color color)
+{
+    if (color.a == 0)
+        return;
+
+    int32_t x0 = dstRect.x < 0 ? 0 : dstRect.x;
+    int32_t y0 = dstRect.y < 0 ? 0 : dstRect.y;
+    int32_t x1 = dstRect.x + static_cast<int32_t>(dstRect.width);
+    int32_t y1 = dstRect.y + static_cast<int32_t>(dstRect.height);
+    if (x1 > static_cast<int32_t>(dstWidth))
+        x1 = dstWidth;
+    if (y1 > static_cast<int32_t>(dstHeight))
+        y1 = dstHeight;
+
+    uint32_t inv = 255 - color.a;
+    for (int32_t y = y0; y < y1; y++) {
+        uint8_t* px = dstBuffer + (static_cast<size_t>(y) * dstWidth + x0) * 4;
+        for (int32_t x = x0; x < x1; x++, px += 4) {
+            px[0] = ((color.r * color.a + px[0] * inv) + 127) / 255;
+            px[1] = ((color.g * color.a + px[1] * inv) + 127) / 255;
+            px[2] = ((color.b * color.a + px[2] * inv) + 127) / 255;
+            px[3] = ((color.a * 255 + px[3] * inv) + 127) / 255;
+        }
+    }
+}
+
+// cam work
+
+
+ScreenRect WorldToScreen(const CameraState &cam, float worldX, float worldY,
+                         float worldW, float worldH)
+{
+    // Translate to camera space
+    float dx = worldX - cam.worldX;
+    float dy = worldY - cam.worldY;
+
+    // Rotate by negative camera rotation (inverse transform)
+    float cosA = cosf(-cam.rotation);
+    float sinA = sinf(-cam.rotation);
+
+    float camX = dx * cosA - dy * sinA;
+    float camY = dx * sinA + dy * cosA;
+
+    // Apply zoom
+    camX *= cam.zoom;
+    camY *= cam.zoom;
+
+    // Convert to screen coordinates (camera center = screen center)
+    float screenX = camX + cam.viewWidth / 2.0f;
+    float screenY = camY + cam.viewHeight / 2.0f;
+
+    return {
+        static_cast<int32_t>(screenX),
+        static_cast<int32_t>(screenY),
+        static_cast<uint32_t>(worldW * cam.zoom),
+        static_cast<uint32_t>(worldH * cam.zoom)};
+}
+
+void Renderer::DrawSprite(uint32_t spriteId, size_t bufRefId)
+{
+    //  Debugger::Instance().LogInfo("DrawSprite called - spriteId: " + std::to_string(spriteId) + ", bufRefId: " + std::to_string(bufRefId));
+     
+     // process pending JS writes
+     ProcessPendingRegions(bufRefId);
+     
+
+     AnimatedSprite* sprite = GetSprite(spriteId);
+     if (!sprite) {
+         Debugger::Instance().LogWarn("DrawSprite - Early return: sprite not found (spriteId: " + std::to_string(spriteId) + ")");
+         return;
+     }
+     
+
+     // may come back without pixels while an evicted atlas reloads in the background
+     SpriteAtlas* atlas = AcquireAtlas(sprite->atlasId, true);
+     if (!atlas) {
+         Debugger::Instance().LogWarn("DrawSprite - Early return: atlas not found (atlasId: " + std::to_string(sprite->atlasId) + ")");
+         return;
+     }
+     bool pending = atlas->data == nullptr;
+     
+     //  get js camera state
+     CameraState cam = GetCameraState(bufRefId);
+     
+     // get frame rect from atlas; a frame table (trimmed frames) wins over the grid
+     FrameRect srcRect = GetFrameRect(sprite, sprite->currentFrame);
+     float worldX = sprite->x;
+     float worldY = sprite->y;
+     bool opaque = sprite->opaque != 0;
+     bool rotated = false;
+
+     if (!atlas->frames.empty()) {
+         if (sprite->currentFrame >= atlas->frames.size())
+             return;
+         const AtlasFrame &frame = atlas->frames[sprite->currentFrame];
+         if (frame.flags & ATLAS_FRAME_EMPTY)
+             return; // nothing visible in this frame
+
+         srcRect = {frame.x, frame.y, frame.w, frame.h};
+
+         // place the trimmed rect where it sat in the untrimmed frame
+         int32_t offX = sprite->flipH ? static_cast<int32_t>(frame.sourceW) - frame.trimX - static_cast<int32_t>(frame.w) : frame.trimX;
+         int32_t offY = sprite->flipV ? static_cast<int32_t>(frame.sourceH) - frame.trimY - static_cast<int32_t>(frame.h) : frame.trimY;
+         worldX += offX * sprite->scaleX;
+         worldY += offY * sprite->scaleY;
+
+         if (frame.flags & ATLAS_FRAME_OPAQUE)
+             opaque = true;
+         rotated = (frame.flags & ATLAS_FRAME_ROTATED) != 0;
+     }
+
+     // calculate world-space sprite bounds
+     float worldW = srcRect.w * sprite->scaleX;
+     float worldH = srcRect.h * sprite->scaleY;
+     
+     // frustum cull
+     if (!IsInFrustum(cam, worldX, worldY, worldW, worldH)) {
+        //  Debugger::Instance().LogInfo("DrawSprite - Early return: sprite outside frustum (pos: " + std::to_string(sprite->x) + ", " + std::to_string(sprite->y) + ")");
+         return; // Off-screen, don't draw
+     }
+     
+     // convert to screen space
+     ScreenRect screenRect = WorldToScreen(cam, worldX, worldY, worldW, worldH);
+     if (screenRect.width == 0 || screenRect.height == 0)
+         return;
+     
+
+     std::lock_guard<std::mutex> lock(buffers_mutex_);
+     if (bufRefId >= shared_buffers_ref.size()) {
+         Debugger::Instance().LogWarn("DrawSprite - Early return: bufRefId out of range (bufRefId: " + std::to_string(bufRefId) + ", size: " + std::to_string(shared_buffers_ref.size()) + ")");
+         return;
+     }
+     
+     SharedBufferRefs* s = shared_buffers_ref[bufRefId];
+     if (!s || !s->control) {
+         Debugger::Instance().LogWarn("DrawSprite - Early return: SharedBufferRefs or control is null (bufRefId: " + std::to_string(bufRefId) + ")");
+         return;
+     }
+    
+    std::atomic<uint32_t>* ctrl = reinterpret_cast<std::atomic<uint32_t>*>(s->control);
+    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
+    uint8_t* dstBuffer = s->pixel_buffers[js_write];
+    
+    // zoomed out: sample a pre-filtered level instead of skipping texels
+    uint32_t level = pending ? 0 : SelectAtlasLevel(atlas, srcRect.w, srcRect.h, screenRect.width, screenRect.height);
+    AtlasSurface surface = AtlasLevel(atlas, level);
+    FrameRect levelRect = LevelRect(srcRect, level);
+    if (rotated && level > 0) {
+        // scale the area the frame covers in the sheet (w/h swapped), then turn it back upright
+        FrameRect sheetRect = LevelRect({srcRect.x, srcRect.y, srcRect.h, srcRect.w}, level);
+        levelRect = {sheetRect.x, sheetRect.y, sheetRect.h, sheetRect.w};
+    }
+
+    // blit pixels (choose fast path if opaque)
+    const uint32_t* palette = sprite->palette.empty() ? atlas->palette.data() : sprite->palette.data();
+    if (pending) {
+        FillAtlasPlaceholder(dstBuffer, s->width, s->height, screenRect, atlas_placeholder_);
+    } else if (rotated) {
+        BlitSpriteNN_Rotated(dstBuffer, s->width, s->height, screenRect,
+                             surface, palette, levelRect, sprite->flipH, sprite->flipV);
+    } else if (surface.format == ATLAS_FORMAT_INDEXED8) {
+        // opacity was worked out against the atlas palette; an override may add alpha
+        BlitSpriteNN_Palette(dstBuffer, s->width, s->height, screenRect,
+                             surface, palette, levelRect, sprite->flipH, sprite->flipV, opaque && sprite->palette.empty());
+    } else if (opaque && level == 0) {
+        // filtered levels have soft edges, only the base level keeps the opaque guarantee
+        BlitSpriteNN_Opaque(dstBuffer, s->width, s->height, screenRect, 
+                           surface, levelRect, sprite->flipH, sprite->flipV);
+    } else {
+        BlitSpriteNN_Alpha(dstBuffer, s->width, s->height, screenRect,
+                          surface, levelRect, sprite->flipH, sprite->flipV);
+    }
+
+    // mark dirty region for the sprite's screen bounds
+    RecordDirtyRegion(s, screenRect.x, screenRect.y, screenRect.width, screenRect.height);
+
+    // Debug output
+    // Debugger::Instance().LogInfo("DrawSprite - ID: " + std::to_string(spriteId) + 
+    //                               " | Atlas: " + std::to_string(sprite->atlasId) +
+    //                               " | Frame: " + std::to_string(sprite->currentFrame));
+    
+    // Debugger::Instance().LogInfo("DrawSprite - World Pos: (" + std::to_string(sprite->x) + 
+    //                               ", " + std::to_string(sprite->y) + 
+    //                               ") | World Size: " + std::to_string(worldW) + 
+    //                               "x" + std::to_string(worldH));
+    
+    // Debugger::Instance().LogInfo("DrawSprite - Screen Rect: (" + std::to_string(screenRect.x) + 
+    //                               ", " + std::to_string(screenRect.y) + 
+    //                               ") | Screen Size: " + std::to_string(screenRect.width) + 
+    //                               "x" + std::to_string(screenRect.height));
+    
+    // Debugger::Instance().LogInfo("DrawSprite - Dirty Region Count: " + std::to_string(dirty_count) + 
+    //                               "/" + std::to_string(MAX_DIRTY_REGIONS) +
+    //                               " | Buffer ID: " + std::to_string(bufRefId) +
+    //                               " | Buffer Size: " + std::to_string(s->width) + 
+    //                               "x" + std::to_string(s->height));
+    
+    // Debugger::Instance().LogInfo("DrawSprite - Scale: (" + std::to_string(sprite->scaleX) + 
+    //                               ", " + std::to_string(sprite->scaleY) + 
+    //                               ") | Flip: H=" + std::to_string(sprite->flipH) + 
+    //                               " V=" + std::to_string(sprite->flipV) +
+    //                               " | Opaque: " + std::to_string(sprite->opaque));
+    
+    // We do NOT swap buffers or set dirty flag here
+    // That only happens on canvas.upload() in javascript, on js has the final say
+}
+
+
+
+// fills
+
+// below this many pixels a fill isn't worth waking the pool
+static const size_t FILL_PARALLEL_PIXELS = 256 * 256;
+static const uint32_t FILL_STRIP_ROWS = 32;
+
+// world point through the camera, unrounded (WorldToScreen without the size)
+static void WorldToScreenPoint(const CameraState &cam, float worldX, float worldY, float &screenX, float &screenY)
+{
+    float dx = worldX - cam.worldX;
+    float dy = worldY - cam.worldY;
+    float cosA = cosf(-cam.rotation);
+    float sinA = sinf(-cam.rotation);
+    screenX = (dx * cosA - dy * sinA) * cam.zoom + cam.viewWidth / 2.0f;
+    screenY = (dx * sinA + dy * cosA) * cam.zoom + cam.viewHeight / 2.0f;
+}
+
+bool Renderer::FillArea(size_t bufRefId, float x, float y, float w, float h, const FillKernel &kernel)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    CameraState cam = GetCameraState(bufRefId);
+    if (w <= 0.0f || h <= 0.0f || !IsInFrustum(cam, x, y, w, h))
+        return true;
+    ScreenRect r = WorldToScreen(cam, x, y, w, h);
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+
+    int64_t x0 = std::max<int64_t>(r.x, 0);
+    int64_t y0 = std::max<int64_t>(r.y, 0);
+    int64_t x1 = std::min<int64_t>(static_cast<int64_t>(r.x) + r.width, s->width);
+    int64_t y1 = std::min<int64_t>(static_cast<int64_t>(r.y) + r.height, s->height);
+    if (x1 <= x0 || y1 <= y0)
+        return true;
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
+    uint32_t cols = static_cast<uint32_t>(x1 - x0);
+    uint32_t rows = static_cast<uint32_t>(y1 - y0);
+
+    auto fillRows = [&](uint32_t from, uint32_t to)
+    {
+        for (uint32_t row = from; row < to; row++)
+        {
+            int32_t sy = static_cast<int32_t>(y0) + row;
+            kernel(dst + sy * stride + static_cast<size_t>(x0) * 4u, static_cast<int32_t>(x0), sy, cols);
+        }
+    };
+
+    if (static_cast<size_t>(cols) * rows < FILL_PARALLEL_PIXELS)
+    {
+        fillRows(0, rows);
+    }
+    else
+    {
+        size_t strips = (rows + FILL_STRIP_ROWS - 1) / FILL_STRIP_ROWS;
+        Workers().ParallelFor(strips, [&](size_t i)
+                              { fillRows(static_cast<uint32_t>(i) * FILL_STRIP_ROWS,
+                                         std::min<uint32_t>(rows, static_cast<uint32_t>(i + 1) * FILL_STRIP_ROWS)); });
+    }
+
+    RecordDirtyRegion(s, static_cast<int32_t>(x0), static_cast<int32_t>(y0), cols, rows);
+    return true;
+}
+
+bool Renderer::FillRect(size_t bufRefId, float x, float y, float w, float h, const Color4 &color)
+{
+    Color c = color.ToRaylib();
+    if (c.a == 0)
+    {
+        // nothing visible to draw
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        return bufRefId < shared_buffers_ref.size() && shared_buffers_ref[bufRefId];
+    }
+
+    uint32_t rgba;
+    std::memcpy(&rgba, &c, 4);
+    if (c.a == 255)
+        return FillArea(bufRefId, x, y, w, h, [rgba](uint8_t *dst, int32_t, int32_t, uint32_t count)
+                        { FillSpan(dst, rgba, count); });
+
+    // translucent: blend one prepared row of the colour over each target row
+    return FillArea(bufRefId, x, y, w, h, [rgba](uint8_t *dst, int32_t, int32_t, uint32_t count)
+                    {
+                        thread_local std::vector<uint8_t> row;
+                        if (row.size() < static_cast<size_t>(count) * 4u)
+                            row.resize(static_cast<size_t>(count) * 4u);
+                        FillSpan(row.data(), rgba, count);
+                        BlendSpan(dst, row.data(), count, 255, BLEND_NORMAL); });
+}
+
+bool Renderer::ClearRect(size_t bufRefId, float x, float y, float w, float h)
+{
+    return FillArea(bufRefId, x, y, w, h, [](uint8_t *dst, int32_t, int32_t, uint32_t count)
+                    { FillSpan(dst, 0u, count); });
+}
+
+// 256-entry ramp through stops in any order; true when every entry is opaque
+static bool BuildSortedRamp(std::vector<GradientStop> stops, std::vector<uint8_t> &ramp)
+{
+    std::stable_sort(stops.begin(), stops.end(), [](const GradientStop &a, const GradientStop &b)
+                     { return a.offset < b.offset; });
+
+    ramp.assign(256 * 4, 0);
+    BuildGradientRamp(stops.data(), stops.size(), ramp.data());
+    bool opaque = true;
+    for (size_t i = 3; i < ramp.size(); i += 4)
+        opaque = opaque && ramp[i] == 255;
+    return opaque;
+}
+
+bool Renderer::FillGradient(size_t bufRefId, float x, float y, float w, float h, const Gradient &gradient)
+{
+    std::vector<uint8_t> ramp;
+    bool opaque = BuildSortedRamp(gradient.stops, ramp);
+
+    // geometry in screen space; t is sampled at pixel centres
+    CameraState cam = GetCameraState(bufRefId);
+    float px0, py0, px1, py1;
+    WorldToScreenPoint(cam, gradient.x0, gradient.y0, px0, py0);
+    WorldToScreenPoint(cam, gradient.x1, gradient.y1, px1, py1);
+    float dx = px1 - px0;
+    float dy = py1 - py0;
+    float len2 = dx * dx + dy * dy;
+    float r0 = gradient.r0 * cam.zoom;
+    float r1 = gradient.r1 * cam.zoom;
+    bool radial = gradient.type == GRADIENT_RADIAL;
+
+    return FillArea(bufRefId, x, y, w, h, [&](uint8_t *dst, int32_t sx, int32_t sy, uint32_t count)
+                    {
+                        thread_local std::vector<uint8_t> row;
+                        if (row.size() < static_cast<size_t>(count) * 4u)
+                            row.resize(static_cast<size_t>(count) * 4u);
+
+                        float fy = sy + 0.5f - py0;
+                        for (uint32_t i = 0; i < count; i++)
+                        {
+                            float fx = sx + i + 0.5f - px0;
+                            float t;
+                            if (radial)
+                            {
+                                float d = sqrtf(fx * fx + fy * fy);
+                                t = r1 > r0 ? (d - r0) / (r1 - r0) : (d >= r1 ? 1.0f : 0.0f);
+                            }
+                            else
+                            {
+                                // degenerate line: the end colour everywhere
+                                t = len2 > 0.0f ? (fx * dx + fy * dy) / len2 : 1.0f;
+                            }
+                            t = t < 0.0f ? 0.0f : (t > 1.0f ? 1.0f : t);
+                            std::memcpy(row.data() + i * 4, ramp.data() + static_cast<int>(t * 255.0f + 0.5f) * 4, 4);
+                        }
+
+                        if (opaque)
+                            std::memcpy(dst, row.data(), static_cast<size_t>(count) * 4u);
+                        else
+                            BlendSpan(dst, row.data(), count, 255, BLEND_NORMAL); });
+}
+
+bool Renderer::FillPolygon(size_t bufRefId, const float *points, size_t pointCount, const std::vector<uint32_t> &contours,
+                           const Color4 &color, FillRule rule, bool useCamera)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    Color c = color.ToRaylib();
+    if (pointCount < 3 || c.a == 0)
+        return true;
+
+    // everything below works in canvas pixels
+    std::vector<float> xy(points, points + pointCount * 2);
+    if (useCamera)
+    {
+        CameraState cam = GetCameraState(bufRefId);
+        for (size_t i = 0; i < pointCount; i++)
+            WorldToScreenPoint(cam, points[i * 2], points[i * 2 + 1], xy[i * 2], xy[i * 2 + 1]);
+    }
+
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    for (size_t i = 0; i < pointCount; i++)
+    {
+        if (!std::isfinite(xy[i * 2]) || !std::isfinite(xy[i * 2 + 1]))
+            continue;
+        minX = std::min(minX, xy[i * 2]);
+        maxX = std::max(maxX, xy[i * 2]);
+        minY = std::min(minY, xy[i * 2 + 1]);
+        maxY = std::max(maxY, xy[i * 2 + 1]);
+    }
+    if (minX > maxX)
+        return true;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+
+    // the raster covers the bounding box clipped to the canvas, no more;
+    // both ends are clamped in float so far-off points convert safely
+    const float fw = static_cast<float>(s->width);
+    const float fh = static_cast<float>(s->height);
+    if (maxX < 0.0f || minX > fw || maxY < 0.0f || minY > fh)
+        return true;
+    int64_t x0 = std::max<int64_t>(0, static_cast<int64_t>(std::floor(std::min(std::max(minX, -1.0f), fw + 1.0f))));
+    int64_t y0 = std::max<int64_t>(0, static_cast<int64_t>(std::floor(std::min(std::max(minY, -1.0f), fh + 1.0f))));
+    int64_t x1 = std::min<int64_t>(s->width, static_cast<int64_t>(std::ceil(std::min(std::max(maxX, -1.0f), fw + 1.0f))));
+    int64_t y1 = std::min<int64_t>(s->height, static_cast<int64_t>(std::ceil(std::min(std::max(maxY, -1.0f), fh + 1.0f))));
+    if (x1 <= x0 || y1 <= y0)
+        return true;
+
+    uint32_t w = static_cast<uint32_t>(x1 - x0);
+    uint32_t h = static_cast<uint32_t>(y1 - y0);
+    polygon_raster_.Reset(w, h);
+
+    auto addContour = [&](size_t first, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t a = first + i;
+            size_t b = first + (i + 1) % count; // contours close themselves
+            polygon_raster_.AddLine(xy[a * 2] - x0, xy[a * 2 + 1] - y0, xy[b * 2] - x0, xy[b * 2 + 1] - y0);
+        }
+    };
+
+    if (contours.empty())
+    {
+        addContour(0, pointCount);
+    }
+    else
+    {
+        size_t first = 0;
+        for (uint32_t count : contours)
+        {
+            count = static_cast<uint32_t>(std::min<size_t>(count, pointCount - first));
+            if (count >= 2)
+                addContour(first, count);
+            first += count;
+        }
+    }
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
+    uint32_t rgba;
+    std::memcpy(&rgba, &c, 4);
+
+    // rows resolve independently once all edges are in
+    auto fillRows = [&](uint32_t from, uint32_t to)
+    {
+        thread_local std::vector<uint8_t> coverage;
+        if (coverage.size() < w)
+            coverage.resize(w);
+        for (uint32_t row = from; row < to; row++)
+        {
+            uint32_t a, b;
+            if (polygon_raster_.ResolveSpan(row, rule, coverage.data(), a, b))
+                BlendMaskSpan(dst + (y0 + row) * stride + static_cast<size_t>(x0 + a) * 4u, rgba, coverage.data() + a, b - a);
+        }
+    };
+
+    if (static_cast<size_t>(w) * h < FILL_PARALLEL_PIXELS)
+    {
+        fillRows(0, h);
+    }
+    else
+    {
+        size_t strips = (h + FILL_STRIP_ROWS - 1) / FILL_STRIP_ROWS;
+        Workers().ParallelFor(strips, [&](size_t i)
+                              { fillRows(static_cast<uint32_t>(i) * FILL_STRIP_ROWS,
+                                         std::min<uint32_t>(h, static_cast<uint32_t>(i + 1) * FILL_STRIP_ROWS)); });
+    }
+
+    RecordDirtyRegion(s, static_cast<int32_t>(x0), static_cast<int32_t>(y0), w, h);
+    return true;
+}
+
+// one line or circle of a stroke batch, in canvas pixels
+struct StrokePrimitive
+{
+    float a, b, c, d; // line: x0, y0, x1, y1; circle: cx, cy, radius, -
+    float thickness;
+    uint32_t rgba;
+    DirtyRect bounds; // clipped to the canvas
+};
+
+// bytes an extra upload region is worth, as SharedBuffer assumes
+static const size_t STROKE_UPLOAD_OVERHEAD = 16 * 1024;
+
+bool Renderer::DrawStrokes(size_t bufRefId, const float *records, size_t count, bool circles, bool useCamera)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    CameraState cam = {};
+    if (useCamera)
+        cam = GetCameraState(bufRefId);
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+
+    // records only differ in where thickness and colour sit
+    const size_t stride = circles ? STROKE_CIRCLE_FLOATS : STROKE_LINE_FLOATS;
+    const size_t thicknessAt = stride - 5;
+
+    std::vector<StrokePrimitive> prims;
+    prims.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const float *r = records + i * stride;
+        bool finite = true;
+        for (size_t k = 0; k < stride; k++)
+            finite = finite && std::isfinite(r[k]);
+        if (!finite)
+            continue;
+        Color color = Color4(r[stride - 4], r[stride - 3], r[stride - 2], r[stride - 1]).ToRaylib();
+        if (color.a == 0)
+            continue;
+
+        StrokePrimitive p;
+        p.a = r[0];
+        p.b = r[1];
+        p.c = r[2];
+        p.d = circles ? 0.0f : r[3];
+        p.thickness = r[thicknessAt];
+        std::memcpy(&p.rgba, &color, 4);
+
+        float reach;
+        float left, top, right, bottom;
+        if (circles)
+        {
+            if (useCamera)
+            {
+                WorldToScreenPoint(cam, r[0], r[1], p.a, p.b);
+                p.c *= cam.zoom;
+                p.thickness *= cam.zoom;
+            }
+            if (p.c <= 0.0f || p.thickness < 0.0f)
+                continue;
+            reach = p.c + std::max(p.thickness, 1.0f) * 0.5f + 1.0f;
+            left = p.a - reach;
+            right = p.a + reach;
+            top = p.b - reach;
+            bottom = p.b + reach;
+        }
+        else
+        {
+            if (useCamera)
+            {
+                WorldToScreenPoint(cam, r[0], r[1], p.a, p.b);
+                WorldToScreenPoint(cam, r[2], r[3], p.c, p.d);
+                p.thickness *= cam.zoom;
+            }
+            if (p.thickness <= 0.0f)
+                continue;
+            reach = std::max(p.thickness, 1.0f) * 0.5f + 1.0f;
+            left = std::min(p.a, p.c) - reach;
+            right = std::max(p.a, p.c) + reach;
+            top = std::min(p.b, p.d) - reach;
+            bottom = std::max(p.b, p.d) + reach;
+        }
+
+        // clip to the canvas; strokes entirely off it are dropped here
+        auto clampTo = [](float v, uint32_t hi)
+        { return static_cast<int>(std::min(std::max(v, 0.0f), static_cast<float>(hi))); };
+        int x0 = clampTo(std::floor(left), s->width);
+        int y0 = clampTo(std::floor(top), s->height);
+        int x1 = clampTo(std::ceil(right), s->width);
+        int y1 = clampTo(std::ceil(bottom), s->height);
+        if (x1 <= x0 || y1 <= y0)
+            continue;
+        p.bounds = DirtyRect(x0, y0, x1 - x0, y1 - y0);
+        prims.push_back(p);
+    }
+
+    if (prims.empty())
+        return true;
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+
+    // Every strip walks the whole batch in order but only touches its own
+    // rows, so overlapping strokes still blend in submission order.
+    auto drawRows = [&](int32_t from, int32_t to)
+    {
+        RasterTarget target = {dst, s->width, from, to};
+        for (const StrokePrimitive &p : prims)
+        {
+            if (p.bounds.y >= to || p.bounds.y + p.bounds.height <= from)
+                continue;
+            if (circles)
+                DrawCircleAA(target, p.a, p.b, p.c, p.thickness, p.rgba);
+            else if (p.thickness <= 1.0f)
+                DrawLineWu(target, p.a, p.b, p.c, p.d, p.rgba, p.thickness);
+            else
+                DrawLineThick(target, p.a, p.b, p.c, p.d, p.thickness, p.rgba);
+        }
+    };
+
+    int64_t area = 0;
+    for (const StrokePrimitive &p : prims)
+        area += static_cast<int64_t>(p.bounds.width) * p.bounds.height;
+
+    if (static_cast<size_t>(area) < FILL_PARALLEL_PIXELS)
+    {
+        drawRows(0, static_cast<int32_t>(s->height));
+    }
+    else
+    {
+        size_t strips = (s->height + FILL_STRIP_ROWS - 1) / FILL_STRIP_ROWS;
+        Workers().ParallelFor(strips, [&](size_t i)
+                              { drawRows(static_cast<int32_t>(i * FILL_STRIP_ROWS),
+                                         static_cast<int32_t>(std::min<size_t>(s->height, (i + 1) * FILL_STRIP_ROWS))); });
+    }
+
+    // thousands of small bounds collapse into a few upload rects
+    DirtyRegionSet dirty;
+    for (const StrokePrimitive &p : prims)
+        dirty.Add(p.bounds.x, p.bounds.y, p.bounds.width, p.bounds.height);
+    for (const DirtyRect &r : dirty.UploadRects(STROKE_UPLOAD_OVERHEAD))
+        RecordDirtyRegion(s, r.x, r.y, r.width, r.height);
+    return true;
+}
+
+bool Renderer::DrawLines(size_t bufRefId, const float *records, size_t count, bool useCamera)
+{
+    return DrawStrokes(bufRefId, records, count, false, useCamera);
+}
+
+bool Renderer::DrawCircles(size_t bufRefId, const float *records, size_t count, bool useCamera)
+{
+    return DrawStrokes(bufRefId, records, count, true, useCamera);
+}
+
+// text
+
+uint32_t Renderer::CreateBitmapFont(uint32_t atlasId, const BitmapFontConfig &config)
+{
+    SpriteAtlas *atlas = GetAtlas(atlasId);
+    if (!atlas)
+    {
+        Debugger::Instance().LogError("CreateBitmapFont: invalid atlasId " + std::to_string(atlasId));
+        return 0;
+    }
+
+    FontFace *face = new FontFace();
+    face->atlasId = atlasId;
+    std::string error;
+    if (!face->font.Build(config, atlas->width, atlas->height, error))
+    {
+        Debugger::Instance().LogError("CreateBitmapFont: " + error);
+        delete face;
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(font_mutex_);
+    uint32_t id = next_font_id_++;
+    fonts_[id] = face;
+    return id;
+}
+
+void Renderer::FreeBitmapFont(uint32_t fontId)
+{
+    std::lock_guard<std::mutex> lock(font_mutex_);
+    auto it = fonts_.find(fontId);
+    if (it != fonts_.end())
+    {
+        delete it->second;
+        fonts_.erase(it);
+    }
+}
+
+bool Renderer::MeasureBitmapText(uint32_t fontId, const std::string &text, const TextStyle &style,
+                                 float &width, float &height, uint32_t &lines)
+{
+    std::lock_guard<std::mutex> lock(font_mutex_);
+    auto it = fonts_.find(fontId);
+    if (it == fonts_.end())
+        return false;
+
+    float scale = style.scale > 0.0f ? style.scale : 0.0f;
+    const TextLayout &layout = it->second->font.Layout(text, scale > 0.0f ? style.maxWidth / scale : 0.0f, style.align);
+    width = layout.width * scale;
+    height = layout.height * scale;
+    lines = layout.lines;
+    return true;
+}
+
+// Glyph cell with tint and any rotation: walks the clipped screen bounds and
+// maps each pixel centre back into the cell, nearest sample.
+static void BlitGlyphNN_Transformed(uint8_t *dstBuffer, uint32_t dstWidth, const DirtyRect &bounds,
+                                    const AtlasSurface &src, const uint32_t *palette, const FrameRect &cell,
+                                    float originX, float originY, float scale, float cosA, float sinA, Color tint)
+{
+    const bool indexed = src.format == ATLAS_FORMAT_INDEXED8;
+    const uint8_t *pal = reinterpret_cast<const uint8_t *>(palette);
+    const float inv = 1.0f / scale;
+    const float w = static_cast<float>(cell.w);
+    const float h = static_cast<float>(cell.h);
+
+    for (int32_t y = bounds.y; y < bounds.y + bounds.height; y++)
+    {
+        float dx = bounds.x + 0.5f - originX;
+        float dy = y + 0.5f - originY;
+        float u = (dx * cosA + dy * sinA) * inv;
+        float v = (dy * cosA - dx * sinA) * inv;
+        uint8_t *px = dstBuffer + (static_cast<size_t>(y) * dstWidth + bounds.x) * 4;
+
+        for (int32_t x = 0; x < bounds.width; x++, px += 4, u += cosA * inv, v -= sinA * inv)
+        {
+            if (u < 0.0f || v < 0.0f || u >= w || v >= h)
+                continue;
+
+            size_t row = static_cast<size_t>(cell.y + static_cast<uint32_t>(v)) * src.stride;
+            uint32_t col = cell.x + static_cast<uint32_t>(u);
+            const uint8_t *c = indexed ? pal + src.data[row + col] * 4 : src.data + row + col * 4;
+
+            uint32_t sA = Div255(c[3] * tint.a);
+            if (sA == 0)
+                continue;
+            uint32_t sR = Div255(c[0] * tint.r);
+            uint32_t sG = Div255(c[1] * tint.g);
+            uint32_t sB = Div255(c[2] * tint.b);
+            if (sA == 255)
+            {
+                px[0] = sR;
+                px[1] = sG;
+                px[2] = sB;
+                px[3] = 255;
+                continue;
+            }
+            uint32_t invA = 255 - sA;
+            px[0] = ((sR * sA + px[0] * invA) + 127) / 255;
+            px[1] = ((sG * sA + px[1] * invA) + 127) / 255;
+            px[2] = ((sB * sA + px[2] * invA) + 127) / 255;
+            px[3] = ((sA * 255 + px[3] * invA) + 127) / 255;
+        }
+    }
+}
+
+bool Renderer::DrawBitmapText(uint32_t fontId, size_t bufRefId, const std::string &text, float x, float y,
+                              const TextStyle &style)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    float originX = x;
+    float originY = y;
+    float scale = style.scale;
+    float rotation = style.rotation;
+    if (style.useCamera)
+    {
+        CameraState cam = GetCameraState(bufRefId);
+        WorldToScreenPoint(cam, x, y, originX, originY);
+        scale *= cam.zoom;
+        rotation -= cam.rotation;
+    }
+
+    std::lock_guard<std::mutex> fontLock(font_mutex_);
+    auto it = fonts_.find(fontId);
+    if (it == fonts_.end())
+        return false;
+
+    Color tint = style.tint.ToRaylib();
+    if (text.empty() || tint.a == 0 || !(scale > 0.0f) || !std::isfinite(originX) || !std::isfinite(originY))
+        return true;
+
+    BitmapFont &font = it->second->font;
+    const TextLayout &layout = font.Layout(text, style.scale > 0.0f ? style.maxWidth / style.scale : 0.0f, style.align);
+    if (layout.glyphs.empty())
+        return true;
+
+    // an atlas still reloading in the background draws nothing this frame
+    SpriteAtlas *atlas = AcquireAtlas(it->second->atlasId, true);
+    if (!atlas || !atlas->data)
+        return atlas != nullptr;
+    AtlasSurface surface = AtlasLevel(atlas, 0);
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+
+    const float cosA = cosf(rotation);
+    const float sinA = sinf(rotation);
+    const bool upright = cosA == 1.0f && sinA == 0.0f;
+    const bool untinted = tint.r == 255 && tint.g == 255 && tint.b == 255 && tint.a == 255;
+    const int32_t canvasW = static_cast<int32_t>(s->width);
+    const int32_t canvasH = static_cast<int32_t>(s->height);
+
+    DirtyRegionSet dirty;
+    for (const PlacedGlyph &placed : layout.glyphs)
+    {
+        const FontGlyph &glyph = font.Glyph(placed.glyph);
+        FrameRect cell = {glyph.x, glyph.y, glyph.w, glyph.h};
+        float gx = placed.x * scale;
+        float gy = placed.y * scale;
+        float ox = originX + gx * cosA - gy * sinA;
+        float oy = originY + gx * sinA + gy * cosA;
+        float cw = glyph.w * scale;
+        float ch = glyph.h * scale;
+
+        if (upright && untinted)
+        {
+            // plain text goes through the sprite blitters; edges are rounded
+            // from the pen position so neighbouring cells neither gap nor overlap
+            int32_t left = static_cast<int32_t>(std::floor(ox + 0.5f));
+            int32_t top = static_cast<int32_t>(std::floor(oy + 0.5f));
+            int32_t right = static_cast<int32_t>(std::floor(ox + cw + 0.5f));
+            int32_t bottom = static_cast<int32_t>(std::floor(oy + ch + 0.5f));
+            if (right <= left || bottom <= top || right <= 0 || bottom <= 0 || left >= canvasW || top >= canvasH)
+                continue;
+
+            ScreenRect r = {left, top, static_cast<uint32_t>(right - left), static_cast<uint32_t>(bottom - top)};
+            if (surface.format == ATLAS_FORMAT_INDEXED8)
+                BlitSpriteNN_Palette(dst, s->width, s->height, r, surface, atlas->palette.data(), cell, false, false, false);
+            else
+                BlitSpriteNN_Alpha(dst, s->width, s->height, r, surface, cell, false, false);
+
+            int32_t x0 = std::max(left, 0);
+            int32_t y0 = std::max(top, 0);
+            dirty.Add(x0, y0, std::min(right, canvasW) - x0, std::min(bottom, canvasH) - y0);
+            continue;
+        }
+
+        // rotated cell: clip its screen bounding box
+        float xs[4] = {ox, ox + cw * cosA, ox - ch * sinA, ox + cw * cosA - ch * sinA};
+        float ys[4] = {oy, oy + cw * sinA, oy + ch * cosA, oy + cw * sinA + ch * cosA};
+        float minX = std::min(std::min(xs[0], xs[1]), std::min(xs[2], xs[3]));
+        float maxX = std::max(std::max(xs[0], xs[1]), std::max(xs[2], xs[3]));
+        float minY = std::min(std::min(ys[0], ys[1]), std::min(ys[2], ys[3]));
+        float maxY = std::max(std::max(ys[0], ys[1]), std::max(ys[2], ys[3]));
+        int32_t x0 = static_cast<int32_t>(std::max(std::floor(minX), 0.0f));
+        int32_t y0 = static_cast<int32_t>(std::max(std::floor(minY), 0.0f));
+        int32_t x1 = static_cast<int32_t>(std::min(std::ceil(maxX), static_cast<float>(canvasW)));
+        int32_t y1 = static_cast<int32_t>(std::min(std::ceil(maxY), static_cast<float>(canvasH)));
+        if (x1 <= x0 || y1 <= y0)
+            continue;
+
+        DirtyRect bounds(x0, y0, x1 - x0, y1 - y0);
+        BlitGlyphNN_Transformed(dst, s->width, bounds, surface, atlas->palette.data(), cell,
+                                ox, oy, scale, cosA, sinA, tint);
+        dirty.Add(bounds.x, bounds.y, bounds.width, bounds.height);
+    }
+
+    // same trade-off as stroke batches: a line of glyphs is one upload
+    for (const DirtyRect &r : dirty.UploadRects(STROKE_UPLOAD_OVERHEAD))
+        RecordDirtyRegion(s, r.x, r.y, r.width, r.height);
+    return true;
+}
+
+uint32_t Renderer::LoadTrueTypeFont(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        Debugger::Instance().LogError("LoadTrueTypeFont: cannot open " + path);
+        return 0;
+    }
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    TrueTypeFont *font = new TrueTypeFont();
+    std::string error;
+    if (!font->Load(std::move(data), error))
+    {
+        Debugger::Instance().LogError("LoadTrueTypeFont: " + path + ": " + error);
+        delete font;
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(font_mutex_);
+    uint32_t id = next_font_id_++;
+    truetype_fonts_[id] = font;
+    return id;
+}
+
+void Renderer::FreeTrueTypeFont(uint32_t fontId)
+{
+    std::lock_guard<std::mutex> lock(font_mutex_);
+    auto it = truetype_fonts_.find(fontId);
+    if (it != truetype_fonts_.end())
+    {
+        delete it->second;
+        truetype_fonts_.erase(it);
+    }
+}
+
+// rasterized size for a requested one, 0: too small to draw
+static uint32_t TrueTypePixelSize(float pixelSize)
+{
+    float size = std::floor(pixelSize + 0.5f);
+    if (!(size >= 1.0f))
+        return 0;
+    return static_cast<uint32_t>(std::min(size, static_cast<float>(TRUETYPE_MAX_SIZE)));
+}
+
+bool Renderer::MeasureTrueTypeText(uint32_t fontId, const std::string &text, float pixelSize, const TextStyle &style,
+                                   float &width, float &height, uint32_t &lines)
+{
+    std::lock_guard<std::mutex> lock(font_mutex_);
+    auto it = truetype_fonts_.find(fontId);
+    if (it == truetype_fonts_.end())
+        return false;
+
+    const TextLayout &layout = it->second->Layout(TrueTypePixelSize(pixelSize * style.scale), text, style.maxWidth, style.align);
+    width = layout.width;
+    height = layout.height;
+    lines = layout.lines;
+    return true;
+}
+
+bool Renderer::DrawTrueTypeText(uint32_t fontId, size_t bufRefId, const std::string &text, float x, float y,
+                                float pixelSize, const TextStyle &style)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    float originX = x;
+    float originY = y;
+    float zoom = 1.0f;
+    if (style.useCamera)
+    {
+        CameraState cam = GetCameraState(bufRefId);
+        WorldToScreenPoint(cam, x, y, originX, originY);
+        zoom = cam.zoom;
+    }
+
+    std::lock_guard<std::mutex> fontLock(font_mutex_);
+    auto it = truetype_fonts_.find(fontId);
+    if (it == truetype_fonts_.end())
+        return false;
+
+    Color tint = style.tint.ToRaylib();
+    uint32_t size = TrueTypePixelSize(pixelSize * style.scale * zoom);
+    if (text.empty() || tint.a == 0 || size == 0 || !std::isfinite(originX) || !std::isfinite(originY))
+        return true;
+
+    TrueTypeFont &font = *it->second;
+    const TextLayout &layout = font.Layout(size, text, style.maxWidth * zoom, style.align);
+    if (layout.glyphs.empty())
+        return true;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+    const int32_t canvasW = static_cast<int32_t>(s->width);
+    const int32_t canvasH = static_cast<int32_t>(s->height);
+    uint32_t rgba;
+    std::memcpy(&rgba, &tint, 4);
+
+    // glyphs land on whole pixels so coverage is used as rasterized
+    const float baseX = std::floor(originX + 0.5f);
+    const float baseY = std::floor(originY + 0.5f);
+
+    DirtyRegionSet dirty;
+    for (const PlacedGlyph &placed : layout.glyphs)
+    {
+        // a glyph evicted by an atlas reset since layout is rasterized again here
+        const TrueTypeGlyph *glyph = font.Glyph(size, placed.glyph);
+        if (!glyph || glyph->w == 0)
+            continue;
+
+        int32_t left = static_cast<int32_t>(baseX + std::floor(placed.x + 0.5f)) + glyph->offsetX;
+        int32_t top = static_cast<int32_t>(baseY + std::floor(placed.y + 0.5f)) + glyph->offsetY;
+        int32_t x0 = std::max(left, 0);
+        int32_t y0 = std::max(top, 0);
+        int32_t x1 = std::min(left + static_cast<int32_t>(glyph->w), canvasW);
+        int32_t y1 = std::min(top + static_cast<int32_t>(glyph->h), canvasH);
+        if (x1 <= x0 || y1 <= y0)
+            continue;
+
+        uint32_t stride;
+        const uint8_t *coverage = font.Coverage(size, stride);
+        for (int32_t row = y0; row < y1; row++)
+        {
+            const uint8_t *mask = coverage + static_cast<size_t>(glyph->y + (row - top)) * stride + glyph->x + (x0 - left);
+            BlendMaskSpan(dst + (static_cast<size_t>(row) * s->width + x0) * 4, rgba, mask, x1 - x0);
+        }
+        dirty.Add(x0, y0, x1 - x0, y1 - y0);
+    }
+
+    for (const DirtyRect &r : dirty.UploadRects(STROKE_UPLOAD_OVERHEAD))
+        RecordDirtyRegion(s, r.x, r.y, r.width, r.height);
+    return true;
+}
+
+bool Renderer::GetTrueTypeFontStats(uint32_t fontId, TrueTypeStats &stats)
+{
+    std::lock_guard<std::mutex> lock(font_mutex_);
+    auto it = truetype_fonts_.find(fontId);
+    if (it == truetype_fonts_.end())
+        return false;
+    stats = it->second->Stats();
+    return true;
+}
+
+// resampling
+
+// output rows per ParallelFor job; each band filters its own source rows
+static const uint32_t RESAMPLE_BAND_ROWS = 32;
+
+bool Renderer::DrawAtlasRegion(size_t bufRefId, uint32_t atlasId, uint32_t sx, uint32_t sy, uint32_t sw, uint32_t sh,
+                               float dx, float dy, float dw, float dh, ResampleFilter filter, bool blend, bool useCamera)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    ScreenRect r;
+    if (useCamera)
+    {
+        CameraState cam = GetCameraState(bufRefId);
+        if (!IsInFrustum(cam, dx, dy, dw, dh))
+            return GetAtlas(atlasId) != nullptr;
+        r = WorldToScreen(cam, dx, dy, dw, dh);
+    }
+    else
+    {
+        if (!(dw > 0.0f) || !(dh > 0.0f) || !std::isfinite(dx) || !std::isfinite(dy))
+            return GetAtlas(atlasId) != nullptr;
+        int32_t left = static_cast<int32_t>(std::floor(dx + 0.5f));
+        int32_t top = static_cast<int32_t>(std::floor(dy + 0.5f));
+        r = {left, top,
+             static_cast<uint32_t>(std::max<int32_t>(static_cast<int32_t>(std::floor(dx + dw + 0.5f)) - left, 0)),
+             static_cast<uint32_t>(std::max<int32_t>(static_cast<int32_t>(std::floor(dy + dh + 0.5f)) - top, 0))};
+    }
+
+    SpriteAtlas *atlas = AcquireAtlas(atlasId, true);
+    if (!atlas)
+        return false;
+
+    // source region clamped to the atlas
+    sw = sx < atlas->width ? std::min(sw, atlas->width - sx) : 0;
+    sh = sy < atlas->height ? std::min(sh, atlas->height - sy) : 0;
+    if (sw == 0 || sh == 0 || r.width == 0 || r.height == 0)
+        return true;
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+
+    // visible part of the output rect
+    int64_t c0 = std::max<int64_t>(-static_cast<int64_t>(r.x), 0);
+    int64_t r0 = std::max<int64_t>(-static_cast<int64_t>(r.y), 0);
+    int64_t c1 = std::min<int64_t>(r.width, static_cast<int64_t>(s->width) - r.x);
+    int64_t r1 = std::min<int64_t>(r.height, static_cast<int64_t>(s->height) - r.y);
+    if (c1 <= c0 || r1 <= r0)
+        return true;
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+
+    if (!atlas->data)
+    {
+        FillAtlasPlaceholder(dst, s->width, s->height, r, atlas_placeholder_);
+        RecordDirtyRegion(s, static_cast<int32_t>(r.x + c0), static_cast<int32_t>(r.y + r0),
+                          static_cast<uint32_t>(c1 - c0), static_cast<uint32_t>(r1 - r0));
+        return true;
+    }
+
+    ResampleSource src = {atlas->data, atlas->stride,
+                          atlas->format == ATLAS_FORMAT_INDEXED8 ? atlas->palette.data() : nullptr,
+                          sx, sy, sw, sh};
+    ResampleAxis ax, ay;
+    BuildResampleAxis(sw, r.width, filter, ax);
+    BuildResampleAxis(sh, r.height, filter, ay);
+
+    const uint32_t cols = static_cast<uint32_t>(c1 - c0);
+    auto emit = [&](uint32_t row, const uint8_t *rgba)
+    {
+        uint8_t *out = dst + (static_cast<size_t>(r.y + row) * s->width + r.x + c0) * 4;
+        if (blend)
+            BlendSpan(out, rgba, cols, 255, BLEND_NORMAL);
+        else
+            std::memcpy(out, rgba, static_cast<size_t>(cols) * 4);
+    };
+
+    uint32_t rows = static_cast<uint32_t>(r1 - r0);
+    if (static_cast<size_t>(cols) * rows < FILL_PARALLEL_PIXELS)
+    {
+        ResampleRows(src, ax, ay, static_cast<uint32_t>(c0), static_cast<uint32_t>(c1),
+                     static_cast<uint32_t>(r0), static_cast<uint32_t>(r1), emit);
+    }
+    else
+    {
+        size_t bands = (rows + RESAMPLE_BAND_ROWS - 1) / RESAMPLE_BAND_ROWS;
+        Workers().ParallelFor(bands, [&](size_t i)
+                              {
+                                  uint32_t from = static_cast<uint32_t>(r0) + static_cast<uint32_t>(i) * RESAMPLE_BAND_ROWS;
+                                  uint32_t to = std::min<uint32_t>(static_cast<uint32_t>(r1), from + RESAMPLE_BAND_ROWS);
+                                  ResampleRows(src, ax, ay, static_cast<uint32_t>(c0), static_cast<uint32_t>(c1), from, to, emit); });
+    }
+
+    RecordDirtyRegion(s, static_cast<int32_t>(r.x + c0), static_cast<int32_t>(r.y + r0), cols, rows);
+    return true;
+}
+
+uint32_t Renderer::ResizeAtlas(uint32_t atlasId, uint32_t width, uint32_t height, ResampleFilter filter)
+{
+    if (width == 0 || height == 0)
+        return 0;
+
+    SpriteAtlas *source = AcquireAtlas(atlasId, false);
+    if (!source || !source->data)
+    {
+        Debugger::Instance().LogError("ResizeAtlas: invalid atlasId " + std::to_string(atlasId));
+        return 0;
+    }
+
+    SpriteAtlas *atlas = new SpriteAtlas();
+    atlas->width = width;
+    atlas->height = height;
+    atlas->stride = width * 4;
+    atlas->format = ATLAS_FORMAT_RGBA8;
+    atlas->storage.assign(static_cast<size_t>(atlas->stride) * height, 0);
+    atlas->data = atlas->storage.data();
+    atlas->frameNames = source->frameNames;
+    atlas->animations = source->animations;
+    // no path: derived atlases are never evicted, there is nothing to reload them from
+
+    const double scaleX = static_cast<double>(width) / source->width;
+    const double scaleY = static_cast<double>(height) / source->height;
+    const uint32_t *palette = source->format == ATLAS_FORMAT_INDEXED8 ? source->palette.data() : nullptr;
+
+    // edges are rounded in sheet space so frames that touched still touch
+    auto resample = [&](const FrameRect &from, FrameRect &to)
+    {
+        uint32_t x0 = static_cast<uint32_t>(std::lround(from.x * scaleX));
+        uint32_t y0 = static_cast<uint32_t>(std::lround(from.y * scaleY));
+        uint32_t x1 = std::min<uint32_t>(static_cast<uint32_t>(std::lround((from.x + from.w) * scaleX)), width);
+        uint32_t y1 = std::min<uint32_t>(static_cast<uint32_t>(std::lround((from.y + from.h) * scaleY)), height);
+        to = {x0, y0, x1 > x0 ? x1 - x0 : 0, y1 > y0 ? y1 - y0 : 0};
+        if (to.w == 0 || to.h == 0 || from.w == 0 || from.h == 0)
+            return;
+
+        ResampleSource src = {source->data, source->stride, palette, from.x, from.y, from.w, from.h};
+        ResampleAxis ax, ay;
+        BuildResampleAxis(from.w, to.w, filter, ax);
+        BuildResampleAxis(from.h, to.h, filter, ay);
+        auto emit = [&](uint32_t row, const uint8_t *rgba)
+        { std::memcpy(atlas->data + static_cast<size_t>(to.y + row) * atlas->stride + to.x * 4, rgba, static_cast<size_t>(to.w) * 4); };
+
+        size_t bands = (to.h + RESAMPLE_BAND_ROWS - 1) / RESAMPLE_BAND_ROWS;
+        Workers().ParallelFor(bands, [&](size_t i)
+                              {
+                                  uint32_t first = static_cast<uint32_t>(i) * RESAMPLE_BAND_ROWS;
+                                  ResampleRows(src, ax, ay, 0, to.w, first, std::min(to.h, first + RESAMPLE_BAND_ROWS), emit); });
+    };
+
+    if (source->frames.empty())
+    {
+        FrameRect to;
+        resample({0, 0, source->width, source->height}, to);
+    }
+    else
+    {
+        for (const AtlasFrame &frame : source->frames)
+        {
+            AtlasFrame scaled = frame;
+            bool rotated = (frame.flags & ATLAS_FRAME_ROTATED) != 0;
+            // rotated frames occupy h x w in the sheet, upright x runs along sheet y
+            FrameRect from = rotated ? FrameRect{frame.x, frame.y, frame.h, frame.w} : FrameRect{frame.x, frame.y, frame.w, frame.h};
+            FrameRect to = {};
+            if (!(frame.flags & ATLAS_FRAME_EMPTY))
+                resample(from, to);
+
+            double ux = rotated ? scaleY : scaleX;
+            double uy = rotated ? scaleX : scaleY;
+            scaled.x = to.x;
+            scaled.y = to.y;
+            scaled.w = rotated ? to.h : to.w;
+            scaled.h = rotated ? to.w : to.h;
+            scaled.trimX = static_cast<int32_t>(std::lround(frame.trimX * ux));
+            scaled.trimY = static_cast<int32_t>(std::lround(frame.trimY * uy));
+            scaled.sourceW = static_cast<uint32_t>(std::lround(frame.sourceW * ux));
+            scaled.sourceH = static_cast<uint32_t>(std::lround(frame.sourceH * uy));
+            if (scaled.w == 0 || scaled.h == 0)
+                scaled.flags |= ATLAS_FRAME_EMPTY;
+            atlas->frames.push_back(scaled);
+        }
+    }
+
+    return RegisterAtlas(atlas);
+}
+
+// noise
+
+// noise values 0..1 -> ramp colours
+static void ColorNoiseRow(const float *values, uint32_t count, const uint8_t *ramp, uint8_t *out)
+{
+    for (uint32_t i = 0; i < count; i++)
+        std::memcpy(out + i * 4, ramp + static_cast<int>(values[i] * 255.0f + 0.5f) * 4, 4);
+}
+
+static bool BuildNoiseRamp(const std::vector<GradientStop> &stops, std::vector<uint8_t> &ramp)
+{
+    if (!stops.empty())
+        return BuildSortedRamp(stops, ramp);
+    return BuildSortedRamp({{0.0f, 0, 0, 0, 255}, {1.0f, 255, 255, 255, 255}}, ramp);
+}
+
+bool Renderer::FillNoise(size_t bufRefId, float x, float y, float w, float h, const NoiseParams &params,
+                         const std::vector<GradientStop> &stops)
+{
+    std::vector<uint8_t> ramp;
+    bool opaque = BuildNoiseRamp(stops, ramp);
+    NoiseGenerator noise(params);
+
+    // noise space follows the rect's top-left corner, one unit per world pixel
+    CameraState cam = GetCameraState(bufRefId);
+    float originX, originY;
+    WorldToScreenPoint(cam, x, y, originX, originY);
+    const float step = cam.zoom > 0.0f ? 1.0f / cam.zoom : 1.0f;
+
+    return FillArea(bufRefId, x, y, w, h, [&](uint8_t *dst, int32_t sx, int32_t sy, uint32_t count)
+                    {
+                        thread_local std::vector<float> values;
+                        thread_local std::vector<uint8_t> row;
+                        if (values.size() < count)
+                            values.resize(count);
+                        if (row.size() < static_cast<size_t>(count) * 4u)
+                            row.resize(static_cast<size_t>(count) * 4u);
+
+                        noise.Row((sx + 0.5f - originX) * step, (sy + 0.5f - originY) * step, step, count, values.data());
+                        if (opaque)
+                        {
+                            ColorNoiseRow(values.data(), count, ramp.data(), dst);
+                            return;
+                        }
+                        ColorNoiseRow(values.data(), count, ramp.data(), row.data());
+                        BlendSpan(dst, row.data(), count, 255, BLEND_NORMAL); });
+}
+
+uint32_t Renderer::CreateNoiseAtlas(uint32_t width, uint32_t height, const NoiseParams &params,
+                                    const std::vector<GradientStop> &stops)
+{
+    if (width == 0 || height == 0)
+        return 0;
+
+    std::vector<uint8_t> ramp;
+    BuildNoiseRamp(stops, ramp);
+    NoiseGenerator noise(params);
+
+    SpriteAtlas *atlas = new SpriteAtlas();
+    atlas->width = width;
+    atlas->height = height;
+    atlas->stride = width * 4;
+    atlas->format = ATLAS_FORMAT_RGBA8;
+    atlas->storage.resize(static_cast<size_t>(atlas->stride) * height);
+    atlas->data = atlas->storage.data();
+    // no path: generated atlases are never evicted
+
+    size_t strips = (height + FILL_STRIP_ROWS - 1) / FILL_STRIP_ROWS;
+    Workers().ParallelFor(strips, [&](size_t i)
+                          {
+                              thread_local std::vector<float> values;
+                              if (values.size() < width)
+                                  values.resize(width);
+                              uint32_t first = static_cast<uint32_t>(i) * FILL_STRIP_ROWS;
+                              uint32_t last = std::min(height, first + FILL_STRIP_ROWS);
+                              for (uint32_t row = first; row < last; row++)
+                              {
+                                  noise.Row(0.5f, row + 0.5f, 1.0f, width, values.data());
+                                  ColorNoiseRow(values.data(), width, ramp.data(), atlas->data + static_cast<size_t>(row) * atlas->stride);
+                              } });
+
+    return RegisterAtlas(atlas);
+}
+
+// filters
+
+bool Renderer::FilterCanvas(size_t bufRefId, int32_t x, int32_t y, uint32_t w, uint32_t h, const ImageFilter &filter,
+                            size_t dstBufRefId, int32_t dstX, int32_t dstY)
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (size_t id : {bufRefId, dstBufRefId})
+    {
+        if (id >= shared_buffers_ref.size() || !shared_buffers_ref[id] || !shared_buffers_ref[id]->control)
+            return false;
+    }
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    SharedBufferRefs *d = shared_buffers_ref[dstBufRefId];
+
+    int64_t x0 = std::max<int64_t>(x, 0);
+    int64_t y0 = std::max<int64_t>(y, 0);
+    int64_t x1 = std::min<int64_t>(static_cast<int64_t>(x) + w, s->width);
+    int64_t y1 = std::min<int64_t>(static_cast<int64_t>(y) + h, s->height);
+    if (x1 <= x0 || y1 <= y0)
+        return true;
+
+    auto writeSlot = [](SharedBufferRefs *refs)
+    {
+        std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(refs->control);
+        return refs->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+    };
+
+    const uint32_t cols = static_cast<uint32_t>(x1 - x0);
+    const uint32_t rows = static_cast<uint32_t>(y1 - y0);
+    FilterImage src = {writeSlot(s) + (static_cast<size_t>(y0) * s->width + x0) * 4, s->width * 4, cols, rows};
+
+    // where the clipped region lands
+    int64_t tx = static_cast<int64_t>(dstX) + (x0 - x);
+    int64_t ty = static_cast<int64_t>(dstY) + (y0 - y);
+    if (d == s && tx == x0 && ty == y0)
+    {
+        ApplyImageFilter(filter, src, src, Workers());
+        RecordDirtyRegion(s, static_cast<int32_t>(x0), static_cast<int32_t>(y0), cols, rows);
+        return true;
+    }
+
+    // elsewhere: filter aside, then copy what fits (source and target may overlap)
+    thread_local std::vector<uint8_t> scratch;
+    scratch.resize(static_cast<size_t>(cols) * rows * 4);
+    FilterImage out = {scratch.data(), cols * 4, cols, rows};
+    ApplyImageFilter(filter, src, out, Workers());
+
+    int64_t dx0 = std::max<int64_t>(tx, 0);
+    int64_t dy0 = std::max<int64_t>(ty, 0);
+    int64_t dx1 = std::min<int64_t>(tx + cols, d->width);
+    int64_t dy1 = std::min<int64_t>(ty + rows, d->height);
+    if (dx1 <= dx0 || dy1 <= dy0)
+        return true;
+
+    uint8_t *dst = writeSlot(d);
+    for (int64_t row = dy0; row < dy1; row++)
+        std::memcpy(dst + (static_cast<size_t>(row) * d->width + dx0) * 4,
+                    scratch.data() + (static_cast<size_t>(row - ty) * cols + (dx0 - tx)) * 4,
+                    static_cast<size_t>(dx1 - dx0) * 4);
+    RecordDirtyRegion(d, static_cast<int32_t>(dx0), static_cast<int32_t>(dy0),
+                      static_cast<uint32_t>(dx1 - dx0), static_cast<uint32_t>(dy1 - dy0));
+    return true;
+}
+
+uint32_t Renderer::FilterAtlas(uint32_t atlasId, const ImageFilter &filter, bool inPlace)
+{
+    SpriteAtlas *source = AcquireAtlas(atlasId, false);
+    if (!source || !source->data)
+    {
+        Debugger::Instance().LogError("FilterAtlas: invalid atlasId " + std::to_string(atlasId));
+        return 0;
+    }
+    if (inPlace && (!source->path.empty() || source->mapping || source->format != ATLAS_FORMAT_RGBA8))
+    {
+        // an eviction would reload the unfiltered file, indices can't hold new colours
+        Debugger::Instance().LogError("FilterAtlas: atlas " + std::to_string(atlasId) +
+                                      " is file-backed or indexed, filter it into a new atlas");
+        return 0;
+    }
+
+    SpriteAtlas *atlas = source;
+    if (!inPlace)
+    {
+        atlas = new SpriteAtlas();
+        atlas->width = source->width;
+        atlas->height = source->height;
+        atlas->stride = source->width * 4;
+        atlas->format = ATLAS_FORMAT_RGBA8;
+        atlas->storage.resize(static_cast<size_t>(atlas->stride) * atlas->height);
+        atlas->data = atlas->storage.data();
+        atlas->frames = source->frames;
+        atlas->frameNames = source->frameNames;
+        atlas->animations = source->animations;
+        // no path: derived atlases are never evicted, there is nothing to reload them from
+
+        for (uint32_t row = 0; row < source->height; row++)
+        {
+            const uint8_t *in = source->data + static_cast<size_t>(row) * source->stride;
+            uint8_t *out = atlas->data + static_cast<size_t>(row) * atlas->stride;
+            if (source->format == ATLAS_FORMAT_INDEXED8)
+            {
+                for (uint32_t col = 0; col < source->width; col++)
+                    std::memcpy(out + col * 4, &source->palette[in[col]], 4);
+            }
+            else
+            {
+                std::memcpy(out, in, atlas->stride);
+            }
+        }
+    }
+
+    // upright kernel for frames stored turned 90deg clockwise: upright
+    // offset (du, dv) sits at sheet offset (-dv, du)
+    ImageFilter rotated = filter;
+    const uint32_t k = filter.size;
+    if (filter.type == FILTER_CONVOLVE && k <= FILTER_MAX_KERNEL)
+    {
+        for (uint32_t i = 0; i < k; i++)
+            for (uint32_t j = 0; j < k; j++)
+                rotated.kernel[i * k + j] = filter.kernel[(k - 1 - j) * k + i];
+    }
+
+    auto apply = [&](const FrameRect &r, const ImageFilter &f)
+    {
+        FilterImage image = {atlas->data + static_cast<size_t>(r.y) * atlas->stride + static_cast<size_t>(r.x) * 4,
+                             atlas->stride, r.w, r.h};
+        ApplyImageFilter(f, image, image, Workers());
+    };
+
+    if (atlas->frames.empty())
+    {
+        apply({0, 0, atlas->width, atlas->height}, filter);
+    }
+    else
+    {
+        // aliased frames share a rect, filtering it twice would compound
+        std::set<std::tuple<uint32_t, uint32_t, uint32_t, uint32_t>> done;
+        for (const AtlasFrame &frame : atlas->frames)
+        {
+            if (frame.flags & ATLAS_FRAME_EMPTY)
+                continue;
+            bool turned = (frame.flags & ATLAS_FRAME_ROTATED) != 0;
+            FrameRect r = turned ? FrameRect{frame.x, frame.y, frame.h, frame.w} : FrameRect{frame.x, frame.y, frame.w, frame.h};
+            r.w = r.x < atlas->width ? std::min(r.w, atlas->width - r.x) : 0;
+            r.h = r.y < atlas->height ? std::min(r.h, atlas->height - r.y) : 0;
+            if (r.w == 0 || r.h == 0 || !done.insert(std::make_tuple(r.x, r.y, r.w, r.h)).second)
+                continue;
+            apply(r, turned ? rotated : filter);
+        }
+    }
+
+    if (!inPlace)
+        return RegisterAtlas(atlas);
+
+    // cached opacity and mip levels describe the old pixels
+    std::lock_guard<std::mutex> lock(atlas_mutex_);
+    atlas->flags &= ~(TATLAS_FLAG_OPAQUE | TATLAS_FLAG_OPACITY_KNOWN);
+    if (!atlas->mips.empty())
+    {
+        uint64_t mipBytes = 0;
+        for (const AtlasMipLevel &mip : atlas->mips)
+            mipBytes += mip.pixels.size();
+        std::vector<AtlasMipLevel>().swap(atlas->mips);
+        atlas->residentBytes -= mipBytes;
+        atlas_resident_bytes_ -= mipBytes;
+    }
+    return atlasId;
+}
+
+// colour grading
+
+// grades h rows of w pixels from src into dst (same rows or a separate
+// buffer), bands across the pool once the area is worth it
+static void GradeRows(const ColorGrade &grade, const uint8_t *src, size_t srcStride,
+                      uint8_t *dst, size_t dstStride, uint32_t w, uint32_t h, WorkerPool &pool)
+{
+    auto gradeRows = [&](uint32_t first, uint32_t last)
+    {
+        for (uint32_t row = first; row < last; row++)
+            grade.ApplyRow(src + row * srcStride, dst + row * dstStride, w);
+    };
+
+    if (static_cast<size_t>(w) * h < FILL_PARALLEL_PIXELS)
+    {
+        gradeRows(0, h);
+        return;
+    }
+    size_t strips = (h + FILL_STRIP_ROWS - 1) / FILL_STRIP_ROWS;
+    pool.ParallelFor(strips, [&](size_t i)
+                     {
+                         uint32_t first = static_cast<uint32_t>(i) * FILL_STRIP_ROWS;
+                         gradeRows(first, std::min(h, first + FILL_STRIP_ROWS)); });
+}
+
+uint32_t Renderer::CreateColorGrade(const ColorGradeConfig &config)
+{
+    auto grade = std::make_shared<ColorGrade>();
+    std::string error;
+    if (!config.cubePath.empty())
+    {
+        if (!grade->LoadCube(config.cubePath, config.interpolation, error))
+        {
+            Debugger::Instance().LogError("CreateColorGrade: " + config.cubePath + ": " + error);
+            return 0;
+        }
+    }
+    else if (config.lutSize)
+    {
+        size_t expected = static_cast<size_t>(config.lutSize) * config.lutSize * config.lutSize * 3;
+        if (config.lut.size() != expected)
+        {
+            Debugger::Instance().LogError("CreateColorGrade: a " + std::to_string(config.lutSize) + "^3 LUT needs " +
+                                          std::to_string(expected) + " floats, got " + std::to_string(config.lut.size()));
+            return 0;
+        }
+        if (!grade->SetLut(config.lutSize, config.lut.data(), config.interpolation, error))
+        {
+            Debugger::Instance().LogError("CreateColorGrade: " + error);
+            return 0;
+        }
+    }
+    else
+    {
+        grade->SetMatrix(config.matrix);
+    }
+
+    std::lock_guard<std::mutex> lock(grade_mutex_);
+    uint32_t id = next_grade_id_++;
+    color_grades_[id] = grade;
+    return id;
+}
+
+bool Renderer::FreeColorGrade(uint32_t gradeId)
+{
+    std::lock_guard<std::mutex> lock(grade_mutex_);
+    return color_grades_.erase(gradeId) > 0;
+}
+
+bool Renderer::ApplyColorGrade(size_t bufRefId, uint32_t gradeId, int32_t x, int32_t y, uint32_t w, uint32_t h)
+{
+    std::shared_ptr<const ColorGrade> grade;
+    {
+        std::lock_guard<std::mutex> lock(grade_mutex_);
+        auto it = color_grades_.find(gradeId);
+        if (it == color_grades_.end())
+        {
+            Debugger::Instance().LogError("ApplyColorGrade: invalid gradeId " + std::to_string(gradeId));
+            return false;
+        }
+        grade = it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+
+    int64_t x0 = std::max<int64_t>(x, 0);
+    int64_t y0 = std::max<int64_t>(y, 0);
+    int64_t x1 = std::min<int64_t>(static_cast<int64_t>(x) + w, s->width);
+    int64_t y1 = std::min<int64_t>(static_cast<int64_t>(y) + h, s->height);
+    if (x1 <= x0 || y1 <= y0)
+        return true;
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *pixels = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)] +
+                      (static_cast<size_t>(y0) * s->width + x0) * 4;
+    const size_t stride = static_cast<size_t>(s->width) * 4;
+    const uint32_t cols = static_cast<uint32_t>(x1 - x0);
+    const uint32_t rows = static_cast<uint32_t>(y1 - y0);
+    GradeRows(*grade, pixels, stride, pixels, stride, cols, rows, Workers());
+    RecordDirtyRegion(s, static_cast<int32_t>(x0), static_cast<int32_t>(y0), cols, rows);
+    return true;
+}
+
+bool Renderer::SetCanvasColorGrade(size_t bufRefId, uint32_t gradeId)
+{
+    std::shared_ptr<const ColorGrade> grade;
+    if (gradeId)
+    {
+        std::lock_guard<std::mutex> lock(grade_mutex_);
+        auto it = color_grades_.find(gradeId);
+        if (it == color_grades_.end())
+        {
+            Debugger::Instance().LogError("SetCanvasColorGrade: invalid gradeId " + std::to_string(gradeId));
+            return false;
+        }
+        grade = it->second;
+    }
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    if (s->composite_source)
+    {
+        Debugger::Instance().LogError("SetCanvasColorGrade: buffer " + std::to_string(bufRefId) +
+                                      " is a compositor layer, grade its target instead");
+        return false;
+    }
+    if (s->color_grade == grade)
+        return true;
+
+    // the texture holds the old grading everywhere, the next upload redoes all of it
+    s->color_grade = grade;
+    RecordDirtyRegion(s, 0, 0, s->width, s->height);
+    return true;
+}
+
+// paths
+
+// how far flattened curves and arcs may stray, canvas pixels
+static const float PATH_TOLERANCE = 0.2f;
+// cached translations snap to 1 / PATH_SUBPIXEL_STEPS of a pixel
+static const float PATH_SUBPIXEL_STEPS = 4.0f;
+static const size_t PATH_MAX_MASKS = 8;
+// bigger masks aren't cached, the path rasterizes clipped to the canvas
+static const size_t PATH_MASK_MAX_PIXELS = 2048 * 2048;
+
+bool Renderer::PathMaskKey::operator==(const PathMaskKey &o) const
+{
+    if (a != o.a || b != o.b || c != o.c || d != o.d || fracX != o.fracX || fracY != o.fracY || stroke != o.stroke)
+        return false;
+    if (!stroke)
+        return rule == o.rule;
+    return style.width == o.style.width && style.join == o.style.join && style.cap == o.style.cap &&
+           style.miterLimit == o.style.miterLimit;
+}
+
+// the paint's transform, through the camera when asked; false when it
+// can't place anything (non-finite, or absurdly far off)
+bool Renderer::PathDeviceTransform(size_t bufRefId, const PathPaint &paint, PathTransform &t)
+{
+    t = paint.transform;
+    if (paint.useCamera)
+    {
+        CameraState cam = GetCameraState(bufRefId);
+        float cosA = cosf(-cam.rotation) * cam.zoom;
+        float sinA = sinf(-cam.rotation) * cam.zoom;
+        const PathTransform w = t;
+        t.a = cosA * w.a - sinA * w.b;
+        t.b = sinA * w.a + cosA * w.b;
+        t.c = cosA * w.c - sinA * w.d;
+        t.d = sinA * w.c + cosA * w.d;
+        t.e = cosA * (w.e - cam.worldX) - sinA * (w.f - cam.worldY) + cam.viewWidth / 2.0f;
+        t.f = sinA * (w.e - cam.worldX) + cosA * (w.f - cam.worldY) + cam.viewHeight / 2.0f;
+    }
+    for (float v : {t.a, t.b, t.c, t.d, t.e, t.f})
+    {
+        if (!std::isfinite(v))
+            return false;
+    }
+    // whole-pixel offsets must fit the blit's integers
+    return std::fabs(t.e) < 1e9f && std::fabs(t.f) < 1e9f;
+}
+
+// stroke width in canvas pixels: the path width times the transform's mean scale
+static StrokeStyle DeviceStrokeStyle(const StrokeStyle &style, const PathTransform &t)
+{
+    StrokeStyle device = style;
+    device.width = style.width * sqrtf(fabsf(t.a * t.d - t.b * t.c));
+    return device;
+}
+
+std::shared_ptr<const Renderer::PathMask> Renderer::BuildPathMask(const FlatPath &flat, bool stroke, FillRule rule,
+                                                                  const StrokeStyle &style)
+{
+    auto mask = std::make_shared<PathMask>();
+    float minX, minY, maxX, maxY;
+    if (!flat.Bounds(minX, minY, maxX, maxY))
+        return mask; // nothing to draw, cached all the same
+
+    // far-off or non-finite bounds can't be cached (nor converted safely);
+    // the caller rasterizes those straight into the canvas
+    float reach = stroke ? StrokeReach(style) : 0.0f;
+    for (float v : {minX - reach, minY - reach, maxX + reach, maxY + reach})
+    {
+        if (!(std::fabs(v) < 1e9f))
+            return nullptr;
+    }
+    int64_t left = static_cast<int64_t>(std::floor(minX - reach));
+    int64_t top = static_cast<int64_t>(std::floor(minY - reach));
+    int64_t right = static_cast<int64_t>(std::ceil(maxX + reach));
+    int64_t bottom = static_cast<int64_t>(std::ceil(maxY + reach));
+    if (static_cast<double>(right - left) * (bottom - top) > PATH_MASK_MAX_PIXELS)
+        return nullptr;
+
+    mask->left = static_cast<int32_t>(left);
+    mask->top = static_cast<int32_t>(top);
+    mask->width = static_cast<uint32_t>(right - left);
+    mask->height = static_cast<uint32_t>(bottom - top);
+    mask->coverage.assign(static_cast<size_t>(mask->width) * mask->height, 0);
+    mask->spans.assign(static_cast<size_t>(mask->height) * 2, 0);
+
+    path_raster_.Reset(mask->width, mask->height);
+    if (stroke)
+        AddStrokeEdges(flat, style, PATH_TOLERANCE, static_cast<float>(left), static_cast<float>(top), path_raster_);
+    else
+        AddFillEdges(flat, static_cast<float>(left), static_cast<float>(top), path_raster_);
+
+    FillRule resolveRule = stroke ? FILL_NONZERO : rule;
+    for (uint32_t row = 0; row < mask->height; row++)
+    {
+        uint32_t x0, x1;
+        if (path_raster_.ResolveSpan(row, resolveRule, mask->coverage.data() + static_cast<size_t>(row) * mask->width, x0, x1))
+        {
+            mask->spans[row * 2] = x0;
+            mask->spans[row * 2 + 1] = x1;
+        }
+    }
+    return mask;
+}
+
+void Renderer::BlendPathMask(SharedBufferRefs *s, const PathMask &mask, int64_t x, int64_t y, uint32_t rgba)
+{
+    int64_t x0 = std::max<int64_t>(x, 0);
+    int64_t y0 = std::max<int64_t>(y, 0);
+    int64_t x1 = std::min<int64_t>(x + mask.width, s->width);
+    int64_t y1 = std::min<int64_t>(y + mask.height, s->height);
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
+
+    // only the covered span of each mask row is blended
+    auto blendRows = [&](int64_t from, int64_t to)
+    {
+        for (int64_t row = from; row < to; row++)
+        {
+            size_t m = static_cast<size_t>(row - y);
+            int64_t a = std::max<int64_t>(x0, x + mask.spans[m * 2]);
+            int64_t b = std::min<int64_t>(x1, x + mask.spans[m * 2 + 1]);
+            if (a < b)
+                BlendMaskSpan(dst + row * stride + static_cast<size_t>(a) * 4u, rgba,
+                              mask.coverage.data() + m * mask.width + (a - x), static_cast<size_t>(b - a));
+        }
+    };
+
+    uint32_t cols = static_cast<uint32_t>(x1 - x0);
+    uint32_t rows = static_cast<uint32_t>(y1 - y0);
+    if (static_cast<size_t>(cols) * rows < FILL_PARALLEL_PIXELS)
+    {
+        blendRows(y0, y1);
+    }
+    else
+    {
+        size_t strips = (rows + FILL_STRIP_ROWS - 1) / FILL_STRIP_ROWS;
+        Workers().ParallelFor(strips, [&](size_t i)
+                              { int64_t first = y0 + static_cast<int64_t>(i) * FILL_STRIP_ROWS;
+                                blendRows(first, std::min<int64_t>(y1, first + FILL_STRIP_ROWS)); });
+    }
+    RecordDirtyRegion(s, static_cast<int32_t>(x0), static_cast<int32_t>(y0), cols, rows);
+}
+
+void Renderer::RasterizeFlatPath(SharedBufferRefs *s, const FlatPath &flat, bool stroke, FillRule rule,
+                                 const StrokeStyle &style, uint32_t rgba)
+{
+    float minX, minY, maxX, maxY;
+    if (!flat.Bounds(minX, minY, maxX, maxY))
+        return;
+
+    // the raster covers the bounds clipped to the canvas, no more; both ends
+    // are clamped in float so far-off points or a huge reach convert safely
+    float reach = stroke ? StrokeReach(style) : 0.0f;
+    const float fw = static_cast<float>(s->width);
+    const float fh = static_cast<float>(s->height);
+    float bx0 = minX - reach, by0 = minY - reach, bx1 = maxX + reach, by1 = maxY + reach;
+    if (!(bx1 >= 0.0f) || !(bx0 <= fw) || !(by1 >= 0.0f) || !(by0 <= fh))
+        return;
+    int64_t x0 = std::max<int64_t>(0, static_cast<int64_t>(std::floor(std::min(std::max(bx0, -1.0f), fw + 1.0f))));
+    int64_t y0 = std::max<int64_t>(0, static_cast<int64_t>(std::floor(std::min(std::max(by0, -1.0f), fh + 1.0f))));
+    int64_t x1 = std::min<int64_t>(s->width, static_cast<int64_t>(std::ceil(std::min(std::max(bx1, -1.0f), fw + 1.0f))));
+    int64_t y1 = std::min<int64_t>(s->height, static_cast<int64_t>(std::ceil(std::min(std::max(by1, -1.0f), fh + 1.0f))));
+    if (x1 <= x0 || y1 <= y0)
+        return;
+
+    uint32_t w = static_cast<uint32_t>(x1 - x0);
+    uint32_t h = static_cast<uint32_t>(y1 - y0);
+    polygon_raster_.Reset(w, h);
+    if (stroke)
+        AddStrokeEdges(flat, style, PATH_TOLERANCE, static_cast<float>(x0), static_cast<float>(y0), polygon_raster_);
+    else
+        AddFillEdges(flat, static_cast<float>(x0), static_cast<float>(y0), polygon_raster_);
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint8_t *dst = s->pixel_buffers[ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
+    FillRule resolveRule = stroke ? FILL_NONZERO : rule;
+
+    auto fillRows = [&](uint32_t from, uint32_t to)
+    {
+        thread_local std::vector<uint8_t> coverage;
+        if (coverage.size() < w)
+            coverage.resize(w);
+        for (uint32_t row = from; row < to; row++)
+        {
+            uint32_t a, b;
+            if (polygon_raster_.ResolveSpan(row, resolveRule, coverage.data(), a, b))
+                BlendMaskSpan(dst + (y0 + row) * stride + static_cast<size_t>(x0 + a) * 4u, rgba, coverage.data() + a, b - a);
+        }
+    };
+
+    if (static_cast<size_t>(w) * h < FILL_PARALLEL_PIXELS)
+    {
+        fillRows(0, h);
+    }
+    else
+    {
+        size_t strips = (h + FILL_STRIP_ROWS - 1) / FILL_STRIP_ROWS;
+        Workers().ParallelFor(strips, [&](size_t i)
+                              { fillRows(static_cast<uint32_t>(i) * FILL_STRIP_ROWS,
+                                         std::min<uint32_t>(h, static_cast<uint32_t>(i + 1) * FILL_STRIP_ROWS)); });
+    }
+
+    RecordDirtyRegion(s, static_cast<int32_t>(x0), static_cast<int32_t>(y0), w, h);
+}
+
+uint32_t Renderer::CreatePath(const float *commands, size_t count)
+{
+    PathEntry entry;
+    std::string error;
+    if (!entry.path.Parse(commands, count, error))
+    {
+        Debugger::Instance().LogError("CreatePath: " + error);
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lock(path_mutex_);
+    uint32_t id = next_path_id_++;
+    paths_[id] = std::move(entry);
+    return id;
+}
+
+bool Renderer::DestroyPath(uint32_t pathId)
+{
+    std::lock_guard<std::mutex> lock(path_mutex_);
+    return paths_.erase(pathId) > 0;
+}
+
+bool Renderer::DrawPath(size_t bufRefId, uint32_t pathId, const PathPaint &paint)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    PathTransform t;
+    if (!PathDeviceTransform(bufRefId, paint, t))
+        return true;
+
+    // masks are cut at the sub-pixel part of the translation, the whole
+    // pixels move the blit
+    float ix = std::floor(t.e);
+    float iy = std::floor(t.f);
+    float fracX = std::round((t.e - ix) * PATH_SUBPIXEL_STEPS) / PATH_SUBPIXEL_STEPS;
+    float fracY = std::round((t.f - iy) * PATH_SUBPIXEL_STEPS) / PATH_SUBPIXEL_STEPS;
+    PathTransform local = t;
+    local.e = fracX;
+    local.f = fracY;
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool stroke = pass == 1;
+        if (stroke ? !paint.stroke : !paint.fill)
+            continue;
+        Color c = (stroke ? paint.strokeColor : paint.fillColor).ToRaylib();
+        if (c.a == 0)
+            continue;
+        uint32_t rgba;
+        std::memcpy(&rgba, &c, 4);
+        StrokeStyle style = DeviceStrokeStyle(paint.style, t);
+
+        std::shared_ptr<const PathMask> mask;
+        FlatPath flat;
+        {
+            std::lock_guard<std::mutex> lock(path_mutex_);
+            auto it = paths_.find(pathId);
+            if (it == paths_.end())
+            {
+                Debugger::Instance().LogError("DrawPath: invalid pathId " + std::to_string(pathId));
+                return false;
+            }
+            PathEntry &entry = it->second;
+
+            PathMaskKey key = {t.a, t.b, t.c, t.d, fracX, fracY, stroke, paint.rule, paint.style};
+            for (CachedPathMask &cached : entry.masks)
+            {
+                if (cached.key == key)
+                {
+                    cached.lastUse = ++path_clock_;
+                    mask = cached.mask;
+                    break;
+                }
+            }
+
+            if (!mask)
+            {
+                entry.path.Flatten(local, PATH_TOLERANCE, flat);
+                mask = BuildPathMask(flat, stroke, paint.rule, style);
+                if (mask)
+                {
+                    if (entry.masks.size() >= PATH_MAX_MASKS)
+                    {
+                        auto oldest = std::min_element(entry.masks.begin(), entry.masks.end(),
+                                                       [](const CachedPathMask &a, const CachedPathMask &b)
+                                                       { return a.lastUse < b.lastUse; });
+                        entry.masks.erase(oldest);
+                    }
+                    entry.masks.push_back({key, mask, ++path_clock_});
+                }
+                else
+                {
+                    // too big to keep: rasterize at the exact translation instead
+                    entry.path.Flatten(t, PATH_TOLERANCE, flat);
+                }
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+            return false;
+        SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+        if (mask)
+            BlendPathMask(s, *mask, static_cast<int64_t>(ix) + mask->left, static_cast<int64_t>(iy) + mask->top, rgba);
+        else
+            RasterizeFlatPath(s, flat, stroke, paint.rule, style, rgba);
+    }
+    return true;
+}
+
+bool Renderer::DrawPathCommands(size_t bufRefId, const float *commands, size_t count, const PathPaint &paint)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId] || !shared_buffers_ref[bufRefId]->control)
+            return false;
+    }
+
+    VectorPath path;
+    std::string error;
+    if (!path.Parse(commands, count, error))
+    {
+        Debugger::Instance().LogError("DrawPathCommands: " + error);
+        return false;
+    }
+
+    PathTransform t;
+    if (!PathDeviceTransform(bufRefId, paint, t))
+        return true;
+    FlatPath flat;
+    path.Flatten(t, PATH_TOLERANCE, flat);
+    StrokeStyle style = DeviceStrokeStyle(paint.style, t);
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    for (int pass = 0; pass < 2; pass++)
+    {
+        bool stroke = pass == 1;
+        if (stroke ? !paint.stroke : !paint.fill)
+            continue;
+        Color c = (stroke ? paint.strokeColor : paint.fillColor).ToRaylib();
+        if (c.a == 0)
+            continue;
+        uint32_t rgba;
+        std::memcpy(&rgba, &c, 4);
+        RasterizeFlatPath(s, flat, stroke, paint.rule, style, rgba);
+    }
+    return true;
+}
+
+// anim 
+
+
+uint32_t Renderer::CreateSpriteWithAnimations(uint32_t atlasId, uint32_t frameWidth,
+                                              uint32_t frameHeight, bool opaque,
+                                              const std::vector<AnimationDef>& animations)
+{
+    // Create base sprite
+    AnimatedSprite* sprite = new AnimatedSprite();
+    sprite->atlasId = atlasId;
+    sprite->frameWidth = frameWidth;
+    sprite->frameHeight = frameHeight;
+    sprite->framesPerRow = 0; // Will be set from atlas
+    sprite->opaque = opaque ? 1 : 0;
+    
+    // Calculate frames per row from atlas
+    SpriteAtlas* atlas = GetAtlas(atlasId);
+    if (atlas) {
+        if (frameWidth == 0 && !atlas->frames.empty()) {
+            sprite->frameWidth = atlas->frames[0].sourceW;
+            sprite->frameHeight = atlas->frames[0].sourceH;
+        }
+        if (sprite->frameWidth > 0)
+            sprite->framesPerRow = atlas->width / sprite->frameWidth;
+    }
+    
+    // Load animations
+    uint32_t nextAnimId = 1;
+    for (const auto& animDef : animations) {
+        SpriteAnimation* anim = new SpriteAnimation();
+        anim->name = animDef.name;
+        anim->id = nextAnimId++;
+        anim->fps = animDef.fps;
+        anim->loop = animDef.loop;
+        anim->frameCount = animDef.frames.size();
+        
+        // Copy frame array
+        anim->frames = new uint32_t[anim->frameCount];
+        for (size_t i = 0; i < anim->frameCount; i++) {
+            anim->frames[i] = animDef.frames[i];
+        }
+        if (animDef.durations.size() == anim->frameCount)
+            anim->durations = animDef.durations;
+        
+        // Store in dictionaries
+        sprite->animations[anim->id] = anim;
+        sprite->animationNames[anim->name] = anim->id;
+    }
+    
+    // Set initial frame to first frame of first animation (if any)
+    if (!animations.empty() && animations[0].frames.size() > 0) {
+        sprite->currentFrame = animations[0].frames[0];
+    }
+    
+    // Register sprite
+    std::lock_guard<std::mutex> lock(sprite_mutex_);
+    uint32_t id = next_sprite_id_++;
+    sprites_[id] = sprite;
+    
+    Debugger::Instance().LogInfo("Created sprite " + std::to_string(id) + 
+                                 " with " + std::to_string(animations.size()) + " animations");
+    
+    return id;
+}
+
+void Renderer::PlayAnimation(uint32_t spriteId, const std::string& animName)
+{
+    AnimatedSprite* sprite = GetSprite(spriteId);
+    if (!sprite)
+        return;
+    
+    // Lookup animation ID by name
+    auto it = sprite->animationNames.find(animName);
+    if (it == sprite->animationNames.end()) {
+        Debugger::Instance().LogWarn("Animation '" + animName + "' not found on sprite " + 
+                                        std::to_string(spriteId));
+        return;
+    }
+    
+    PlayAnimationById(spriteId, it->second);
+}
+
+void Renderer::PlayAnimationById(uint32_t spriteId, uint32_t animId)
+{
+    AnimatedSprite* sprite = GetSprite(spriteId);
+    if (!sprite)
+        return;
+    
+    // Get animation
+    auto it = sprite->animations.find(animId);
+    if (it == sprite->animations.end())
+        return;
+    
+    SpriteAnimation* anim = it->second;
+    
+    // Switch to this animation
+    sprite->currentAnimationId = animId;
+    sprite->animFrameIndex = 0;
+    sprite->playing = 1;
+    sprite->frameTimer = 0.0f;
+    
+    // Set first frame
+    if (anim->frameCount > 0) {
+        sprite->currentFrame = anim->frames[0];
+    }
+}
+
+
+void Renderer::UpdateSpriteAnimations(float deltaTime)
+{
+    std::lock_guard<std::mutex> lock(sprite_mutex_);
+    
+    for (auto& pair : sprites_) {
+        AnimatedSprite* sprite = pair.second;
+        
+        if (!sprite->playing || sprite->currentAnimationId == 0)
+            continue;
+        
+        // Get current animation
+        auto it = sprite->animations.find(sprite->currentAnimationId);
+        if (it == sprite->animations.end())
+            continue;
+        
+        SpriteAnimation* anim = it->second;
+        if (anim->frameCount == 0)
+            continue;
+        
+        sprite->frameTimer += deltaTime;
+        
+        // Advance frames
+        while (true) {
+            // tracked position, frames may repeat inside a sequence (ping-pong)
+            uint32_t currentIdx = sprite->animFrameIndex < anim->frameCount ? sprite->animFrameIndex : 0;
+
+            float frameDuration = anim->durations.empty() ? 1.0f / anim->fps : anim->durations[currentIdx];
+            if (frameDuration <= 0.0f || sprite->frameTimer < frameDuration)
+                break;
+            sprite->frameTimer -= frameDuration;
+            
+            // Advance
+            currentIdx++;
+            
+            // Check end
+            if (currentIdx >= anim->frameCount) {
+                if (anim->loop) {
+                    currentIdx = 0;
+                } else {
+                    currentIdx = anim->frameCount - 1;
+                    sprite->playing = 0;
+                    break;
+                }
+            }
+            
+            sprite->animFrameIndex = currentIdx;
+            sprite->currentFrame = anim->frames[currentIdx];
+        }
+    }
+}
+
+uint32_t Renderer::CreateAnimator(const std::vector<std::string>& animNames,
+                                  const std::vector<std::vector<std::string>>& framePaths,
+                                  const std::vector<float>& fpsList,
+                                  const std::vector<bool>& loopList)
+{
+    Animator* animator = new Animator();
+    
+    uint32_t nextAnimId = 1;
+    for (size_t i = 0; i < animNames.size(); i++) {
+        MultiAtlasAnimation* anim = new MultiAtlasAnimation();
+        anim->name = animNames[i];
+        anim->id = nextAnimId++;
+        anim->fps = fpsList[i];
+        anim->loop = loopList[i];
+        
+        // Load each frame's atlas
+        for (const std::string& path : framePaths[i]) {
+            uint32_t atlasId = LoadAtlas(path);
+            
+            if (atlasId == 0) {
+                Debugger::Instance().LogError("Failed to load animator frame: " + path);
+                continue;
+            }
+            
+            SpriteAtlas* atlas = GetAtlas(atlasId);
+            AnimatorFrame frame;
+            frame.atlasId = atlasId;
+            frame.width = atlas->width;
+            frame.height = atlas->height;
+            
+            anim->frames.push_back(frame);
+        }
+        
+        animator->animations[anim->id] = anim;
+        animator->animationNames[anim->name] = anim->id;
+        
+        Debugger::Instance().LogInfo("Loaded animation '" + anim->name + 
+                                     "' with " + std::to_string(anim->frames.size()) + " frames");
+    }
+    
+    std::lock_guard<std::mutex> lock(animator_mutex_);
+    uint32_t id = next_animator_id_++;
+    animators_[id] = animator;
+    
+    return id;
+}
+
+void Renderer::UpdateAnimator(uint32_t animatorId, float x, float y, float rotation,
+                              float scaleX, float scaleY, bool flipH, bool flipV)
+{
+    std::lock_guard<std::mutex> lock(animator_mutex_);
+    auto it = animators_.find(animatorId);
+    if (it == animators_.end())
+        return;
+    
+    Animator* anim = it->second;
+    anim->x = x;
+    anim->y = y;
+    anim->rotation = rotation;
+    anim->scaleX = scaleX;
+    anim->scaleY = scaleY;
+    anim->flipH = flipH ? 1 : 0;
+    anim->flipV = flipV ? 1 : 0;
+}
+
+void Renderer::PlayAnimatorAnimation(uint32_t animatorId, const std::string& animName)
+{
+    std::lock_guard<std::mutex> lock(animator_mutex_);
+    auto it = animators_.find(animatorId);
+    if (it == animators_.end())
+        return;
+    
+    Animator* animator = it->second;
+    auto nameIt = animator->animationNames.find(animName);
+    if (nameIt == animator->animationNames.end())
+        return;
+    
+    animator->currentAnimationId = nameIt->second;
+    animator->currentFrameIndex = 0;
+    animator->frameTimer = 0.0f;
+    animator->playing = 1;
+}
+
+void Renderer::DrawAnimator(uint32_t animatorId, size_t bufRefId)
+{
+    std::lock_guard<std::mutex> lock(animator_mutex_);
+    auto it = animators_.find(animatorId);
+    if (it == animators_.end())
+        return;
+    
+    Animator* animator = it->second;
+    
+    if (animator->currentAnimationId == 0)
+        return;
+    
+    auto animIt = animator->animations.find(animator->currentAnimationId);
+    if (animIt == animator->animations.end())
+        return;
+    
+    MultiAtlasAnimation* anim = animIt->second;
+    
+    if (animator->currentFrameIndex >= anim->frames.size())
+        return;
+    
+    // Get current frame
+    AnimatorFrame& frame = anim->frames[animator->currentFrameIndex];
+    SpriteAtlas* atlas = AcquireAtlas(frame.atlasId, true);
+    if (!atlas)
+        return;
+    
+    // Get camera
+    CameraState cam = GetCameraState(bufRefId);
+    
+    // Calculate world bounds
+    float worldW = frame.width * animator->scaleX;
+    float worldH = frame.height * animator->scaleY;
+    
+    // Frustum cull
+    if (!IsInFrustum(cam, animator->x, animator->y, worldW, worldH))
+        return;
+    
+    // Convert to screen
+    ScreenRect screenRect = WorldToScreen(cam, animator->x, animator->y, worldW, worldH);
+    
+    // Get write buffer
+    std::lock_guard<std::mutex> bufLock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size())
+        return;
+    
+    SharedBufferRefs* s = shared_buffers_ref[bufRefId];
+    if (!s || !s->control)
+        return;
+    
+    std::atomic<uint32_t>* ctrl = reinterpret_cast<std::atomic<uint32_t>*>(s->control);
+    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
+    uint8_t* dstBuffer = s->pixel_buffers[js_write];
+    
+    // Source rect is entire atlas (loose sprite)
+    FrameRect srcRect = { 0, 0, frame.width, frame.height };
+    
+    uint32_t level = atlas->data ? SelectAtlasLevel(atlas, srcRect.w, srcRect.h, screenRect.width, screenRect.height) : 0;
+    AtlasSurface surface = AtlasLevel(atlas, level);
+    FrameRect levelRect = LevelRect(srcRect, level);
+    
+    // Blit (assume non-opaque for loose sprites)
+    if (!atlas->data)
+        FillAtlasPlaceholder(dstBuffer, s->width, s->height, screenRect, atlas_placeholder_);
+    else if (surface.format == ATLAS_FORMAT_INDEXED8)
+        BlitSpriteNN_Palette(dstBuffer, s->width, s->height, screenRect,
+                             surface, atlas->palette.data(), levelRect, animator->flipH, animator->flipV, false);
+    else
+        BlitSpriteNN_Alpha(dstBuffer, s->width, s->height, screenRect,
+                          surface, levelRect, animator->flipH, animator->flipV);
+    
+    // Mark dirty
+    RecordDirtyRegion(s, screenRect.x, screenRect.y, screenRect.width, screenRect.height);
+}
+
+void Renderer::UpdateAnimators(float deltaTime)
+{
+    std::lock_guard<std::mutex> lock(animator_mutex_);
+    
+    for (auto& pair : animators_) {
+        Animator* animator = pair.second;
+        
+        if (!animator->playing || animator->currentAnimationId == 0)
+            continue;
+        
+        auto it = animator->animations.find(animator->currentAnimationId);
+        if (it == animator->animations.end())
+            continue;
+        
+        MultiAtlasAnimation* anim = it->second;
+        
+        float frameDuration = 1.0f / anim->fps;
+        animator->frameTimer += deltaTime;
+        
+        while (animator->frameTimer >= frameDuration) {
+            animator->frameTimer -= frameDuration;
+            animator->currentFrameIndex++;
+            
+            if (animator->currentFrameIndex >= anim->frames.size()) {
+                if (anim->loop) {
+                    animator->currentFrameIndex = 0;
+                } else {
+                    animator->currentFrameIndex = anim->frames.size() - 1;
+                    animator->playing = 0;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+void Renderer::DestroyAnimator(uint32_t animatorId)
+{
+    std::lock_guard<std::mutex> lock(animator_mutex_);
+    auto it = animators_.find(animatorId);
+    if (it != animators_.end()) {
+        delete it->second;
+        animators_.erase(it);
+    }
+}
+
+// img
+
+Renderer::ImageData Renderer::LoadImageFromFile(const std::string &path)
+{
+    ImageData result;
+    result.success = false;
+
+    Image image = ::LoadImage(path.c_str());
+
+    if (image.data == NULL)
+    {
+        std::cerr << "Failed to load image: " << path << std::endl;
+        return result;
+    }
+
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+
+    result.width = image.width;
+    result.height = image.height;
+    result.format = image.format;
+
+    int dataSize = image.width * image.height * 4; // 4 bytes per pixel (RGBA)
+    result.data.resize(dataSize);
+
+    memcpy(result.data.data(), image.data, dataSize);
+
+    ::UnloadImage(image);
+
+    result.success = true;
+    return result;
+}
+
+void Renderer::UnloadImageData(ImageData &imageData)
+{
+    imageData.data.clear();
+    imageData.width = 0;
+    imageData.height = 0;
+    imageData.format = 0;
+    imageData.success = false;
+}
+
+// Texture management
+Renderer::TextureId Renderer::GenerateTextureId()
+{
+    return nextTextureId_++;
+}
+
+Renderer::TextureId Renderer::LoadTexture(const std::string &path)
+{
+    if (!std::filesystem::exists(path))
+    {
+        std::cerr << "Texture file not found: " << path << std::endl;
+        return 0;
+    }
+
+    Texture2D texture = ::LoadTexture(path.c_str());
+    if (texture.id == 0)
+    {
+        std::cerr << "Failed to load texture: " << path << std::endl;
+        return 0;
+    }
+
+    TextureId id = GenerateTextureId();
+    textures_.emplace(id, texture);
+    std::cout << "Texture loaded: " << path << " (ID: " << id << ")" << std::endl;
+
+    return id;
+}
+
+void Renderer::UnloadTexture(TextureId textureId)
+{
+    auto it = textures_.find(textureId);
+    if (it != textures_.end())
+    {
+        UnloadTexture(it->second.id);
+        textures_.erase(it);
+        std::cout << "Texture unloaded: " << textureId << std::endl;
+    }
+}
+
+void Renderer::DrawTexture(TextureId textureId, const Vec2 &pos, const Color4 &tint)
+{
+    // Check internal render textures first
+    auto renderIt = internalRenderTextures_.find(textureId);
+    if (renderIt != internalRenderTextures_.end())
+    {
+        ::DrawTextureV(renderIt->second.texture, pos.ToRaylib(), tint.ToRaylib());
+        return;
+    }
+
+    // Check regular textures
+    auto textureIt = textures_.find(textureId);
+    if (textureIt != textures_.end())
+    {
+        ::DrawTextureV(textureIt->second, pos.ToRaylib(), tint.ToRaylib());
+    }
+}
+
+void Renderer::DrawTexture(TextureId textureId, const Vec2 &pos, const Vec2 &size, const Color4 &tint)
+{
+    auto renderIt = internalRenderTextures_.find(textureId);
+    if (renderIt != internalRenderTextures_.end())
+    {
+        Rectangle dest = {pos.x, pos.y, size.x, size.y};
+        Rectangle src = {0, 0, (float)renderIt->second.texture.width, (float)renderIt->second.texture.height};
+        ::DrawTexturePro(renderIt->second.texture, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+        return;
+    }
+
+    auto textureIt = textures_.find(textureId);
+    if (textureIt != textures_.end())
+    {
+        Rectangle dest = {pos.x, pos.y, size.x, size.y};
+        Rectangle src = {0, 0, (float)textureIt->second.width, (float)textureIt->second.height};
+        ::DrawTexturePro(textureIt->second, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+    }
+}
+
+void Renderer::DrawTextureRegion(TextureId textureId, const Vec2 &srcPos, const Vec2 &srcSize,
+                                 const Vec2 &destPos, const Vec2 &destSize, const Color4 &tint)
+{
+    auto renderIt = internalRenderTextures_.find(textureId);
+    if (renderIt != internalRenderTextures_.end())
+    {
+        Rectangle src = {srcPos.x, srcPos.y, srcSize.x, srcSize.y};
+        Rectangle dest = {destPos.x, destPos.y, destSize.x, destSize.y};
+        ::DrawTexturePro(renderIt->second.texture, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+        return;
+    }
+
+    auto textureIt = textures_.find(textureId);
+    if (textureIt != textures_.end())
+    {
+        Rectangle src = {srcPos.x, srcPos.y, srcSize.x, srcSize.y};
+        Rectangle dest = {destPos.x, destPos.y, destSize.x, destSize.y};
+        ::DrawTexturePro(textureIt->second, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+    }
+}
+
+// Render targets
+Renderer::TextureId Renderer::CreateRenderTexture(int width, int height)
+{
+    RenderTexture2D rt = LoadRenderTexture(width, height);
+    TextureId id = nextRenderTextureId_++;
+    internalRenderTextures_.emplace(id, rt);
+    std::cout << "Created render texture: " << id << " (" << width << "x" << height << ")" << std::endl;
+    return id;
+}
+
+void Renderer::DestroyRenderTexture(TextureId id)
+{
+    auto it = internalRenderTextures_.find(id);
+    if (it != internalRenderTextures_.end())
+    {
+        UnloadRenderTexture(it->second);
+        internalRenderTextures_.erase(it);
+        std::cout << "Destroyed render texture: " << id << std::endl;
+    }
+}
+
+void Renderer::SetRenderTarget(TextureId id)
+{
+    if (id == 0)
+    {
+        if (inTextureMode_)
+        {
+            EndTextureMode();
+            inTextureMode_ = false;
+            currentRenderTargetId_ = 0;
+        }
+        return;
+    }
+
+    auto it = internalRenderTextures_.find(id);
+    if (it == internalRenderTextures_.end())
+    {
+        std::cerr << "Unknown render target: " << id << std::endl;
+        return;
+    }
+
+    if (inTextureMode_)
+    {
+        EndTextureMode();
+    }
+
+    BeginTextureMode(it->second);
+    inTextureMode_ = true;
+    currentRenderTargetId_ = id;
+}
+
+Vec2 Renderer::GetRenderTextureSize(TextureId id) const
+{
+    auto it = internalRenderTextures_.find(id);
+    if (it != internalRenderTextures_.end())
+    {
+        return Vec2((float)it->second.texture.width, (float)it->second.texture.height);
+    }
+
+    auto textureIt = textures_.find(id);
+    if (textureIt != textures_.end())
+    {
+        return Vec2((float)textureIt->second.width, (float)textureIt->second.height);
+    }
+
+    return Vec2(0, 0);
+}
+
+// Utility for steping thru the renderer(usually for games) it's a single call vs multiple from
+
+void Renderer::RegisterRenderCallback(std::function<void()> callback)
+{
+    renderCallbacks_.push_back(callback);
+}
+
+CameraState Renderer::GetCameraState(size_t bufRefId)
+{
+    CameraState cam = {0};
+
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size())
+        return cam;
+
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    if (!s || !s->control)
+        return cam;
+
+    // Reinterpret control buffer as float*
+    float *ctrl_f32 = reinterpret_cast<float *>(s->control);
+
+    cam.worldX = ctrl_f32[CTRL_CAM_WORLD_X];
+    cam.worldY = ctrl_f32[CTRL_CAM_WORLD_Y];
+    cam.zoom = ctrl_f32[CTRL_CAM_ZOOM];
+    cam.viewWidth = ctrl_f32[CTRL_CAM_VIEW_WIDTH];
+    cam.viewHeight = ctrl_f32[CTRL_CAM_VIEW_HEIGHT];
+    cam.rotation = ctrl_f32[CTRL_CAM_ROTATION];
+    cam.frustumLeft = ctrl_f32[CTRL_CAM_FRUSTUM_LEFT];
+    cam.frustumRight = ctrl_f32[CTRL_CAM_FRUSTUM_RIGHT];
+    cam.frustumTop = ctrl_f32[CTRL_CAM_FRUSTUM_TOP];
+    cam.frustumBottom = ctrl_f32[CTRL_CAM_FRUSTUM_BOTTOM];
+
+    return cam;
+}
+
+bool Renderer::IsInFrustum(const CameraState &cam, float worldX, float worldY, float width, float height)
+{
+    float left = worldX - width / 2.0f;
+    float right = worldX + width / 2.0f;
+    float top = worldY - height / 2.0f;
+    float bottom = worldY + height / 2.0f;
+
+    // AABB intersection test
+    if (right < cam.frustumLeft || left > cam.frustumRight ||
+        bottom < cam.frustumTop || top > cam.frustumBottom)
+    {
+        return false; // Outside
+    }
+
+    return true; // at least partially visible
+}
+
+bool Renderer::Step()
 {
-    AnimatedSprite* sprite = GetSprite(spriteId);
-    if (!sprite)
-        return;
-    
-    // Get animation
-    auto it = sprite->animations.find(animId);
-    if (it == sprite->animations.end())
-        return;
-    
-    SpriteAnimation* anim = it->second;
-    
-    // Switch to this animation
-    sprite->currentAnimationId = animId;
-    sprite->playing = 1;
-    sprite->frameTimer = 0.0f;
-    
-    // Set first frame
-    if (anim->frameCount > 0) {
-        sprite->currentFrame = anim->frames[0];
+    UpdateSizeIfNeeded();
+    SwapAllBuffers();
+    BeginFrame();
+    Clear(clearColor);
+    for (auto &callback : renderCallbacks_)
+    {
+        callback();
     }
+
+    // Keep music streams fed (required for raylib streaming music playback)
+    AudioManager::Instance().Update();
+
+    EndFrame();
+    return !IsWindowClosed();
 }
 
+// Buffer
 
-void Renderer::UpdateSpriteAnimations(float deltaTime)
+bool Renderer::SwapBuffers(size_t bufRefId)
 {
-    std::lock_guard<std::mutex> lock(sprite_mutex_);
-    
-    for (auto& pair : sprites_) {
-        AnimatedSprite* sprite = pair.second;
-        
-        if (!sprite->playing || sprite->currentAnimationId == 0)
-            continue;
-        
-        // Get current animation
-        auto it = sprite->animations.find(sprite->currentAnimationId);
-        if (it == sprite->animations.end())
-            continue;
-        
-        SpriteAnimation* anim = it->second;
-        
-        float frameDuration = 1.0f / anim->fps;
-        sprite->frameTimer += deltaTime;
-        
-        // Advance frames
-        while (sprite->frameTimer >= frameDuration) {
-            sprite->frameTimer -= frameDuration;
-            
-            // Find current frame index
-            uint32_t currentIdx = 0;
-            for (uint32_t i = 0; i < anim->frameCount; i++) {
-                if (anim->frames[i] == sprite->currentFrame) {
-                    currentIdx = i;
-                    break;
-                }
-            }
-            
-            // Advance
-            currentIdx++;
-            
-            // Check end
-            if (currentIdx >= anim->frameCount) {
-                if (anim->loop) {
-                    currentIdx = 0;
-                } else {
-                    currentIdx = anim->frameCount - 1;
-                    sprite->playing = 0;
-                    break;
-                }
-            }
-            
-            sprite->currentFrame = anim->frames[currentIdx];
-        }
+    // Debugger::Instance().LogInfo("swapping buffer " + std::to_string(bufRefId));
+    // Debugger::Instance().LogInfo("buffer size " + std::to_string(shared_buffers_ref.size()));
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size())
+        return false;
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    if (!s || s->composite_source)
+        return false; // layers reach the screen through their compositor target
+    // Debugger::Instance().LogInfo("buffer textureId " + std::to_string(s->texture_id));
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint32_t dirty = ctrl[CTRL_DIRTY_FLAG].load(std::memory_order_acquire);
+
+    // frame barrier: with workers armed the frame is done once all of them committed
+    uint32_t workers = s->ext_version ? ctrl[CTRL_WORKER_COUNT].load(std::memory_order_acquire) : 0;
+    if (workers)
+        dirty = ctrl[CTRL_WORKER_COMMITS].load(std::memory_order_acquire) >= workers;
+
+    if (dirty == 0)
+        return false;
+
+    if (s->slot_count == 1)
+    {
+        // nothing rotates: JS keeps the one slot, the texture takes the staged copy
+        if (s->staged.empty())
+            StageFrame(s);
+        UploadStaged(s);
+    }
+    else
+    {
+        uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_relaxed);
+        uint32_t cpp_read = ctrl[CTRL_CPP_READ_IDX].load(std::memory_order_relaxed);
+        uint32_t gpu_render = ctrl[CTRL_GPU_RENDER_IDX].load(std::memory_order_relaxed);
+
+        // with two slots the one just uploaded is both the ready and the on-screen one
+        uint32_t new_gpu = s->slot_count == 2 ? js_write : cpp_read;
+        uint32_t new_ready = js_write;
+        uint32_t new_write = s->slot_count == 2 ? cpp_read : gpu_render;
+
+        // process dirty regions for the buffer that JS wrote into (js_write)
+        ProcessDirtyRegions(bufRefId, js_write);
+
+        // the slot handed back to JS is one or two frames behind, bring it up to date
+        CopyForward(s, js_write, new_write);
+
+        // rotate indices
+        ctrl[CTRL_GPU_RENDER_IDX].store(new_gpu, std::memory_order_relaxed);
+        ctrl[CTRL_CPP_READ_IDX].store(new_ready, std::memory_order_relaxed);
+        ctrl[CTRL_JS_WRITE_IDX].store(new_write, std::memory_order_release);
+    }
+
+    // Clear dirty flag AFTER swapping
+    ctrl[CTRL_DIRTY_FLAG].store(0u, std::memory_order_release);
+
+    if (s->ext_version)
+    {
+        // workers wait for the epoch to move before touching the new write slot
+        ctrl[CTRL_WORKER_COMMITS].store(0u, std::memory_order_relaxed);
+        ctrl[CTRL_FRAME_EPOCH].fetch_add(1u, std::memory_order_release);
     }
+
+    // announced (and drained) on the JS thread
+    if (std::find(swapped_buffers_.begin(), swapped_buffers_.end(), bufRefId) == swapped_buffers_.end())
+        swapped_buffers_.push_back(bufRefId);
+    return true;
 }
 
-uint32_t Renderer::CreateAnimator(const std::vector<std::string>& animNames,
-                                  const std::vector<std::vector<std::string>>& framePaths,
-                                  const std::vector<float>& fpsList,
-                                  const std::vector<bool>& loopList)
+// Turns a tile bitmap (bit col & 31 of word row * wordsPerRow + col / 32) into
+// pixel rects: runs of set tiles become spans, and consecutive tile rows with
+// identical spans merge into one band.
+static void AppendTileBands(const uint32_t *bits, uint32_t cols, uint32_t rows, uint32_t wordsPerRow,
+                            uint32_t tileSize, uint32_t width, uint32_t height,
+                            std::vector<DirtyRect> &regions)
 {
-    Animator* animator = new Animator();
-    
-    uint32_t nextAnimId = 1;
-    for (size_t i = 0; i < animNames.size(); i++) {
-        MultiAtlasAnimation* anim = new MultiAtlasAnimation();
-        anim->name = animNames[i];
-        anim->id = nextAnimId++;
-        anim->fps = fpsList[i];
-        anim->loop = loopList[i];
-        
-        // Load each frame's atlas
-        for (const std::string& path : framePaths[i]) {
-            uint32_t atlasId = LoadAtlas(path);
-            
-            if (atlasId == 0) {
-                Debugger::Instance().LogError("Failed to load animator frame: " + path);
+    // column spans [first, last] of the current band, and where it started
+    std::vector<std::pair<uint32_t, uint32_t>> band, spans;
+    uint32_t bandStart = 0;
+
+    auto flushBand = [&](uint32_t rowEnd)
+    {
+        uint32_t y = bandStart * tileSize;
+        uint32_t h = std::min(rowEnd * tileSize, height) - y;
+        for (const auto &span : band)
+        {
+            uint32_t x = span.first * tileSize;
+            uint32_t w = std::min((span.second + 1) * tileSize, width) - x;
+            regions.emplace_back(x, y, w, h);
+        }
+    };
+
+    for (uint32_t row = 0; row < rows; row++)
+    {
+        spans.clear();
+        const uint32_t *words = bits + static_cast<size_t>(row) * wordsPerRow;
+        bool open = false;
+        for (uint32_t word = 0; word < wordsPerRow; word++)
+        {
+            uint32_t w = words[word];
+            if (w == 0 && !open)
                 continue;
+            for (uint32_t bit = 0; bit < 32; bit++)
+            {
+                uint32_t col = word * 32 + bit;
+                if (col >= cols)
+                    break;
+                bool set = (w >> bit) & 1u;
+                if (set && !open)
+                    spans.emplace_back(col, col);
+                else if (set)
+                    spans.back().second = col;
+                open = set;
             }
-            
-            SpriteAtlas* atlas = GetAtlas(atlasId);
-            AnimatorFrame frame;
-            frame.atlasId = atlasId;
-            frame.width = atlas->width;
-            frame.height = atlas->height;
-            
-            anim->frames.push_back(frame);
         }
-        
-        animator->animations[anim->id] = anim;
-        animator->animationNames[anim->name] = anim->id;
-        
-        Debugger::Instance().LogInfo("Loaded animation '" + anim->name + 
-                                     "' with " + std::to_string(anim->frames.size()) + " frames");
+
+        if (spans == band)
+            continue;
+        flushBand(row);
+        band.swap(spans);
+        bandStart = row;
     }
-    
-    std::lock_guard<std::mutex> lock(animator_mutex_);
-    uint32_t id = next_animator_id_++;
-    animators_[id] = animator;
-    
-    return id;
+    flushBand(rows);
 }
 
-void Renderer::UpdateAnimator(uint32_t animatorId, float x, float y, float rotation,
-                              float scaleX, float scaleY, bool flipH, bool flipV)
+void Renderer::ProcessPendingRegions(size_t bufRefId)
 {
-    std::lock_guard<std::mutex> lock(animator_mutex_);
-    auto it = animators_.find(animatorId);
-    if (it == animators_.end())
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size())
         return;
-    
-    Animator* anim = it->second;
-    anim->x = x;
-    anim->y = y;
-    anim->rotation = rotation;
-    anim->scaleX = scaleX;
-    anim->scaleY = scaleY;
-    anim->flipH = flipH ? 1 : 0;
-    anim->flipV = flipV ? 1 : 0;
-}
 
-void Renderer::PlayAnimatorAnimation(uint32_t animatorId, const std::string& animName)
-{
-    std::lock_guard<std::mutex> lock(animator_mutex_);
-    auto it = animators_.find(animatorId);
-    if (it == animators_.end())
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    if (!s || !s->control || s->composite_source)
         return;
-    
-    Animator* animator = it->second;
-    auto nameIt = animator->animationNames.find(animName);
-    if (nameIt == animator->animationNames.end())
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+
+    // Get the CURRENT write buffer that JS is using
+    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
+    uint8_t *pixel_data = s->pixel_buffers[js_write];
+
+    if (textures_.find(s->texture_id) == textures_.end())
         return;
-    
-    animator->currentAnimationId = nameIt->second;
-    animator->currentFrameIndex = 0;
-    animator->frameTimer = 0.0f;
-    animator->playing = 1;
+
+    std::vector<DirtyRect> regions;
+    if (!TakeDirtyRegions(s, regions))
+        return; // Nothing to do
+
+    for (const DirtyRect &r : regions)
+        UploadRegionToGPU(s->texture_id, pixel_data, r.x, r.y, r.width, r.height, s->width, s->height,
+                          s->color_grade.get());
+    SyncShadow(s, pixel_data, regions);
+    NoteDamage(s, regions, false);
 }
 
-void Renderer::DrawAnimator(uint32_t animatorId, size_t bufRefId)
+void Renderer::PartialTextureUpdate(size_t bufRefId, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
 {
-    std::lock_guard<std::mutex> lock(animator_mutex_);
-    auto it = animators_.find(animatorId);
-    if (it == animators_.end())
-        return;
-    
-    Animator* animator = it->second;
-    
-    if (animator->currentAnimationId == 0)
-        return;
-    
-    auto animIt = animator->animations.find(animator->currentAnimationId);
-    if (animIt == animator->animations.end())
-        return;
-    
-    MultiAtlasAnimation* anim = animIt->second;
-    
-    if (animator->currentFrameIndex >= anim->frames.size())
-        return;
-    
-    // Get current frame
-    AnimatorFrame& frame = anim->frames[animator->currentFrameIndex];
-    SpriteAtlas* atlas = GetAtlas(frame.atlasId);
-    if (!atlas)
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size())
         return;
-    
-    // Get camera
-    CameraState cam = GetCameraState(bufRefId);
-    
-    // Calculate world bounds
-    float worldW = frame.width * animator->scaleX;
-    float worldH = frame.height * animator->scaleY;
-    
-    // Frustum cull
-    if (!IsInFrustum(cam, animator->x, animator->y, worldW, worldH))
+
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    if (!s)
         return;
-    
-    // Convert to screen
-    ScreenRect screenRect = WorldToScreen(cam, animator->x, animator->y, worldW, worldH);
-    
-    // Get write buffer
-    std::lock_guard<std::mutex> bufLock(buffers_mutex_);
+
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
+    uint8_t *pixel_data = s->pixel_buffers[js_write];
+
+    UploadRegionToGPU(s->texture_id, pixel_data, x, y, w, h, s->width, s->height, s->color_grade.get());
+    SyncShadow(s, pixel_data, {DirtyRect(x, y, w, h)});
+    NoteDamage(s, {DirtyRect(x, y, w, h)}, false);
+}
+
+void Renderer::ProcessDirtyRegions(size_t bufRefId, uint32_t buffer_idx)
+{
+    // std::lock_guard<std::mutex> lock(buffers_mutex_);
     if (bufRefId >= shared_buffers_ref.size())
         return;
-    
-    SharedBufferRefs* s = shared_buffers_ref[bufRefId];
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
     if (!s || !s->control)
         return;
-    
-    std::atomic<uint32_t>* ctrl = reinterpret_cast<std::atomic<uint32_t>*>(s->control);
-    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
-    uint8_t* dstBuffer = s->pixel_buffers[js_write];
-    
-    // Source rect is entire atlas (loose sprite)
-    FrameRect srcRect = { 0, 0, frame.width, frame.height };
-    
-    // Blit (assume non-opaque for loose sprites)
-    BlitSpriteNN_Alpha(dstBuffer, s->width, s->height, screenRect,
-                      atlas, srcRect, animator->flipH, animator->flipV);
-    
-    // Mark dirty
-    uint32_t dirty_count = ctrl[CTRL_DIRTY_COUNT].load(std::memory_order_acquire);
-    if (dirty_count < MAX_DIRTY_REGIONS) {
-        uint32_t offset = CTRL_DIRTY_REGIONS + (dirty_count * 4);
-        ctrl[offset + 0] = screenRect.x;
-        ctrl[offset + 1] = screenRect.y;
-        ctrl[offset + 2] = screenRect.width;
-        ctrl[offset + 3] = screenRect.height;
-        ctrl[CTRL_DIRTY_COUNT].store(dirty_count + 1, std::memory_order_release);
+
+    uint8_t *pixel_data = s->pixel_buffers[buffer_idx];
+
+    // retrieve texture by id
+    auto it = textures_.find(s->texture_id);
+    if (it == textures_.end())
+    {
+        // no texture, nothing to upload
+        return;
+    }
+
+    std::vector<DirtyRect> regions;
+    if (!TakeDirtyRegions(s, regions))
+    {
+        if (!s->diff_tile_size || !s->shadow_valid)
+        {
+            // no regions => upload entire buffer
+            UploadEntireBuffer(bufRefId, buffer_idx);
+            if (s->diff_tile_size)
+            {
+                std::memcpy(s->shadow.data(), pixel_data, s->shadow.size());
+                s->shadow_valid = true;
+            }
+            NoteDamage(s, regions, true);
+            return;
+        }
+
+        // unannotated frame: upload only the tiles that changed since last time
+        DiffAgainstShadow(s, pixel_data, regions);
+        for (const DirtyRect &r : regions)
+            UploadRegionToGPU(s->texture_id, pixel_data, r.x, r.y, r.width, r.height, s->width, s->height,
+                          s->color_grade.get());
+        NoteDamage(s, regions, false);
+        return;
     }
+
+    for (const DirtyRect &r : regions)
+        UploadRegionToGPU(s->texture_id, pixel_data, r.x, r.y, r.width, r.height, s->width, s->height,
+                          s->color_grade.get());
+    SyncShadow(s, pixel_data, regions);
+    NoteDamage(s, regions, false);
 }
 
-void Renderer::UpdateAnimators(float deltaTime)
+// Single-slot sets: copies what changed out of the one pixel buffer, so JS
+// can keep drawing while the upload is pending. Regions come from the marks,
+// the shadow diff, or the whole canvas, as in ProcessDirtyRegions.
+void Renderer::StageFrame(SharedBufferRefs *s)
 {
-    std::lock_guard<std::mutex> lock(animator_mutex_);
-    
-    for (auto& pair : animators_) {
-        Animator* animator = pair.second;
-        
-        if (!animator->playing || animator->currentAnimationId == 0)
+    const uint8_t *pixels = s->pixel_buffers[0];
+    std::vector<DirtyRect> regions;
+    if (!TakeDirtyRegions(s, regions))
+    {
+        if (s->diff_tile_size && s->shadow_valid)
+        {
+            DiffAgainstShadow(s, pixels, regions);
+        }
+        else
+        {
+            // a full frame supersedes anything staged before it
+            s->staging.clear();
+            s->staged.clear();
+            regions.emplace_back(0, 0, s->width, s->height);
+            s->shadow_valid = s->diff_tile_size != 0; // filled by SyncShadow below
+        }
+    }
+    SyncShadow(s, pixels, regions);
+
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
+    for (const DirtyRect &r : regions)
+    {
+        if (r.x < 0 || r.y < 0 || r.width <= 0 || r.height <= 0 ||
+            static_cast<uint32_t>(r.x) >= s->width || static_cast<uint32_t>(r.y) >= s->height)
             continue;
-        
-        auto it = animator->animations.find(animator->currentAnimationId);
-        if (it == animator->animations.end())
+        uint32_t w = std::min<uint32_t>(r.width, s->width - r.x);
+        uint32_t h = std::min<uint32_t>(r.height, s->height - r.y);
+
+        size_t at = s->staging.size();
+        s->staging.resize(at + static_cast<size_t>(w) * h * 4u);
+        const uint8_t *first = pixels + r.y * stride + static_cast<size_t>(r.x) * 4u;
+        if (s->color_grade)
+        {
+            GradeRows(*s->color_grade, first, stride, s->staging.data() + at, static_cast<size_t>(w) * 4u, w, h, Workers());
+            s->staged.emplace_back(r.x, r.y, w, h);
             continue;
-        
-        MultiAtlasAnimation* anim = it->second;
-        
-        float frameDuration = 1.0f / anim->fps;
-        animator->frameTimer += deltaTime;
-        
-        while (animator->frameTimer >= frameDuration) {
-            animator->frameTimer -= frameDuration;
-            animator->currentFrameIndex++;
-            
-            if (animator->currentFrameIndex >= anim->frames.size()) {
-                if (anim->loop) {
-                    animator->currentFrameIndex = 0;
-                } else {
-                    animator->currentFrameIndex = anim->frames.size() - 1;
-                    animator->playing = 0;
-                    break;
-                }
-            }
         }
+        for (uint32_t row = 0; row < h; row++)
+            std::memcpy(s->staging.data() + at + static_cast<size_t>(row) * w * 4u,
+                        first + row * stride, static_cast<size_t>(w) * 4u);
+        s->staged.emplace_back(r.x, r.y, w, h);
     }
 }
 
-void Renderer::DestroyAnimator(uint32_t animatorId)
+// staged rects are tightly packed already, they go to the GPU without another copy
+void Renderer::UploadStaged(SharedBufferRefs *s)
 {
-    std::lock_guard<std::mutex> lock(animator_mutex_);
-    auto it = animators_.find(animatorId);
-    if (it != animators_.end()) {
-        delete it->second;
-        animators_.erase(it);
+    auto it = textures_.find(s->texture_id);
+    if (it != textures_.end())
+    {
+        const uint8_t *data = s->staging.data();
+        for (const DirtyRect &r : s->staged)
+        {
+            Rectangle rect = {static_cast<float>(r.x), static_cast<float>(r.y),
+                              static_cast<float>(r.width), static_cast<float>(r.height)};
+            ::UpdateTextureRec(it->second, rect, data);
+            data += static_cast<size_t>(r.width) * r.height * 4u;
+        }
     }
+
+    // keeps capacity, so steady frames don't reallocate
+    s->staging.clear();
+    s->staged.clear();
 }
 
-// img
+bool Renderer::SetCopyForward(size_t bufRefId, bool enabled)
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+        return false;
 
-Renderer::ImageData Renderer::LoadImageFromFile(const std::string &path)
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    s->copy_forward = enabled;
+    s->frame_damage.clear();
+    s->prev_damage.clear();
+
+    // slots filled before this have unknown history, the first two handoffs copy in full
+    s->frame_damage_full = s->prev_damage_full = enabled;
+    return true;
+}
+
+bool Renderer::AssignWorkerBands(size_t bufRefId, uint32_t count, std::vector<DirtyRect> &bands)
 {
-    ImageData result;
-    result.success = false;
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+        return false;
 
-    Image image = ::LoadImage(path.c_str());
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    if (!s->tile_size)
+        return false; // the legacy region list isn't safe for concurrent writers
 
-    if (image.data == NULL)
+    // bands own whole tile rows, so workers never share a bitmap word
+    count = std::min(count, s->tile_rows);
+    for (uint32_t i = 0; i < count; i++)
     {
-        std::cerr << "Failed to load image: " << path << std::endl;
-        return result;
+        uint32_t r0 = static_cast<uint32_t>(static_cast<uint64_t>(s->tile_rows) * i / count);
+        uint32_t r1 = static_cast<uint32_t>(static_cast<uint64_t>(s->tile_rows) * (i + 1) / count);
+        uint32_t y0 = r0 * s->tile_size;
+        uint32_t y1 = std::min(r1 * s->tile_size, s->height);
+        bands.emplace_back(0, y0, s->width, y1 - y0);
     }
 
-    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    ctrl[CTRL_WORKER_COMMITS].store(0u, std::memory_order_relaxed);
+    ctrl[CTRL_WORKER_COUNT].store(count, std::memory_order_release);
+    return true;
+}
 
-    result.width = image.width;
-    result.height = image.height;
-    result.format = image.format;
+// writes the old w x h image into dst (nw x nh) according to the policy;
+// src and dst never alias
+static void ResamplePixels(const uint8_t *src, uint32_t w, uint32_t h,
+                           uint8_t *dst, uint32_t nw, uint32_t nh, BufferResizePolicy policy)
+{
+    const size_t dstStride = static_cast<size_t>(nw) * 4u;
+    const size_t srcStride = static_cast<size_t>(w) * 4u;
 
-    int dataSize = image.width * image.height * 4; // 4 bytes per pixel (RGBA)
-    result.data.resize(dataSize);
+    if (policy == RESIZE_SCALE && w > 0 && h > 0)
+    {
+        std::vector<uint32_t> xmap(nw);
+        for (uint32_t x = 0; x < nw; x++)
+            xmap[x] = static_cast<uint32_t>((static_cast<uint64_t>(x) * w) / nw);
 
-    memcpy(result.data.data(), image.data, dataSize);
+        for (uint32_t y = 0; y < nh; y++)
+        {
+            const uint32_t *srow = reinterpret_cast<const uint32_t *>(src + ((static_cast<uint64_t>(y) * h) / nh) * srcStride);
+            uint32_t *drow = reinterpret_cast<uint32_t *>(dst + y * dstStride);
+            for (uint32_t x = 0; x < nw; x++)
+                drow[x] = srow[xmap[x]];
+        }
+        return;
+    }
 
-    ::UnloadImage(image);
+    std::memset(dst, 0, dstStride * nh);
+    if (policy != RESIZE_KEEP)
+        return;
 
-    result.success = true;
-    return result;
+    size_t rowBytes = static_cast<size_t>(std::min(w, nw)) * 4u;
+    uint32_t rows = std::min(h, nh);
+    for (uint32_t y = 0; y < rows; y++)
+        std::memcpy(dst + y * dstStride, src + y * srcStride, rowBytes);
 }
 
-void Renderer::UnloadImageData(ImageData &imageData)
+bool Renderer::ResizeSharedBuffers(size_t bufRefId, uint32_t width, uint32_t height, BufferResizePolicy policy,
+                                   uint8_t *const pixels[3], uint32_t *control, size_t controlBytes)
 {
-    imageData.data.clear();
-    imageData.width = 0;
-    imageData.height = 0;
-    imageData.format = 0;
-    imageData.success = false;
-}
+    if (width == 0 || height == 0)
+        return false;
 
-// Texture management
-Renderer::TextureId Renderer::GenerateTextureId()
-{
-    return nextTextureId_++;
-}
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+        return false;
 
-Renderer::TextureId Renderer::LoadTexture(const std::string &path)
-{
-    if (!std::filesystem::exists(path))
+    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+    if (controlBytes < GetControlBufferSize(width, height, s->tile_size))
+        return false;
+
+    // reused buffers are resampled from a copy, the old and new layouts overlap
+    std::vector<uint8_t> scratch;
+    for (uint32_t i = 0; i < s->slot_count; i++)
     {
-        std::cerr << "Texture file not found: " << path << std::endl;
-        return 0;
+        const uint8_t *src = s->pixel_buffers[i];
+        if (pixels[i] == src && policy != RESIZE_CLEAR)
+        {
+            scratch.assign(src, src + s->buffer_size);
+            src = scratch.data();
+        }
+        ResamplePixels(src, s->width, s->height, pixels[i], width, height, policy);
+        s->pixel_buffers[i] = pixels[i];
     }
 
-    Texture2D texture = ::LoadTexture(path.c_str());
-    if (texture.id == 0)
+    if (control != s->control)
     {
-        std::cerr << "Failed to load texture: " << path << std::endl;
-        return 0;
+        // indices, camera and pending legacy regions carry over
+        std::memcpy(control, s->control, CTRL_LEGACY_SLOTS * sizeof(uint32_t));
+        s->control = control;
     }
 
-    TextureId id = GenerateTextureId();
-    textures_.emplace(id, texture);
-    std::cout << "Texture loaded: " << path << " (ID: " << id << ")" << std::endl;
+    s->width = width;
+    s->height = height;
+    s->buffer_size = static_cast<size_t>(width) * height * 4u;
 
-    return id;
-}
+    // old coordinates mean nothing now, the next upload is a full one
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    ctrl[CTRL_DIRTY_COUNT].store(0u, std::memory_order_relaxed);
+    uint32_t epoch = s->ext_version ? ctrl[CTRL_FRAME_EPOCH].load(std::memory_order_relaxed) : 0;
+    InitControlLayout(s, controlBytes, s->tile_size);
 
-void Renderer::UnloadTexture(TextureId textureId)
-{
-    auto it = textures_.find(textureId);
-    if (it != textures_.end())
-    {
-        UnloadTexture(it->second.id);
-        textures_.erase(it);
-        std::cout << "Texture unloaded: " << textureId << std::endl;
-    }
-}
+    // worker bands no longer fit; the barrier is disarmed (InitControlLayout
+    // clears it) and the epoch moves so waiting workers pick up the new size
+    if (s->ext_version)
+        ctrl[CTRL_FRAME_EPOCH].store(epoch + 1, std::memory_order_release);
 
-void Renderer::DrawTexture(TextureId textureId, const Vec2 &pos, const Color4 &tint)
-{
-    // Check internal render textures first
-    auto renderIt = internalRenderTextures_.find(textureId);
-    if (renderIt != internalRenderTextures_.end())
+    if (s->diff_tile_size)
     {
-        ::DrawTextureV(renderIt->second.texture, pos.ToRaylib(), tint.ToRaylib());
-        return;
+        s->shadow.assign(s->buffer_size, 0);
+        s->shadow_valid = false;
     }
+    s->frame_damage.clear();
+    s->prev_damage.clear();
+    s->frame_damage_full = s->prev_damage_full = s->copy_forward;
+    s->staging.clear();
+    s->staged.clear();
 
-    // Check regular textures
-    auto textureIt = textures_.find(textureId);
-    if (textureIt != textures_.end())
+    // one texture reallocation, same id; seeded with the latest submitted frame
+    auto it = textures_.find(s->texture_id);
+    if (it != textures_.end())
     {
-        ::DrawTextureV(textureIt->second, pos.ToRaylib(), tint.ToRaylib());
+        ::UnloadTexture(it->second);
+
+        Image image;
+        image.data = s->pixel_buffers[ctrl[CTRL_CPP_READ_IDX].load(std::memory_order_relaxed) % s->slot_count];
+        image.width = width;
+        image.height = height;
+        image.mipmaps = 1;
+        image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+        it->second = LoadTextureFromImage(image);
     }
+
+    return true;
 }
 
-void Renderer::DrawTexture(TextureId textureId, const Vec2 &pos, const Vec2 &size, const Color4 &tint)
+void Renderer::NoteDamage(SharedBufferRefs *s, const std::vector<DirtyRect> &regions, bool full)
 {
-    auto renderIt = internalRenderTextures_.find(textureId);
-    if (renderIt != internalRenderTextures_.end())
-    {
-        Rectangle dest = {pos.x, pos.y, size.x, size.y};
-        Rectangle src = {0, 0, (float)renderIt->second.texture.width, (float)renderIt->second.texture.height};
-        ::DrawTexturePro(renderIt->second.texture, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+    if (!s->copy_forward)
         return;
-    }
 
-    auto textureIt = textures_.find(textureId);
-    if (textureIt != textures_.end())
+    if (full)
     {
-        Rectangle dest = {pos.x, pos.y, size.x, size.y};
-        Rectangle src = {0, 0, (float)textureIt->second.width, (float)textureIt->second.height};
-        ::DrawTexturePro(textureIt->second, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+        s->frame_damage_full = true;
+        s->frame_damage.clear();
+        return;
     }
+
+    if (!s->frame_damage_full)
+        s->frame_damage.insert(s->frame_damage.end(), regions.begin(), regions.end());
 }
 
-void Renderer::DrawTextureRegion(TextureId textureId, const Vec2 &srcPos, const Vec2 &srcSize,
-                                 const Vec2 &destPos, const Vec2 &destSize, const Color4 &tint)
+// Copies the damage of the last two frames from slot `from` (just submitted,
+// current) into slot `to` (about to be handed to JS) and ages the history.
+void Renderer::CopyForward(SharedBufferRefs *s, uint32_t from, uint32_t to)
 {
-    auto renderIt = internalRenderTextures_.find(textureId);
-    if (renderIt != internalRenderTextures_.end())
-    {
-        Rectangle src = {srcPos.x, srcPos.y, srcSize.x, srcSize.y};
-        Rectangle dest = {destPos.x, destPos.y, destSize.x, destSize.y};
-        ::DrawTexturePro(renderIt->second.texture, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+    if (!s->copy_forward || from == to)
         return;
-    }
 
-    auto textureIt = textures_.find(textureId);
-    if (textureIt != textures_.end())
+    const uint8_t *src = s->pixel_buffers[from];
+    uint8_t *dst = s->pixel_buffers[to];
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
+
+    if (s->frame_damage_full || s->prev_damage_full)
     {
-        Rectangle src = {srcPos.x, srcPos.y, srcSize.x, srcSize.y};
-        Rectangle dest = {destPos.x, destPos.y, destSize.x, destSize.y};
-        ::DrawTexturePro(textureIt->second, src, dest, Vector2{0, 0}, 0.0f, tint.ToRaylib());
+        std::memcpy(dst, src, stride * s->height);
+    }
+    else
+    {
+        for (const std::vector<DirtyRect> *damage : {&s->prev_damage, &s->frame_damage})
+        {
+            for (const DirtyRect &r : *damage)
+            {
+                // regions were clamped when recorded, stay defensive anyway
+                if (r.x < 0 || r.y < 0 || r.width <= 0 || r.height <= 0 ||
+                    static_cast<uint32_t>(r.x) >= s->width || static_cast<uint32_t>(r.y) >= s->height)
+                    continue;
+                size_t bytes = static_cast<size_t>(std::min<uint32_t>(r.width, s->width - r.x)) * 4u;
+                uint32_t yEnd = r.y + std::min<uint32_t>(r.height, s->height - r.y);
+                for (uint32_t y = r.y; y < yEnd; y++)
+                {
+                    size_t off = y * stride + static_cast<size_t>(r.x) * 4u;
+                    std::memcpy(dst + off, src + off, bytes);
+                }
+            }
+        }
     }
+
+    s->prev_damage.swap(s->frame_damage);
+    s->frame_damage.clear();
+    s->prev_damage_full = s->frame_damage_full;
+    s->frame_damage_full = false;
 }
 
-// Render targets
-Renderer::TextureId Renderer::CreateRenderTexture(int width, int height)
+WorkerPool &Renderer::Workers()
 {
-    RenderTexture2D rt = LoadRenderTexture(width, height);
-    TextureId id = nextRenderTextureId_++;
-    internalRenderTextures_.emplace(id, rt);
-    std::cout << "Created render texture: " << id << " (" << width << "x" << height << ")" << std::endl;
-    return id;
+    std::lock_guard<std::mutex> lock(worker_pool_mutex_);
+    if (!worker_pool_)
+        worker_pool_.reset(new WorkerPool());
+    return *worker_pool_;
 }
 
-void Renderer::DestroyRenderTexture(TextureId id)
+static bool SameRect(const DirtyRect &a, const DirtyRect &b)
 {
-    auto it = internalRenderTextures_.find(id);
-    if (it != internalRenderTextures_.end())
-    {
-        UnloadRenderTexture(it->second);
-        internalRenderTextures_.erase(it);
-        std::cout << "Destroyed render texture: " << id << std::endl;
-    }
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
 }
 
-void Renderer::SetRenderTarget(TextureId id)
+static bool SameLayer(const CompositeLayer &a, const CompositeLayer &b)
 {
-    if (id == 0)
-    {
-        if (inTextureMode_)
-        {
-            EndTextureMode();
-            inTextureMode_ = false;
-            currentRenderTargetId_ = 0;
-        }
-        return;
-    }
+    return a.bufRefId == b.bufRefId && a.x == b.x && a.y == b.y && a.opacity == b.opacity &&
+           a.blend == b.blend && a.visible == b.visible && SameRect(a.scissor, b.scissor);
+}
 
-    auto it = internalRenderTextures_.find(id);
-    if (it == internalRenderTextures_.end())
+// layer rect in target space, clipped to the target and the scissor; empty when it draws nothing
+DirtyRect Renderer::LayerBounds(const SharedBufferRefs *target, const CompositeLayer &layer)
+{
+    const SharedBufferRefs *src = shared_buffers_ref[layer.bufRefId];
+    if (!src || !layer.visible || layer.opacity == 0)
+        return DirtyRect();
+
+    int64_t x0 = std::max<int64_t>(layer.x, 0);
+    int64_t y0 = std::max<int64_t>(layer.y, 0);
+    int64_t x1 = std::min<int64_t>(static_cast<int64_t>(layer.x) + src->width, target->width);
+    int64_t y1 = std::min<int64_t>(static_cast<int64_t>(layer.y) + src->height, target->height);
+    if (layer.scissor.IsValid())
     {
-        std::cerr << "Unknown render target: " << id << std::endl;
-        return;
+        x0 = std::max<int64_t>(x0, layer.scissor.x);
+        y0 = std::max<int64_t>(y0, layer.scissor.y);
+        x1 = std::min<int64_t>(x1, static_cast<int64_t>(layer.scissor.x) + layer.scissor.width);
+        y1 = std::min<int64_t>(y1, static_cast<int64_t>(layer.scissor.y) + layer.scissor.height);
     }
+    if (x1 <= x0 || y1 <= y0)
+        return DirtyRect();
+    return DirtyRect(static_cast<int>(x0), static_cast<int>(y0), static_cast<int>(x1 - x0), static_cast<int>(y1 - y0));
+}
+
+bool Renderer::SetCompositeLayers(size_t targetId, const std::vector<CompositeLayer> &layers)
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    if (targetId >= shared_buffers_ref.size() || !shared_buffers_ref[targetId])
+        return false;
 
-    if (inTextureMode_)
+    SharedBufferRefs *target = shared_buffers_ref[targetId];
+    if (target->composite_source)
+        return false; // no nesting, a target has to swap on its own
+
+    for (const CompositeLayer &layer : layers)
     {
-        EndTextureMode();
+        if (layer.bufRefId == targetId || layer.bufRefId >= shared_buffers_ref.size() ||
+            !shared_buffers_ref[layer.bufRefId])
+            return false;
+
+        auto nested = composite_targets_.find(layer.bufRefId);
+        if (nested != composite_targets_.end() && !nested->second.layers.empty())
+            return false;
     }
 
-    BeginTextureMode(it->second);
-    inTextureMode_ = true;
-    currentRenderTargetId_ = id;
-}
+    CompositeTarget &state = composite_targets_[targetId];
+    std::vector<DirtyRect> bounds;
+    for (const CompositeLayer &layer : layers)
+        bounds.push_back(LayerBounds(target, layer));
 
-Vec2 Renderer::GetRenderTextureSize(TextureId id) const
-{
-    auto it = internalRenderTextures_.find(id);
-    if (it != internalRenderTextures_.end())
+    // only layers whose config moved need recompositing, over where they were and where they are
+    for (size_t i = 0; i < std::max(layers.size(), state.layers.size()); i++)
     {
-        return Vec2((float)it->second.texture.width, (float)it->second.texture.height);
+        bool kept = i < layers.size() && i < state.layers.size() &&
+                    SameLayer(layers[i], state.layers[i]) && SameRect(bounds[i], state.bounds[i]);
+        if (kept)
+            continue;
+        if (i < state.bounds.size())
+            state.pending.Add(state.bounds[i].x, state.bounds[i].y, state.bounds[i].width, state.bounds[i].height);
+        if (i < bounds.size())
+            state.pending.Add(bounds[i].x, bounds[i].y, bounds[i].width, bounds[i].height);
     }
 
-    auto textureIt = textures_.find(id);
-    if (textureIt != textures_.end())
+    for (const CompositeLayer &layer : state.layers)
     {
-        return Vec2((float)textureIt->second.width, (float)textureIt->second.height);
+        if (shared_buffers_ref[layer.bufRefId])
+            shared_buffers_ref[layer.bufRefId]->composite_source = false;
     }
+    state.layers = layers;
+    state.bounds.swap(bounds);
 
-    return Vec2(0, 0);
+    // a buffer can feed several targets, so flags are rebuilt from all of them
+    for (const auto &entry : composite_targets_)
+    {
+        for (const CompositeLayer &layer : entry.second.layers)
+            shared_buffers_ref[layer.bufRefId]->composite_source = true;
+    }
+    return true;
 }
 
-// Utility for steping thru the renderer(usually for games) it's a single call vs multiple from
+// rows per compositor job
+static const int COMPOSITE_STRIP_ROWS = 64;
 
-void Renderer::RegisterRenderCallback(std::function<void()> callback)
+struct CompositeInput
 {
-    renderCallbacks_.push_back(callback);
-}
+    const uint8_t *pixels;
+    uint32_t width;
+    int32_t x;
+    int32_t y;
+    DirtyRect bounds;
+    uint32_t opacity;
+    BlendMode blend;
+};
 
-CameraState Renderer::GetCameraState(size_t bufRefId)
+// rebuilds r in the target from the layers covering it, bottom to top
+static void CompositeRect(uint8_t *dst, uint32_t dstWidth, const DirtyRect &r, const std::vector<CompositeInput> &inputs)
 {
-    CameraState cam = {0};
-
-    std::lock_guard<std::mutex> lock(buffers_mutex_);
-    if (bufRefId >= shared_buffers_ref.size())
-        return cam;
-
-    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
-    if (!s || !s->control)
-        return cam;
-
-    // Reinterpret control buffer as float*
-    float *ctrl_f32 = reinterpret_cast<float *>(s->control);
+    bool covered = false;
+    for (const CompositeInput &in : inputs)
+    {
+        int x0 = std::max(r.x, in.bounds.x);
+        int y0 = std::max(r.y, in.bounds.y);
+        int x1 = std::min(r.x + r.width, in.bounds.x + in.bounds.width);
+        int y1 = std::min(r.y + r.height, in.bounds.y + in.bounds.height);
+        if (x1 <= x0 || y1 <= y0)
+            continue;
 
-    cam.worldX = ctrl_f32[CTRL_CAM_WORLD_X];
-    cam.worldY = ctrl_f32[CTRL_CAM_WORLD_Y];
-    cam.zoom = ctrl_f32[CTRL_CAM_ZOOM];
-    cam.viewWidth = ctrl_f32[CTRL_CAM_VIEW_WIDTH];
-    cam.viewHeight = ctrl_f32[CTRL_CAM_VIEW_HEIGHT];
-    cam.rotation = ctrl_f32[CTRL_CAM_ROTATION];
-    cam.frustumLeft = ctrl_f32[CTRL_CAM_FRUSTUM_LEFT];
-    cam.frustumRight = ctrl_f32[CTRL_CAM_FRUSTUM_RIGHT];
-    cam.frustumTop = ctrl_f32[CTRL_CAM_FRUSTUM_TOP];
-    cam.frustumBottom = ctrl_f32[CTRL_CAM_FRUSTUM_BOTTOM];
+        bool whole = x0 == r.x && y0 == r.y && x1 == r.x + r.width && y1 == r.y + r.height;
+        if (!covered && whole && in.blend == BLEND_NORMAL && in.opacity == 255)
+        {
+            // an opaque-mode bottom layer replaces the rect outright
+            for (int y = y0; y < y1; y++)
+                std::memcpy(dst + (static_cast<size_t>(y) * dstWidth + x0) * 4,
+                            in.pixels + (static_cast<size_t>(y - in.y) * in.width + (x0 - in.x)) * 4,
+                            static_cast<size_t>(x1 - x0) * 4);
+            covered = true;
+            continue;
+        }
 
-    return cam;
-}
+        if (!covered)
+        {
+            for (int y = r.y; y < r.y + r.height; y++)
+                std::memset(dst + (static_cast<size_t>(y) * dstWidth + r.x) * 4, 0, static_cast<size_t>(r.width) * 4);
+            covered = true;
+        }
 
-bool Renderer::IsInFrustum(const CameraState &cam, float worldX, float worldY, float width, float height)
-{
-    float left = worldX - width / 2.0f;
-    float right = worldX + width / 2.0f;
-    float top = worldY - height / 2.0f;
-    float bottom = worldY + height / 2.0f;
+        for (int y = y0; y < y1; y++)
+            BlendSpan(dst + (static_cast<size_t>(y) * dstWidth + x0) * 4,
+                      in.pixels + (static_cast<size_t>(y - in.y) * in.width + (x0 - in.x)) * 4,
+                      x1 - x0, in.opacity, in.blend);
+    }
 
-    // AABB intersection test
-    if (right < cam.frustumLeft || left > cam.frustumRight ||
-        bottom < cam.frustumTop || top > cam.frustumBottom)
+    if (!covered)
     {
-        return false; // Outside
+        for (int y = r.y; y < r.y + r.height; y++)
+            std::memset(dst + (static_cast<size_t>(y) * dstWidth + r.x) * 4, 0, static_cast<size_t>(r.width) * 4);
     }
-
-    return true; // at least partially visible
 }
 
-bool Renderer::Step()
+int Renderer::CompositeLayers(size_t targetId)
 {
-    UpdateSizeIfNeeded();
-    SwapAllBuffers();
-    BeginFrame();
-    Clear(clearColor);
-    for (auto &callback : renderCallbacks_)
+    std::vector<DirtyRect> rects;
     {
-        callback();
-    }
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        auto it = composite_targets_.find(targetId);
+        if (targetId >= shared_buffers_ref.size() || !shared_buffers_ref[targetId] || it == composite_targets_.end())
+            return -1;
 
-    // Keep music streams fed (required for raylib streaming music playback)
-    AudioManager::Instance().Update();
+        SharedBufferRefs *target = shared_buffers_ref[targetId];
+        CompositeTarget &state = it->second;
 
-    EndFrame();
-    return !IsWindowClosed();
-}
+        // unseen or resized target: everything is stale
+        if (state.width != target->width || state.height != target->height)
+        {
+            state.width = target->width;
+            state.height = target->height;
+            state.pending.Add(0, 0, target->width, target->height);
+        }
 
-// Buffer
+        // only damaged areas are rebuilt, the rest must already be in the write slot
+        if (!target->copy_forward)
+        {
+            target->copy_forward = true;
+            target->frame_damage_full = target->prev_damage_full = true;
+            state.pending.Add(0, 0, target->width, target->height);
+        }
 
-void Renderer::SwapBuffers(size_t bufRefId)
-{
-    // Debugger::Instance().LogInfo("swapping buffer " + std::to_string(bufRefId));
-    // Debugger::Instance().LogInfo("buffer size " + std::to_string(shared_buffers_ref.size()));
-    std::lock_guard<std::mutex> lock(buffers_mutex_);
-    if (bufRefId >= shared_buffers_ref.size())
-        return;
-    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
-    if (!s)
-        return;
-    // Debugger::Instance().LogInfo("buffer textureId " + std::to_string(s->texture_id));
+        std::vector<CompositeInput> inputs;
+        std::vector<DirtyRect> regions;
+        for (size_t i = 0; i < state.layers.size(); i++)
+        {
+            const CompositeLayer &layer = state.layers[i];
+            SharedBufferRefs *src = shared_buffers_ref[layer.bufRefId];
+            if (!src)
+                continue;
 
-    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
-    uint32_t dirty = ctrl[CTRL_DIRTY_FLAG].load(std::memory_order_acquire);
-    if (dirty == 0)
-        return;
+            // a resized layer covers a different area now
+            DirtyRect bounds = LayerBounds(target, layer);
+            if (!SameRect(bounds, state.bounds[i]))
+            {
+                state.pending.Add(state.bounds[i].x, state.bounds[i].y, state.bounds[i].width, state.bounds[i].height);
+                state.pending.Add(bounds.x, bounds.y, bounds.width, bounds.height);
+                state.bounds[i] = bounds;
+            }
 
-    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_relaxed);
-    uint32_t cpp_read = ctrl[CTRL_CPP_READ_IDX].load(std::memory_order_relaxed);
-    uint32_t gpu_render = ctrl[CTRL_GPU_RENDER_IDX].load(std::memory_order_relaxed);
+            // consume the layer's marks even when hidden, so showing it later starts clean
+            std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(src->control);
+            regions.clear();
+            bool marked = TakeDirtyRegions(src, regions);
+            bool committed = ctrl[CTRL_DIRTY_FLAG].exchange(0u, std::memory_order_acq_rel) != 0;
+            if (!bounds.IsValid())
+                continue;
 
-    uint32_t new_gpu = cpp_read;
-    uint32_t new_ready = js_write;
-    uint32_t new_write = gpu_render;
+            // committed without marking anything: the whole layer
+            if (!marked && committed)
+                regions.emplace_back(0, 0, src->width, src->height);
+
+            for (const DirtyRect &r : regions)
+            {
+                int x0 = std::max(r.x + layer.x, bounds.x);
+                int y0 = std::max(r.y + layer.y, bounds.y);
+                int x1 = std::min(r.x + r.width + layer.x, bounds.x + bounds.width);
+                int y1 = std::min(r.y + r.height + layer.y, bounds.y + bounds.height);
+                state.pending.Add(x0, y0, x1 - x0, y1 - y0);
+            }
 
-    // process dirty regions for the buffer that JS wrote into (js_write)
-    ProcessDirtyRegions(bufRefId, js_write);
+            uint32_t slot = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
+            inputs.push_back({src->pixel_buffers[slot], src->width, layer.x, layer.y, bounds, layer.opacity, layer.blend});
+        }
 
-    // rotate indices
-    ctrl[CTRL_GPU_RENDER_IDX].store(new_gpu, std::memory_order_relaxed);
-    ctrl[CTRL_CPP_READ_IDX].store(new_ready, std::memory_order_relaxed);
-    ctrl[CTRL_JS_WRITE_IDX].store(new_write, std::memory_order_release);
+        if (state.pending.Empty())
+            return 0; // no layer drew or moved: nothing to composite or upload
 
-    // Clear dirty flag AFTER swapping
-    ctrl[CTRL_DIRTY_FLAG].store(0u, std::memory_order_release);
+        rects = state.pending.Rects();
+        state.pending.Clear();
+
+        std::atomic<uint32_t> *tctrl = reinterpret_cast<std::atomic<uint32_t> *>(target->control);
+        uint8_t *dst = target->pixel_buffers[tctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire)];
+
+        // rects are disjoint; cut them into strips so large ones spread across the pool too
+        std::vector<DirtyRect> strips;
+        for (const DirtyRect &r : rects)
+        {
+            for (int y = r.y; y < r.y + r.height; y += COMPOSITE_STRIP_ROWS)
+                strips.emplace_back(r.x, y, r.width, std::min(COMPOSITE_STRIP_ROWS, r.y + r.height - y));
+        }
+        Workers().ParallelFor(strips.size(), [&](size_t i)
+                              { CompositeRect(dst, target->width, strips[i], inputs); });
+
+        for (const DirtyRect &r : rects)
+            RecordDirtyRegion(target, r.x, r.y, r.width, r.height);
+        tctrl[CTRL_DIRTY_FLAG].store(1u, std::memory_order_release);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        frame_committed_ = true;
+    }
+    commit_cv_.notify_one();
+    return static_cast<int>(rects.size());
 }
 
-void Renderer::ProcessPendingRegions(size_t bufRefId)
+bool Renderer::SetAutoDirtyDetection(size_t bufRefId, bool enabled, uint32_t tileSize)
 {
     std::lock_guard<std::mutex> lock(buffers_mutex_);
-    if (bufRefId >= shared_buffers_ref.size())
-        return;
+    if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+        return false;
 
     SharedBufferRefs *s = shared_buffers_ref[bufRefId];
-    if (!s || !s->control)
-        return;
-
-    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
-
-    // Get the CURRENT write buffer that JS is using
-    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
-    uint32_t dirty_count = ctrl[CTRL_DIRTY_COUNT].load(std::memory_order_acquire);
+    if (!enabled)
+    {
+        s->diff_tile_size = 0;
+        s->shadow_valid = false;
+        std::vector<uint8_t>().swap(s->shadow);
+        return true;
+    }
 
-    if (dirty_count == 0)
-        return; // Nothing to do
+    if (tileSize == 0)
+        return false;
 
-    uint8_t *pixel_data = s->pixel_buffers[js_write];
+    // the first unannotated frame after this uploads in full and seeds the shadow
+    s->diff_tile_size = tileSize;
+    s->shadow.assign(static_cast<size_t>(s->width) * s->height * 4u, 0);
+    s->shadow_valid = false;
+    return true;
+}
 
-    auto it = textures_.find(s->texture_id);
-    if (it == textures_.end())
-        return;
+// true if the two byte ranges differ anywhere
+static bool SpanDiffers(const uint8_t *a, const uint8_t *b, size_t bytes)
+{
+    size_t i = 0;
+#ifdef RENDERER_SSE2
+    // xor/or 64 bytes at a time, one test per row keeps the loop branch-light
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 64 <= bytes; i += 64)
+    {
+        __m128i d0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i)));
+        __m128i d1 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 16)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 16)));
+        __m128i d2 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 32)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 32)));
+        __m128i d3 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i + 48)),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i + 48)));
+        acc = _mm_or_si128(acc, _mm_or_si128(_mm_or_si128(d0, d1), _mm_or_si128(d2, d3)));
+    }
+    for (; i + 16 <= bytes; i += 16)
+        acc = _mm_or_si128(acc, _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i)),
+                                              _mm_loadu_si128(reinterpret_cast<const __m128i *>(b + i))));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(acc, _mm_setzero_si128())) != 0xFFFF)
+        return true;
+#endif
+    return i < bytes && std::memcmp(a + i, b + i, bytes - i) != 0;
+}
 
-    Texture2D &texture = it->second;
+// Compares pixels against the shadow copy tile by tile (tile rows spread over
+// the worker pool), copies changed tiles into the shadow and returns them as
+// merged row bands.
+void Renderer::DiffAgainstShadow(SharedBufferRefs *s, const uint8_t *pixels, std::vector<DirtyRect> &regions)
+{
+    const uint32_t ts = s->diff_tile_size;
+    const uint32_t cols = (s->width + ts - 1) / ts;
+    const uint32_t rows = (s->height + ts - 1) / ts;
+    const uint32_t wordsPerRow = (cols + 31) / 32;
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
 
-    // Process all dirty regions
-    if (dirty_count > MAX_DIRTY_REGIONS)
-        dirty_count = MAX_DIRTY_REGIONS;
+    // one word range per tile row, so workers never share a word
+    std::vector<uint32_t> bits(static_cast<size_t>(rows) * wordsPerRow, 0u);
+    uint8_t *shadow = s->shadow.data();
 
-    for (uint32_t i = 0; i < dirty_count; ++i)
+    std::function<void(size_t)> diffRow = [&](size_t row)
     {
-        uint32_t offset = CTRL_DIRTY_REGIONS + (i * 4);
-        uint32_t x = ctrl[offset + 0].load(std::memory_order_relaxed);
-        uint32_t y = ctrl[offset + 1].load(std::memory_order_relaxed);
-        uint32_t w = ctrl[offset + 2].load(std::memory_order_relaxed);
-        uint32_t h = ctrl[offset + 3].load(std::memory_order_relaxed);
+        uint32_t y0 = static_cast<uint32_t>(row) * ts;
+        uint32_t y1 = std::min(y0 + ts, s->height);
+        uint32_t *words = bits.data() + row * wordsPerRow;
 
-        if (w == 0 || h == 0)
-            continue;
+        for (uint32_t col = 0; col < cols; col++)
+        {
+            uint32_t x0 = col * ts;
+            size_t bytes = static_cast<size_t>(std::min(x0 + ts, s->width) - x0) * 4u;
+
+            bool changed = false;
+            for (uint32_t y = y0; y < y1 && !changed; y++)
+            {
+                size_t off = y * stride + x0 * 4u;
+                changed = SpanDiffers(pixels + off, shadow + off, bytes);
+            }
+            if (!changed)
+                continue;
 
-        UploadRegionToGPU(s->texture_id, pixel_data, x, y, w, h, s->width, s->height);
-    }
+            words[col / 32] |= 1u << (col % 32);
+            for (uint32_t y = y0; y < y1; y++)
+            {
+                size_t off = y * stride + x0 * 4u;
+                std::memcpy(shadow + off, pixels + off, bytes);
+            }
+        }
+    };
+    Workers().ParallelFor(rows, diffRow);
 
-    // Clear dirty count - JS can start fresh
-    ctrl[CTRL_DIRTY_COUNT].store(0u, std::memory_order_release);
+    AppendTileBands(bits.data(), cols, rows, wordsPerRow, ts, s->width, s->height, regions);
 }
 
-void Renderer::PartialTextureUpdate(size_t bufRefId, uint32_t x, uint32_t y, uint32_t w, uint32_t h)
+// keeps the shadow equal to the texture after an annotated upload
+void Renderer::SyncShadow(SharedBufferRefs *s, const uint8_t *pixels, const std::vector<DirtyRect> &regions)
 {
-    std::lock_guard<std::mutex> lock(buffers_mutex_);
-    if (bufRefId >= shared_buffers_ref.size())
+    if (!s->diff_tile_size || !s->shadow_valid)
         return;
 
-    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
-    if (!s)
-        return;
+    const size_t stride = static_cast<size_t>(s->width) * 4u;
+    for (const DirtyRect &r : regions)
+    {
+        if (r.x < 0 || r.y < 0 || r.width <= 0 || r.height <= 0 ||
+            static_cast<uint32_t>(r.x) >= s->width || static_cast<uint32_t>(r.y) >= s->height)
+            continue;
+        uint32_t w = std::min<uint32_t>(r.width, s->width - r.x);
+        uint32_t h = std::min<uint32_t>(r.height, s->height - r.y);
+        for (uint32_t y = r.y; y < r.y + h; y++)
+        {
+            size_t off = y * stride + static_cast<size_t>(r.x) * 4u;
+            std::memcpy(s->shadow.data() + off, pixels + off, static_cast<size_t>(w) * 4u);
+        }
+    }
+}
+
+size_t GetControlBufferSize(uint32_t width, uint32_t height, uint32_t tileSize)
+{
+    if (tileSize == 0)
+        return CTRL_LEGACY_SLOTS * sizeof(uint32_t);
 
+    size_t cols = (width + tileSize - 1) / tileSize;
+    size_t rows = (height + tileSize - 1) / tileSize;
+    size_t wordsPerRow = (cols + 31) / 32;
+    return (CTRL_TILE_BITMAP + rows * wordsPerRow) * sizeof(uint32_t);
+}
+
+bool Renderer::InitControlLayout(SharedBufferRefs *s, size_t controlBytes, uint32_t tileSize)
+{
     std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
-    uint32_t js_write = ctrl[CTRL_JS_WRITE_IDX].load(std::memory_order_acquire);
-    uint8_t *pixel_data = s->pixel_buffers[js_write];
 
-    UploadRegionToGPU(s->texture_id, pixel_data, x, y, w, h, s->width, s->height);
+    s->ext_version = 0;
+    s->tile_size = s->tile_cols = s->tile_rows = s->tile_words_per_row = 0;
+
+    if (tileSize == 0)
+    {
+        // legacy list only; a stale header from a previous layout must not be trusted
+        if (controlBytes >= CTRL_TILE_BITMAP * sizeof(uint32_t))
+            ctrl[CTRL_EXT_MAGIC].store(0u, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (controlBytes < GetControlBufferSize(s->width, s->height, tileSize))
+        return false;
+
+    s->ext_version = CTRL_EXT_VERSION_VALUE;
+    s->tile_size = tileSize;
+    s->tile_cols = (s->width + tileSize - 1) / tileSize;
+    s->tile_rows = (s->height + tileSize - 1) / tileSize;
+    s->tile_words_per_row = (s->tile_cols + 31) / 32;
+
+    ctrl[CTRL_EXT_VERSION].store(s->ext_version, std::memory_order_relaxed);
+    ctrl[CTRL_TILE_SIZE].store(s->tile_size, std::memory_order_relaxed);
+    ctrl[CTRL_TILE_COLS].store(s->tile_cols, std::memory_order_relaxed);
+    ctrl[CTRL_TILE_ROWS].store(s->tile_rows, std::memory_order_relaxed);
+    ctrl[CTRL_TILE_WORDS_PER_ROW].store(s->tile_words_per_row, std::memory_order_relaxed);
+    for (uint32_t i = CTRL_TILE_WORDS_PER_ROW + 1; i < CTRL_TILE_BITMAP; i++)
+        ctrl[i].store(0u, std::memory_order_relaxed);
+
+    size_t words = static_cast<size_t>(s->tile_rows) * s->tile_words_per_row;
+    for (size_t i = 0; i < words; i++)
+        ctrl[CTRL_TILE_BITMAP + i].store(0u, std::memory_order_relaxed);
+
+    // magic last, readers treat the header as valid once it is set
+    ctrl[CTRL_EXT_MAGIC].store(CTRL_EXT_MAGIC_VALUE, std::memory_order_release);
+    return true;
 }
 
-void Renderer::ProcessDirtyRegions(size_t bufRefId, uint32_t buffer_idx)
+void Renderer::RecordDirtyRegion(SharedBufferRefs *s, int32_t x, int32_t y, int32_t w, int32_t h)
 {
-    // std::lock_guard<std::mutex> lock(buffers_mutex_);
-    if (bufRefId >= shared_buffers_ref.size())
+    if (!s || !s->control || w <= 0 || h <= 0)
         return;
-    SharedBufferRefs *s = shared_buffers_ref[bufRefId];
-    if (!s || !s->control)
+
+    // clamp to buffer bounds (64-bit so far off-screen sprites can't wrap)
+    int64_t x0 = std::max<int64_t>(x, 0);
+    int64_t y0 = std::max<int64_t>(y, 0);
+    int64_t x1 = std::min<int64_t>(static_cast<int64_t>(x) + w, s->width);
+    int64_t y1 = std::min<int64_t>(static_cast<int64_t>(y) + h, s->height);
+    if (x1 <= x0 || y1 <= y0)
         return;
 
     std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
-    uint32_t dirty_count = ctrl[CTRL_DIRTY_COUNT].load(std::memory_order_acquire);
-    uint8_t *pixel_data = s->pixel_buffers[buffer_idx];
 
-    // retrieve texture by id
-    auto it = textures_.find(s->texture_id);
-    if (it == textures_.end())
+    if (s->tile_size)
     {
-        // no texture, nothing to upload
+        // bitmap: a fixed number of words whatever the draw count
+        uint32_t c0 = static_cast<uint32_t>(x0) / s->tile_size;
+        uint32_t c1 = static_cast<uint32_t>(x1 - 1) / s->tile_size;
+        uint32_t r0 = static_cast<uint32_t>(y0) / s->tile_size;
+        uint32_t r1 = static_cast<uint32_t>(y1 - 1) / s->tile_size;
+
+        for (uint32_t row = r0; row <= r1; row++)
+        {
+            std::atomic<uint32_t> *words = ctrl + CTRL_TILE_BITMAP + static_cast<size_t>(row) * s->tile_words_per_row;
+            for (uint32_t word = c0 / 32; word <= c1 / 32; word++)
+            {
+                uint32_t lo = word == c0 / 32 ? c0 % 32 : 0;
+                uint32_t hi = word == c1 / 32 ? c1 % 32 : 31;
+                uint32_t mask = (hi == 31 ? 0xFFFFFFFFu : ((1u << (hi + 1)) - 1)) & ~((1u << lo) - 1);
+                words[word].fetch_or(mask, std::memory_order_release);
+            }
+        }
         return;
     }
 
-    Texture2D &texture = it->second;
+    uint32_t rx = static_cast<uint32_t>(x0);
+    uint32_t ry = static_cast<uint32_t>(y0);
+    uint32_t rw = static_cast<uint32_t>(x1 - x0);
+    uint32_t rh = static_cast<uint32_t>(y1 - y0);
 
-    if (dirty_count == 0)
+    uint32_t dirty_count = ctrl[CTRL_DIRTY_COUNT].load(std::memory_order_acquire);
+    if (dirty_count < MAX_DIRTY_REGIONS)
     {
-        // no regions => upload entire buffer
-        UploadEntireBuffer(bufRefId, buffer_idx);
+        uint32_t offset = CTRL_DIRTY_REGIONS + (dirty_count * 4);
+        ctrl[offset + 0].store(rx, std::memory_order_relaxed);
+        ctrl[offset + 1].store(ry, std::memory_order_relaxed);
+        ctrl[offset + 2].store(rw, std::memory_order_relaxed);
+        ctrl[offset + 3].store(rh, std::memory_order_relaxed);
+        ctrl[CTRL_DIRTY_COUNT].store(dirty_count + 1, std::memory_order_release);
         return;
     }
 
-    if (dirty_count > MAX_DIRTY_REGIONS)
-        dirty_count = MAX_DIRTY_REGIONS;
+    // list is full: grow the last region instead of dropping this one
+    uint32_t offset = CTRL_DIRTY_REGIONS + (MAX_DIRTY_REGIONS - 1) * 4;
+    uint32_t lx = ctrl[offset + 0].load(std::memory_order_relaxed);
+    uint32_t ly = ctrl[offset + 1].load(std::memory_order_relaxed);
+    uint32_t lr = lx + ctrl[offset + 2].load(std::memory_order_relaxed);
+    uint32_t lb = ly + ctrl[offset + 3].load(std::memory_order_relaxed);
+
+    uint32_t nx = std::min(lx, rx);
+    uint32_t ny = std::min(ly, ry);
+    ctrl[offset + 0].store(nx, std::memory_order_relaxed);
+    ctrl[offset + 1].store(ny, std::memory_order_relaxed);
+    ctrl[offset + 2].store(std::max(lr, rx + rw) - nx, std::memory_order_relaxed);
+    ctrl[offset + 3].store(std::max(lb, ry + rh) - ny, std::memory_order_release);
+}
+
+// Collects and clears everything marked dirty since the last upload: the
+// legacy list as-is, the tile bitmap as row bands (consecutive tile rows with
+// identical column spans merge into one rect). Returns false if nothing was marked.
+bool Renderer::TakeDirtyRegions(SharedBufferRefs *s, std::vector<DirtyRect> &regions)
+{
+    std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+    bool marked = false;
 
-    for (uint32_t i = 0; i < dirty_count; ++i)
+    uint32_t dirty_count = ctrl[CTRL_DIRTY_COUNT].load(std::memory_order_acquire);
+    if (dirty_count > 0)
     {
-        uint32_t offset = CTRL_DIRTY_REGIONS + (i * 4);
-        uint32_t x = ctrl[offset + 0].load(std::memory_order_relaxed);
-        uint32_t y = ctrl[offset + 1].load(std::memory_order_relaxed);
-        uint32_t w = ctrl[offset + 2].load(std::memory_order_relaxed);
-        uint32_t h = ctrl[offset + 3].load(std::memory_order_relaxed);
+        marked = true;
+        if (dirty_count > MAX_DIRTY_REGIONS)
+            dirty_count = MAX_DIRTY_REGIONS;
 
-        if (w == 0 || h == 0)
-            continue;
-        UploadRegionToGPU(s->texture_id, pixel_data, x, y, w, h, s->width, s->height);
+        for (uint32_t i = 0; i < dirty_count; ++i)
+        {
+            uint32_t offset = CTRL_DIRTY_REGIONS + (i * 4);
+            uint32_t x = ctrl[offset + 0].load(std::memory_order_relaxed);
+            uint32_t y = ctrl[offset + 1].load(std::memory_order_relaxed);
+            uint32_t w = ctrl[offset + 2].load(std::memory_order_relaxed);
+            uint32_t h = ctrl[offset + 3].load(std::memory_order_relaxed);
+            if (w == 0 || h == 0)
+                continue;
+            regions.emplace_back(x, y, w, h);
+        }
+
+        // Clear dirty count - JS can start fresh
+        ctrl[CTRL_DIRTY_COUNT].store(0u, std::memory_order_release);
     }
 
-    // Clear dirty count after processing
-    ctrl[CTRL_DIRTY_COUNT].store(0u, std::memory_order_release);
+    if (!s->tile_size)
+        return marked;
+
+    // snapshot-and-clear first so the scan below works on a stable copy
+    size_t words = static_cast<size_t>(s->tile_rows) * s->tile_words_per_row;
+    std::vector<uint32_t> bits(words);
+    std::atomic<uint32_t> *bitmap = ctrl + CTRL_TILE_BITMAP;
+    for (size_t i = 0; i < words; i++)
+        bits[i] = bitmap[i].load(std::memory_order_relaxed) ? bitmap[i].exchange(0u, std::memory_order_acq_rel) : 0u;
+
+    size_t before = regions.size();
+    AppendTileBands(bits.data(), s->tile_cols, s->tile_rows, s->tile_words_per_row,
+                    s->tile_size, s->width, s->height, regions);
+
+    return marked || regions.size() > before;
 }
 
 // Upload a rectangle region for given texture id.
 // pixel_data points to the full RGBA8 pixel buffer (width*height*4).
 void Renderer::UploadRegionToGPU(TextureId texId, uint8_t *pixel_data,
                                  uint32_t x, uint32_t y, uint32_t w, uint32_t h,
-                                 uint32_t fullWidth, uint32_t fullHeight)
+                                 uint32_t fullWidth, uint32_t fullHeight, const ColorGrade *grade)
 {
     if (w == 0 || h == 0)
         return;
@@ -1482,12 +5184,21 @@ void Renderer::UploadRegionToGPU(TextureId texId, uint8_t *pixel_data,
     std::vector<uint8_t> region_data;
     region_data.resize(regionSize);
 
-    // copy scanlines
-    for (uint32_t row = 0; row < h; ++row)
+    // copy scanlines (grading them on the way when the canvas has a grade)
+    const uint8_t *first = pixel_data + (static_cast<size_t>(y) * fullWidth + x) * 4u;
+    if (grade)
+    {
+        GradeRows(*grade, first, static_cast<size_t>(fullWidth) * 4u, region_data.data(),
+                  static_cast<size_t>(w) * 4u, w, h, Workers());
+    }
+    else
     {
-        const uint8_t *src = pixel_data + ((static_cast<size_t>(y + row) * fullWidth + x) * 4u);
-        uint8_t *dst = region_data.data() + (static_cast<size_t>(row) * w * 4u);
-        memcpy(dst, src, static_cast<size_t>(w) * 4u);
+        for (uint32_t row = 0; row < h; ++row)
+        {
+            const uint8_t *src = first + static_cast<size_t>(row) * fullWidth * 4u;
+            uint8_t *dst = region_data.data() + (static_cast<size_t>(row) * w * 4u);
+            memcpy(dst, src, static_cast<size_t>(w) * 4u);
+        }
     }
 
     Rectangle rect = {static_cast<float>(x),
@@ -1515,10 +5226,58 @@ void Renderer::UploadEntireBuffer(size_t bufRefId, uint32_t buffer_idx)
         return;
     Texture2D &texture = it->second;
 
+    // graded canvases go through the region path, which grades while copying
+    if (s->color_grade)
+    {
+        UploadRegionToGPU(s->texture_id, pixel_data, 0, 0, s->width, s->height, s->width, s->height,
+                          s->color_grade.get());
+        return;
+    }
+
     // full upload: UpdateTexture expects pointer to full RGBA buffer
     ::UpdateTexture(texture, pixel_data);
 }
 
+bool Renderer::CommitFrame(size_t bufRefId)
+{
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex_);
+        if (bufRefId >= shared_buffers_ref.size() || !shared_buffers_ref[bufRefId])
+            return false;
+
+        SharedBufferRefs *s = shared_buffers_ref[bufRefId];
+        std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(s->control);
+
+        // single slot: snapshot now, JS may draw again as soon as this returns
+        // (with workers armed the frame isn't complete yet, the swap stages it)
+        bool workers = s->ext_version && ctrl[CTRL_WORKER_COUNT].load(std::memory_order_acquire);
+        if (s->slot_count == 1 && !s->composite_source && !workers)
+            StageFrame(s);
+        ctrl[CTRL_DIRTY_FLAG].store(1u, std::memory_order_release);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        frame_committed_ = true;
+    }
+    commit_cv_.notify_one();
+    return true;
+}
+
+std::vector<size_t> Renderer::TakeSwappedBuffers()
+{
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    std::vector<size_t> swapped;
+    swapped.swap(swapped_buffers_);
+    return swapped;
+}
+
+void Renderer::SetSwapListener(std::function<void()> listener)
+{
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    swap_listener_ = std::move(listener);
+}
+
 void Renderer::SwapAllBuffers()
 {
 
@@ -1551,7 +5310,11 @@ void Renderer::StartAsyncBufferProcessing()
 
 void Renderer::StopAsyncBufferProcessing()
 {
-    async_processing_.store(false);
+    {
+        std::lock_guard<std::mutex> lock(commit_mutex_);
+        async_processing_.store(false);
+    }
+    commit_cv_.notify_one();
     if (buffer_update_thread_.joinable())
     {
         buffer_update_thread_.join();
@@ -1562,10 +5325,27 @@ void Renderer::BufferUpdateThread()
 {
     while (async_processing_.load())
     {
-        // process buffer swaps at controlled rate (e.g., 60Hz)
-        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+        // wake on commitFrame; the timeout still picks up JS that only
+        // stores CTRL_DIRTY_FLAG itself
+        std::function<void()> listener;
+        {
+            std::unique_lock<std::mutex> lock(commit_mutex_);
+            commit_cv_.wait_for(lock, std::chrono::milliseconds(16), [this]
+                                { return frame_committed_ || !async_processing_.load(); });
+            frame_committed_ = false;
+            listener = swap_listener_;
+        }
 
         SwapAllBuffers();
+
+        // announce right after the swap, not on the next step() / commitFrame()
+        bool swapped;
+        {
+            std::lock_guard<std::mutex> lock(buffers_mutex_);
+            swapped = !swapped_buffers_.empty();
+        }
+        if (swapped && listener)
+            listener();
     }
 }
 
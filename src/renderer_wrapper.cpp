@@ -1,6 +1,8 @@
 
 #include "renderer_wrapper.h"
 #include <iostream>
+#include <cmath>
+#include <algorithm>
 #include "console_control.h"
 
 // Forward declare stb_image functions
@@ -43,6 +45,8 @@ Napi::Object RendererWrapper::Init(Napi::Env env, Napi::Object exports)
                                                            InstanceMethod("isBufferDirty", &RendererWrapper::IsBufferDirty),
                                                            InstanceMethod("getBufferData", &RendererWrapper::GetBufferData),
                                                            InstanceMethod("updateBufferData", &RendererWrapper::UpdateBufferData),
+                                                           InstanceMethod("getBufferViews", &RendererWrapper::GetBufferViews),
+                                                           InstanceMethod("getBufferGeneration", &RendererWrapper::GetBufferGeneration),
                                                            InstanceMethod("updateTextureFromBuffer", &RendererWrapper::UpdateTextureFromBuffer),
 
                                                            InstanceMethod("loadTextureFromBuffer", &RendererWrapper::LoadTextureFromBuffer),
@@ -125,6 +129,14 @@ Napi::Object RendererWrapper::Init(Napi::Env env, Napi::Object exports)
 
                                                            // migrating to zero copy
                                                            InstanceMethod("initSharedBuffers", &RendererWrapper::InitSharedBuffers),
+                                                           InstanceMethod("getControlBufferSize", &RendererWrapper::GetControlBufferSize),
+                                                           InstanceMethod("setAutoDirtyDetection", &RendererWrapper::SetAutoDirtyDetection),
+                                                           InstanceMethod("setCopyForward", &RendererWrapper::SetCopyForward),
+                                                           InstanceMethod("resizeSharedBuffers", &RendererWrapper::ResizeSharedBuffers),
+                                                           InstanceMethod("assignWorkerBands", &RendererWrapper::AssignWorkerBands),
+                                                           InstanceMethod("commitFrame", &RendererWrapper::CommitFrame),
+                                                           InstanceMethod("setCompositeLayers", &RendererWrapper::SetCompositeLayers),
+                                                           InstanceMethod("compositeLayers", &RendererWrapper::CompositeLayers),
 
                                                            // extending to support internal cpp commands
                                                            InstanceMethod("processPendingRegions", &RendererWrapper::ProcessPendingRegions),
@@ -134,6 +146,18 @@ Napi::Object RendererWrapper::Init(Napi::Env env, Napi::Object exports)
                                                            InstanceMethod("getAtlasData", &RendererWrapper::GetAtlasData),
                                                            InstanceMethod("getAtlasDataAndFree", &RendererWrapper::GetAtlasDataAndFree),
                                                            InstanceMethod("freeAtlas", &RendererWrapper::FreeAtlas),
+                                                           InstanceMethod("setAtlasCache", &RendererWrapper::SetAtlasCache),
+                                                           InstanceMethod("compileAtlas", &RendererWrapper::CompileAtlas),
+                                                           InstanceMethod("getAtlasPalette", &RendererWrapper::GetAtlasPalette),
+                                                           InstanceMethod("setAtlasBudget", &RendererWrapper::SetAtlasBudget),
+                                                           InstanceMethod("getAtlasMemoryStats", &RendererWrapper::GetAtlasMemoryStats),
+                                                           InstanceMethod("setAtlasMipmaps", &RendererWrapper::SetAtlasMipmaps),
+                                                           InstanceMethod("drawAtlasRegion", &RendererWrapper::DrawAtlasRegion),
+                                                           InstanceMethod("resizeAtlas", &RendererWrapper::ResizeAtlas),
+                                                           InstanceMethod("loadAtlasWithMetadata", &RendererWrapper::LoadAtlasWithMetadata),
+                                                           InstanceMethod("createSpriteFromAtlas", &RendererWrapper::CreateSpriteFromAtlas),
+                                                           InstanceMethod("setSpritePalette", &RendererWrapper::SetSpritePalette),
+                                                           InstanceMethod("cycleSpritePalette", &RendererWrapper::CycleSpritePalette),
                                                            InstanceMethod("createSprite", &RendererWrapper::CreateSprite),
                                                            InstanceMethod("updateSprite", &RendererWrapper::UpdateSprite),
                                                            InstanceMethod("drawSprite", &RendererWrapper::DrawSprite),
@@ -147,6 +171,32 @@ Napi::Object RendererWrapper::Init(Napi::Env env, Napi::Object exports)
                                                            InstanceMethod("drawAnimator", &RendererWrapper::DrawAnimator),
                                                            InstanceMethod("updateAnimators", &RendererWrapper::UpdateAnimators),
                                                            InstanceMethod("destroyAnimator", &RendererWrapper::DestroyAnimator),
+                                                           InstanceMethod("fillRect", &RendererWrapper::FillRect),
+                                                           InstanceMethod("clearRect", &RendererWrapper::ClearRect),
+                                                           InstanceMethod("fillGradient", &RendererWrapper::FillGradient),
+                                                           InstanceMethod("fillNoise", &RendererWrapper::FillNoise),
+                                                           InstanceMethod("createNoiseAtlas", &RendererWrapper::CreateNoiseAtlas),
+                                                           InstanceMethod("filterCanvas", &RendererWrapper::FilterCanvas),
+                                                           InstanceMethod("filterAtlas", &RendererWrapper::FilterAtlas),
+                                                           InstanceMethod("createColorGrade", &RendererWrapper::CreateColorGrade),
+                                                           InstanceMethod("freeColorGrade", &RendererWrapper::FreeColorGrade),
+                                                           InstanceMethod("applyColorGrade", &RendererWrapper::ApplyColorGrade),
+                                                           InstanceMethod("setCanvasColorGrade", &RendererWrapper::SetCanvasColorGrade),
+                                                           InstanceMethod("createPath", &RendererWrapper::CreatePath),
+                                                           InstanceMethod("destroyPath", &RendererWrapper::DestroyPath),
+                                                           InstanceMethod("drawPath", &RendererWrapper::DrawPath),
+                                                           InstanceMethod("fillPolygon", &RendererWrapper::FillPolygon),
+                                                           InstanceMethod("drawLines", &RendererWrapper::DrawLines),
+                                                           InstanceMethod("drawCircles", &RendererWrapper::DrawCircles),
+                                                           InstanceMethod("createBitmapFont", &RendererWrapper::CreateBitmapFont),
+                                                           InstanceMethod("freeBitmapFont", &RendererWrapper::FreeBitmapFont),
+                                                           InstanceMethod("measureBitmapText", &RendererWrapper::MeasureBitmapText),
+                                                           InstanceMethod("drawBitmapText", &RendererWrapper::DrawBitmapText),
+                                                           InstanceMethod("loadTrueTypeFont", &RendererWrapper::LoadTrueTypeFont),
+                                                           InstanceMethod("freeTrueTypeFont", &RendererWrapper::FreeTrueTypeFont),
+                                                           InstanceMethod("measureTrueTypeText", &RendererWrapper::MeasureTrueTypeText),
+                                                           InstanceMethod("drawTrueTypeText", &RendererWrapper::DrawTrueTypeText),
+                                                           InstanceMethod("getTrueTypeFontStats", &RendererWrapper::GetTrueTypeFontStats),
                                                            });
 
     constructor = Napi::Persistent(func);
@@ -168,7 +218,34 @@ Napi::Object RendererWrapper::Init(Napi::Env env, Napi::Object exports)
 }
 
 RendererWrapper::RendererWrapper(const Napi::CallbackInfo &info)
-    : Napi::ObjectWrap<RendererWrapper>(info), renderer_(std::make_unique<Renderer>()) {}
+    : Napi::ObjectWrap<RendererWrapper>(info), renderer_(std::make_unique<Renderer>())
+{
+    // no JS function: the call runs NotifySwappedBuffers on the JS thread.
+    // Unref'd so an idle notifier doesn't keep the process alive.
+    Napi::Env env = info.Env();
+    swapNotifier_ = Napi::ThreadSafeFunction::New(env, Napi::Function(), "tessera.swapNotify", 0, 1);
+    swapNotifier_.Unref(env);
+    renderer_->SetSwapListener([this]()
+                               { swapNotifier_.NonBlockingCall([this](Napi::Env env, Napi::Function)
+                                                               { NotifySwappedBuffers(env); }); });
+}
+
+RendererWrapper::~RendererWrapper()
+{
+    CloseSwapNotifier();
+}
+
+// no swap may reach a notifier (or a wrapper) that is going away; calls still
+// queued are dropped by the abort
+void RendererWrapper::CloseSwapNotifier()
+{
+    if (!swapNotifier_)
+        return;
+    renderer_->SetSwapListener(nullptr);
+    renderer_->StopAsyncBufferProcessing();
+    swapNotifier_.Abort();
+    swapNotifier_ = Napi::ThreadSafeFunction();
+}
 
 // sprite
 
@@ -183,7 +260,17 @@ Napi::Value RendererWrapper::LoadAtlas(const Napi::CallbackInfo &info)
     }
 
     std::string path = info[0].As<Napi::String>().Utf8Value();
-    uint32_t atlasId = renderer_->LoadAtlas(path);
+
+    // optional { indexed: true } -> 8-bit palette indices when the image has <= 256 colours
+    bool indexed = false;
+    if (info.Length() > 1 && info[1].IsObject())
+    {
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has("indexed") && options.Get("indexed").IsBoolean())
+            indexed = options.Get("indexed").As<Napi::Boolean>().Value();
+    }
+
+    uint32_t atlasId = renderer_->LoadAtlas(path, indexed);
 
     if (atlasId == 0)
     {
@@ -194,6 +281,100 @@ Napi::Value RendererWrapper::LoadAtlas(const Napi::CallbackInfo &info)
     return Napi::Number::New(env, atlasId);
 }
 
+Napi::Value RendererWrapper::LoadAtlasWithMetadata(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString())
+    {
+        Napi::TypeError::New(env, "Expected (imagePath, jsonPath, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string imagePath = info[0].As<Napi::String>().Utf8Value();
+    std::string jsonPath = info[1].As<Napi::String>().Utf8Value();
+
+    bool indexed = false;
+    if (info.Length() > 2 && info[2].IsObject())
+    {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Has("indexed") && options.Get("indexed").IsBoolean())
+            indexed = options.Get("indexed").As<Napi::Boolean>().Value();
+    }
+
+    uint32_t atlasId = renderer_->LoadAtlasWithMetadata(imagePath, jsonPath, indexed);
+    SpriteAtlas *atlas = renderer_->GetAtlas(atlasId);
+    if (!atlas)
+    {
+        Napi::Error::New(env, "Failed to load atlas with metadata: " + imagePath).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("atlasId", Napi::Number::New(env, atlasId));
+
+    // frame names, index == frame number for createSprite / updateSprite
+    Napi::Array frames = Napi::Array::New(env, atlas->frameNames.size());
+    for (uint32_t i = 0; i < atlas->frameNames.size(); i++)
+    {
+        frames.Set(i, Napi::String::New(env, atlas->frameNames[i]));
+    }
+    result.Set("frames", frames);
+
+    Napi::Array animations = Napi::Array::New(env, atlas->animations.size());
+    for (uint32_t i = 0; i < atlas->animations.size(); i++)
+    {
+        const AtlasAnimation &anim = atlas->animations[i];
+        Napi::Object animObj = Napi::Object::New(env);
+        animObj.Set("name", Napi::String::New(env, anim.name));
+        animObj.Set("fps", Napi::Number::New(env, anim.fps));
+        animObj.Set("loop", Napi::Boolean::New(env, anim.loop));
+
+        Napi::Array animFrames = Napi::Array::New(env, anim.frames.size());
+        for (uint32_t j = 0; j < anim.frames.size(); j++)
+        {
+            animFrames.Set(j, Napi::Number::New(env, anim.frames[j]));
+        }
+        animObj.Set("frames", animFrames);
+
+        // milliseconds, like the aseprite export
+        Napi::Array durations = Napi::Array::New(env, anim.durations.size());
+        for (uint32_t j = 0; j < anim.durations.size(); j++)
+        {
+            durations.Set(j, Napi::Number::New(env, anim.durations[j] * 1000.0f));
+        }
+        animObj.Set("durations", durations);
+
+        animations.Set(i, animObj);
+    }
+    result.Set("animations", animations);
+
+    return result;
+}
+
+Napi::Value RendererWrapper::CreateSpriteFromAtlas(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (atlasId, opaque?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
+    bool opaque = info.Length() > 1 && info[1].IsBoolean() ? info[1].As<Napi::Boolean>().Value() : false;
+
+    uint32_t spriteId = renderer_->CreateSpriteFromAtlas(atlasId, opaque);
+    if (spriteId == 0)
+    {
+        Napi::Error::New(env, "Failed to create sprite from atlas " + std::to_string(atlasId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, spriteId);
+}
+
 Napi::Value RendererWrapper::GetAtlasPixel(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -208,7 +389,7 @@ Napi::Value RendererWrapper::GetAtlasPixel(const Napi::CallbackInfo &info)
     uint32_t x = info[1].As<Napi::Number>().Uint32Value();
     uint32_t y = info[2].As<Napi::Number>().Uint32Value();
 
-    SpriteAtlas *atlas = renderer_->GetAtlas(atlasId);
+    SpriteAtlas *atlas = renderer_->AcquireAtlas(atlasId, false);
     if (!atlas)
     {
         Napi::Error::New(env, "Atlas not found").ThrowAsJavaScriptException();
@@ -230,7 +411,7 @@ Napi::Value RendererWrapper::IsAtlasOpaque(const Napi::CallbackInfo &info)
     }
 
     uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
-    SpriteAtlas *atlas = renderer_->GetAtlas(atlasId);
+    SpriteAtlas *atlas = renderer_->AcquireAtlas(atlasId, false);
     if (!atlas)
     {
         Napi::Error::New(env, "Atlas not found").ThrowAsJavaScriptException();
@@ -252,7 +433,7 @@ Napi::Value RendererWrapper::GetAtlasData(const Napi::CallbackInfo &info)
     }
 
     uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
-    SpriteAtlas *atlas = renderer_->GetAtlas(atlasId);
+    SpriteAtlas *atlas = renderer_->AcquireAtlas(atlasId, false);
     if (!atlas)
     {
         Napi::Error::New(env, "Atlas not found").ThrowAsJavaScriptException();
@@ -264,9 +445,9 @@ Napi::Value RendererWrapper::GetAtlasData(const Napi::CallbackInfo &info)
     result.Set("height", Napi::Number::New(env, atlas->height));
 
     // Create Uint8Array from pixel data
-    size_t dataSize = atlas->width * atlas->height * 4;
+    size_t dataSize = static_cast<size_t>(atlas->width) * atlas->height * 4;
     Napi::ArrayBuffer arrayBuffer = Napi::ArrayBuffer::New(env, dataSize);
-    memcpy(arrayBuffer.Data(), atlas->data, dataSize);
+    renderer_->CopyAtlasPixels(atlas, static_cast<uint8_t *>(arrayBuffer.Data()));
     Napi::Uint8Array uint8Array = Napi::Uint8Array::New(env, dataSize, arrayBuffer, 0);
 
     result.Set("data", uint8Array);
@@ -285,7 +466,7 @@ Napi::Value RendererWrapper::GetAtlasDataAndFree(const Napi::CallbackInfo &info)
     }
 
     uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
-    SpriteAtlas *atlas = renderer_->GetAtlas(atlasId);
+    SpriteAtlas *atlas = renderer_->AcquireAtlas(atlasId, false);
     if (!atlas)
     {
         Napi::Error::New(env, "Atlas not found").ThrowAsJavaScriptException();
@@ -297,9 +478,9 @@ Napi::Value RendererWrapper::GetAtlasDataAndFree(const Napi::CallbackInfo &info)
     result.Set("height", Napi::Number::New(env, atlas->height));
 
     // Create Uint8Array from pixel data
-    size_t dataSize = atlas->width * atlas->height * 4;
+    size_t dataSize = static_cast<size_t>(atlas->width) * atlas->height * 4;
     Napi::ArrayBuffer arrayBuffer = Napi::ArrayBuffer::New(env, dataSize);
-    memcpy(arrayBuffer.Data(), atlas->data, dataSize);
+    renderer_->CopyAtlasPixels(atlas, static_cast<uint8_t *>(arrayBuffer.Data()));
     Napi::Uint8Array uint8Array = Napi::Uint8Array::New(env, dataSize, arrayBuffer, 0);
 
     result.Set("data", uint8Array);
@@ -310,6 +491,251 @@ Napi::Value RendererWrapper::GetAtlasDataAndFree(const Napi::CallbackInfo &info)
     return result;
 }
 
+Napi::Value RendererWrapper::SetAtlasCache(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsBoolean())
+    {
+        Napi::TypeError::New(env, "Expected (enabled, cacheDir?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool enabled = info[0].As<Napi::Boolean>().Value();
+    std::string cacheDir;
+    if (info.Length() > 1 && info[1].IsString())
+        cacheDir = info[1].As<Napi::String>().Utf8Value();
+
+    renderer_->SetAtlasCache(enabled, cacheDir);
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::CompileAtlas(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString())
+    {
+        Napi::TypeError::New(env, "Expected (srcPath, dstPath, frameWidth?, frameHeight?, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string srcPath = info[0].As<Napi::String>().Utf8Value();
+    std::string dstPath = info[1].As<Napi::String>().Utf8Value();
+    uint32_t frameWidth = 0;
+    uint32_t frameHeight = 0;
+    if (info.Length() > 3 && info[2].IsNumber() && info[3].IsNumber())
+    {
+        frameWidth = info[2].As<Napi::Number>().Uint32Value();
+        frameHeight = info[3].As<Napi::Number>().Uint32Value();
+    }
+
+    bool indexed = false;
+    if (info.Length() > 4 && info[4].IsObject())
+    {
+        Napi::Object options = info[4].As<Napi::Object>();
+        if (options.Has("indexed") && options.Get("indexed").IsBoolean())
+            indexed = options.Get("indexed").As<Napi::Boolean>().Value();
+    }
+
+    if (!renderer_->CompileAtlas(srcPath, dstPath, frameWidth, frameHeight, indexed))
+    {
+        Napi::Error::New(env, "Failed to compile atlas: " + srcPath).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value RendererWrapper::SetAtlasBudget(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (budgetBytes, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // 0 disables the budget
+    double budget = info[0].As<Napi::Number>().DoubleValue();
+    uint64_t budgetBytes = budget > 0 ? static_cast<uint64_t>(budget) : 0;
+
+    // options: { async: bool, placeholder: {r,g,b,a} }
+    bool async = false;
+    Color4 placeholder(0, 0, 0, 0);
+    if (info.Length() > 1 && info[1].IsObject())
+    {
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has("async") && options.Get("async").IsBoolean())
+            async = options.Get("async").As<Napi::Boolean>().Value();
+        if (options.Has("placeholder"))
+            placeholder = ParseColor(options.Get("placeholder"), placeholder);
+    }
+
+    renderer_->SetAtlasBudget(budgetBytes, async, placeholder);
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::SetAtlasMipmaps(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBoolean())
+    {
+        Napi::TypeError::New(env, "Expected (atlasId, enabled)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
+    bool enabled = info[1].As<Napi::Boolean>().Value();
+
+    return Napi::Boolean::New(env, renderer_->SetAtlasMipmaps(atlasId, enabled));
+}
+
+// "nearest" | "bilinear" | "bicubic" | "lanczos", false on anything else
+static bool ParseResampleFilter(const Napi::Object &options, ResampleFilter &filter)
+{
+    if (!options.Has("filter") || !options.Get("filter").IsString())
+        return true;
+
+    std::string name = options.Get("filter").As<Napi::String>().Utf8Value();
+    if (name == "nearest")
+        filter = RESAMPLE_NEAREST;
+    else if (name == "bilinear")
+        filter = RESAMPLE_BILINEAR;
+    else if (name == "bicubic")
+        filter = RESAMPLE_BICUBIC;
+    else if (name == "lanczos")
+        filter = RESAMPLE_LANCZOS3;
+    else
+        return false;
+    return true;
+}
+
+// drawAtlasRegion(bufRefId, atlasId, sx, sy, sw, sh, dx, dy, dw, dh, { filter, blend, camera }?)
+// filter defaults to "bilinear"; blend false copies instead of blending;
+// camera true maps the destination rect through the buffer's camera.
+Napi::Value RendererWrapper::DrawAtlasRegion(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    bool numbers = info.Length() >= 10;
+    for (size_t i = 0; numbers && i < 10; i++)
+        numbers = info[i].IsNumber();
+    if (!numbers)
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, atlasId, sx, sy, sw, sh, dx, dy, dw, dh, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ResampleFilter filter = RESAMPLE_BILINEAR;
+    bool blend = true;
+    bool useCamera = false;
+    if (info.Length() > 10 && info[10].IsObject())
+    {
+        Napi::Object options = info[10].As<Napi::Object>();
+        if (!ParseResampleFilter(options, filter))
+        {
+            Napi::TypeError::New(env, "filter must be \"nearest\", \"bilinear\", \"bicubic\" or \"lanczos\"").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (options.Has("blend") && options.Get("blend").IsBoolean())
+            blend = options.Get("blend").As<Napi::Boolean>().Value();
+        if (options.Has("camera") && options.Get("camera").IsBoolean())
+            useCamera = options.Get("camera").As<Napi::Boolean>().Value();
+    }
+
+    auto u32 = [&](size_t i)
+    { return info[i].As<Napi::Number>().Uint32Value(); };
+    auto f32 = [&](size_t i)
+    { return info[i].As<Napi::Number>().FloatValue(); };
+
+    if (!renderer_->DrawAtlasRegion(u32(0), u32(1), u32(2), u32(3), u32(4), u32(5),
+                                    f32(6), f32(7), f32(8), f32(9), filter, blend, useCamera))
+    {
+        Napi::Error::New(env, "Invalid buffer or atlas id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// resizeAtlas(atlasId, width, height, { filter }?) -> new atlasId
+// filter defaults to "lanczos"; frame tables are scaled along
+Napi::Value RendererWrapper::ResizeAtlas(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (atlasId, width, height, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ResampleFilter filter = RESAMPLE_LANCZOS3;
+    if (info.Length() > 3 && info[3].IsObject() && !ParseResampleFilter(info[3].As<Napi::Object>(), filter))
+    {
+        Napi::TypeError::New(env, "filter must be \"nearest\", \"bilinear\", \"bicubic\" or \"lanczos\"").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t resized = renderer_->ResizeAtlas(atlasId, info[1].As<Napi::Number>().Uint32Value(),
+                                              info[2].As<Napi::Number>().Uint32Value(), filter);
+    if (resized == 0)
+    {
+        Napi::Error::New(env, "Failed to resize atlas " + std::to_string(atlasId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, resized);
+}
+
+Napi::Value RendererWrapper::GetAtlasMemoryStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+    AtlasMemoryStats stats = renderer_->GetAtlasMemoryStats();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("residentBytes", Napi::Number::New(env, static_cast<double>(stats.residentBytes)));
+    result.Set("budgetBytes", Napi::Number::New(env, static_cast<double>(stats.budgetBytes)));
+    result.Set("evictions", Napi::Number::New(env, static_cast<double>(stats.evictions)));
+    result.Set("reloads", Napi::Number::New(env, static_cast<double>(stats.reloads)));
+    result.Set("atlases", Napi::Number::New(env, stats.atlasCount));
+    result.Set("residentAtlases", Napi::Number::New(env, stats.residentCount));
+    result.Set("pendingReloads", Napi::Number::New(env, stats.pendingReloads));
+    return result;
+}
+
+Napi::Value RendererWrapper::GetAtlasPalette(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected atlasId").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
+    SpriteAtlas *atlas = renderer_->GetAtlas(atlasId);
+    if (!atlas)
+    {
+        Napi::Error::New(env, "Atlas not found").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (atlas->format != ATLAS_FORMAT_INDEXED8)
+        return env.Null();
+
+    // 256 RGBA entries, same layout setSpritePalette takes
+    size_t dataSize = ATLAS_PALETTE_SIZE * 4;
+    Napi::ArrayBuffer arrayBuffer = Napi::ArrayBuffer::New(env, dataSize);
+    memcpy(arrayBuffer.Data(), atlas->palette.data(), dataSize);
+    return Napi::Uint8Array::New(env, dataSize, arrayBuffer, 0);
+}
+
 Napi::Value RendererWrapper::FreeAtlas(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -413,6 +839,64 @@ Napi::Value RendererWrapper::DestroySprite(const Napi::CallbackInfo &info)
     return env.Undefined();
 }
 
+Napi::Value RendererWrapper::SetSpritePalette(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (spriteId, palette | null)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t spriteId = info[0].As<Napi::Number>().Uint32Value();
+
+    // null / undefined drops the override
+    if (info[1].IsNull() || info[1].IsUndefined())
+    {
+        renderer_->ResetSpritePalette(spriteId);
+        return Napi::Boolean::New(env, true);
+    }
+
+    if (!info[1].IsTypedArray())
+    {
+        Napi::TypeError::New(env, "Palette must be a typed array of RGBA bytes").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // any typed array works, it is read as packed RGBA bytes
+    Napi::TypedArray colors = info[1].As<Napi::TypedArray>();
+    const uint8_t *bytes = static_cast<const uint8_t *>(colors.ArrayBuffer().Data()) + colors.ByteOffset();
+    uint32_t count = static_cast<uint32_t>(colors.ByteLength() / 4);
+    if (count > ATLAS_PALETTE_SIZE)
+        count = ATLAS_PALETTE_SIZE;
+
+    uint32_t palette[ATLAS_PALETTE_SIZE];
+    memcpy(palette, bytes, count * 4);
+
+    bool ok = renderer_->SetSpritePalette(spriteId, palette, count);
+    return Napi::Boolean::New(env, ok);
+}
+
+Napi::Value RendererWrapper::CycleSpritePalette(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (spriteId, start, count, shift?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t spriteId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t start = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t count = info[2].As<Napi::Number>().Uint32Value();
+    int32_t shift = (info.Length() > 3 && info[3].IsNumber()) ? info[3].As<Napi::Number>().Int32Value() : 1;
+
+    bool ok = renderer_->CycleSpritePalette(spriteId, start, count, shift);
+    return Napi::Boolean::New(env, ok);
+}
+
 // anime
 
 // Animator wrappers
@@ -490,286 +974,1970 @@ Napi::Value RendererWrapper::UpdateAnimator(const Napi::CallbackInfo &info)
 
     renderer_->UpdateAnimator(animatorId, x, y, rotation, scaleX, scaleY, flipH, flipV);
 
-    return env.Undefined();
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::PlayAnimatorAnimation(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString())
+    {
+        Napi::TypeError::New(env, "Expected (animatorId, animName)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t animatorId = info[0].As<Napi::Number>().Uint32Value();
+    std::string animName = info[1].As<Napi::String>().Utf8Value();
+
+    renderer_->PlayAnimatorAnimation(animatorId, animName);
+
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::DrawAnimator(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (animatorId, bufRefId)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t animatorId = info[0].As<Napi::Number>().Uint32Value();
+    size_t bufRefId = info[1].As<Napi::Number>().Uint32Value();
+
+    renderer_->DrawAnimator(animatorId, bufRefId);
+
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::UpdateAnimators(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected deltaTime").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    float deltaTime = info[0].As<Napi::Number>().FloatValue();
+    renderer_->UpdateAnimators(deltaTime);
+
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::DestroyAnimator(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected animatorId").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t animatorId = info[0].As<Napi::Number>().Uint32Value();
+    renderer_->DestroyAnimator(animatorId);
+
+    return env.Undefined();
+}
+
+// software drawing into a buffer set's write slot, world coordinates
+
+// reads (bufRefId, x, y, w, h) from the first five arguments
+static bool GetFillArgs(const Napi::CallbackInfo &info, size_t &bufRefId, float rect[4])
+{
+    if (info.Length() < 5)
+        return false;
+    for (size_t i = 0; i < 5; i++)
+    {
+        if (!info[i].IsNumber())
+            return false;
+    }
+
+    bufRefId = info[0].As<Napi::Number>().Uint32Value();
+    for (size_t i = 0; i < 4; i++)
+        rect[i] = info[i + 1].As<Napi::Number>().FloatValue();
+    return true;
+}
+
+// fillRect(bufRefId, x, y, w, h, color): color { r, g, b, a } in 0..1, a < 1 blends
+Napi::Value RendererWrapper::FillRect(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    size_t bufRefId;
+    float rect[4];
+    if (!GetFillArgs(info, bufRefId, rect) || info.Length() < 6 || !info[5].IsObject())
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, x, y, w, h, color)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!renderer_->FillRect(bufRefId, rect[0], rect[1], rect[2], rect[3], ParseColor(info[5])))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// clearRect(bufRefId, x, y, w, h): transparent black, no blending
+Napi::Value RendererWrapper::ClearRect(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    size_t bufRefId;
+    float rect[4];
+    if (!GetFillArgs(info, bufRefId, rect))
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, x, y, w, h)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!renderer_->ClearRect(bufRefId, rect[0], rect[1], rect[2], rect[3]))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// fillGradient(bufRefId, x, y, w, h, { type, x0, y0, x1, y1, r0, r1, stops })
+// type "linear" (default, x0,y0 -> x1,y1) or "radial" (centre x0,y0, radius
+// r0 -> r1), in world space. stops: [{ offset: 0..1, color: { r, g, b, a } }]
+Napi::Value RendererWrapper::FillGradient(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    size_t bufRefId;
+    float rect[4];
+    if (!GetFillArgs(info, bufRefId, rect) || info.Length() < 6 || !info[5].IsObject())
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, x, y, w, h, gradient)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object options = info[5].As<Napi::Object>();
+    Gradient gradient;
+    if (options.Has("type") && options.Get("type").IsString())
+    {
+        std::string type = options.Get("type").As<Napi::String>().Utf8Value();
+        if (type == "radial")
+            gradient.type = GRADIENT_RADIAL;
+        else if (type != "linear")
+        {
+            Napi::TypeError::New(env, "type must be \"linear\" or \"radial\"").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    float *fields[] = {&gradient.x0, &gradient.y0, &gradient.x1, &gradient.y1, &gradient.r0, &gradient.r1};
+    const char *names[] = {"x0", "y0", "x1", "y1", "r0", "r1"};
+    for (size_t i = 0; i < 6; i++)
+    {
+        if (options.Has(names[i]) && options.Get(names[i]).IsNumber())
+            *fields[i] = options.Get(names[i]).As<Napi::Number>().FloatValue();
+    }
+
+    if (!options.Has("stops") || !options.Get("stops").IsArray())
+    {
+        Napi::TypeError::New(env, "gradient.stops must be an array").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ParseGradientStops(options.Get("stops").As<Napi::Array>(), gradient.stops);
+
+    if (!renderer_->FillGradient(bufRefId, rect[0], rect[1], rect[2], rect[3], gradient))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// [{ offset: 0..1, color: { r, g, b, a } }], entries that aren't objects are skipped
+void RendererWrapper::ParseGradientStops(const Napi::Array &array, std::vector<GradientStop> &stops)
+{
+    for (uint32_t i = 0; i < array.Length(); i++)
+    {
+        Napi::Value entry = array.Get(i);
+        if (!entry.IsObject())
+            continue;
+        Napi::Object stop = entry.As<Napi::Object>();
+        float offset = (stop.Has("offset") && stop.Get("offset").IsNumber()) ? stop.Get("offset").As<Napi::Number>().FloatValue() : 0.0f;
+        Color c = ParseColor(stop.Get("color"), Color4(0, 0, 0, 1)).ToRaylib();
+        stops.push_back({std::min(std::max(offset, 0.0f), 1.0f), c.r, c.g, c.b, c.a});
+    }
+}
+
+// { type, fractal, seed, scale, octaves, lacunarity, gain, offsetX, offsetY, time, stops }
+// type "perlin" (default) | "simplex" | "value" | "cellular";
+// fractal "fbm" (default) | "ridged" | "turbulence"; stops as in fillGradient
+bool RendererWrapper::ParseNoiseOptions(const Napi::Value &value, NoiseParams &params,
+                                        std::vector<GradientStop> &stops, std::string &error)
+{
+    if (!value.IsObject())
+        return true;
+    Napi::Object options = value.As<Napi::Object>();
+
+    if (options.Has("type") && options.Get("type").IsString())
+    {
+        std::string type = options.Get("type").As<Napi::String>().Utf8Value();
+        if (type == "perlin")
+            params.type = NOISE_PERLIN;
+        else if (type == "simplex")
+            params.type = NOISE_SIMPLEX;
+        else if (type == "value")
+            params.type = NOISE_VALUE;
+        else if (type == "cellular")
+            params.type = NOISE_CELLULAR;
+        else
+        {
+            error = "type must be \"perlin\", \"simplex\", \"value\" or \"cellular\"";
+            return false;
+        }
+    }
+
+    if (options.Has("fractal") && options.Get("fractal").IsString())
+    {
+        std::string fractal = options.Get("fractal").As<Napi::String>().Utf8Value();
+        if (fractal == "fbm")
+            params.fractal = NOISE_FBM;
+        else if (fractal == "ridged")
+            params.fractal = NOISE_RIDGED;
+        else if (fractal == "turbulence")
+            params.fractal = NOISE_TURBULENCE;
+        else
+        {
+            error = "fractal must be \"fbm\", \"ridged\" or \"turbulence\"";
+            return false;
+        }
+    }
+
+    if (options.Has("seed") && options.Get("seed").IsNumber())
+        params.seed = options.Get("seed").As<Napi::Number>().Uint32Value();
+    if (options.Has("octaves") && options.Get("octaves").IsNumber())
+        params.octaves = options.Get("octaves").As<Napi::Number>().Uint32Value();
+
+    float *fields[] = {&params.scale, &params.lacunarity, &params.gain, &params.offsetX, &params.offsetY, &params.time};
+    const char *names[] = {"scale", "lacunarity", "gain", "offsetX", "offsetY", "time"};
+    for (size_t i = 0; i < 6; i++)
+    {
+        if (options.Has(names[i]) && options.Get(names[i]).IsNumber())
+            *fields[i] = options.Get(names[i]).As<Napi::Number>().FloatValue();
+    }
+
+    if (options.Has("stops") && options.Get("stops").IsArray())
+        ParseGradientStops(options.Get("stops").As<Napi::Array>(), stops);
+    return true;
+}
+
+// fillNoise(bufRefId, x, y, w, h, options?), options as parsed above; the
+// rect is in world space, noise coordinates are its own pixels
+Napi::Value RendererWrapper::FillNoise(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    size_t bufRefId;
+    float rect[4];
+    if (!GetFillArgs(info, bufRefId, rect))
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, x, y, w, h, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    NoiseParams params;
+    std::vector<GradientStop> stops;
+    std::string error;
+    if (info.Length() > 5 && !ParseNoiseOptions(info[5], params, stops, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!renderer_->FillNoise(bufRefId, rect[0], rect[1], rect[2], rect[3], params, stops))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// createNoiseAtlas(width, height, options?) -> atlasId
+Napi::Value RendererWrapper::CreateNoiseAtlas(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (width, height, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    NoiseParams params;
+    std::vector<GradientStop> stops;
+    std::string error;
+    if (info.Length() > 2 && !ParseNoiseOptions(info[2], params, stops, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t atlasId = renderer_->CreateNoiseAtlas(info[0].As<Napi::Number>().Uint32Value(),
+                                                   info[1].As<Napi::Number>().Uint32Value(), params, stops);
+    if (atlasId == 0)
+    {
+        Napi::Error::New(env, "Failed to create noise atlas").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, atlasId);
+}
+
+// { type, radius, kernel, divisor, bias }: type "gaussian" (default),
+// "box" or "convolve"; radius is the box half width or the Gaussian's
+// standard deviation; kernel holds 9 or 25 weights, rows top to bottom
+static bool ParseImageFilter(const Napi::Value &value, ImageFilter &filter, std::string &error)
+{
+    if (!value.IsObject())
+    {
+        error = "filter must be an object";
+        return false;
+    }
+    Napi::Object options = value.As<Napi::Object>();
+
+    if (options.Has("type") && options.Get("type").IsString())
+    {
+        std::string type = options.Get("type").As<Napi::String>().Utf8Value();
+        if (type == "gaussian")
+            filter.type = FILTER_GAUSSIAN_BLUR;
+        else if (type == "box")
+            filter.type = FILTER_BOX_BLUR;
+        else if (type == "convolve")
+            filter.type = FILTER_CONVOLVE;
+        else
+        {
+            error = "filter type must be \"gaussian\", \"box\" or \"convolve\"";
+            return false;
+        }
+    }
+
+    if (options.Has("radius") && options.Get("radius").IsNumber())
+        filter.radius = options.Get("radius").As<Napi::Number>().FloatValue();
+    if (options.Has("divisor") && options.Get("divisor").IsNumber())
+        filter.divisor = options.Get("divisor").As<Napi::Number>().FloatValue();
+    if (options.Has("bias") && options.Get("bias").IsNumber())
+        filter.bias = options.Get("bias").As<Napi::Number>().FloatValue();
+
+    if (filter.type != FILTER_CONVOLVE)
+        return true;
+
+    Napi::Value kernel = options.Has("kernel") ? options.Get("kernel") : Napi::Value();
+    uint32_t length = 0;
+    if (kernel.IsArray())
+        length = kernel.As<Napi::Array>().Length();
+    else if (kernel.IsTypedArray() && kernel.As<Napi::TypedArray>().TypedArrayType() == napi_float32_array)
+        length = static_cast<uint32_t>(kernel.As<Napi::Float32Array>().ElementLength());
+    if (length != 9 && length != 25)
+    {
+        error = "kernel must hold 9 (3x3) or 25 (5x5) numbers";
+        return false;
+    }
+
+    filter.size = length == 9 ? 3 : 5;
+    for (uint32_t i = 0; i < length; i++)
+    {
+        if (kernel.IsArray())
+        {
+            Napi::Value weight = kernel.As<Napi::Array>().Get(i);
+            filter.kernel[i] = weight.IsNumber() ? weight.As<Napi::Number>().FloatValue() : 0.0f;
+        }
+        else
+        {
+            filter.kernel[i] = kernel.As<Napi::Float32Array>()[i];
+        }
+    }
+    return true;
+}
+
+// filterCanvas(bufRefId, x, y, w, h, filter, { target, x, y }?)
+// region in canvas pixels; without a destination the result replaces the
+// region, otherwise it lands at (x, y) in target (a bufRefId, default the
+// same canvas)
+Napi::Value RendererWrapper::FilterCanvas(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    bool numbers = info.Length() >= 6;
+    for (size_t i = 0; numbers && i < 5; i++)
+        numbers = info[i].IsNumber();
+    if (!numbers)
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, x, y, w, h, filter, destination?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ImageFilter filter;
+    std::string error;
+    if (!ParseImageFilter(info[5], filter, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    size_t bufRefId = info[0].As<Napi::Number>().Uint32Value();
+    int32_t x = info[1].As<Napi::Number>().Int32Value();
+    int32_t y = info[2].As<Napi::Number>().Int32Value();
+    double w = info[3].As<Napi::Number>().DoubleValue();
+    double h = info[4].As<Napi::Number>().DoubleValue();
+    if (!(w > 0.0) || !(h > 0.0))
+        return env.Undefined();
+
+    size_t target = bufRefId;
+    int32_t dstX = x;
+    int32_t dstY = y;
+    if (info.Length() > 6 && info[6].IsObject())
+    {
+        Napi::Object destination = info[6].As<Napi::Object>();
+        if (destination.Has("target") && destination.Get("target").IsNumber())
+            target = destination.Get("target").As<Napi::Number>().Uint32Value();
+        if (destination.Has("x") && destination.Get("x").IsNumber())
+            dstX = destination.Get("x").As<Napi::Number>().Int32Value();
+        if (destination.Has("y") && destination.Get("y").IsNumber())
+            dstY = destination.Get("y").As<Napi::Number>().Int32Value();
+    }
+
+    if (!renderer_->FilterCanvas(bufRefId, x, y, static_cast<uint32_t>(std::min(w, 65535.0)),
+                                 static_cast<uint32_t>(std::min(h, 65535.0)), filter, target, dstX, dstY))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// filterAtlas(atlasId, filter, { inPlace }?) -> atlasId of the result
+Napi::Value RendererWrapper::FilterAtlas(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (atlasId, filter, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ImageFilter filter;
+    std::string error;
+    if (!ParseImageFilter(info[1], filter, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool inPlace = false;
+    if (info.Length() > 2 && info[2].IsObject())
+    {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Has("inPlace") && options.Get("inPlace").IsBoolean())
+            inPlace = options.Get("inPlace").As<Napi::Boolean>().Value();
+    }
+
+    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t filtered = renderer_->FilterAtlas(atlasId, filter, inPlace);
+    if (filtered == 0)
+    {
+        Napi::Error::New(env, "Failed to filter atlas " + std::to_string(atlasId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, filtered);
+}
+
+// reads an array or Float32Array of numbers; false when value is neither
+static bool ReadFloats(const Napi::Value &value, std::vector<float> &out)
+{
+    if (value.IsTypedArray() && value.As<Napi::TypedArray>().TypedArrayType() == napi_float32_array)
+    {
+        Napi::Float32Array array = value.As<Napi::Float32Array>();
+        out.assign(array.Data(), array.Data() + array.ElementLength());
+        return true;
+    }
+    if (!value.IsArray())
+        return false;
+    Napi::Array array = value.As<Napi::Array>();
+    out.resize(array.Length());
+    for (uint32_t i = 0; i < array.Length(); i++)
+    {
+        Napi::Value v = array.Get(i);
+        out[i] = v.IsNumber() ? v.As<Napi::Number>().FloatValue() : 0.0f;
+    }
+    return true;
+}
+
+// createColorGrade({ cube } | { lut, size? } | { matrix?, saturation?, hueRotate?, sepia? }, interpolation?)
+// cube: path of a .cube file; lut: size^3 RGB triples in 0..1, red fastest
+// (size defaults to the cube root of the count); matrix: 20 numbers, rows
+// r g b a, columns r g b a offset, as feColorMatrix. saturation, hueRotate
+// (degrees) and sepia apply after the matrix, in that order. interpolation
+// "tetrahedral" (default) or "trilinear" for LUTs. Returns a gradeId.
+Napi::Value RendererWrapper::CreateColorGrade(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject())
+    {
+        Napi::TypeError::New(env, "Expected (options)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    Napi::Object options = info[0].As<Napi::Object>();
+    ColorGradeConfig config;
+
+    if (options.Has("interpolation") && options.Get("interpolation").IsString())
+    {
+        std::string interpolation = options.Get("interpolation").As<Napi::String>().Utf8Value();
+        if (interpolation == "tetrahedral")
+            config.interpolation = LUT_TETRAHEDRAL;
+        else if (interpolation == "trilinear")
+            config.interpolation = LUT_TRILINEAR;
+        else
+        {
+            Napi::TypeError::New(env, "interpolation must be \"tetrahedral\" or \"trilinear\"").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    if (options.Has("cube") && options.Get("cube").IsString())
+    {
+        config.cubePath = options.Get("cube").As<Napi::String>().Utf8Value();
+    }
+    else if (options.Has("lut"))
+    {
+        if (!ReadFloats(options.Get("lut"), config.lut))
+        {
+            Napi::TypeError::New(env, "lut must be an array or Float32Array").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (options.Has("size") && options.Get("size").IsNumber())
+            config.lutSize = options.Get("size").As<Napi::Number>().Uint32Value();
+        else
+            config.lutSize = static_cast<uint32_t>(std::lround(std::cbrt(config.lut.size() / 3.0)));
+        if (config.lutSize == 0)
+        {
+            Napi::TypeError::New(env, "lut is empty").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+    else
+    {
+        if (options.Has("matrix"))
+        {
+            std::vector<float> matrix;
+            if (!ReadFloats(options.Get("matrix"), matrix) || matrix.size() != 20)
+            {
+                Napi::TypeError::New(env, "matrix must hold 20 numbers").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            std::copy(matrix.begin(), matrix.end(), config.matrix.m);
+        }
+        if (options.Has("saturation") && options.Get("saturation").IsNumber())
+            config.matrix = MultiplyColorMatrix(SaturationColorMatrix(options.Get("saturation").As<Napi::Number>().FloatValue()), config.matrix);
+        if (options.Has("hueRotate") && options.Get("hueRotate").IsNumber())
+            config.matrix = MultiplyColorMatrix(HueRotateColorMatrix(options.Get("hueRotate").As<Napi::Number>().FloatValue()), config.matrix);
+        if (options.Has("sepia") && options.Get("sepia").IsNumber())
+            config.matrix = MultiplyColorMatrix(SepiaColorMatrix(options.Get("sepia").As<Napi::Number>().FloatValue()), config.matrix);
+    }
+
+    uint32_t gradeId = renderer_->CreateColorGrade(config);
+    if (gradeId == 0)
+    {
+        Napi::Error::New(env, "Failed to create colour grade").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, gradeId);
+}
+
+// freeColorGrade(gradeId) -> bool
+Napi::Value RendererWrapper::FreeColorGrade(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (gradeId)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Boolean::New(env, renderer_->FreeColorGrade(info[0].As<Napi::Number>().Uint32Value()));
+}
+
+// applyColorGrade(bufRefId, gradeId, x?, y?, w?, h?): grades the region (the
+// whole canvas by default) in place, in canvas pixels
+Napi::Value RendererWrapper::ApplyColorGrade(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, gradeId, x?, y?, w?, h?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int32_t x = 0, y = 0;
+    uint32_t w = UINT32_MAX, h = UINT32_MAX;
+    if (info.Length() >= 6)
+    {
+        if (!info[2].IsNumber() || !info[3].IsNumber() || !info[4].IsNumber() || !info[5].IsNumber())
+        {
+            Napi::TypeError::New(env, "Expected (bufRefId, gradeId, x, y, w, h)").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        x = info[2].As<Napi::Number>().Int32Value();
+        y = info[3].As<Napi::Number>().Int32Value();
+        w = info[4].As<Napi::Number>().Uint32Value();
+        h = info[5].As<Napi::Number>().Uint32Value();
+    }
+
+    size_t bufRefId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t gradeId = info[1].As<Napi::Number>().Uint32Value();
+    if (!renderer_->ApplyColorGrade(bufRefId, gradeId, x, y, w, h))
+    {
+        Napi::Error::New(env, "Failed to apply colour grade " + std::to_string(gradeId) + " to buffer " +
+                                  std::to_string(bufRefId))
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// setCanvasColorGrade(bufRefId, gradeId | null): grades the canvas's uploads
+// (dirty regions only) without touching its pixels; null or 0 turns it off
+Napi::Value RendererWrapper::SetCanvasColorGrade(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, gradeId | null)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    size_t bufRefId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t gradeId = info.Length() > 1 && info[1].IsNumber() ? info[1].As<Napi::Number>().Uint32Value() : 0;
+    if (!renderer_->SetCanvasColorGrade(bufRefId, gradeId))
+    {
+        Napi::Error::New(env, "Failed to set colour grade on buffer " + std::to_string(bufRefId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// createPath(commands) -> pathId. commands: Float32Array or array of
+// opcodes and coordinates: 0 moveTo x y, 1 lineTo x y, 2 quadTo cx cy x y,
+// 3 cubicTo c1x c1y c2x c2y x y, 4 close
+Napi::Value RendererWrapper::CreatePath(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    std::vector<float> commands;
+    if (info.Length() < 1 || !ReadFloats(info[0], commands))
+    {
+        Napi::TypeError::New(env, "Expected (commands: Float32Array | number[])").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t pathId = renderer_->CreatePath(commands.data(), commands.size());
+    if (pathId == 0)
+    {
+        Napi::Error::New(env, "Failed to create path").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, pathId);
+}
+
+// destroyPath(pathId) -> bool
+Napi::Value RendererWrapper::DestroyPath(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (pathId)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Boolean::New(env, renderer_->DestroyPath(info[0].As<Napi::Number>().Uint32Value()));
+}
+
+// { x, y, scale, rotation, transform, fill, stroke, width, join, cap,
+// miterLimit, rule, camera }: transform [a, b, c, d, e, f] replaces x, y,
+// scale and rotation (radians); fill / stroke are colours, fill defaults to
+// black unless only a stroke is given, null turns it off
+bool RendererWrapper::ParsePathPaint(const Napi::Value &value, PathPaint &paint, std::string &error)
+{
+    paint.fill = true;
+    paint.stroke = false;
+    if (!value.IsObject())
+        return true;
+    Napi::Object options = value.As<Napi::Object>();
+
+    auto number = [&](const char *name, float fallback)
+    {
+        return options.Has(name) && options.Get(name).IsNumber() ? options.Get(name).As<Napi::Number>().FloatValue() : fallback;
+    };
+
+    if (options.Has("transform"))
+    {
+        std::vector<float> m;
+        if (!ReadFloats(options.Get("transform"), m) || m.size() != 6)
+        {
+            error = "transform must hold 6 numbers [a, b, c, d, e, f]";
+            return false;
+        }
+        paint.transform = {m[0], m[1], m[2], m[3], m[4], m[5]};
+    }
+    else
+    {
+        float scale = number("scale", 1.0f);
+        float rotation = number("rotation", 0.0f);
+        float cs = cosf(rotation) * scale, sn = sinf(rotation) * scale;
+        paint.transform = {cs, sn, -sn, cs, number("x", 0.0f), number("y", 0.0f)};
+    }
+
+    if (options.Has("stroke") && options.Get("stroke").IsObject())
+    {
+        paint.stroke = true;
+        paint.strokeColor = ParseColor(options.Get("stroke"), paint.strokeColor);
+        paint.fill = false;
+    }
+    if (options.Has("fill"))
+    {
+        paint.fill = options.Get("fill").IsObject();
+        paint.fillColor = ParseColor(options.Get("fill"), paint.fillColor);
+    }
+
+    paint.style.width = number("width", paint.style.width);
+    paint.style.miterLimit = number("miterLimit", paint.style.miterLimit);
+    if (options.Has("join") && options.Get("join").IsString())
+    {
+        std::string join = options.Get("join").As<Napi::String>().Utf8Value();
+        if (join == "miter")
+            paint.style.join = JOIN_MITER;
+        else if (join == "round")
+            paint.style.join = JOIN_ROUND;
+        else if (join == "bevel")
+            paint.style.join = JOIN_BEVEL;
+        else
+        {
+            error = "join must be \"miter\", \"round\" or \"bevel\"";
+            return false;
+        }
+    }
+    if (options.Has("cap") && options.Get("cap").IsString())
+    {
+        std::string cap = options.Get("cap").As<Napi::String>().Utf8Value();
+        if (cap == "butt")
+            paint.style.cap = CAP_BUTT;
+        else if (cap == "round")
+            paint.style.cap = CAP_ROUND;
+        else if (cap == "square")
+            paint.style.cap = CAP_SQUARE;
+        else
+        {
+            error = "cap must be \"butt\", \"round\" or \"square\"";
+            return false;
+        }
+    }
+    if (options.Has("rule") && options.Get("rule").IsString())
+    {
+        std::string rule = options.Get("rule").As<Napi::String>().Utf8Value();
+        if (rule == "evenodd")
+            paint.rule = FILL_EVENODD;
+        else if (rule != "nonzero")
+        {
+            error = "rule must be \"nonzero\" or \"evenodd\"";
+            return false;
+        }
+    }
+    if (options.Has("camera") && options.Get("camera").IsBoolean())
+        paint.useCamera = options.Get("camera").As<Napi::Boolean>().Value();
+    return true;
+}
+
+// drawPath(bufRefId, pathId | commands, options?): a pathId draws from the
+// handle's cached masks, a command array is rasterized once, uncached
+Napi::Value RendererWrapper::DrawPath(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, pathId | commands, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    PathPaint paint;
+    std::string error;
+    if (!ParsePathPaint(info.Length() > 2 ? info[2] : env.Undefined(), paint, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    size_t bufRefId = info[0].As<Napi::Number>().Uint32Value();
+    bool drawn;
+    if (info[1].IsNumber())
+    {
+        drawn = renderer_->DrawPath(bufRefId, info[1].As<Napi::Number>().Uint32Value(), paint);
+    }
+    else
+    {
+        std::vector<float> commands;
+        if (!ReadFloats(info[1], commands))
+        {
+            Napi::TypeError::New(env, "path must be a pathId or a command array").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        drawn = renderer_->DrawPathCommands(bufRefId, commands.data(), commands.size(), paint);
+    }
+
+    if (!drawn)
+    {
+        Napi::Error::New(env, "Failed to draw path on buffer " + std::to_string(bufRefId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// fillPolygon(bufRefId, points, color, { rule, camera, contours }?)
+// points: Float32Array of x, y pairs. rule "nonzero" (default) or "evenodd";
+// camera true maps points through the buffer's camera (default: canvas
+// pixels); contours: point count of each closed contour for holes/islands.
+Napi::Value RendererWrapper::FillPolygon(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsTypedArray() || !info[2].IsObject() ||
+        info[1].As<Napi::TypedArray>().TypedArrayType() != napi_float32_array)
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, points: Float32Array, color, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Float32Array points = info[1].As<Napi::Float32Array>();
+    FillRule rule = FILL_NONZERO;
+    bool useCamera = false;
+    std::vector<uint32_t> contours;
+    if (info.Length() > 3 && info[3].IsObject())
+    {
+        Napi::Object options = info[3].As<Napi::Object>();
+        if (options.Has("rule") && options.Get("rule").IsString())
+        {
+            std::string name = options.Get("rule").As<Napi::String>().Utf8Value();
+            if (name == "evenodd")
+                rule = FILL_EVENODD;
+            else if (name != "nonzero")
+            {
+                Napi::TypeError::New(env, "rule must be \"nonzero\" or \"evenodd\"").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+        }
+        if (options.Has("camera") && options.Get("camera").IsBoolean())
+            useCamera = options.Get("camera").As<Napi::Boolean>().Value();
+        if (options.Has("contours") && options.Get("contours").IsArray())
+        {
+            Napi::Array list = options.Get("contours").As<Napi::Array>();
+            for (uint32_t i = 0; i < list.Length(); i++)
+                contours.push_back(list.Get(i).ToNumber().Uint32Value());
+        }
+    }
+
+    if (!renderer_->FillPolygon(info[0].As<Napi::Number>().Uint32Value(), points.Data(), points.ElementLength() / 2,
+                                contours, ParseColor(info[2]), rule, useCamera))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// shared by drawLines / drawCircles: (bufRefId, records: Float32Array, { camera }?)
+static bool GetStrokeArgs(const Napi::CallbackInfo &info, Napi::Float32Array &records, bool &useCamera)
+{
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsTypedArray() ||
+        info[1].As<Napi::TypedArray>().TypedArrayType() != napi_float32_array)
+        return false;
+
+    records = info[1].As<Napi::Float32Array>();
+    useCamera = false;
+    if (info.Length() > 2 && info[2].IsObject())
+    {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Has("camera") && options.Get("camera").IsBoolean())
+            useCamera = options.Get("camera").As<Napi::Boolean>().Value();
+    }
+    return true;
+}
+
+// drawLines(bufRefId, records, { camera }?)
+// records: Float32Array of x0, y0, x1, y1, thickness, r, g, b, a per line
+// (colour 0..1). Lines up to 1px are Wu lines, thicker ones round-capped.
+Napi::Value RendererWrapper::DrawLines(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Float32Array records;
+    bool useCamera;
+    if (!GetStrokeArgs(info, records, useCamera))
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, records: Float32Array, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!renderer_->DrawLines(info[0].As<Napi::Number>().Uint32Value(), records.Data(),
+                              records.ElementLength() / STROKE_LINE_FLOATS, useCamera))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// drawCircles(bufRefId, records, { camera }?)
+// records: Float32Array of cx, cy, radius, thickness, r, g, b, a per circle;
+// thickness 0 fills the disc.
+Napi::Value RendererWrapper::DrawCircles(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Float32Array records;
+    bool useCamera;
+    if (!GetStrokeArgs(info, records, useCamera))
+    {
+        Napi::TypeError::New(env, "Expected (bufRefId, records: Float32Array, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!renderer_->DrawCircles(info[0].As<Napi::Number>().Uint32Value(), records.Data(),
+                                records.ElementLength() / STROKE_CIRCLE_FLOATS, useCamera))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// createBitmapFont(atlasId, config?) -> fontId
+// config: cellsPerRow, cellsPerColumn, cellWidth, cellHeight, offsetX,
+// offsetY, charOrder, lineHeight, lineGap, charSpacing (as BitmapFont in
+// docs.md), plus advances: number[] per cell and kerning: { "AV": -2 }
+Napi::Value RendererWrapper::CreateBitmapFont(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (atlasId, config?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
+    BitmapFontConfig config;
+    if (info.Length() > 1 && info[1].IsObject())
+    {
+        Napi::Object options = info[1].As<Napi::Object>();
+        auto getUint = [&](const char *key, uint32_t &out)
+        {
+            if (options.Has(key) && options.Get(key).IsNumber())
+                out = options.Get(key).As<Napi::Number>().Uint32Value();
+        };
+        auto getFloat = [&](const char *key, float &out)
+        {
+            if (options.Has(key) && options.Get(key).IsNumber())
+                out = options.Get(key).As<Napi::Number>().FloatValue();
+        };
+
+        getUint("cellsPerRow", config.cellsPerRow);
+        getUint("cellsPerColumn", config.cellsPerColumn);
+        getUint("cellWidth", config.cellWidth);
+        getUint("cellHeight", config.cellHeight);
+        getUint("offsetX", config.offsetX);
+        getUint("offsetY", config.offsetY);
+        getFloat("lineHeight", config.lineHeight);
+        getFloat("lineGap", config.lineGap);
+        getFloat("charSpacing", config.charSpacing);
+        if (options.Has("charOrder") && options.Get("charOrder").IsString())
+            config.charOrder = options.Get("charOrder").As<Napi::String>().Utf8Value();
+
+        if (options.Has("advances") && options.Get("advances").IsArray())
+        {
+            Napi::Array list = options.Get("advances").As<Napi::Array>();
+            for (uint32_t i = 0; i < list.Length(); i++)
+                config.advances.push_back(list.Get(i).ToNumber().FloatValue());
+        }
+
+        if (options.Has("kerning") && options.Get("kerning").IsObject())
+        {
+            Napi::Object kerning = options.Get("kerning").As<Napi::Object>();
+            Napi::Array pairs = kerning.GetPropertyNames();
+            for (uint32_t i = 0; i < pairs.Length(); i++)
+            {
+                Napi::Value key = pairs.Get(i);
+                Napi::Value amount = kerning.Get(key);
+                if (amount.IsNumber())
+                    config.kerning.emplace_back(key.As<Napi::String>().Utf8Value(), amount.As<Napi::Number>().FloatValue());
+            }
+        }
+    }
+
+    uint32_t fontId = renderer_->CreateBitmapFont(atlasId, config);
+    if (fontId == 0)
+    {
+        Napi::Error::New(env, "Failed to create bitmap font from atlas " + std::to_string(atlasId)).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, fontId);
+}
+
+Napi::Value RendererWrapper::FreeBitmapFont(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (fontId)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    renderer_->FreeBitmapFont(info[0].As<Napi::Number>().Uint32Value());
+    return env.Undefined();
+}
+
+// { scale, rotation (radians), color, maxWidth, align, camera }, all optional
+bool RendererWrapper::ParseTextStyle(const Napi::Value &value, TextStyle &style, std::string &error)
+{
+    if (!value.IsObject())
+        return true;
+
+    Napi::Object options = value.As<Napi::Object>();
+    if (options.Has("scale") && options.Get("scale").IsNumber())
+        style.scale = options.Get("scale").As<Napi::Number>().FloatValue();
+    if (options.Has("rotation") && options.Get("rotation").IsNumber())
+        style.rotation = options.Get("rotation").As<Napi::Number>().FloatValue();
+    if (options.Has("maxWidth") && options.Get("maxWidth").IsNumber())
+        style.maxWidth = options.Get("maxWidth").As<Napi::Number>().FloatValue();
+    if (options.Has("camera") && options.Get("camera").IsBoolean())
+        style.useCamera = options.Get("camera").As<Napi::Boolean>().Value();
+    if (options.Has("color"))
+        style.tint = ParseColor(options.Get("color"), Color4(1, 1, 1, 1));
+    if (options.Has("align") && options.Get("align").IsString())
+    {
+        std::string align = options.Get("align").As<Napi::String>().Utf8Value();
+        if (align == "center")
+            style.align = TEXT_ALIGN_CENTER;
+        else if (align == "right")
+            style.align = TEXT_ALIGN_RIGHT;
+        else if (align != "left")
+        {
+            error = "align must be \"left\", \"center\" or \"right\"";
+            return false;
+        }
+    }
+    return true;
+}
+
+// measureBitmapText(fontId, text, { scale, maxWidth, align }?) -> { width, height, lines }
+Napi::Value RendererWrapper::MeasureBitmapText(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString())
+    {
+        Napi::TypeError::New(env, "Expected (fontId, text, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    TextStyle style;
+    std::string error;
+    if (info.Length() > 2 && !ParseTextStyle(info[2], style, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    float width, height;
+    uint32_t lines;
+    if (!renderer_->MeasureBitmapText(info[0].As<Napi::Number>().Uint32Value(), info[1].As<Napi::String>().Utf8Value(),
+                                      style, width, height, lines))
+    {
+        Napi::Error::New(env, "Invalid font id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("width", Napi::Number::New(env, width));
+    result.Set("height", Napi::Number::New(env, height));
+    result.Set("lines", Napi::Number::New(env, lines));
+    return result;
+}
+
+// drawBitmapText(fontId, bufRefId, text, x, y, { scale, rotation, color, maxWidth, align, camera }?)
+// x, y is the top-left of the text block; color tints the glyphs (0..1).
+Napi::Value RendererWrapper::DrawBitmapText(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 5 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsString() ||
+        !info[3].IsNumber() || !info[4].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (fontId, bufRefId, text, x, y, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    TextStyle style;
+    std::string error;
+    if (info.Length() > 5 && !ParseTextStyle(info[5], style, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!renderer_->DrawBitmapText(info[0].As<Napi::Number>().Uint32Value(), info[1].As<Napi::Number>().Uint32Value(),
+                                   info[2].As<Napi::String>().Utf8Value(), info[3].As<Napi::Number>().FloatValue(),
+                                   info[4].As<Napi::Number>().FloatValue(), style))
+    {
+        Napi::Error::New(env, "Invalid font or buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+// loadTrueTypeFont(path) -> fontId
+Napi::Value RendererWrapper::LoadTrueTypeFont(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::TypeError::New(env, "Expected (path)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    uint32_t fontId = renderer_->LoadTrueTypeFont(path);
+    if (fontId == 0)
+    {
+        Napi::Error::New(env, "Failed to load font: " + path).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Number::New(env, fontId);
+}
+
+Napi::Value RendererWrapper::FreeTrueTypeFont(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (fontId)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    renderer_->FreeTrueTypeFont(info[0].As<Napi::Number>().Uint32Value());
+    return env.Undefined();
+}
+
+// measureTrueTypeText(fontId, text, size, { scale, maxWidth, align }?) -> { width, height, lines }
+Napi::Value RendererWrapper::MeasureTrueTypeText(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsString() || !info[2].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (fontId, text, size, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    TextStyle style;
+    std::string error;
+    if (info.Length() > 3 && !ParseTextStyle(info[3], style, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    float width, height;
+    uint32_t lines;
+    if (!renderer_->MeasureTrueTypeText(info[0].As<Napi::Number>().Uint32Value(), info[1].As<Napi::String>().Utf8Value(),
+                                        info[2].As<Napi::Number>().FloatValue(), style, width, height, lines))
+    {
+        Napi::Error::New(env, "Invalid font id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("width", Napi::Number::New(env, width));
+    result.Set("height", Napi::Number::New(env, height));
+    result.Set("lines", Napi::Number::New(env, lines));
+    return result;
+}
+
+// drawTrueTypeText(fontId, bufRefId, text, x, y, size, { scale, color, maxWidth, align, camera }?)
+// size in pixels; x, y is the top-left of the text block.
+Napi::Value RendererWrapper::DrawTrueTypeText(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 6 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsString() ||
+        !info[3].IsNumber() || !info[4].IsNumber() || !info[5].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (fontId, bufRefId, text, x, y, size, options?)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    TextStyle style;
+    std::string error;
+    if (info.Length() > 6 && !ParseTextStyle(info[6], style, error))
+    {
+        Napi::TypeError::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!renderer_->DrawTrueTypeText(info[0].As<Napi::Number>().Uint32Value(), info[1].As<Napi::Number>().Uint32Value(),
+                                     info[2].As<Napi::String>().Utf8Value(), info[3].As<Napi::Number>().FloatValue(),
+                                     info[4].As<Napi::Number>().FloatValue(), info[5].As<Napi::Number>().FloatValue(), style))
+    {
+        Napi::Error::New(env, "Invalid font or buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::GetTrueTypeFontStats(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected (fontId)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    TrueTypeStats stats;
+    if (!renderer_->GetTrueTypeFontStats(info[0].As<Napi::Number>().Uint32Value(), stats))
+    {
+        Napi::Error::New(env, "Invalid font id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint64_t lookups = stats.hits + stats.misses;
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("hits", Napi::Number::New(env, static_cast<double>(stats.hits)));
+    result.Set("misses", Napi::Number::New(env, static_cast<double>(stats.misses)));
+    result.Set("hitRate", Napi::Number::New(env, lookups ? static_cast<double>(stats.hits) / lookups : 0.0));
+    result.Set("resets", Napi::Number::New(env, stats.resets));
+    result.Set("sizes", Napi::Number::New(env, stats.sizes));
+    result.Set("glyphs", Napi::Number::New(env, stats.glyphs));
+    result.Set("atlasBytes", Napi::Number::New(env, static_cast<double>(stats.atlasBytes)));
+    result.Set("atlasUsage", Napi::Number::New(env, stats.atlasBytes ? static_cast<double>(stats.usedPixels) / stats.atlasBytes : 0.0));
+    return result;
+}
+
+// renderer_wrapper.cpp
+
+Napi::Value RendererWrapper::CreateSpriteWithAnimations(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 4 || !info[3].IsObject())
+    {
+        Napi::TypeError::New(env, "Expected (atlasId, frameWidth, frameHeight, animations)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t frameWidth = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t frameHeight = info[2].As<Napi::Number>().Uint32Value();
+    Napi::Object animsObj = info[3].As<Napi::Object>();
+
+    bool opaque = info.Length() > 4 ? info[4].As<Napi::Boolean>().Value() : false;
+
+    // Parse animations object
+    std::vector<AnimationDef> animations;
+    Napi::Array animNames = animsObj.GetPropertyNames();
+
+    for (uint32_t i = 0; i < animNames.Length(); i++)
+    {
+        std::string animName = animNames.Get(i).As<Napi::String>().Utf8Value();
+        Napi::Object animData = animsObj.Get(animName).As<Napi::Object>();
+
+        AnimationDef def;
+        def.name = animName;
+
+        // Parse frames array
+        Napi::Array framesArray = animData.Get("frames").As<Napi::Array>();
+        for (uint32_t j = 0; j < framesArray.Length(); j++)
+        {
+            def.frames.push_back(framesArray.Get(j).As<Napi::Number>().Uint32Value());
+        }
+
+        // Parse fps and loop
+        def.fps = animData.Get("fps").As<Napi::Number>().FloatValue();
+        def.loop = animData.Get("loop").As<Napi::Boolean>().Value();
+
+        animations.push_back(def);
+    }
+
+    uint32_t spriteId = renderer_->CreateSpriteWithAnimations(atlasId, frameWidth, frameHeight,
+                                                              opaque, animations);
+
+    return Napi::Number::New(env, spriteId);
+}
+
+Napi::Value RendererWrapper::PlayAnimation(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2)
+    {
+        Napi::TypeError::New(env, "Expected (spriteId, animName)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    uint32_t spriteId = info[0].As<Napi::Number>().Uint32Value();
+    std::string animName = info[1].As<Napi::String>().Utf8Value();
+
+    renderer_->PlayAnimation(spriteId, animName);
+
+    return env.Undefined();
+}
+
+Napi::Value RendererWrapper::UpdateSpriteAnimations(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1)
+    {
+        Napi::TypeError::New(env, "Expected deltaTime").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    float deltaTime = info[0].As<Napi::Number>().FloatValue();
+    renderer_->UpdateSpriteAnimations(deltaTime);
+
+    return env.Undefined();
+}
+
+// ArrayBuffer, or a Uint8/Uint8Clamped/Uint32/Int32 view, which may sit on a
+// SharedArrayBuffer so worker_threads can draw into the same memory; shared
+// is only set for views whose buffer really is a SharedArrayBuffer
+static bool GetBufferMemory(const Napi::Value &value, uint8_t *&data, size_t &bytes, bool &shared)
+{
+    if (value.IsArrayBuffer())
+    {
+        Napi::ArrayBuffer ab = value.As<Napi::ArrayBuffer>();
+        data = static_cast<uint8_t *>(ab.Data());
+        bytes = ab.ByteLength();
+        shared = false;
+        return true;
+    }
+
+    if (!value.IsTypedArray())
+        return false;
+
+    Napi::TypedArray ta = value.As<Napi::TypedArray>();
+    switch (ta.TypedArrayType())
+    {
+    case napi_uint8_array:
+    case napi_uint8_clamped_array:
+        data = value.As<Napi::Uint8Array>().Data();
+        break;
+    case napi_uint32_array:
+        data = reinterpret_cast<uint8_t *>(value.As<Napi::Uint32Array>().Data());
+        break;
+    case napi_int32_array:
+        data = reinterpret_cast<uint8_t *>(value.As<Napi::Int32Array>().Data());
+        break;
+    default:
+        return false;
+    }
+    bytes = ta.ByteLength();
+    Napi::Value sharedCtor = value.Env().Global().Get("SharedArrayBuffer");
+    shared = sharedCtor.IsFunction() && ta.ArrayBuffer().InstanceOf(sharedCtor.As<Napi::Function>());
+    return true;
+}
+
+// migrate to shared buffer
+//
+// bufferCount (default 3) trades latency for memory: 2 slots swap on every
+// commit, 1 slot has no swap at all and commitFrame copies the dirty regions
+// into a native staging area instead. JS always draws into CTRL_JS_WRITE_IDX.
+
+Napi::Value RendererWrapper::InitSharedBuffers(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 6)
+    {
+        Napi::Error::New(env, "Need pixel0, pixel1, pixel2, control, width, height").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // optional arg 6: { dirtyTileSize, copyForward, bufferCount }
+    uint32_t tileSize = 0;
+    bool copyForward = false;
+    uint32_t slots = 3;
+    if (info.Length() > 6 && info[6].IsObject())
+    {
+        Napi::Object options = info[6].As<Napi::Object>();
+        if (options.Has("dirtyTileSize") && options.Get("dirtyTileSize").IsNumber())
+            tileSize = options.Get("dirtyTileSize").As<Napi::Number>().Uint32Value();
+        if (options.Has("copyForward") && options.Get("copyForward").IsBoolean())
+            copyForward = options.Get("copyForward").As<Napi::Boolean>().Value();
+        if (options.Has("bufferCount") && options.Get("bufferCount").IsNumber())
+            slots = options.Get("bufferCount").As<Napi::Number>().Uint32Value();
+    }
+
+    if (slots < 1 || slots > 3)
+    {
+        Napi::Error::New(env, "bufferCount must be 1, 2 or 3").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // Create new SharedBufferRefs instance
+    SharedBufferRefs *refs = new SharedBufferRefs();
+    refs->buffer_size = 0;
+    refs->control = nullptr;
+    refs->pixel_buffers[0] = refs->pixel_buffers[1] = refs->pixel_buffers[2] = nullptr;
+    refs->width = info[4].As<Napi::Number>().Uint32Value();  // set appropriately
+    refs->height = info[5].As<Napi::Number>().Uint32Value(); // set appropriately
+
+    refs->slot_count = slots;
+
+    // Pixel buffers (args 0..2) and control (arg 3): all plain ArrayBuffers, or
+    // all views over SharedArrayBuffers. Slots past bufferCount are ignored
+    // (pass null).
+    uint8_t *memory[4] = {nullptr, nullptr, nullptr, nullptr};
+    bool shared[4] = {false, false, false, false};
+    for (int i = 0; i < 4; ++i)
+    {
+        if (i < 3 && static_cast<uint32_t>(i) >= slots)
+            continue;
+        if (!GetBufferMemory(info[i], memory[i], refs->capacity[i], shared[i]) || shared[i] != shared[0])
+        {
+            delete refs;
+            Napi::TypeError::New(env, "Pixel buffers in use and the control buffer must all be ArrayBuffers, or all Uint8Array/Uint32Array views over SharedArrayBuffers")
+                .ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+    refs->shared_memory = shared[0];
+
+    size_t expected = static_cast<size_t>(refs->width) * refs->height * 4u;
+    refs->buffer_size = expected;
+    for (uint32_t i = 0; i < slots; ++i)
+    {
+        // Optional: validate expected size matches width*height*4
+        if (refs->capacity[i] != expected)
+        {
+            delete refs;
+            Napi::Error::New(env, "Pixel" + std::to_string(i) + " buffer size doesn't match expected texture size").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        refs->pixel_buffers[i] = memory[i];
+    }
+
+    size_t control_size = refs->capacity[3];
+    size_t control_needed = ::GetControlBufferSize(refs->width, refs->height, tileSize);
+    if (control_size < control_needed)
+    {
+        delete refs;
+        Napi::Error::New(env, "Control buffer must be at least " + std::to_string(control_needed) +
+                                  " bytes for dirtyTileSize " + std::to_string(tileSize))
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (reinterpret_cast<uintptr_t>(memory[3]) % alignof(std::atomic<uint32_t>) != 0)
+    {
+        delete refs;
+        Napi::Error::New(env, "Control buffer is not properly aligned for atomic access").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    refs->control = reinterpret_cast<uint32_t *>(memory[3]);
+    for (int i = 0; i < 4; ++i)
+    {
+        if (memory[i])
+            refs->refs[i] = Napi::Reference<Napi::Object>::New(info[i].As<Napi::Object>(), 1);
+    }
+    refs->copy_forward = refs->frame_damage_full = refs->prev_damage_full = copyForward;
+
+    if (!renderer_->InitControlLayout(refs, refs->capacity[3], tileSize))
+    {
+        for (int i = 0; i < 4; ++i)
+            if (!refs->refs[i].IsEmpty())
+                refs->refs[i].Reset();
+        size_t needed = ::GetControlBufferSize(refs->width, refs->height, tileSize);
+        delete refs;
+        Napi::Error::New(env, "Control buffer must be at least " + std::to_string(needed) +
+                                  " bytes for dirtyTileSize " + std::to_string(tileSize))
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // initialize control buffer state (atomic)
+    {
+        std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(refs->control);
+        // two slots: read and on-screen are the same one; one slot: all three are 0
+        ctrl[CTRL_JS_WRITE_IDX].store(0u, std::memory_order_relaxed);
+        ctrl[CTRL_CPP_READ_IDX].store(slots > 1 ? 1u : 0u, std::memory_order_relaxed);
+        ctrl[CTRL_GPU_RENDER_IDX].store(slots - 1, std::memory_order_relaxed);
+        ctrl[CTRL_DIRTY_FLAG].store(0u, std::memory_order_relaxed);
+        ctrl[CTRL_DIRTY_COUNT].store(0u, std::memory_order_relaxed);
+    }
+
+    // create raylib texture from pixel buffer 0
+    Image image;
+    image.data = refs->pixel_buffers[0]; // NOTE: raylib will NOT own this pointer
+    image.width = refs->width;
+    image.height = refs->height;
+    image.mipmaps = 1;
+    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+
+    // Create texture (make a copy into GPU memory)
+    Texture2D texture = LoadTextureFromImage(image);
+
+    Renderer::TextureId texId = renderer_->GenerateTextureId();
+    {
+        std::lock_guard<std::mutex> lock(renderer_->buffers_mutex_);
+        renderer_->textures_.emplace(texId, texture);
+
+        // store the texture id in the refs and push refs into the vector
+        refs->texture_id = texId;
+        renderer_->shared_buffers_ref.push_back(refs);
+    }
+
+    renderer_->buffers_initialized_ = true;
+
+    // return the bufferRefId = index into the vector
+    size_t bufferRefId = renderer_->shared_buffers_ref.size() - 1;
+    return Napi::Number::New(env, static_cast<double>(bufferRefId));
 }
 
-Napi::Value RendererWrapper::PlayAnimatorAnimation(const Napi::CallbackInfo &info)
+// control buffer bytes for (width, height, dirtyTileSize?); 0 or no tile size is the legacy layout
+Napi::Value RendererWrapper::GetControlBufferSize(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
 
-    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsString())
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
     {
-        Napi::TypeError::New(env, "Expected (animatorId, animName)").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (width, height, dirtyTileSize?)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    uint32_t animatorId = info[0].As<Napi::Number>().Uint32Value();
-    std::string animName = info[1].As<Napi::String>().Utf8Value();
-
-    renderer_->PlayAnimatorAnimation(animatorId, animName);
+    uint32_t width = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t height = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t tileSize = (info.Length() > 2 && info[2].IsNumber()) ? info[2].As<Napi::Number>().Uint32Value() : 0;
 
-    return env.Undefined();
+    return Napi::Number::New(env, static_cast<double>(::GetControlBufferSize(width, height, tileSize)));
 }
 
-Napi::Value RendererWrapper::DrawAnimator(const Napi::CallbackInfo &info)
+// setAutoDirtyDetection(bufferId, enabled, { tileSize }?): frames flagged dirty
+// without any marked region are diffed against the last upload instead of
+// being uploaded whole
+Napi::Value RendererWrapper::SetAutoDirtyDetection(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
 
-    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBoolean())
     {
-        Napi::TypeError::New(env, "Expected (animatorId, bufRefId)").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (bufferId, enabled, options?)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    uint32_t animatorId = info[0].As<Napi::Number>().Uint32Value();
-    size_t bufRefId = info[1].As<Napi::Number>().Uint32Value();
+    size_t bufferId = info[0].As<Napi::Number>().Uint32Value();
+    bool enabled = info[1].As<Napi::Boolean>().Value();
 
-    renderer_->DrawAnimator(animatorId, bufRefId);
+    uint32_t tileSize = DEFAULT_DIRTY_TILE_SIZE;
+    if (info.Length() > 2 && info[2].IsObject())
+    {
+        Napi::Object options = info[2].As<Napi::Object>();
+        if (options.Has("tileSize") && options.Get("tileSize").IsNumber())
+            tileSize = options.Get("tileSize").As<Napi::Number>().Uint32Value();
+    }
+
+    if (!renderer_->SetAutoDirtyDetection(bufferId, enabled, tileSize))
+    {
+        Napi::Error::New(env, "Invalid buffer id or tile size").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
     return env.Undefined();
 }
 
-Napi::Value RendererWrapper::UpdateAnimators(const Napi::CallbackInfo &info)
+// setCopyForward(bufferId, enabled): after each swap the slot handed to JS
+// receives the last two frames' damage, so dirty-rect-only drawing stays correct
+Napi::Value RendererWrapper::SetCopyForward(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
 
-    if (info.Length() < 1 || !info[0].IsNumber())
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsBoolean())
     {
-        Napi::TypeError::New(env, "Expected deltaTime").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (bufferId, enabled)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    float deltaTime = info[0].As<Napi::Number>().FloatValue();
-    renderer_->UpdateAnimators(deltaTime);
+    size_t bufferId = info[0].As<Napi::Number>().Uint32Value();
+    if (!renderer_->SetCopyForward(bufferId, info[1].As<Napi::Boolean>().Value()))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
     return env.Undefined();
 }
 
-Napi::Value RendererWrapper::DestroyAnimator(const Napi::CallbackInfo &info)
+// resizeSharedBuffers(bufferId, width, height, policy?) -> { buffers: [p0, ...bufferCount], control }
+// policy: "clear" (default), "keep" (top-left) or "scale". Buffers with enough
+// capacity are reused (returned as passed to initSharedBuffers), larger ones
+// are allocated here; JS must re-wrap its views over the returned buffers.
+Napi::Value RendererWrapper::ResizeSharedBuffers(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
 
-    if (info.Length() < 1 || !info[0].IsNumber())
+    if (info.Length() < 3 || !info[0].IsNumber() || !info[1].IsNumber() || !info[2].IsNumber())
     {
-        Napi::TypeError::New(env, "Expected animatorId").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (bufferId, width, height, policy?)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    uint32_t animatorId = info[0].As<Napi::Number>().Uint32Value();
-    renderer_->DestroyAnimator(animatorId);
+    size_t bufferId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t width = info[1].As<Napi::Number>().Uint32Value();
+    uint32_t height = info[2].As<Napi::Number>().Uint32Value();
 
-    return env.Undefined();
-}
+    BufferResizePolicy policy = RESIZE_CLEAR;
+    if (info.Length() > 3 && info[3].IsString())
+    {
+        std::string name = info[3].As<Napi::String>().Utf8Value();
+        if (name == "keep")
+            policy = RESIZE_KEEP;
+        else if (name == "scale")
+            policy = RESIZE_SCALE;
+        else if (name != "clear")
+        {
+            Napi::TypeError::New(env, "policy must be \"clear\", \"keep\" or \"scale\"").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
 
-// renderer_wrapper.cpp
+    if (bufferId >= renderer_->shared_buffers_ref.size() || !renderer_->shared_buffers_ref[bufferId] ||
+        width == 0 || height == 0)
+    {
+        Napi::Error::New(env, "Invalid buffer id or size").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
-Napi::Value RendererWrapper::CreateSpriteWithAnimations(const Napi::CallbackInfo &info)
-{
-    Napi::Env env = info.Env();
+    SharedBufferRefs *refs = renderer_->shared_buffers_ref[bufferId];
+    size_t needed = static_cast<size_t>(width) * height * 4u;
 
-    if (info.Length() < 4 || !info[3].IsObject())
+    // shrinking keeps the existing buffers, growing allocates once
+    size_t controlNeeded = ::GetControlBufferSize(width, height, refs->tile_size);
+    bool tooSmall = refs->capacity[3] < controlNeeded;
+    for (uint32_t i = 0; i < refs->slot_count; i++)
+        tooSmall = tooSmall || refs->capacity[i] < needed;
+    if (refs->shared_memory && tooSmall)
     {
-        Napi::TypeError::New(env, "Expected (atlasId, frameWidth, frameHeight, animations)").ThrowAsJavaScriptException();
+        // SharedArrayBuffers can't be created through node-api
+        Napi::Error::New(env, "Shared-memory buffer sets can only shrink; init a new set with larger SharedArrayBuffers")
+            .ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    uint32_t atlasId = info[0].As<Napi::Number>().Uint32Value();
-    uint32_t frameWidth = info[1].As<Napi::Number>().Uint32Value();
-    uint32_t frameHeight = info[2].As<Napi::Number>().Uint32Value();
-    Napi::Object animsObj = info[3].As<Napi::Object>();
-
-    bool opaque = info.Length() > 4 ? info[4].As<Napi::Boolean>().Value() : false;
+    Napi::Object buffers[4];
+    bool replaced[4] = {false, false, false, false};
+    uint8_t *pixels[3] = {nullptr, nullptr, nullptr};
+    for (uint32_t i = 0; i < refs->slot_count; i++)
+    {
+        buffers[i] = refs->refs[i].Value();
+        pixels[i] = refs->pixel_buffers[i];
+        if (refs->capacity[i] < needed)
+        {
+            Napi::ArrayBuffer grown = Napi::ArrayBuffer::New(env, needed);
+            buffers[i] = grown;
+            pixels[i] = static_cast<uint8_t *>(grown.Data());
+            replaced[i] = true;
+        }
+    }
 
-    // Parse animations object
-    std::vector<AnimationDef> animations;
-    Napi::Array animNames = animsObj.GetPropertyNames();
+    buffers[3] = refs->refs[3].Value();
+    uint32_t *control = refs->control;
+    size_t controlBytes = refs->capacity[3];
+    if (controlBytes < controlNeeded)
+    {
+        Napi::ArrayBuffer grown = Napi::ArrayBuffer::New(env, controlNeeded);
+        buffers[3] = grown;
+        control = static_cast<uint32_t *>(grown.Data());
+        controlBytes = controlNeeded;
+        replaced[3] = true;
+    }
 
-    for (uint32_t i = 0; i < animNames.Length(); i++)
+    if (!renderer_->ResizeSharedBuffers(bufferId, width, height, policy, pixels, control, controlBytes))
     {
-        std::string animName = animNames.Get(i).As<Napi::String>().Utf8Value();
-        Napi::Object animData = animsObj.Get(animName).As<Napi::Object>();
+        Napi::Error::New(env, "Failed to resize shared buffers").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
-        AnimationDef def;
-        def.name = animName;
+    if (replaced[3])
+        notifyViews_.erase(bufferId);
 
-        // Parse frames array
-        Napi::Array framesArray = animData.Get("frames").As<Napi::Array>();
-        for (uint32_t j = 0; j < framesArray.Length(); j++)
+    Napi::Array pixelArray = Napi::Array::New(env, refs->slot_count);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (replaced[i])
         {
-            def.frames.push_back(framesArray.Get(j).As<Napi::Number>().Uint32Value());
+            refs->refs[i] = Napi::Reference<Napi::Object>::New(buffers[i], 1);
+            refs->capacity[i] = i < 3 ? needed : controlBytes;
         }
-
-        // Parse fps and loop
-        def.fps = animData.Get("fps").As<Napi::Number>().FloatValue();
-        def.loop = animData.Get("loop").As<Napi::Boolean>().Value();
-
-        animations.push_back(def);
+        if (i < refs->slot_count)
+            pixelArray.Set(i, buffers[i]);
     }
 
-    uint32_t spriteId = renderer_->CreateSpriteWithAnimations(atlasId, frameWidth, frameHeight,
-                                                              opaque, animations);
-
-    return Napi::Number::New(env, spriteId);
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("buffers", pixelArray);
+    result.Set("control", buffers[3]);
+    result.Set("width", Napi::Number::New(env, width));
+    result.Set("height", Napi::Number::New(env, height));
+    return result;
 }
 
-Napi::Value RendererWrapper::PlayAnimation(const Napi::CallbackInfo &info)
+// assignWorkerBands(bufferId, count) -> [{ x, y, width, height }]
+// One band per worker (fewer if the canvas has fewer tile rows). Each worker
+// waits for CTRL_FRAME_EPOCH to change, draws into the CTRL_JS_WRITE_IDX slot
+// inside its band, marks tiles with Atomics.or and then does
+// Atomics.add(control, CTRL_WORKER_COMMITS, 1); the swap happens once all
+// bands are committed. count 0 goes back to CTRL_DIRTY_FLAG.
+Napi::Value RendererWrapper::AssignWorkerBands(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
 
-    if (info.Length() < 2)
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
     {
-        Napi::TypeError::New(env, "Expected (spriteId, animName)").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (bufferId, count)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    uint32_t spriteId = info[0].As<Napi::Number>().Uint32Value();
-    std::string animName = info[1].As<Napi::String>().Utf8Value();
+    size_t bufferId = info[0].As<Napi::Number>().Uint32Value();
+    uint32_t count = info[1].As<Napi::Number>().Uint32Value();
 
-    renderer_->PlayAnimation(spriteId, animName);
+    std::vector<DirtyRect> bands;
+    if (!renderer_->AssignWorkerBands(bufferId, count, bands))
+    {
+        Napi::Error::New(env, "Invalid buffer id, or buffer set created without dirtyTileSize").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
-    return env.Undefined();
+    Napi::Array result = Napi::Array::New(env, bands.size());
+    for (size_t i = 0; i < bands.size(); i++)
+    {
+        Napi::Object band = Napi::Object::New(env);
+        band.Set("x", Napi::Number::New(env, bands[i].x));
+        band.Set("y", Napi::Number::New(env, bands[i].y));
+        band.Set("width", Napi::Number::New(env, bands[i].width));
+        band.Set("height", Napi::Number::New(env, bands[i].height));
+        result.Set(static_cast<uint32_t>(i), band);
+    }
+    return result;
 }
 
-Napi::Value RendererWrapper::UpdateSpriteAnimations(const Napi::CallbackInfo &info)
+// commitFrame(bufferId): marks the write slot finished and wakes the swap
+// side immediately instead of waiting for its next poll
+Napi::Value RendererWrapper::CommitFrame(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
 
-    if (info.Length() < 1)
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        Napi::TypeError::New(env, "Expected deltaTime").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (bufferId)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    float deltaTime = info[0].As<Napi::Number>().FloatValue();
-    renderer_->UpdateSpriteAnimations(deltaTime);
+    if (!renderer_->CommitFrame(info[0].As<Napi::Number>().Uint32Value()))
+    {
+        Napi::Error::New(env, "Invalid buffer id").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
 
+    NotifySwappedBuffers(env);
     return env.Undefined();
 }
 
-// migrate to shared buffer
-
-Napi::Value RendererWrapper::InitSharedBuffers(const Napi::CallbackInfo &info)
+// setCompositeLayers(targetId, [{ buffer, x, y, opacity, blend, scissor, visible }])
+// Layers are listed bottom to top. opacity is 0..1, blend "normal" (default),
+// "add", "multiply" or "screen", scissor { x, y, width, height } in target
+// space. Layer buffers stop swapping on their own: JS draws into their write
+// slot and commits (or marks regions) as usual, compositeLayers picks it up.
+Napi::Value RendererWrapper::SetCompositeLayers(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
 
-    if (info.Length() < 4)
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsArray())
     {
-        Napi::Error::New(env, "Need 4 ArrayBuffers: pixel0, pixel1, pixel2, control").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (targetId, layers[])").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    // Create new SharedBufferRefs instance
-    SharedBufferRefs *refs = new SharedBufferRefs();
-    refs->buffer_size = 0;
-    refs->control = nullptr;
-    refs->pixel_buffers[0] = refs->pixel_buffers[1] = refs->pixel_buffers[2] = nullptr;
-    refs->width = info[4].As<Napi::Number>().Uint32Value();  // set appropriately
-    refs->height = info[5].As<Napi::Number>().Uint32Value(); // set appropriately
-
-    // Pixel buffers (args 0..2)
-    for (int i = 0; i < 3; ++i)
+    Napi::Array list = info[1].As<Napi::Array>();
+    std::vector<CompositeLayer> layers;
+    for (uint32_t i = 0; i < list.Length(); i++)
     {
-        if (!info[i].IsArrayBuffer())
+        Napi::Value entry = list.Get(i);
+        if (!entry.IsObject())
         {
-            delete refs;
-            Napi::Error::New(env, "Args 0-2 must be ArrayBuffers").ThrowAsJavaScriptException();
+            Napi::TypeError::New(env, "Each layer must be an object").ThrowAsJavaScriptException();
             return env.Undefined();
         }
-        Napi::ArrayBuffer pixelbuffer = info[i].As<Napi::ArrayBuffer>();
-        void *p = pixelbuffer.Data();
-        refs->pixel_buffers[i] = static_cast<uint8_t *>(p);
-        refs->refs[i] = Napi::Reference<Napi::ArrayBuffer>::New(pixelbuffer, 1);
 
-        if (i == 0)
+        Napi::Object options = entry.As<Napi::Object>();
+        if (!options.Has("buffer") || !options.Get("buffer").IsNumber())
         {
-            refs->buffer_size = pixelbuffer.ByteLength();
-            // Optional: validate expected size matches width*height*4
-            size_t expected = static_cast<size_t>(refs->width) * refs->height * 4u;
-            if (refs->buffer_size != expected)
+            Napi::TypeError::New(env, "Layer needs a numeric buffer id").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        CompositeLayer layer;
+        layer.bufRefId = options.Get("buffer").As<Napi::Number>().Uint32Value();
+        if (options.Has("x") && options.Get("x").IsNumber())
+            layer.x = options.Get("x").As<Napi::Number>().Int32Value();
+        if (options.Has("y") && options.Get("y").IsNumber())
+            layer.y = options.Get("y").As<Napi::Number>().Int32Value();
+        if (options.Has("opacity") && options.Get("opacity").IsNumber())
+        {
+            double opacity = std::min(std::max(options.Get("opacity").As<Napi::Number>().DoubleValue(), 0.0), 1.0);
+            layer.opacity = static_cast<uint32_t>(opacity * 255.0 + 0.5);
+        }
+        if (options.Has("visible") && options.Get("visible").IsBoolean())
+            layer.visible = options.Get("visible").As<Napi::Boolean>().Value();
+
+        if (options.Has("blend") && options.Get("blend").IsString())
+        {
+            std::string name = options.Get("blend").As<Napi::String>().Utf8Value();
+            if (name == "add")
+                layer.blend = BLEND_ADD;
+            else if (name == "multiply")
+                layer.blend = BLEND_MULTIPLY;
+            else if (name == "screen")
+                layer.blend = BLEND_SCREEN;
+            else if (name != "normal")
             {
-                // clean up
-                refs->refs[0].Reset();
-                delete refs;
-                Napi::Error::New(env, "Pixel0 buffer size doesn't match expected texture size").ThrowAsJavaScriptException();
+                Napi::TypeError::New(env, "blend must be \"normal\", \"add\", \"multiply\" or \"screen\"").ThrowAsJavaScriptException();
                 return env.Undefined();
             }
         }
+
+        if (options.Has("scissor") && options.Get("scissor").IsObject())
+        {
+            Napi::Object rect = options.Get("scissor").As<Napi::Object>();
+            layer.scissor = DirtyRect(rect.Get("x").ToNumber().Int32Value(), rect.Get("y").ToNumber().Int32Value(),
+                                      rect.Get("width").ToNumber().Int32Value(), rect.Get("height").ToNumber().Int32Value());
+            if (!layer.scissor.IsValid())
+                layer.visible = false; // an empty scissor clips everything
+        }
+
+        layers.push_back(layer);
     }
 
-    // control buffer (arg 3)
-    if (!info[3].IsArrayBuffer())
+    if (!renderer_->SetCompositeLayers(info[0].As<Napi::Number>().Uint32Value(), layers))
     {
-        // cleanup references we've set
-        for (int i = 0; i < 3; ++i)
-            if (!refs->refs[i].IsEmpty())
-                refs->refs[i].Reset();
-        delete refs;
-        Napi::TypeError::New(env, "Arg 3 must be an ArrayBuffer").ThrowAsJavaScriptException();
+        Napi::Error::New(env, "Invalid target or layer buffer id (layers can't be the target or another target)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    Napi::ArrayBuffer control = info[3].As<Napi::ArrayBuffer>();
-    size_t control_size = control.ByteLength();
-    if (control_size < 4156)
+    return env.Undefined();
+}
+
+// compositeLayers(targetId) -> number of rects rebuilt (0: nothing changed)
+// Blends the changed parts of all layers into the target's write slot and
+// commits it, so the target is uploaded once for the whole stack.
+Napi::Value RendererWrapper::CompositeLayers(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
     {
-        for (int i = 0; i < 3; ++i)
-            if (!refs->refs[i].IsEmpty())
-                refs->refs[i].Reset();
-        delete refs;
-        Napi::Error::New(env, "Control buffer must be at least 4156 bytes").ThrowAsJavaScriptException();
+        Napi::TypeError::New(env, "Expected (targetId)").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    void *control_ptr = control.Data();
-    if (reinterpret_cast<uintptr_t>(control_ptr) % alignof(std::atomic<uint32_t>) != 0)
+    int rects = renderer_->CompositeLayers(info[0].As<Napi::Number>().Uint32Value());
+    if (rects < 0)
     {
-        for (int i = 0; i < 3; ++i)
-            if (!refs->refs[i].IsEmpty())
-                refs->refs[i].Reset();
-        delete refs;
-        Napi::Error::New(env, "Control buffer is not properly aligned for atomic access").ThrowAsJavaScriptException();
+        Napi::Error::New(env, "Invalid target id, or no layers set for it").ThrowAsJavaScriptException();
         return env.Undefined();
     }
 
-    refs->control = static_cast<uint32_t *>(control_ptr);
-    refs->refs[3] = Napi::Reference<Napi::ArrayBuffer>::New(control, 1);
-
-    // initialize control buffer state (atomic)
-    {
-        std::atomic<uint32_t> *ctrl = reinterpret_cast<std::atomic<uint32_t> *>(refs->control);
-        ctrl[CTRL_JS_WRITE_IDX].store(0u, std::memory_order_relaxed);
-        ctrl[CTRL_CPP_READ_IDX].store(1u, std::memory_order_relaxed);
-        ctrl[CTRL_GPU_RENDER_IDX].store(2u, std::memory_order_relaxed);
-        ctrl[CTRL_DIRTY_FLAG].store(0u, std::memory_order_relaxed);
-        ctrl[CTRL_DIRTY_COUNT].store(0u, std::memory_order_relaxed);
-    }
+    return Napi::Number::New(env, rects);
+}
 
-    // create raylib texture from pixel buffer 0
-    Image image;
-    image.data = refs->pixel_buffers[0]; // NOTE: raylib will NOT own this pointer
-    image.width = refs->width;
-    image.height = refs->height;
-    image.mipmaps = 1;
-    image.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+// After a swap, wakes JS waiting with Atomics.wait/waitAsync on
+// CTRL_JS_WRITE_IDX (and CTRL_FRAME_EPOCH with the extended layout). Native
+// stores don't wake V8 waiters, so the notify is issued here on the JS thread:
+// from step() / commitFrame(), and through swapNotifier_ as soon as the async
+// swap thread has rotated a set. Only shared-memory sets can have waiters.
+void RendererWrapper::NotifySwappedBuffers(Napi::Env env)
+{
+    std::vector<size_t> swapped = renderer_->TakeSwappedBuffers();
+    if (swapped.empty())
+        return;
 
-    // Create texture (make a copy into GPU memory)
-    Texture2D texture = LoadTextureFromImage(image);
+    Napi::Object atomics = env.Global().Get("Atomics").As<Napi::Object>();
+    Napi::Function notify = atomics.Get("notify").As<Napi::Function>();
 
-    Renderer::TextureId texId = renderer_->GenerateTextureId();
+    for (size_t bufferId : swapped)
     {
-        std::lock_guard<std::mutex> lock(renderer_->buffers_mutex_);
-        renderer_->textures_.emplace(texId, texture);
-
-        // store the texture id in the refs and push refs into the vector
-        refs->texture_id = texId;
-        renderer_->shared_buffers_ref.push_back(refs);
-    }
+        if (bufferId >= renderer_->shared_buffers_ref.size())
+            continue;
+        SharedBufferRefs *refs = renderer_->shared_buffers_ref[bufferId];
+        if (!refs || !refs->shared_memory)
+            continue;
 
-    renderer_->buffers_initialized_ = true;
+        auto it = notifyViews_.find(bufferId);
+        if (it == notifyViews_.end())
+        {
+            // the control view may be a Uint32Array; Atomics.notify wants Int32Array
+            Napi::Object view = refs->refs[3].Value();
+            Napi::Function int32Array = env.Global().Get("Int32Array").As<Napi::Function>();
+            Napi::Object int32View = int32Array.New({view.Get("buffer"), view.Get("byteOffset"),
+                                                     Napi::Number::New(env, static_cast<double>(refs->capacity[3] / 4))});
+            it = notifyViews_.emplace(bufferId, Napi::Persistent(int32View)).first;
+        }
 
-    // return the bufferRefId = index into the vector
-    size_t bufferRefId = renderer_->shared_buffers_ref.size() - 1;
-    return Napi::Number::New(env, static_cast<double>(bufferRefId));
+        Napi::Object int32View = it->second.Value();
+        notify.Call(atomics, {int32View, Napi::Number::New(env, CTRL_JS_WRITE_IDX)});
+        if (refs->ext_version)
+            notify.Call(atomics, {int32View, Napi::Number::New(env, CTRL_FRAME_EPOCH)});
+    }
 }
 
 // Core lifecycle methods
@@ -802,6 +2970,7 @@ Napi::Value RendererWrapper::Shutdown(const Napi::CallbackInfo &info)
 {
     if (renderer_)
     {
+        CloseSwapNotifier();
         renderer_->Shutdown();
     }
     return info.Env().Undefined();
@@ -1213,6 +3382,7 @@ Napi::Value RendererWrapper::Step(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
     bool continuing = renderer_->Step();
+    NotifySwappedBuffers(env);
     return Napi::Boolean::New(env, continuing);
 }
 
@@ -1398,13 +3568,9 @@ Napi::Value RendererWrapper::GetBufferStats(const Napi::CallbackInfo &info)
     stats.Set("width", Napi::Number::New(env, buffer->GetWidth()));
     stats.Set("height", Napi::Number::New(env, buffer->GetHeight()));
 
-    // Calculate total dirty area
-    int total_dirty_pixels = 0;
-    for (const auto &rect : regions)
-    {
-        total_dirty_pixels += rect.Area();
-    }
-    stats.Set("dirtyPixels", Napi::Number::New(env, total_dirty_pixels));
+    // exact union area, overlaps counted once
+    int64_t total_dirty_pixels = buffer->GetDirtyArea();
+    stats.Set("dirtyPixels", Napi::Number::New(env, static_cast<double>(total_dirty_pixels)));
 
     int total_pixels = buffer->GetWidth() * buffer->GetHeight();
     float coverage = total_pixels > 0 ? static_cast<float>(total_dirty_pixels) / total_pixels : 0.0f;
@@ -1413,6 +3579,30 @@ Napi::Value RendererWrapper::GetBufferStats(const Napi::CallbackInfo &info)
     return stats;
 }
 
+// Uint8Array over SharedBuffer storage without copying. The view owns a
+// reference to the block, so it stays valid after a Resize or the buffer's
+// deletion; runtimes that forbid external buffers (electron) get a copy.
+static Napi::Value ExternalStorageView(Napi::Env env, const std::shared_ptr<std::vector<uint8_t>> &storage)
+{
+    if (storage->empty())
+        return Napi::Uint8Array::New(env, 0);
+
+    auto *hold = new std::shared_ptr<std::vector<uint8_t>>(storage);
+    Napi::ArrayBuffer arrayBuffer = Napi::ArrayBuffer::New(env, storage->data(), storage->size(),
+                                                           [hold](Napi::Env, void *)
+                                                           { delete hold; });
+    if (env.IsExceptionPending())
+    {
+        env.GetAndClearPendingException();
+        delete hold;
+        arrayBuffer = Napi::ArrayBuffer::New(env, storage->size());
+        memcpy(arrayBuffer.Data(), storage->data(), storage->size());
+    }
+
+    return Napi::Uint8Array::New(env, storage->size(), arrayBuffer, 0);
+}
+
+// zero-copy view of the read (last swapped-in) frame
 Napi::Value RendererWrapper::GetBufferData(const Napi::CallbackInfo &info)
 {
     Napi::Env env = info.Env();
@@ -1433,10 +3623,63 @@ Napi::Value RendererWrapper::GetBufferData(const Napi::CallbackInfo &info)
     }
 
     SharedBuffer *buffer = renderer_->shared_buffers_[bufferId];
+    return ExternalStorageView(env, buffer->GetReadStorage()); // read is always up to date
+}
+
+// getBufferViews(bufferId) -> { read, write, generation }
+// Draw into `write` and pass it to updateBufferData to commit without a copy.
+// Once getBufferGeneration() differs from `generation` the views have
+// traded roles (swap) or been replaced (resize) and must be fetched again.
+Napi::Value RendererWrapper::GetBufferViews(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected bufferId (number) argument").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    int bufferId = info[0].As<Napi::Number>().Int32Value();
+
+    std::lock_guard<std::mutex> lock(renderer_->buffers_mutex_);
+    if (bufferId < 0 || bufferId >= static_cast<int>(renderer_->shared_buffers_.size()))
+    {
+        Napi::Error::New(env, "Invalid buffer ID").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    SharedBuffer *buffer = renderer_->shared_buffers_[bufferId];
+
+    // generation first: if a swap sneaks in, the views look stale rather than current
+    size_t generation = buffer->GetGeneration();
+    Napi::Object views = Napi::Object::New(env);
+    views.Set("generation", Napi::Number::New(env, static_cast<double>(generation)));
+    views.Set("read", ExternalStorageView(env, buffer->GetReadStorage()));
+    views.Set("write", ExternalStorageView(env, buffer->GetWriteStorage()));
+    return views;
+}
+
+Napi::Value RendererWrapper::GetBufferGeneration(const Napi::CallbackInfo &info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::TypeError::New(env, "Expected bufferId (number) argument").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    int bufferId = info[0].As<Napi::Number>().Int32Value();
+
+    std::lock_guard<std::mutex> lock(renderer_->buffers_mutex_);
+    if (bufferId < 0 || bufferId >= static_cast<int>(renderer_->shared_buffers_.size()))
+    {
+        Napi::Error::New(env, "Invalid buffer ID").ThrowAsJavaScriptException();
+        return env.Null();
+    }
 
-    Napi::ArrayBuffer arrayBuffer = Napi::ArrayBuffer::New(env, buffer->GetSize());
-    memcpy(arrayBuffer.Data(), buffer->GetReadData(), buffer->GetSize()); // read is always up to date
-    return Napi::Uint8Array::New(env, buffer->GetSize(), arrayBuffer, 0);
+    return Napi::Number::New(env, static_cast<double>(renderer_->shared_buffers_[bufferId]->GetGeneration()));
 }
 
 Napi::Value RendererWrapper::UpdateBufferData(const Napi::CallbackInfo &info)
@@ -1490,6 +3733,19 @@ Napi::Value RendererWrapper::UpdateBufferData(const Napi::CallbackInfo &info)
 
     void *writeData = buffer->GetWriteData();
 
+    // drawn straight into the write view from getBufferViews: nothing to copy
+    if (jsData.Data() == writeData && jsData.ByteLength() == buffer->GetSize())
+    {
+        if (has_region)
+            buffer->MarkRegionDirty(region_x, region_y, region_width, region_height);
+        else
+            buffer->MarkFullyDirty();
+
+        buffer->MarkDirty();
+        buffer->UnlockWrite();
+        return env.Undefined();
+    }
+
     if (has_region)
     {
         int buffer_width = buffer->GetWidth();
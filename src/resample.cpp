@@ -0,0 +1,226 @@
+#include "resample.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RESAMPLE_SSE2 1
+#endif
+
+static const float PI = 3.14159265358979f;
+
+static float Sinc(float x)
+{
+    if (x == 0.0f)
+        return 1.0f;
+    x *= PI;
+    return std::sin(x) / x;
+}
+
+static float FilterSupport(ResampleFilter filter)
+{
+    switch (filter)
+    {
+    case RESAMPLE_BILINEAR:
+        return 1.0f;
+    case RESAMPLE_BICUBIC:
+        return 2.0f;
+    case RESAMPLE_LANCZOS3:
+        return 3.0f;
+    default:
+        return 0.5f;
+    }
+}
+
+static float FilterWeight(ResampleFilter filter, float x)
+{
+    x = std::fabs(x);
+    switch (filter)
+    {
+    case RESAMPLE_BILINEAR:
+        return x < 1.0f ? 1.0f - x : 0.0f;
+    case RESAMPLE_BICUBIC:
+    {
+        // Catmull-Rom, a = -0.5
+        const float a = -0.5f;
+        if (x < 1.0f)
+            return ((a + 2.0f) * x - (a + 3.0f)) * x * x + 1.0f;
+        if (x < 2.0f)
+            return ((a * x - 5.0f * a) * x + 8.0f * a) * x - 4.0f * a;
+        return 0.0f;
+    }
+    case RESAMPLE_LANCZOS3:
+        return x < 3.0f ? Sinc(x) * Sinc(x / 3.0f) : 0.0f;
+    default:
+        return x <= 0.5f ? 1.0f : 0.0f;
+    }
+}
+
+void BuildResampleAxis(uint32_t srcLength, uint32_t dstLength, ResampleFilter filter, ResampleAxis &axis)
+{
+    axis.first.assign(dstLength, 0);
+    axis.weights.clear();
+    axis.taps = 0;
+    if (srcLength == 0 || dstLength == 0)
+        return;
+
+    const double scale = static_cast<double>(srcLength) / dstLength;
+
+    if (filter == RESAMPLE_NEAREST)
+    {
+        axis.taps = 1;
+        axis.weights.assign(dstLength, 1.0f);
+        for (uint32_t i = 0; i < dstLength; i++)
+            axis.first[i] = std::min<int32_t>(static_cast<int32_t>((i + 0.5) * scale), static_cast<int32_t>(srcLength) - 1);
+        return;
+    }
+
+    // downscaling stretches the kernel over every source pixel it covers
+    const double filterScale = std::max(scale, 1.0);
+    const double support = FilterSupport(filter) * filterScale;
+    axis.taps = static_cast<uint32_t>(std::ceil(support)) * 2 + 1;
+    axis.weights.assign(static_cast<size_t>(dstLength) * axis.taps, 0.0f);
+
+    for (uint32_t i = 0; i < dstLength; i++)
+    {
+        double center = (i + 0.5) * scale;
+        int32_t from = std::max(static_cast<int32_t>(std::floor(center - support + 0.5)), 0);
+        int32_t to = std::min(static_cast<int32_t>(std::floor(center + support + 0.5)), static_cast<int32_t>(srcLength));
+        to = std::min(to, from + static_cast<int32_t>(axis.taps));
+        float *w = &axis.weights[static_cast<size_t>(i) * axis.taps];
+
+        // truncated at the edges, then normalised
+        float sum = 0.0f;
+        for (int32_t j = from; j < to; j++)
+        {
+            w[j - from] = FilterWeight(filter, static_cast<float>((j + 0.5 - center) / filterScale));
+            sum += w[j - from];
+        }
+        if (to <= from || sum == 0.0f)
+        {
+            from = std::min(std::max(static_cast<int32_t>(center), 0), static_cast<int32_t>(srcLength) - 1);
+            std::fill(w, w + axis.taps, 0.0f);
+            w[0] = 1.0f;
+            sum = 1.0f;
+        }
+        for (uint32_t k = 0; k < axis.taps; k++)
+            w[k] /= sum;
+        axis.first[i] = from;
+    }
+}
+
+#ifdef RESAMPLE_SSE2
+typedef __m128 Pixel4;
+static inline Pixel4 Zero4() { return _mm_setzero_ps(); }
+static inline Pixel4 Load4(const float *p) { return _mm_loadu_ps(p); }
+static inline void Store4(float *p, Pixel4 v) { _mm_storeu_ps(p, v); }
+static inline Pixel4 MulAdd4(Pixel4 acc, const float *p, float w) { return _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(p), _mm_set1_ps(w))); }
+#else
+struct Pixel4
+{
+    float v[4];
+};
+static inline Pixel4 Zero4() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+static inline Pixel4 Load4(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+static inline void Store4(float *p, Pixel4 v) { std::memcpy(p, v.v, sizeof(v.v)); }
+static inline Pixel4 MulAdd4(Pixel4 acc, const float *p, float w)
+{
+    for (int c = 0; c < 4; c++)
+        acc.v[c] += p[c] * w;
+    return acc;
+}
+#endif
+
+// source row -> premultiplied floats, count pixels from column x
+static void PremultiplyRow(const ResampleSource &src, uint32_t row, uint32_t x, uint32_t count, float *out)
+{
+    const uint8_t *line = src.data + static_cast<size_t>(src.y + row) * src.stride;
+    const uint8_t *pal = reinterpret_cast<const uint8_t *>(src.palette);
+    for (uint32_t i = 0; i < count; i++, out += 4)
+    {
+        uint32_t col = src.x + x + i;
+        const uint8_t *p = pal ? pal + line[col] * 4 : line + static_cast<size_t>(col) * 4;
+        float a = p[3] * (1.0f / 255.0f);
+        out[0] = p[0] * a;
+        out[1] = p[1] * a;
+        out[2] = p[2] * a;
+        out[3] = p[3];
+    }
+}
+
+static inline uint8_t ToByte(float v)
+{
+    return static_cast<uint8_t>(std::min(std::max(v, 0.0f), 255.0f) + 0.5f);
+}
+
+void ResampleRows(const ResampleSource &src, const ResampleAxis &ax, const ResampleAxis &ay,
+                  uint32_t colBegin, uint32_t colEnd, uint32_t rowBegin, uint32_t rowEnd, const ResampleEmit &emit)
+{
+    if (colEnd <= colBegin || rowEnd <= rowBegin || ax.taps == 0 || ay.taps == 0)
+        return;
+
+    const uint32_t cols = colEnd - colBegin;
+    // first[] never decreases, so the ends bound everything in between
+    const uint32_t srcCol0 = ax.first[colBegin];
+    const uint32_t srcCol1 = ax.first[colEnd - 1] + ax.taps; // may run past the region, padded with zeros
+    const uint32_t srcRow0 = ay.first[rowBegin];
+    const uint32_t srcRow1 = ay.first[rowEnd - 1] + ay.taps;
+
+    thread_local std::vector<float> line;
+    thread_local std::vector<float> columns; // horizontally filtered rows, cols wide
+    thread_local std::vector<uint8_t> out;
+    line.assign(static_cast<size_t>(srcCol1 - srcCol0) * 4, 0.0f);
+    columns.resize(static_cast<size_t>(srcRow1 - srcRow0) * cols * 4);
+    out.resize(static_cast<size_t>(cols) * 4);
+
+    const uint32_t readable = std::min(srcCol1, src.width) - srcCol0;
+    for (uint32_t sr = srcRow0; sr < srcRow1; sr++)
+    {
+        float *dst = &columns[static_cast<size_t>(sr - srcRow0) * cols * 4];
+        if (sr >= src.height)
+        {
+            std::fill(dst, dst + static_cast<size_t>(cols) * 4, 0.0f);
+            continue;
+        }
+
+        PremultiplyRow(src, sr, srcCol0, readable, line.data());
+        for (uint32_t c = 0; c < cols; c++)
+        {
+            uint32_t i = colBegin + c;
+            const float *w = &ax.weights[static_cast<size_t>(i) * ax.taps];
+            const float *p = &line[static_cast<size_t>(ax.first[i] - srcCol0) * 4];
+            Pixel4 acc = Zero4();
+            for (uint32_t k = 0; k < ax.taps; k++)
+                acc = MulAdd4(acc, p + k * 4, w[k]);
+            Store4(dst + c * 4, acc);
+        }
+    }
+
+    for (uint32_t r = rowBegin; r < rowEnd; r++)
+    {
+        const float *w = &ay.weights[static_cast<size_t>(r) * ay.taps];
+        const float *base = &columns[static_cast<size_t>(ay.first[r] - srcRow0) * cols * 4];
+        for (uint32_t c = 0; c < cols; c++)
+        {
+            Pixel4 acc = Zero4();
+            const float *p = base + c * 4;
+            for (uint32_t k = 0; k < ay.taps; k++, p += static_cast<size_t>(cols) * 4)
+                acc = MulAdd4(acc, p, w[k]);
+
+            float px[4];
+            Store4(px, acc);
+            uint8_t *o = &out[static_cast<size_t>(c) * 4];
+            if (px[3] < 0.5f)
+            {
+                std::memset(o, 0, 4);
+                continue;
+            }
+            float unpremultiply = 255.0f / std::min(px[3], 255.0f);
+            o[0] = ToByte(px[0] * unpremultiply);
+            o[1] = ToByte(px[1] * unpremultiply);
+            o[2] = ToByte(px[2] * unpremultiply);
+            o[3] = ToByte(px[3]);
+        }
+        emit(r, out.data());
+    }
+}
@@ -4,47 +4,241 @@
 #include "debugger.h"
 
 constexpr float FULL_DIRTY_THRESHOLD = 0.75f;
-constexpr size_t MAX_DIRTY_REGIONS = 64;
+// roughly what one texture sub-upload costs over its payload, in bytes
+constexpr size_t DEFAULT_UPLOAD_OVERHEAD = 16 * 1024;
 
-SharedBuffer::SharedBuffer(size_t size, int width, int height)
-    : data_(size), buffer_height_(height), buffer_width_(width), dirty_(false), locked_(false), buffers_{std::vector<uint8_t>(size), std::vector<uint8_t>(size)}, write_locked_(false)
-//   last_access_(std::chrono::steady_clock::now())
+// DirtyRegionSet
+
+void DirtyRegionSet::Clear()
 {
-    if (size > 0)
+    bands_.clear();
+    area_ = 0;
+}
+
+// make y a band boundary if it falls inside one
+void DirtyRegionSet::SplitAt(int y)
+{
+    auto it = bands_.upper_bound(y);
+    if (it == bands_.begin())
+        return;
+    --it;
+    if (it->first < y && y < it->second.y1)
     {
-        memset(buffers_[0].data(), 0, size);
-        memset(buffers_[1].data(), 0, size);
+        Band lower = it->second;
+        it->second.y1 = y;
+        bands_.emplace(y, std::move(lower));
     }
 }
 
-SharedBuffer::~SharedBuffer()
+// unions [x0, x1) into sorted disjoint spans, returns the newly covered width
+int DirtyRegionSet::AddSpan(std::vector<Span> &spans, int x0, int x1)
 {
-    std::lock_guard<std::mutex> lock(swap_mutex_); // <- make sure no one is writing
+    auto first = std::lower_bound(spans.begin(), spans.end(), x0,
+                                  [](const Span &s, int x)
+                                  { return s.second < x; });
+    int covered = 0;
+    auto last = first;
+    while (last != spans.end() && last->first <= x1)
+    {
+        x0 = std::min(x0, last->first);
+        x1 = std::max(x1, last->second);
+        covered += last->second - last->first;
+        ++last;
+    }
+
+    int added = (x1 - x0) - covered;
+    first = spans.erase(first, last);
+    spans.insert(first, Span(x0, x1));
+    return added;
 }
-/**
- * @deprecated in favor of double buffering
- */
-void *SharedBuffer::GetData()
+
+// joins touching bands with identical spans around [y0, y1]
+void DirtyRegionSet::Coalesce(int y0, int y1)
+{
+    auto it = bands_.lower_bound(y0);
+    if (it != bands_.begin())
+        --it;
+
+    while (it != bands_.end() && it->first <= y1)
+    {
+        auto next = std::next(it);
+        if (next != bands_.end() && it->second.y1 == next->first && it->second.spans == next->second.spans)
+        {
+            it->second.y1 = next->second.y1;
+            bands_.erase(next);
+            continue;
+        }
+        it = next;
+    }
+}
+
+void DirtyRegionSet::Add(int x, int y, int width, int height)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    const int x1 = x + width;
+    const int y1 = y + height;
+    SplitAt(y);
+    SplitAt(y1);
+
+    int cy = y;
+    auto it = bands_.lower_bound(y);
+    while (cy < y1)
+    {
+        if (it == bands_.end() || it->first >= y1 || it->first > cy)
+        {
+            // uncovered rows up to the next band
+            int gapEnd = (it == bands_.end() || it->first >= y1) ? y1 : it->first;
+            Band band;
+            band.y1 = gapEnd;
+            band.spans.emplace_back(x, x1);
+            it = std::next(bands_.emplace_hint(it, cy, std::move(band)));
+            area_ += static_cast<int64_t>(width) * (gapEnd - cy);
+            cy = gapEnd;
+            continue;
+        }
+
+        area_ += static_cast<int64_t>(AddSpan(it->second.spans, x, x1)) * (it->second.y1 - it->first);
+        cy = it->second.y1;
+        ++it;
+    }
+
+    Coalesce(y, y1);
+}
+
+std::vector<DirtyRect> DirtyRegionSet::Rects() const
+{
+    std::vector<DirtyRect> rects;
+    for (const auto &band : bands_)
+        for (const Span &span : band.second.spans)
+            rects.emplace_back(span.first, band.first, span.second - span.first, band.second.y1 - band.first);
+    return rects;
+}
+
+// Merging n rects into one bounding box saves (n - 1) uploads and costs the
+// uncovered pixels inside the box; it is taken only when that is a win.
+std::vector<DirtyRect> DirtyRegionSet::UploadRects(size_t uploadOverheadBytes, size_t bytesPerPixel) const
 {
-    // last_access_ = std::chrono::steady_clock::now();
-    return data_.data();
+    struct Pending
+    {
+        DirtyRect box;
+        int64_t covered;
+        int parts;
+    };
+
+    auto worthIt = [&](int64_t boxArea, int64_t covered, int parts)
+    {
+        return static_cast<double>(boxArea - covered) * bytesPerPixel <= static_cast<double>(uploadOverheadBytes) * (parts - 1);
+    };
+
+    std::vector<DirtyRect> out;
+    std::vector<Pending> open, next;
+
+    for (const auto &entry : bands_)
+    {
+        const int by0 = entry.first;
+        const int bh = entry.second.y1 - by0;
+
+        // horizontal pass: bridge gaps inside the band
+        std::vector<Pending> row;
+        for (const Span &span : entry.second.spans)
+        {
+            Pending piece = {DirtyRect(span.first, by0, span.second - span.first, bh),
+                             static_cast<int64_t>(span.second - span.first) * bh, 1};
+            if (!row.empty())
+            {
+                Pending &last = row.back();
+                DirtyRect box = last.box.Merge(piece.box);
+                if (worthIt(box.Area(), last.covered + piece.covered, last.parts + 1))
+                {
+                    last.box = box;
+                    last.covered += piece.covered;
+                    last.parts++;
+                    continue;
+                }
+            }
+            row.push_back(piece);
+        }
+
+        // vertical pass: extend a rect still open from the band above
+        next.clear();
+        for (Pending &piece : row)
+        {
+            bool merged = false;
+            for (Pending &above : open)
+            {
+                if (above.parts == 0)
+                    continue; // already taken by another piece of this band
+                DirtyRect box = above.box.Merge(piece.box);
+                int64_t covered = above.covered + piece.covered;
+                int parts = above.parts + piece.parts;
+                if (worthIt(static_cast<int64_t>(box.width) * box.height, covered, parts))
+                {
+                    next.push_back({box, covered, parts});
+                    above.parts = 0;
+                    merged = true;
+                    break;
+                }
+            }
+            if (!merged)
+                next.push_back(piece);
+        }
+
+        for (const Pending &above : open)
+            if (above.parts != 0)
+                out.push_back(above.box);
+        open.swap(next);
+    }
+
+    for (const Pending &above : open)
+        out.push_back(above.box);
+    return out;
 }
 
+// SharedBuffer
+
+
+SharedBuffer::SharedBuffer(size_t size, int width, int height)
+    : buffer_height_(height), buffer_width_(width), dirty_(false), locked_(false),
+      buffers_{std::make_shared<std::vector<uint8_t>>(size), std::make_shared<std::vector<uint8_t>>(size)}, write_locked_(false),
+      upload_overhead_(DEFAULT_UPLOAD_OVERHEAD)
+//   last_access_(std::chrono::steady_clock::now())
+{
+    // vectors are value-initialised, both frames start zeroed
+}
+
+SharedBuffer::~SharedBuffer()
+{
+    std::lock_guard<std::mutex> lock(swap_mutex_); // <- make sure no one is writing
+}
 void *SharedBuffer::GetReadData()
 {
     // safe to call without lock - atomic read
-    return buffers_[read_index_.load()].data();
+    return buffers_[read_index_.load()]->data();
 }
 
 void *SharedBuffer::GetWriteData()
 {
 
-    return buffers_[write_index_.load()].data();
+    return buffers_[write_index_.load()]->data();
+}
+
+std::shared_ptr<std::vector<uint8_t>> SharedBuffer::GetReadStorage()
+{
+    std::lock_guard<std::mutex> lock(swap_mutex_);
+    return buffers_[read_index_.load()];
+}
+
+std::shared_ptr<std::vector<uint8_t>> SharedBuffer::GetWriteStorage()
+{
+    std::lock_guard<std::mutex> lock(swap_mutex_);
+    return buffers_[write_index_.load()];
 }
 
 size_t SharedBuffer::GetSize() const
 {
-    return buffers_[0].size();
+    return buffers_[0]->size();
 }
 
 bool SharedBuffer::IsDirty() const
@@ -76,14 +270,21 @@ std::vector<DirtyRect> SharedBuffer::GetDirtyRegions() const
         return {};
     }
 
-    // copy of dirty regions
-    return dirty_regions_;
+    return dirty_regions_.UploadRects(upload_overhead_);
+}
+
+int64_t SharedBuffer::GetDirtyArea() const
+{
+    std::lock_guard<std::mutex> lock(dirty_mutex_);
+    if (fully_dirty_)
+        return static_cast<int64_t>(std::max(buffer_width_, 0)) * std::max(buffer_height_, 0);
+    return dirty_regions_.Area();
 }
 
 void SharedBuffer::ClearDirtyRegions()
 {
     std::lock_guard<std::mutex> lock(dirty_mutex_);
-    dirty_regions_.clear();
+    dirty_regions_.Clear();
     fully_dirty_ = false;
 }
 
@@ -127,22 +328,16 @@ void SharedBuffer::MarkRegionDirty(int x, int y, int width, int height)
         return; // Invalid region, ignore
     }
 
-    DirtyRect new_rect(x, y, width, height);
-
     std::lock_guard<std::mutex> lock(dirty_mutex_);
 
-    dirty_regions_.push_back(new_rect);
+    dirty_regions_.Add(x, y, width, height);
 
-    // optimize if we have too many regions
-    if (dirty_regions_.size() > MAX_DIRTY_REGIONS)
-    {
-        OptimizeDirtyRegions();
-    }
-
-    float coverage = CalculateDirtyCoverage();
+    // exact union area, overlapping draws don't push it up
+    float coverage = static_cast<float>(dirty_regions_.Area()) /
+                     (static_cast<float>(buffer_width_) * buffer_height_);
     if (coverage > FULL_DIRTY_THRESHOLD)
     {
-        dirty_regions_.clear();
+        dirty_regions_.Clear();
         fully_dirty_ = true;
     }
 }
@@ -150,87 +345,10 @@ void SharedBuffer::MarkRegionDirty(int x, int y, int width, int height)
 void SharedBuffer::MarkFullyDirty()
 {
     std::lock_guard<std::mutex> lock(dirty_mutex_);
-    dirty_regions_.clear();
+    dirty_regions_.Clear();
     fully_dirty_ = true;
 }
 
-void SharedBuffer::OptimizeDirtyRegions()
-{
-    if (dirty_regions_.empty())
-    {
-        return;
-    }
-
-    std::vector<DirtyRect> optimized;
-    optimized.reserve(dirty_regions_.size());
-
-    optimized.push_back(dirty_regions_[0]);
-
-    // try to merge each subsequent region
-    for (size_t i = 1; i < dirty_regions_.size(); ++i)
-    {
-        const DirtyRect &current = dirty_regions_[i];
-        bool merged = false;
-
-        for (size_t j = 0; j < optimized.size(); ++j)
-        {
-            DirtyRect &existing = optimized[j];
-
-            if (current.Overlaps(existing) || current.IsAdjacent(existing))
-            {
-                DirtyRect merged_rect = existing.Merge(current);
-
-                // Only merge if area increase is reasonable
-                // (avoid creating huge rects from small overlaps)
-                int old_area = existing.Area() + current.Area();
-                int new_area = merged_rect.Area();
-
-                // Allow up to 50% area increase from merge
-                if (new_area <= old_area * 1.5f)
-                {
-                    existing = merged_rect;
-                    merged = true;
-                    break;
-                }
-            }
-        }
-
-        if (!merged)
-        {
-            optimized.push_back(current);
-        }
-    }
-
-    dirty_regions_ = std::move(optimized);
-}
-
-float SharedBuffer::CalculateDirtyCoverage() const
-{
-
-    if (fully_dirty_ || buffer_width_ <= 0 || buffer_height_ <= 0)
-    {
-        return 1.0f;
-    }
-
-    if (dirty_regions_.empty())
-    {
-        return 0.0f;
-    }
-
-    int total_area = buffer_width_ * buffer_height_;
-
-    // Simple approach: sum all dirty areas
-    // (slight overestimation due to overlaps, but fast)
-    int dirty_area = 0;
-    for (const auto &rect : dirty_regions_)
-    {
-        dirty_area += rect.Area();
-    }
-
-    // cap at 100% to handle overlap overestimation
-    return std::min(1.0f, static_cast<float>(dirty_area) / total_area);
-}
-
 /**
  * keep checking if we can write with 100ms sleep in between if timeout > 0, basically trying to acquire a lock
  */
@@ -306,6 +424,7 @@ bool SharedBuffer::SwapBuffers()
 
     dirty_.store(false);
     swap_count_.fetch_add(1);
+    generation_.fetch_add(1);
     ClearDirtyRegions();
     return true;
 }
@@ -320,8 +439,14 @@ void SharedBuffer::Resize(size_t new_size)
         std::this_thread::sleep_for(std::chrono::microseconds(100));
     }
 
-    buffers_[0].resize(new_size);
-    buffers_[1].resize(new_size);
+    // fresh blocks: JS views over the old ones stay valid until collected
+    for (auto &buffer : buffers_)
+    {
+        auto resized = std::make_shared<std::vector<uint8_t>>(new_size);
+        memcpy(resized->data(), buffer->data(), std::min(new_size, buffer->size()));
+        buffer = std::move(resized);
+    }
+    generation_.fetch_add(1);
 
     dirty_.store(true);
 }
\ No newline at end of file
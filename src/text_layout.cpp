@@ -0,0 +1,202 @@
+#include "text_layout.h"
+#include <algorithm>
+
+// laid-out strings kept per generation
+static const size_t LAYOUT_CACHE_ENTRIES = 256;
+
+uint32_t DecodeUtf8(const std::string &text, size_t &i)
+{
+    const uint32_t invalid = 0xFFFD;
+    uint8_t lead = static_cast<uint8_t>(text[i++]);
+    if (lead < 0x80)
+        return lead;
+
+    uint32_t cp;
+    size_t extra;
+    if ((lead & 0xE0) == 0xC0)
+    {
+        cp = lead & 0x1F;
+        extra = 1;
+    }
+    else if ((lead & 0xF0) == 0xE0)
+    {
+        cp = lead & 0x0F;
+        extra = 2;
+    }
+    else if ((lead & 0xF8) == 0xF0)
+    {
+        cp = lead & 0x07;
+        extra = 3;
+    }
+    else
+    {
+        return invalid; // stray continuation byte
+    }
+
+    for (size_t k = 0; k < extra; k++)
+    {
+        if (i >= text.size() || (static_cast<uint8_t>(text[i]) & 0xC0) != 0x80)
+            return invalid; // truncated, resume at the offending byte
+        cp = (cp << 6) | (static_cast<uint8_t>(text[i++]) & 0x3F);
+    }
+    return cp;
+}
+
+void LayoutText(const std::string &text, float maxWidth, TextAlign align, const TextMetrics &metrics,
+                const GlyphLookup &lookup, const KerningLookup &kerning, TextLayout &out)
+{
+    struct Line
+    {
+        size_t begin, end;
+        float width;
+    };
+    std::vector<Line> lines;
+
+    const float lineAdvance = metrics.lineHeight + metrics.lineGap;
+    float penX = 0.0f;
+    float y = 0.0f;
+    float lineWidth = 0.0f; // right edge of the last glyph, trailing spaces excluded
+    size_t lineBegin = 0;
+    bool havePrev = false;
+    uint32_t prev = 0;
+
+    // last space on the line: wrapping moves everything after it down
+    bool haveBreak = false;
+    size_t breakGlyph = 0;
+    float breakPen = 0.0f;
+    float breakWidth = 0.0f;
+
+    auto newLine = [&](size_t end, float width)
+    {
+        lines.push_back({lineBegin, end, width});
+        lineBegin = end;
+        y += lineAdvance;
+        haveBreak = false;
+        havePrev = false;
+    };
+
+    size_t i = 0;
+    while (i < text.size())
+    {
+        uint32_t cp = DecodeUtf8(text, i);
+        if (cp == '\r')
+            continue;
+        if (cp == '\n')
+        {
+            newLine(out.glyphs.size(), lineWidth);
+            penX = 0.0f;
+            lineWidth = 0.0f;
+            continue;
+        }
+        if (cp == ' ' || cp == '\t')
+        {
+            breakWidth = lineWidth;
+            penX += cp == '\t' ? metrics.spaceAdvance * 4.0f : metrics.spaceAdvance;
+            haveBreak = true;
+            breakGlyph = out.glyphs.size();
+            breakPen = penX;
+            havePrev = false;
+            continue;
+        }
+
+        GlyphMetrics glyph;
+        if (!lookup(cp, glyph))
+        {
+            penX += metrics.spaceAdvance;
+            havePrev = false;
+            continue;
+        }
+
+        float kern = havePrev && kerning ? kerning(prev, glyph.glyph) : 0.0f;
+        if (maxWidth > 0.0f && penX + kern + glyph.advance > maxWidth)
+        {
+            if (haveBreak && breakGlyph > lineBegin)
+            {
+                // word wrap: the current word moves to the next line
+                size_t moved = breakGlyph;
+                float shift = breakPen;
+                newLine(moved, breakWidth);
+                for (size_t k = moved; k < out.glyphs.size(); k++)
+                {
+                    out.glyphs[k].x -= shift;
+                    out.glyphs[k].y = y;
+                }
+                penX -= shift;
+                lineWidth = penX;
+                kern = 0.0f;
+            }
+            else if (out.glyphs.size() > lineBegin)
+            {
+                // a single word wider than the box breaks between characters
+                newLine(out.glyphs.size(), lineWidth);
+                penX = 0.0f;
+                lineWidth = 0.0f;
+                kern = 0.0f;
+            }
+        }
+
+        penX += kern;
+        out.glyphs.push_back({glyph.glyph, penX, y});
+        penX += glyph.advance;
+        lineWidth = penX;
+        prev = glyph.glyph;
+        havePrev = true;
+    }
+    lines.push_back({lineBegin, out.glyphs.size(), lineWidth});
+
+    out.lines = static_cast<uint32_t>(lines.size());
+    out.width = 0.0f;
+    for (const Line &line : lines)
+        out.width = std::max(out.width, line.width);
+    out.height = text.empty() ? 0.0f : out.lines * metrics.lineHeight + (out.lines - 1) * metrics.lineGap;
+
+    if (align == TEXT_ALIGN_LEFT)
+        return;
+
+    float box = maxWidth > 0.0f ? maxWidth : out.width;
+    for (const Line &line : lines)
+    {
+        float offset = box - line.width;
+        if (align == TEXT_ALIGN_CENTER)
+            offset *= 0.5f;
+        for (size_t k = line.begin; k < line.end; k++)
+            out.glyphs[k].x += offset;
+    }
+}
+
+const TextLayout &TextLayoutCache::Get(const std::string &text, float maxWidth, TextAlign align, const Compute &compute)
+{
+    std::string key = text;
+    key.push_back('\0');
+    key.append(reinterpret_cast<const char *>(&maxWidth), sizeof(maxWidth));
+    key.push_back(static_cast<char>(align));
+
+    auto it = layouts_.find(key);
+    if (it != layouts_.end())
+        return it->second;
+
+    TextLayout layout;
+    auto old = old_layouts_.find(key);
+    if (old != old_layouts_.end())
+    {
+        layout = std::move(old->second);
+        old_layouts_.erase(old);
+    }
+    else
+    {
+        compute(layout);
+    }
+
+    if (layouts_.size() >= LAYOUT_CACHE_ENTRIES)
+    {
+        old_layouts_ = std::move(layouts_);
+        layouts_.clear();
+    }
+    return layouts_.emplace(std::move(key), std::move(layout)).first->second;
+}
+
+void TextLayoutCache::Clear()
+{
+    layouts_.clear();
+    old_layouts_.clear();
+}
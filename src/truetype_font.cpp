@@ -0,0 +1,212 @@
+#include "truetype_font.h"
+#include "raylib.h"
+#include <algorithm>
+#include <cstring>
+
+// glyphs are packed with this much empty space around them
+static const uint32_t GLYPH_PADDING = 1;
+
+static uint32_t NextPow2(uint32_t v)
+{
+    uint32_t p = 1;
+    while (p < v)
+        p <<= 1;
+    return p;
+}
+
+bool TrueTypeFont::Load(std::vector<unsigned char> data, std::string &error)
+{
+    if (data.empty())
+    {
+        error = "empty font file";
+        return false;
+    }
+
+    // raylib rasterizes through its bundled stb_truetype; a probe glyph
+    // tells us whether the data parses at all
+    int probe = 'A';
+    GlyphInfo *info = LoadFontData(data.data(), static_cast<int>(data.size()), 16, &probe, 1, FONT_DEFAULT);
+    if (!info)
+    {
+        error = "not a TrueType / OpenType font";
+        return false;
+    }
+    UnloadFontData(info, 1);
+
+    data_ = std::move(data);
+    sizes_.clear();
+    return true;
+}
+
+TrueTypeFont::SizeCache *TrueTypeFont::Size(uint32_t pixelSize)
+{
+    if (pixelSize == 0 || pixelSize > TRUETYPE_MAX_SIZE || data_.empty())
+        return nullptr;
+
+    auto it = sizes_.find(pixelSize);
+    if (it != sizes_.end())
+        return it->second.get();
+
+    std::unique_ptr<SizeCache> cache(new SizeCache());
+    cache->pixelSize = pixelSize;
+    // room for a line of text per shelf; height doubles on demand
+    cache->width = std::min<uint32_t>(std::max<uint32_t>(NextPow2(pixelSize * 16), 256), TRUETYPE_ATLAS_MAX_SIDE);
+    cache->height = std::min<uint32_t>(std::max<uint32_t>(NextPow2(pixelSize * 2), 64), TRUETYPE_ATLAS_MAX_SIDE);
+    cache->coverage.assign(static_cast<size_t>(cache->width) * cache->height, 0);
+
+    int space = ' ';
+    GlyphInfo *info = LoadFontData(data_.data(), static_cast<int>(data_.size()), static_cast<int>(pixelSize), &space, 1, FONT_DEFAULT);
+    cache->spaceAdvance = info ? static_cast<float>(info[0].advanceX) : pixelSize * 0.25f;
+    if (info)
+        UnloadFontData(info, 1);
+
+    SizeCache *result = cache.get();
+    sizes_.emplace(pixelSize, std::move(cache));
+    return result;
+}
+
+void TrueTypeFont::Reset(SizeCache &cache)
+{
+    // packed rects are overwritten in full and padding is never written,
+    // so the old coverage can stay
+    cache.glyphs.clear();
+    cache.shelfX = 0;
+    cache.shelfY = 0;
+    cache.shelfHeight = 0;
+    cache.usedPixels = 0;
+    resets_++;
+}
+
+// shelf packing: left to right, a new shelf when the row is full
+bool TrueTypeFont::Pack(SizeCache &cache, uint32_t w, uint32_t h, uint32_t &x, uint32_t &y)
+{
+    const uint32_t pw = w + GLYPH_PADDING;
+    const uint32_t ph = h + GLYPH_PADDING;
+    if (pw > cache.width || ph > TRUETYPE_ATLAS_MAX_SIDE)
+        return false;
+
+    if (cache.shelfX + pw > cache.width)
+    {
+        cache.shelfY += cache.shelfHeight;
+        cache.shelfX = 0;
+        cache.shelfHeight = 0;
+    }
+
+    while (cache.shelfY + ph > cache.height)
+    {
+        if (cache.height >= TRUETYPE_ATLAS_MAX_SIDE)
+        {
+            Reset(cache);
+            continue;
+        }
+        cache.height = std::min<uint32_t>(cache.height * 2, TRUETYPE_ATLAS_MAX_SIDE);
+        cache.coverage.resize(static_cast<size_t>(cache.width) * cache.height, 0);
+    }
+
+    x = cache.shelfX;
+    y = cache.shelfY;
+    cache.shelfX += pw;
+    cache.shelfHeight = std::max(cache.shelfHeight, ph);
+    cache.usedPixels += static_cast<uint64_t>(w) * h;
+    return true;
+}
+
+const TrueTypeGlyph *TrueTypeFont::Glyph(uint32_t pixelSize, uint32_t codepoint)
+{
+    SizeCache *cache = Size(pixelSize);
+    if (!cache)
+        return nullptr;
+
+    auto it = cache->glyphs.find(codepoint);
+    if (it != cache->glyphs.end())
+    {
+        hits_++;
+        return &it->second;
+    }
+    if (cache->missing.count(codepoint))
+    {
+        hits_++;
+        return nullptr;
+    }
+
+    misses_++;
+    int cp = static_cast<int>(codepoint);
+    GlyphInfo *info = LoadFontData(data_.data(), static_cast<int>(data_.size()), static_cast<int>(pixelSize), &cp, 1, FONT_DEFAULT);
+    if (!info)
+    {
+        cache->missing.insert(codepoint);
+        return nullptr;
+    }
+
+    TrueTypeGlyph glyph = {};
+    glyph.offsetX = static_cast<int16_t>(info[0].offsetX);
+    glyph.offsetY = static_cast<int16_t>(info[0].offsetY);
+    glyph.advance = static_cast<float>(info[0].advanceX);
+
+    const Image &image = info[0].image;
+    uint32_t x, y;
+    if (image.data && image.width > 0 && image.height > 0 && image.format == PIXELFORMAT_UNCOMPRESSED_GRAYSCALE &&
+        Pack(*cache, image.width, image.height, x, y))
+    {
+        const uint8_t *src = static_cast<const uint8_t *>(image.data);
+        for (int row = 0; row < image.height; row++)
+            std::memcpy(&cache->coverage[static_cast<size_t>(y + row) * cache->width + x], src + static_cast<size_t>(row) * image.width, image.width);
+        glyph.x = static_cast<uint16_t>(x);
+        glyph.y = static_cast<uint16_t>(y);
+        glyph.w = static_cast<uint16_t>(image.width);
+        glyph.h = static_cast<uint16_t>(image.height);
+    }
+    UnloadFontData(info, 1);
+
+    return &(cache->glyphs[codepoint] = glyph);
+}
+
+const uint8_t *TrueTypeFont::Coverage(uint32_t pixelSize, uint32_t &stride) const
+{
+    auto it = sizes_.find(pixelSize);
+    if (it == sizes_.end())
+        return nullptr;
+    stride = it->second->width;
+    return it->second->coverage.data();
+}
+
+const TextLayout &TrueTypeFont::Layout(uint32_t pixelSize, const std::string &text, float maxWidth, TextAlign align)
+{
+    static const TextLayout empty;
+    SizeCache *cache = Size(pixelSize);
+    if (!cache)
+        return empty;
+    if (maxWidth < 0.0f)
+        maxWidth = 0.0f;
+
+    return cache->layouts.Get(text, maxWidth, align, [&](TextLayout &out)
+                              {
+                                  TextMetrics metrics = {static_cast<float>(pixelSize), 0.0f, cache->spaceAdvance};
+                                  auto lookup = [&](uint32_t cp, GlyphMetrics &glyph)
+                                  {
+                                      const TrueTypeGlyph *g = Glyph(pixelSize, cp);
+                                      if (!g)
+                                          return false;
+                                      glyph = {cp, g->advance};
+                                      return true;
+                                  };
+                                  // raylib doesn't expose the kerning table
+                                  LayoutText(text, maxWidth, align, metrics, lookup, KerningLookup(), out); });
+}
+
+TrueTypeStats TrueTypeFont::Stats() const
+{
+    TrueTypeStats stats = {};
+    stats.hits = hits_;
+    stats.misses = misses_;
+    stats.resets = resets_;
+    stats.sizes = static_cast<uint32_t>(sizes_.size());
+    for (const auto &pair : sizes_)
+    {
+        const SizeCache &cache = *pair.second;
+        stats.glyphs += static_cast<uint32_t>(cache.glyphs.size());
+        stats.atlasBytes += cache.coverage.size();
+        stats.usedPixels += cache.usedPixels;
+    }
+    return stats;
+}
@@ -0,0 +1,413 @@
+#include "vector_path.h"
+#include <algorithm>
+#include <cmath>
+
+// Wang's formula bound, so a runaway control point can't explode a curve
+static const uint32_t PATH_MAX_CURVE_SEGMENTS = 1024;
+// arcs of round joins and caps
+static const int PATH_MAX_ARC_SEGMENTS = 256;
+
+bool FlatPath::Bounds(float &minX, float &minY, float &maxX, float &maxY) const
+{
+    if (xy.empty())
+        return false;
+    minX = maxX = xy[0];
+    minY = maxY = xy[1];
+    for (size_t i = 2; i < xy.size(); i += 2)
+    {
+        minX = std::min(minX, xy[i]);
+        maxX = std::max(maxX, xy[i]);
+        minY = std::min(minY, xy[i + 1]);
+        maxY = std::max(maxY, xy[i + 1]);
+    }
+    return true;
+}
+
+bool VectorPath::Parse(const float *commands, size_t count, std::string &error)
+{
+    static const size_t kArgs[] = {2, 2, 4, 6, 0};
+
+    verbs_.clear();
+    points_.clear();
+    bool started = false;
+    size_t i = 0;
+    while (i < count)
+    {
+        float op = commands[i];
+        if (!(op >= 0.0f && op <= static_cast<float>(PATH_CLOSE)) || op != std::floor(op))
+        {
+            error = "unknown path command " + std::to_string(op) + " at index " + std::to_string(i);
+            return false;
+        }
+        uint32_t verb = static_cast<uint32_t>(op);
+        size_t args = kArgs[verb];
+        if (count - i - 1 < args)
+        {
+            error = "truncated path command at index " + std::to_string(i);
+            return false;
+        }
+
+        const float *p = commands + i + 1;
+        for (size_t a = 0; a < args; a++)
+        {
+            if (!std::isfinite(p[a]))
+            {
+                error = "non-finite path coordinate at index " + std::to_string(i + 1 + a);
+                return false;
+            }
+        }
+
+        if (verb == PATH_CLOSE)
+        {
+            if (started)
+                verbs_.push_back(PATH_CLOSE);
+        }
+        else
+        {
+            if (verb != PATH_MOVE && !started)
+            {
+                verbs_.push_back(PATH_MOVE);
+                points_.insert(points_.end(), p, p + 2);
+            }
+            verbs_.push_back(static_cast<uint8_t>(verb));
+            points_.insert(points_.end(), p, p + args);
+            started = true;
+        }
+        i += 1 + args;
+    }
+    return true;
+}
+
+// segments for a curve whose second differences reach `spread` (already
+// scaled by Wang's degree factor)
+static uint32_t CurveSegments(float spread, float tolerance)
+{
+    float n = std::ceil(std::sqrt(spread / tolerance));
+    if (!(n >= 1.0f))
+        return 1;
+    return static_cast<uint32_t>(std::min(n, static_cast<float>(PATH_MAX_CURVE_SEGMENTS)));
+}
+
+void VectorPath::Flatten(const PathTransform &t, float tolerance, FlatPath &out) const
+{
+    out.xy.clear();
+    out.counts.clear();
+    out.closed.clear();
+    tolerance = std::max(tolerance, 0.01f);
+
+    size_t contourStart = 0; // first point of the open contour
+    bool open = false;
+    float startX = 0.0f, startY = 0.0f;
+    float curX = 0.0f, curY = 0.0f;
+
+    auto addPoint = [&](float x, float y)
+    {
+        size_t n = out.xy.size();
+        if (n / 2 > contourStart)
+        {
+            float dx = x - out.xy[n - 2];
+            float dy = y - out.xy[n - 1];
+            if (dx * dx + dy * dy < 1e-8f)
+                return; // zero-length segments have no direction to stroke
+        }
+        out.xy.push_back(x);
+        out.xy.push_back(y);
+        curX = x;
+        curY = y;
+    };
+
+    auto finish = [&](bool closed)
+    {
+        if (!open)
+            return;
+        size_t n = out.xy.size() / 2 - contourStart;
+        if (closed && n >= 2)
+        {
+            // the closing edge is implied, drop a last point sitting on the first
+            float dx = out.xy[out.xy.size() - 2] - out.xy[contourStart * 2];
+            float dy = out.xy[out.xy.size() - 1] - out.xy[contourStart * 2 + 1];
+            if (dx * dx + dy * dy < 1e-8f)
+            {
+                out.xy.resize(out.xy.size() - 2);
+                n--;
+            }
+        }
+        if (n >= 2)
+        {
+            out.counts.push_back(static_cast<uint32_t>(n));
+            out.closed.push_back(closed ? 1 : 0);
+        }
+        else
+        {
+            out.xy.resize(contourStart * 2);
+        }
+        contourStart = out.xy.size() / 2;
+        open = false;
+    };
+
+    auto map = [&](const float *p, float &x, float &y)
+    {
+        x = t.a * p[0] + t.c * p[1] + t.e;
+        y = t.b * p[0] + t.d * p[1] + t.f;
+    };
+
+    const float *p = points_.data();
+    for (uint8_t verb : verbs_)
+    {
+        switch (verb)
+        {
+        case PATH_MOVE:
+        {
+            finish(false);
+            float x, y;
+            map(p, x, y);
+            startX = x;
+            startY = y;
+            open = true;
+            addPoint(x, y);
+            p += 2;
+            break;
+        }
+        case PATH_LINE:
+        {
+            float x, y;
+            map(p, x, y);
+            addPoint(x, y);
+            p += 2;
+            break;
+        }
+        case PATH_QUAD:
+        {
+            float cx, cy, ex, ey;
+            map(p, cx, cy);
+            map(p + 2, ex, ey);
+            float x0 = curX, y0 = curY;
+            float spread = 0.25f * std::hypot(x0 - 2.0f * cx + ex, y0 - 2.0f * cy + ey);
+            uint32_t n = CurveSegments(spread, tolerance);
+            for (uint32_t k = 1; k <= n; k++)
+            {
+                float u = static_cast<float>(k) / n;
+                float v = 1.0f - u;
+                addPoint(v * v * x0 + 2.0f * v * u * cx + u * u * ex,
+                         v * v * y0 + 2.0f * v * u * cy + u * u * ey);
+            }
+            p += 4;
+            break;
+        }
+        case PATH_CUBIC:
+        {
+            float c1x, c1y, c2x, c2y, ex, ey;
+            map(p, c1x, c1y);
+            map(p + 2, c2x, c2y);
+            map(p + 4, ex, ey);
+            float x0 = curX, y0 = curY;
+            float dd = std::max(std::hypot(x0 - 2.0f * c1x + c2x, y0 - 2.0f * c1y + c2y),
+                                std::hypot(c1x - 2.0f * c2x + ex, c1y - 2.0f * c2y + ey));
+            uint32_t n = CurveSegments(0.75f * dd, tolerance);
+            for (uint32_t k = 1; k <= n; k++)
+            {
+                float u = static_cast<float>(k) / n;
+                float v = 1.0f - u;
+                float w0 = v * v * v, w1 = 3.0f * v * v * u, w2 = 3.0f * v * u * u, w3 = u * u * u;
+                addPoint(w0 * x0 + w1 * c1x + w2 * c2x + w3 * ex,
+                         w0 * y0 + w1 * c1y + w2 * c2y + w3 * ey);
+            }
+            p += 6;
+            break;
+        }
+        case PATH_CLOSE:
+            finish(true);
+            // drawing on after a close starts a new contour at the same point
+            open = true;
+            addPoint(startX, startY);
+            break;
+        }
+    }
+    finish(false);
+}
+
+void AddFillEdges(const FlatPath &path, float originX, float originY, CoverageRasterizer &raster)
+{
+    size_t first = 0;
+    for (uint32_t n : path.counts)
+    {
+        const float *pts = path.xy.data() + first * 2;
+        for (uint32_t i = 0; i < n; i++)
+        {
+            uint32_t j = i + 1 == n ? 0 : i + 1;
+            raster.AddLine(pts[i * 2] - originX, pts[i * 2 + 1] - originY, pts[j * 2] - originX, pts[j * 2 + 1] - originY);
+        }
+        first += n;
+    }
+}
+
+// closed polygon, always added with positive winding so pieces union
+static void AddPiece(CoverageRasterizer &raster, const float *xy, int n, float ox, float oy)
+{
+    float area = 0.0f;
+    for (int i = 0; i < n; i++)
+    {
+        int j = i + 1 == n ? 0 : i + 1;
+        area += xy[i * 2] * xy[j * 2 + 1] - xy[j * 2] * xy[i * 2 + 1];
+    }
+    if (!(area != 0.0f))
+        return;
+
+    for (int i = 0; i < n; i++)
+    {
+        int j = i + 1 == n ? 0 : i + 1;
+        if (area > 0.0f)
+            raster.AddLine(xy[i * 2] - ox, xy[i * 2 + 1] - oy, xy[j * 2] - ox, xy[j * 2 + 1] - oy);
+        else
+            raster.AddLine(xy[j * 2] - ox, xy[j * 2 + 1] - oy, xy[i * 2] - ox, xy[i * 2 + 1] - oy);
+    }
+}
+
+// pie slice at (cx, cy) from offset (ux, uy), turning by angle radians
+static void AddArcPiece(CoverageRasterizer &raster, float cx, float cy, float ux, float uy, float angle,
+                        float radius, float tolerance, float ox, float oy)
+{
+    // the chord of each step may sag by at most the tolerance
+    float c = 1.0f - tolerance / radius;
+    float step = c > -1.0f ? 2.0f * std::acos(c) : 3.14159265f;
+    step = std::min(step, 3.14159265f / 2.0f);
+    int k = std::max(1, static_cast<int>(std::ceil(std::fabs(angle) / step)));
+    k = std::min(k, PATH_MAX_ARC_SEGMENTS);
+
+    thread_local std::vector<float> pts;
+    pts.assign({cx, cy});
+    for (int i = 0; i <= k; i++)
+    {
+        float a = angle * i / k;
+        float cs = std::cos(a), sn = std::sin(a);
+        pts.push_back(cx + ux * cs - uy * sn);
+        pts.push_back(cy + ux * sn + uy * cs);
+    }
+    AddPiece(raster, pts.data(), k + 2, ox, oy);
+}
+
+// fills the gap on the outer side of the turn at v, from direction d0 to d1
+static void AddJoin(CoverageRasterizer &raster, const StrokeStyle &style, float hw, float tolerance,
+                    float vx, float vy, float d0x, float d0y, float d1x, float d1y, float ox, float oy)
+{
+    float cross = d0x * d1y - d0y * d1x;
+    float dot = d0x * d1x + d0y * d1y;
+    if (std::fabs(cross) < 1e-6f && dot > 0.0f)
+        return; // straight on
+
+    // offsets on the side away from the turn; they rotate with the direction
+    float side = cross > 0.0f ? -hw : hw;
+    float o0x = -d0y * side, o0y = d0x * side;
+    float o1x = -d1y * side, o1y = d1x * side;
+    float theta = std::atan2(cross, dot);
+
+    if (style.join == JOIN_ROUND)
+    {
+        AddArcPiece(raster, vx, vy, o0x, o0y, theta, hw, tolerance, ox, oy);
+        return;
+    }
+
+    if (style.join == JOIN_MITER)
+    {
+        float cosHalf = std::cos(theta * 0.5f);
+        if (cosHalf > 1e-4f && 1.0f / cosHalf <= style.miterLimit)
+        {
+            float mx = o0x + o1x, my = o0y + o1y;
+            float scale = hw / (cosHalf * std::hypot(mx, my));
+            const float quad[8] = {vx, vy, vx + o0x, vy + o0y, vx + mx * scale, vy + my * scale, vx + o1x, vy + o1y};
+            AddPiece(raster, quad, 4, ox, oy);
+            return;
+        }
+    }
+
+    const float bevel[6] = {vx, vy, vx + o0x, vy + o0y, vx + o1x, vy + o1y};
+    AddPiece(raster, bevel, 3, ox, oy);
+}
+
+void AddStrokeEdges(const FlatPath &path, const StrokeStyle &style, float tolerance,
+                    float originX, float originY, CoverageRasterizer &raster)
+{
+    float hw = style.width * 0.5f;
+    if (!(hw > 0.0f))
+        return;
+    tolerance = std::max(tolerance, 0.01f);
+
+    auto direction = [](const float *a, const float *b, float &dx, float &dy)
+    {
+        dx = b[0] - a[0];
+        dy = b[1] - a[1];
+        float len = std::hypot(dx, dy);
+        dx /= len;
+        dy /= len;
+    };
+
+    size_t first = 0;
+    for (size_t c = 0; c < path.counts.size(); c++)
+    {
+        const uint32_t n = path.counts[c];
+        const float *pts = path.xy.data() + first * 2;
+        const bool closed = path.closed[c] != 0;
+        first += n;
+
+        // one quad per segment
+        uint32_t segments = closed ? n : n - 1;
+        for (uint32_t i = 0; i < segments; i++)
+        {
+            const float *a = pts + i * 2;
+            const float *b = pts + (i + 1 == n ? 0 : i + 1) * 2;
+            float dx, dy;
+            direction(a, b, dx, dy);
+            float nx = -dy * hw, ny = dx * hw;
+            const float quad[8] = {a[0] + nx, a[1] + ny, b[0] + nx, b[1] + ny,
+                                   b[0] - nx, b[1] - ny, a[0] - nx, a[1] - ny};
+            AddPiece(raster, quad, 4, originX, originY);
+        }
+
+        // joins at every vertex with a segment on both sides
+        for (uint32_t j = closed ? 0 : 1; j < (closed ? n : n - 1); j++)
+        {
+            const float *prev = pts + (j == 0 ? n - 1 : j - 1) * 2;
+            const float *v = pts + j * 2;
+            const float *next = pts + (j + 1 == n ? 0 : j + 1) * 2;
+            float d0x, d0y, d1x, d1y;
+            direction(prev, v, d0x, d0y);
+            direction(v, next, d1x, d1y);
+            AddJoin(raster, style, hw, tolerance, v[0], v[1], d0x, d0y, d1x, d1y, originX, originY);
+        }
+
+        if (closed || style.cap == CAP_BUTT)
+            continue;
+
+        // caps: start faces back along the first segment, end forward along the last
+        for (int end = 0; end < 2; end++)
+        {
+            const float *p = end ? pts + (n - 1) * 2 : pts;
+            float dx, dy;
+            if (end)
+                direction(pts + (n - 2) * 2, p, dx, dy);
+            else
+                direction(p, pts + 2, dx, dy);
+            float nx = -dy * hw, ny = dx * hw;
+            if (style.cap == CAP_ROUND)
+            {
+                AddArcPiece(raster, p[0], p[1], nx, ny, end ? -3.14159265f : 3.14159265f, hw, tolerance, originX, originY);
+                continue;
+            }
+            float ex = (end ? dx : -dx) * hw, ey = (end ? dy : -dy) * hw;
+            const float square[8] = {p[0] + nx, p[1] + ny, p[0] + nx + ex, p[1] + ny + ey,
+                                     p[0] - nx + ex, p[1] - ny + ey, p[0] - nx, p[1] - ny};
+            AddPiece(raster, square, 4, originX, originY);
+        }
+    }
+}
+
+float StrokeReach(const StrokeStyle &style)
+{
+    float hw = std::max(style.width * 0.5f, 0.0f);
+    float reach = hw;
+    if (style.join == JOIN_MITER)
+        reach = hw * std::max(style.miterLimit, 1.0f);
+    if (style.cap == CAP_SQUARE)
+        reach = std::max(reach, hw * 1.41421356f);
+    return reach;
+}
@@ -0,0 +1,90 @@
+#include "worker_pool.h"
+
+WorkerPool::WorkerPool(unsigned threads)
+{
+    if (threads == 0)
+    {
+        unsigned hw = std::thread::hardware_concurrency();
+        threads = hw > 1 ? hw - 1 : 0;
+    }
+
+    for (unsigned i = 0; i < threads; i++)
+        workers_.emplace_back(&WorkerPool::WorkerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    wake_cv_.notify_all();
+    for (std::thread &t : workers_)
+        t.join();
+}
+
+// pulls indices until the current job runs dry
+void WorkerPool::RunJobs()
+{
+    for (size_t i = next_.fetch_add(1, std::memory_order_relaxed); i < job_count_;
+         i = next_.fetch_add(1, std::memory_order_relaxed))
+        (*job_)(i);
+}
+
+void WorkerPool::WorkerLoop()
+{
+    uint64_t seen = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_cv_.wait(lock, [&]
+                          { return stop_ || generation_ != seen; });
+            if (stop_)
+                return;
+            seen = generation_;
+            active_++;
+        }
+
+        RunJobs();
+
+        // the submitter waits for every worker to leave before the job goes out of scope
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--active_ == 0)
+            done_cv_.notify_all();
+    }
+}
+
+void WorkerPool::ParallelFor(size_t count, const std::function<void(size_t)> &fn)
+{
+    if (count == 0)
+        return;
+
+    if (workers_.empty() || count == 1)
+    {
+        for (size_t i = 0; i < count; i++)
+            fn(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(submit_mutex_);
+    {
+        // a worker that woke late for the previous job may still be draining it
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [&]
+                      { return active_ == 0; });
+        job_ = &fn;
+        job_count_ = count;
+        next_.store(0, std::memory_order_relaxed);
+        generation_++;
+    }
+    wake_cv_.notify_all();
+
+    RunJobs();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&]
+                  { return active_ == 0; });
+    job_ = nullptr;
+    job_count_ = 0;
+}
@@ -0,0 +1,122 @@
+// Checks ApplyImageFilter with real worker threads against a single-threaded
+// run and a brute-force box blur. Returns non-zero on the first mismatch.
+#include "image_filter.h"
+#include "worker_pool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what)
+{
+    if (!ok)
+    {
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static std::vector<uint8_t> Noise(uint32_t w, uint32_t h, bool opaque)
+{
+    std::vector<uint8_t> px(static_cast<size_t>(w) * h * 4);
+    uint32_t seed = 12345;
+    for (size_t i = 0; i < px.size(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        px[i] = static_cast<uint8_t>(seed >> 24);
+        if (opaque && i % 4 == 3)
+            px[i] = 255;
+    }
+    return px;
+}
+
+static std::vector<uint8_t> Run(const ImageFilter &filter, const std::vector<uint8_t> &in, uint32_t w, uint32_t h,
+                                WorkerPool &pool, bool inPlace)
+{
+    std::vector<uint8_t> src = in;
+    std::vector<uint8_t> dst(in.size());
+    FilterImage s = {src.data(), w * 4, w, h};
+    FilterImage d = {inPlace ? src.data() : dst.data(), w * 4, w, h};
+    Check(ApplyImageFilter(filter, s, d, pool), "ApplyImageFilter returned false");
+    return inPlace ? src : dst;
+}
+
+// box blur of an opaque image with clamped edges, straight from the definition
+static std::vector<uint8_t> BruteBox(const std::vector<uint8_t> &in, uint32_t w, uint32_t h, int r)
+{
+    std::vector<float> tmp(in.size());
+    std::vector<uint8_t> out(in.size());
+    for (uint32_t y = 0; y < h; y++)
+        for (uint32_t x = 0; x < w; x++)
+            for (int c = 0; c < 4; c++)
+            {
+                float sum = 0.0f;
+                for (int k = -r; k <= r; k++)
+                {
+                    int sx = std::min(std::max(static_cast<int>(x) + k, 0), static_cast<int>(w) - 1);
+                    sum += in[(static_cast<size_t>(y) * w + sx) * 4 + c];
+                }
+                tmp[(static_cast<size_t>(y) * w + x) * 4 + c] = sum / (2 * r + 1);
+            }
+    for (uint32_t y = 0; y < h; y++)
+        for (uint32_t x = 0; x < w; x++)
+            for (int c = 0; c < 4; c++)
+            {
+                float sum = 0.0f;
+                for (int k = -r; k <= r; k++)
+                {
+                    int sy = std::min(std::max(static_cast<int>(y) + k, 0), static_cast<int>(h) - 1);
+                    sum += tmp[(static_cast<size_t>(sy) * w + x) * 4 + c];
+                }
+                out[(static_cast<size_t>(y) * w + x) * 4 + c] = static_cast<uint8_t>(sum / (2 * r + 1) + 0.5f);
+            }
+    return out;
+}
+
+static bool Near(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b, int tolerance)
+{
+    for (size_t i = 0; i < a.size(); i++)
+        if (std::abs(a[i] - b[i]) > tolerance)
+            return false;
+    return true;
+}
+
+int main()
+{
+    WorkerPool serial(0);
+    WorkerPool parallel(4); // real worker threads, whatever the machine has
+    const uint32_t w = 157, h = 113; // several bands, odd sizes
+
+    std::vector<uint8_t> opaque = Noise(w, h, true);
+    std::vector<uint8_t> mixed = Noise(w, h, false);
+
+    ImageFilter box;
+    box.type = FILTER_BOX_BLUR;
+    box.radius = 3.0f;
+    ImageFilter gaussian;
+    gaussian.type = FILTER_GAUSSIAN_BLUR;
+    gaussian.radius = 2.5f;
+    ImageFilter sharpen;
+    sharpen.type = FILTER_CONVOLVE;
+    sharpen.size = 3;
+    const float kernel[9] = {0, -1, 0, -1, 5, -1, 0, -1, 0};
+    std::memcpy(sharpen.kernel, kernel, sizeof(kernel));
+
+    for (const ImageFilter *filter : {&box, &gaussian, &sharpen})
+    {
+        for (bool inPlace : {false, true})
+        {
+            std::vector<uint8_t> a = Run(*filter, mixed, w, h, serial, inPlace);
+            std::vector<uint8_t> b = Run(*filter, mixed, w, h, parallel, inPlace);
+            Check(a == b, "worker threads change the result");
+        }
+    }
+
+    Check(Near(Run(box, opaque, w, h, parallel, false), BruteBox(opaque, w, h, 3), 1), "box blur differs from brute force");
+
+    if (failures == 0)
+        std::printf("image_filter_test: ok\n");
+    return failures ? 1 : 0;
+}
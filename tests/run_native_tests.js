@@ -0,0 +1,12 @@
+// runs the native test executable built next to the addon by node-gyp
+const { spawnSync } = require("child_process");
+const path = require("path");
+
+const exe = path.join(__dirname, "..", "build", "Release",
+    process.platform === "win32" ? "native_tests.exe" : "native_tests");
+const result = spawnSync(exe, { stdio: "inherit" });
+if (result.error) {
+    console.error(`can't run ${exe}: ${result.error.message} (build with npm run build first)`);
+    process.exit(1);
+}
+process.exit(result.status);